@@ -0,0 +1,224 @@
+#ifndef ALLOC_TRACE_H
+#define ALLOC_TRACE_H
+
+#include <Arduino.h>
+#include <esp_rom_sys.h>
+
+// ===== TRAÇAGE DES ALLOCATIONS DU TAS =====
+// Avec -Wl,--wrap=malloc,--wrap=free,--wrap=realloc,--wrap=calloc
+// (platformio.ini), chaque malloc/free du firmware, des libs et du core
+// (String, new, ArduinoJson hors arène...) passe ici.
+// - Tâche loop: comptée par sous-système (étiquette posée par AllocScope
+//   autour des services de loop()) et par itération de loop().
+// - Autres tâches (USB CDC, UART, timers, lwIP...): un compteur commun.
+// - Section chaude (AllocHotSection): chemins servis à chaque itération, qui
+//   ne doivent pas allouer. Une allocation y est comptée avec l'adresse de
+//   l'appelant (addr2line). Avec -DALLOC_TRAP=1: message sur la console ROM
+//   puis abort() (backtrace dans le moniteur série).
+// Rien n'est compté avant allocTraceBegin(), ni sans l'option de l'éditeur
+// de liens (allocTrace.active reste à 0). heap_caps_malloc() appelé
+// directement (pilotes IDF) n'est pas vu.
+
+#ifndef ALLOC_TRAP
+#define ALLOC_TRAP 0
+#endif
+
+enum AllocTag : uint8_t {
+  ALLOC_TAG_BOOT = 0,                      // setup()
+  ALLOC_TAG_LOOP,                          // loop() hors sous-système
+  ALLOC_TAG_NET,                           // lien, IRQ W5500, DHCP, UDP, liens entre cartes
+  ALLOC_TAG_HTTP,
+  ALLOC_TAG_MQTT,
+  ALLOC_TAG_MODBUS,                        // TCP et RTU
+  ALLOC_TAG_IO,                            // entrées, capteurs
+  ALLOC_TAG_LOG,
+  ALLOC_TAG_STORE,                         // écritures NVS / SPIFFS
+  ALLOC_TAG_SERIAL,                        // commandes série
+  ALLOC_TAG_COUNT
+};
+
+static const char *const ALLOC_TAG_NAMES[ALLOC_TAG_COUNT] = {
+  "boot", "loop", "net", "http", "mqtt", "modbus", "io", "log", "store", "serial",
+};
+
+struct AllocTagStats {
+  uint32_t allocs;                         // malloc, calloc, realloc (hors libération)
+  uint32_t frees;
+  uint32_t bytes;                          // octets demandés
+};
+
+struct AllocTrace {
+  TaskHandle_t task;                       // tâche loop (nullptr: traçage arrêté)
+  bool active;                             // option de l'éditeur de liens présente
+  uint8_t tag;
+  uint8_t hot;                             // profondeur des sections chaudes
+  uint8_t hotTag;                          // étiquette de la dernière allocation en section chaude
+  uint32_t total;                          // allocations de la tâche loop
+  AllocTagStats tags[ALLOC_TAG_COUNT];
+  uint32_t otherAllocs;                    // autres tâches
+  uint32_t otherFrees;
+  uint32_t hotAllocs;
+  uintptr_t hotCaller;
+  // Itérations de loop() (depuis la dernière remise à zéro)
+  bool marked;                             // repère posé (première itération)
+  uint32_t iterations;
+  uint32_t iterMark;                       // total au début de l'itération
+  uint32_t iterLast;
+  uint32_t iterMax;
+  uint32_t iterDirty;                      // itérations avec au moins une allocation
+  uint32_t resetMs;
+};
+
+AllocTrace allocTrace = {};
+
+// Le compilateur suppose que malloc/free ne lisent ni n'écrivent les
+// globales: sans barrière, l'étiquette posée juste avant un malloc en ligne
+// (String, new) pourrait être écrite après lui, ou pas du tout.
+static inline void allocTraceBarrier() {
+  __asm__ __volatile__("" ::: "memory");
+}
+
+// Sous-système des allocations qui suivent (services successifs de loop())
+static inline void allocTag(uint8_t tag) {
+  allocTrace.tag = tag;
+  allocTraceBarrier();
+}
+
+// Sous-système courant de la tâche loop, restauré en sortie de portée
+struct AllocScope {
+  uint8_t saved;
+  explicit AllocScope(uint8_t tag) : saved(allocTrace.tag) {
+    allocTrace.tag = tag;
+    allocTraceBarrier();
+  }
+  ~AllocScope() {
+    allocTraceBarrier();
+    allocTrace.tag = saved;
+  }
+};
+
+// Section où toute allocation est une régression (on = false: sans effet)
+struct AllocHotSection {
+  bool on;
+  explicit AllocHotSection(bool enable = true) : on(enable) {
+    if (on) allocTrace.hot++;
+    allocTraceBarrier();
+  }
+  ~AllocHotSection() {
+    allocTraceBarrier();
+    if (on) allocTrace.hot--;
+  }
+};
+
+static inline bool allocTraceMine() {
+  return allocTrace.task != nullptr && !xPortInIsrContext() && xTaskGetCurrentTaskHandle() == allocTrace.task;
+}
+
+static void allocTraceOnAlloc(size_t n, void *caller) {
+  if (!allocTrace.task) return;
+  if (!allocTraceMine()) {
+    __atomic_fetch_add(&allocTrace.otherAllocs, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  AllocTagStats &t = allocTrace.tags[allocTrace.tag];
+  t.allocs++;
+  t.bytes += (uint32_t)n;
+  allocTrace.total++;
+  if (allocTrace.hot) {
+    allocTrace.hotAllocs++;
+    allocTrace.hotCaller = (uintptr_t)caller;
+    allocTrace.hotTag = allocTrace.tag;
+#if ALLOC_TRAP
+    esp_rom_printf("\nALLOC_TRAP: %u octets (%s), appelant %p\n", (unsigned)n, ALLOC_TAG_NAMES[allocTrace.tag], caller);
+    abort();
+#endif
+  }
+}
+
+static void allocTraceOnFree() {
+  if (!allocTrace.task) return;
+  if (!allocTraceMine()) {
+    __atomic_fetch_add(&allocTrace.otherFrees, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  allocTrace.tags[allocTrace.tag].frees++;
+}
+
+extern "C" void *__real_malloc(size_t n);
+extern "C" void __real_free(void *p);
+extern "C" void *__real_realloc(void *p, size_t n);
+extern "C" void *__real_calloc(size_t count, size_t size);
+
+extern "C" void *__wrap_malloc(size_t n) {
+  allocTraceOnAlloc(n, __builtin_return_address(0));
+  return __real_malloc(n);
+}
+
+extern "C" void __wrap_free(void *p) {
+  if (p) allocTraceOnFree();
+  __real_free(p);
+}
+
+// realloc(p, 0) libère; un changement de taille compte comme une allocation
+extern "C" void *__wrap_realloc(void *p, size_t n) {
+  if (n == 0) {
+    if (p) allocTraceOnFree();
+  } else {
+    allocTraceOnAlloc(n, __builtin_return_address(0));
+  }
+  return __real_realloc(p, n);
+}
+
+extern "C" void *__wrap_calloc(size_t count, size_t size) {
+  allocTraceOnAlloc(count * size, __builtin_return_address(0));
+  return __real_calloc(count, size);
+}
+
+// setup(), depuis la tâche loop. Un malloc d'essai vérifie que l'option de
+// l'éditeur de liens est présente. Le premier printf d'un flottant alloue
+// les tampons de conversion de newlib (gardés ensuite par la tâche): fait
+// ici pour qu'il ne tombe pas dans une section chaude.
+void allocTraceBegin() {
+  allocTrace.task = xTaskGetCurrentTaskHandle();
+  allocTrace.tag = ALLOC_TAG_BOOT;
+  uint32_t before = allocTrace.total;
+  void *volatile probe = malloc(8);
+  free(probe);
+  allocTraceBarrier();
+  allocTrace.active = allocTrace.total != before;
+  char warm[24];
+  snprintf(warm, sizeof(warm), "%.1f %.2f", 21.5, 1013.25);
+}
+
+// Compteurs par sous-système et par itération remis à zéro (GET /api/mem?reset=1)
+void allocTraceReset() {
+  memset(allocTrace.tags, 0, sizeof(allocTrace.tags));
+  allocTrace.otherAllocs = 0;
+  allocTrace.otherFrees = 0;
+  allocTrace.hotAllocs = 0;
+  allocTrace.hotCaller = 0;
+  allocTrace.marked = false;
+  allocTrace.iterations = 0;
+  allocTrace.iterLast = 0;
+  allocTrace.iterMax = 0;
+  allocTrace.iterDirty = 0;
+  allocTrace.resetMs = millis();
+}
+
+// Début de loop(): bilan de l'itération précédente. La première (après le
+// démarrage ou une remise à zéro) ne fait que poser le repère.
+void allocTraceIteration() {
+  uint32_t n = allocTrace.total - allocTrace.iterMark;
+  allocTrace.iterMark = allocTrace.total;
+  allocTrace.tag = ALLOC_TAG_LOOP;
+  if (!allocTrace.marked) {
+    allocTrace.marked = true;
+    return;
+  }
+  allocTrace.iterations++;
+  allocTrace.iterLast = n;
+  if (n > allocTrace.iterMax) allocTrace.iterMax = n;
+  if (n) allocTrace.iterDirty++;
+}
+
+#endif // ALLOC_TRACE_H
@@ -0,0 +1,102 @@
+#ifndef CONFIG_BLOB_H
+#define CONFIG_BLOB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ===== INSTANTANÉ BINAIRE DE LA CONFIGURATION (NVS) =====
+// Source de la config au démarrage: un bloc lu d'un coup en NVS, sans montage
+// SPIFFS ni analyse JSON. /config.json ne sert plus qu'à l'import (migration,
+// `config import`) et à l'export (réécrit à chaque sauvegarde, GET
+// /api/config_raw).
+// En-tête puis données: les champs de la table de config_schema.h, à la
+// suite, dans l'ordre de la table. L'empreinte de la table (clés, types,
+// tailles) est dans l'en-tête: ajouter ou modifier un champ rend l'ancien
+// instantané invalide et /config.json est réimporté.
+// Aucune dépendance Arduino.
+
+#define CONFIG_BLOB_MAGIC 0x57384346UL   // "FC8W" en mémoire
+#define CONFIG_BLOB_VERSION 2            // format de l'en-tête
+
+struct ConfigBlobHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;                         // octets de données après l'en-tête
+  uint32_t schema;                       // empreinte de la table des champs
+  uint32_t crc;                          // CRC-32 des données
+};
+
+enum ConfigBlobStatus : uint8_t {
+  CFG_BLOB_OK = 0,
+  CFG_BLOB_MISSING,                      // jamais écrit (première mise à jour)
+  CFG_BLOB_SIZE,                         // taille stockée différente
+  CFG_BLOB_MAGIC,
+  CFG_BLOB_VERSION,                      // en-tête d'un autre firmware
+  CFG_BLOB_SCHEMA,                       // table des champs modifiée
+  CFG_BLOB_CRC,                          // écriture interrompue ou flash corrompue
+};
+
+static inline const char *configBlobStatusName(ConfigBlobStatus s) {
+  switch (s) {
+    case CFG_BLOB_OK: return "ok";
+    case CFG_BLOB_MISSING: return "missing";
+    case CFG_BLOB_SIZE: return "size";
+    case CFG_BLOB_MAGIC: return "magic";
+    case CFG_BLOB_VERSION: return "version";
+    case CFG_BLOB_SCHEMA: return "schema";
+    default: return "crc";
+  }
+}
+
+// CRC-32 IEEE (celui de zlib), table de 16 entrées: 64 octets de flash
+static inline uint32_t configCrc32(const void *data, size_t len, uint32_t crc = 0) {
+  static const uint32_t T[16] = {
+    0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL, 0x76DC4190UL, 0x6B6B51F4UL,
+    0x4DB26158UL, 0x5005713CUL, 0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+    0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL,
+  };
+  const uint8_t *p = (const uint8_t *)data;
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= p[i];
+    crc = (crc >> 4) ^ T[crc & 0x0F];
+    crc = (crc >> 4) ^ T[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+// blob = en-tête + dataLen octets de données déjà remplies
+static inline void configBlobSeal(uint8_t *blob, size_t dataLen, uint32_t schema) {
+  ConfigBlobHeader h;
+  h.magic = CONFIG_BLOB_MAGIC;
+  h.version = CONFIG_BLOB_VERSION;
+  h.size = (uint16_t)dataLen;
+  h.schema = schema;
+  h.crc = configCrc32(blob + sizeof(h), dataLen);
+  memcpy(blob, &h, sizeof(h));
+}
+
+// len = taille lue en NVS (0 = clé absente), dataLen = taille attendue des données
+static inline ConfigBlobStatus configBlobCheck(const uint8_t *blob, size_t len, size_t dataLen, uint32_t schema) {
+  if (len == 0) return CFG_BLOB_MISSING;
+  ConfigBlobHeader h;
+  if (len < sizeof(h)) return CFG_BLOB_SIZE;
+  memcpy(&h, blob, sizeof(h));
+  if (h.magic != CONFIG_BLOB_MAGIC) return CFG_BLOB_MAGIC;
+  if (h.version != CONFIG_BLOB_VERSION) return CFG_BLOB_VERSION;
+  if (h.schema != schema) return CFG_BLOB_SCHEMA;
+  if (h.size != dataLen || len != sizeof(h) + dataLen) return CFG_BLOB_SIZE;
+  if (configCrc32(blob + sizeof(h), dataLen) != h.crc) return CFG_BLOB_CRC;
+  return CFG_BLOB_OK;
+}
+
+// Copie d'une chaîne de l'instantané, terminée même si la source ne l'est pas
+static inline void configBlobStr(char *dst, size_t dstSize, const char *src, size_t srcSize) {
+  size_t n = strnlen(src, srcSize);
+  if (n >= dstSize) n = dstSize - 1;
+  memcpy(dst, src, n);
+  dst[n] = '\0';
+}
+
+#endif // CONFIG_BLOB_H
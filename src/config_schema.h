@@ -0,0 +1,422 @@
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config_blob.h"
+
+// ===== SCHÉMA DE CONFIGURATION =====
+// Chaque clé de config est décrite une seule fois, dans une table de CfgField
+// (web_config.h: CONFIG_FIELDS): type, bornes, défaut, secret, effet d'une
+// modification, crochet d'application. Tout le reste en est dérivé:
+// - import de /config.json et POST /api/config (validation + différences),
+//   en un seul parcours du document
+// - export /config.json et GET /api/config (secrets masqués)
+// - instantané NVS (config_blob.h): champs à la suite, empreinte de la table
+// - capacité exacte des JsonDocument
+// Ajouter un champ = une ligne de table.
+
+enum CfgType : uint8_t {
+  CFG_BOOL = 0,                            // bool, 0/1 en JSON
+  CFG_U8,
+  CFG_U16,
+  CFG_U32,
+  CFG_FLOAT,
+  CFG_STR,                                 // char[size]
+  CFG_IP,                                  // IPAddress, "a.b.c.d" en JSON
+  CFG_ENUM,                                // nom parmi names, via get/set
+  CFG_LABELS,                              // char[count][size], tableau JSON
+};
+
+// Drapeaux
+#define CFG_SECRET 0x01                    // hors GET (clé "<nom>_set" à la place)
+#define CFG_KEEP_EMPTY 0x02                // une chaîne vide ne remplace pas la valeur
+// Effet d'une modification par POST /api/config
+#define CFG_FX_RESTART 0x10                // pris en compte au redémarrage
+#define CFG_FX_NET 0x20                    // adresse réappliquée à chaud
+#define CFG_FX_MQTT 0x40                   // reconnexion MQTT
+#define CFG_FX_LABELS 0x80                 // routeur de topics / discovery
+
+struct CfgField {
+  const char *key;
+  CfgType type;
+  uint8_t flags;
+  uint16_t size;                           // octets de la valeur (CFG_LABELS: d'un label)
+  void *ptr;                               // variable (nullptr pour CFG_ENUM)
+  float min;                               // bornes des numériques
+  float max;                               // CFG_LABELS: nombre de labels
+  float def;                               // défaut des numériques et CFG_BOOL
+  const char *defStr;                      // défaut CFG_STR/CFG_IP/CFG_ENUM (nullptr: valeur
+                                           // de compilation gardée); CFG_LABELS: préfixe
+  const char *const *names;                // CFG_ENUM: valeurs admises, nullptr en fin
+  const char *(*get)();                    // CFG_ENUM
+  void (*set)(const char *);               // CFG_ENUM
+  void (*apply)();                         // après chaque écriture (import, POST, NVS)
+};
+
+// Lignes de table: le type de la variable est vérifié à la compilation
+static inline constexpr void *cfgVar(bool &v) { return &v; }
+static inline constexpr void *cfgVar(uint8_t &v) { return &v; }
+static inline constexpr void *cfgVar(uint16_t &v) { return &v; }
+static inline constexpr void *cfgVar(uint32_t &v) { return &v; }
+static inline constexpr void *cfgVar(float &v) { return &v; }
+static inline constexpr void *cfgVar(IPAddress &v) { return &v; }
+
+#define CFG_BOOL_F(key, var, def, fl) \
+  {key, CFG_BOOL, fl, 1, cfgVar(var), 0, 1, def, nullptr, nullptr, nullptr, nullptr, nullptr}
+#define CFG_NUM_F(key, type, var, lo, hi, def, fl, hook) \
+  {key, type, fl, sizeof(var), cfgVar(var), lo, hi, def, nullptr, nullptr, nullptr, nullptr, hook}
+#define CFG_STR_F(key, var, def, fl) \
+  {key, CFG_STR, fl, sizeof(var), var, 0, 0, 0, def, nullptr, nullptr, nullptr, nullptr}
+#define CFG_IP_F(key, var, def, fl) \
+  {key, CFG_IP, fl, 4, cfgVar(var), 0, 0, 0, def, nullptr, nullptr, nullptr, nullptr}
+#define CFG_ENUM_F(key, names, get, set, def, fl) \
+  {key, CFG_ENUM, fl, 1, nullptr, 0, 0, 0, def, names, get, set, nullptr}
+#define CFG_LABELS_F(key, var, prefix, fl) \
+  {key, CFG_LABELS, fl, sizeof(var[0]), var, 0, sizeof(var) / sizeof(var[0]), 0, prefix, nullptr, nullptr, nullptr, nullptr}
+
+// Adresse IPv4 stricte: 4 nombres 0..255 séparés par des points
+static bool cfgParseIp(const char *s, IPAddress &out) {
+  if (!s) return false;
+  uint8_t b[4];
+  for (int i = 0; i < 4; i++) {
+    if (*s < '0' || *s > '9') return false;
+    uint16_t v = 0;
+    for (int d = 0; d < 3 && *s >= '0' && *s <= '9'; d++) v = v * 10 + (*s++ - '0');
+    if (v > 255 || (*s >= '0' && *s <= '9')) return false;
+    b[i] = (uint8_t)v;
+    if (i < 3 && *s++ != '.') return false;
+  }
+  if (*s != '\0') return false;
+  out = IPAddress(b[0], b[1], b[2], b[3]);
+  return true;
+}
+
+static int cfgEnumIndex(const CfgField &f, const char *name) {
+  if (!name) return -1;
+  for (int i = 0; f.names[i]; i++) {
+    if (strcmp(f.names[i], name) == 0) return i;
+  }
+  return -1;
+}
+
+static uint8_t cfgLabelCount(const CfgField &f) {
+  return (uint8_t)f.max;
+}
+
+// Recherche à partir du champ suivant le précédent trouvé: un document
+// écrit par cfgToJson (ordre de la table) se lit en une comparaison par clé
+static const CfgField *cfgFind(const CfgField *t, size_t n, const char *key, size_t &cursor) {
+  for (size_t k = 0; k < n; k++) {
+    size_t i = (cursor + k) % n;
+    if (strcmp(t[i].key, key) == 0) {
+      cursor = i + 1;
+      return &t[i];
+    }
+  }
+  return nullptr;
+}
+
+// ----- Valeurs par défaut -----
+static void cfgSetDefaults(const CfgField *t, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    const CfgField &f = t[i];
+    switch (f.type) {
+      case CFG_BOOL: *(bool *)f.ptr = f.def != 0; break;
+      case CFG_U8: *(uint8_t *)f.ptr = (uint8_t)f.def; break;
+      case CFG_U16: *(uint16_t *)f.ptr = (uint16_t)f.def; break;
+      case CFG_U32: *(uint32_t *)f.ptr = (uint32_t)f.def; break;
+      case CFG_FLOAT: *(float *)f.ptr = f.def; break;
+      case CFG_STR:
+        if (f.defStr) strlcpy((char *)f.ptr, f.defStr, f.size);
+        break;
+      case CFG_IP:
+        if (f.defStr) cfgParseIp(f.defStr, *(IPAddress *)f.ptr);
+        break;
+      case CFG_ENUM:
+        if (f.defStr) f.set(f.defStr);
+        break;
+      case CFG_LABELS:
+        for (uint8_t k = 0; k < cfgLabelCount(f); k++) {
+          snprintf((char *)f.ptr + k * f.size, f.size, "%s%u", f.defStr, (unsigned)(k + 1));
+        }
+        break;
+    }
+    if (f.apply) f.apply();
+  }
+}
+
+// ----- Validation -----
+// nullptr si v est acceptable pour f, sinon la raison
+static const char *cfgCheck(const CfgField &f, JsonVariantConst v) {
+  switch (f.type) {
+    case CFG_BOOL:
+      return (v.is<bool>() || v.is<int>()) ? nullptr : "type";
+    case CFG_U8:
+    case CFG_U16:
+    case CFG_U32:
+    case CFG_FLOAT: {
+      if (!v.is<float>()) return "type";
+      float x = v.as<float>();
+      return (x < f.min || x > f.max) ? "range" : nullptr;
+    }
+    case CFG_STR: {
+      if (!v.is<const char *>()) return "type";
+      return strlen(v.as<const char *>()) >= f.size ? "length" : nullptr;
+    }
+    case CFG_IP: {
+      IPAddress ip;
+      return cfgParseIp(v.as<const char *>(), ip) ? nullptr : "ip";
+    }
+    case CFG_ENUM:
+      return cfgEnumIndex(f, v.as<const char *>()) < 0 ? "value" : nullptr;
+    case CFG_LABELS: {
+      if (!v.is<JsonArrayConst>()) return "type";
+      JsonArrayConst arr = v.as<JsonArrayConst>();
+      if (arr.size() > cfgLabelCount(f)) return "count";
+      for (JsonVariantConst e : arr) {
+        if (!e.is<const char *>()) return "type";
+        if (strlen(e.as<const char *>()) >= f.size) return "length";
+      }
+      return nullptr;
+    }
+  }
+  return "type";
+}
+
+// ----- Écriture d'une valeur validée; true si elle a changé -----
+template <class T> static bool cfgStore(void *ptr, T v) {
+  if (*(T *)ptr == v) return false;
+  *(T *)ptr = v;
+  return true;
+}
+
+static bool cfgStoreStr(char *dst, size_t size, const char *v) {
+  if (strncmp(dst, v, size) == 0) return false;
+  strlcpy(dst, v, size);
+  return true;
+}
+
+static bool cfgAssign(const CfgField &f, JsonVariantConst v) {
+  switch (f.type) {
+    case CFG_BOOL: return cfgStore<bool>(f.ptr, v.is<bool>() ? v.as<bool>() : v.as<int>() != 0);
+    case CFG_U8: return cfgStore<uint8_t>(f.ptr, v.as<uint8_t>());
+    case CFG_U16: return cfgStore<uint16_t>(f.ptr, v.as<uint16_t>());
+    case CFG_U32: return cfgStore<uint32_t>(f.ptr, v.as<uint32_t>());
+    case CFG_FLOAT: return cfgStore<float>(f.ptr, v.as<float>());
+    case CFG_STR: {
+      const char *s = v.as<const char *>();
+      if ((f.flags & CFG_KEEP_EMPTY) && s[0] == '\0') return false;
+      return cfgStoreStr((char *)f.ptr, f.size, s);
+    }
+    case CFG_IP: {
+      IPAddress ip;
+      cfgParseIp(v.as<const char *>(), ip);
+      IPAddress &cur = *(IPAddress *)f.ptr;   // objet (vtable): pas d'accès par uint32_t*
+      if (cur == ip) return false;
+      cur = ip;
+      return true;
+    }
+    case CFG_ENUM: {
+      const char *s = v.as<const char *>();
+      if (strcmp(f.get(), s) == 0) return false;
+      f.set(s);
+      return true;
+    }
+    case CFG_LABELS: {
+      // Label vide: inchangé (formulaire web partiel)
+      bool changed = false;
+      uint8_t k = 0;
+      for (JsonVariantConst e : v.as<JsonArrayConst>()) {
+        const char *s = e.as<const char *>();
+        if (s[0] != '\0') changed |= cfgStoreStr((char *)f.ptr + k * f.size, f.size, s);
+        k++;
+      }
+      return changed;
+    }
+  }
+  return false;
+}
+
+// ----- Document -> variables -----
+struct CfgApplyResult {
+  uint8_t fx;                              // CFG_FX_* des champs modifiés
+  uint8_t changed;                         // nombre de champs modifiés
+  uint8_t invalid;                         // champs refusés (import)
+  uint8_t unknown;                         // clés hors table (ignorées)
+  const char *badKey;                      // premier champ refusé
+  const char *reason;
+  const char *changedKeys[8];              // les premiers champs modifiés (réponse POST)
+};
+
+// strict (POST): un seul champ invalide et rien n'est appliqué.
+// Sinon (import): les champs invalides sont ignorés, les autres appliqués.
+static bool cfgFromJson(const CfgField *t, size_t n, JsonObjectConst obj, bool strict, CfgApplyResult &r) {
+  memset(&r, 0, sizeof(r));
+  size_t cursor = 0;
+  if (strict) {
+    for (JsonPairConst kv : obj) {
+      const CfgField *f = cfgFind(t, n, kv.key().c_str(), cursor);
+      if (!f) continue;
+      const char *why = cfgCheck(*f, kv.value());
+      if (why) {
+        r.invalid = 1;
+        r.badKey = f->key;
+        r.reason = why;
+        return false;
+      }
+    }
+    cursor = 0;
+  }
+  for (JsonPairConst kv : obj) {
+    const CfgField *f = cfgFind(t, n, kv.key().c_str(), cursor);
+    if (!f) {
+      r.unknown++;
+      continue;
+    }
+    if (!strict) {
+      const char *why = cfgCheck(*f, kv.value());
+      if (why) {
+        if (!r.badKey) {
+          r.badKey = f->key;
+          r.reason = why;
+        }
+        r.invalid++;
+        continue;
+      }
+    }
+    if (!cfgAssign(*f, kv.value())) continue;
+    if (f->apply) f->apply();
+    if (r.changed < sizeof(r.changedKeys) / sizeof(r.changedKeys[0])) r.changedKeys[r.changed] = f->key;
+    r.changed++;
+    r.fx |= f->flags & 0xF0;
+  }
+  return r.invalid == 0;
+}
+
+// ----- Variables -> document -----
+// secrets=false (GET): les secrets deviennent "<clé>_set": 0/1
+static void cfgToJson(const CfgField *t, size_t n, JsonObject obj, bool secrets) {
+  for (size_t i = 0; i < n; i++) {
+    const CfgField &f = t[i];
+    if ((f.flags & CFG_SECRET) && !secrets) {
+      char key[40];
+      snprintf(key, sizeof(key), "%s_set", f.key);
+      obj[(char *)key] = ((const char *)f.ptr)[0] != '\0' ? 1 : 0;   // char*: clé copiée
+      continue;
+    }
+    switch (f.type) {
+      case CFG_BOOL: obj[f.key] = *(bool *)f.ptr ? 1 : 0; break;
+      case CFG_U8: obj[f.key] = *(uint8_t *)f.ptr; break;
+      case CFG_U16: obj[f.key] = *(uint16_t *)f.ptr; break;
+      case CFG_U32: obj[f.key] = *(uint32_t *)f.ptr; break;
+      case CFG_FLOAT: obj[f.key] = *(float *)f.ptr; break;
+      case CFG_STR: obj[f.key] = (const char *)f.ptr; break;   // const char*: pas de copie
+      case CFG_IP: {
+        const IPAddress &ip = *(IPAddress *)f.ptr;
+        char s[16];
+        snprintf(s, sizeof(s), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+        obj[f.key] = (char *)s;                                 // copiée
+        break;
+      }
+      case CFG_ENUM: obj[f.key] = f.get(); break;
+      case CFG_LABELS: {
+        JsonArray arr = obj.createNestedArray(f.key);
+        for (uint8_t k = 0; k < cfgLabelCount(f); k++) arr.add((const char *)f.ptr + k * f.size);
+        break;
+      }
+    }
+  }
+}
+
+// Capacité exacte pour cfgToJson (+ extra membres ajoutés par l'appelant)
+static size_t cfgDocSize(const CfgField *t, size_t n, bool secrets, size_t extra = 0) {
+  size_t size = JSON_OBJECT_SIZE(n + extra);
+  for (size_t i = 0; i < n; i++) {
+    const CfgField &f = t[i];
+    if ((f.flags & CFG_SECRET) && !secrets) size += strlen(f.key) + 5;   // "<clé>_set"
+    else if (f.type == CFG_IP) size += 16;
+    else if (f.type == CFG_LABELS) size += JSON_ARRAY_SIZE(cfgLabelCount(f));
+  }
+  return size;
+}
+
+// Capacité pour lire un document en place (char* modifiable: chaînes non
+// copiées): tous les champs + extra clés hors table
+static size_t cfgParseDocSize(const CfgField *t, size_t n, size_t extra) {
+  size_t size = JSON_OBJECT_SIZE(n + extra);
+  for (size_t i = 0; i < n; i++) {
+    if (t[i].type == CFG_LABELS) size += JSON_ARRAY_SIZE(cfgLabelCount(t[i]));
+  }
+  return size;
+}
+
+// ----- Instantané binaire -----
+static size_t cfgFieldBytes(const CfgField &f) {
+  return f.type == CFG_LABELS ? (size_t)f.size * cfgLabelCount(f) : f.size;
+}
+
+static size_t cfgBlobSize(const CfgField *t, size_t n) {
+  size_t size = 0;
+  for (size_t i = 0; i < n; i++) size += cfgFieldBytes(t[i]);
+  return size;
+}
+
+// Empreinte de la table: clés, types et tailles dans l'ordre
+static uint32_t cfgSchemaHash(const CfgField *t, size_t n) {
+  uint32_t h = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t count = t[i].type == CFG_LABELS ? cfgLabelCount(t[i]) : 1;   // bornes hors empreinte
+    uint8_t desc[4] = {t[i].type, (uint8_t)t[i].size, (uint8_t)(t[i].size >> 8), count};
+    h = configCrc32(t[i].key, strlen(t[i].key) + 1, h);
+    h = configCrc32(desc, sizeof(desc), h);
+  }
+  return h;
+}
+
+static void cfgPack(const CfgField *t, size_t n, uint8_t *out) {
+  for (size_t i = 0; i < n; i++) {
+    const CfgField &f = t[i];
+    size_t len = cfgFieldBytes(f);
+    if (f.type == CFG_ENUM) {
+      int idx = cfgEnumIndex(f, f.get());
+      out[0] = idx < 0 ? 0 : (uint8_t)idx;
+    } else if (f.type == CFG_IP) {
+      uint32_t ip = (uint32_t)*(IPAddress *)f.ptr;
+      memcpy(out, &ip, 4);
+    } else if (f.type == CFG_STR || f.type == CFG_LABELS) {
+      // Octets après le '\0' à zéro: le CRC ne dépend que du contenu
+      memset(out, 0, len);
+      for (size_t off = 0; off < len; off += f.size) strncpy((char *)out + off, (const char *)f.ptr + off, f.size - 1);
+    } else {
+      memcpy(out, f.ptr, len);
+    }
+    out += len;
+  }
+}
+
+static void cfgUnpack(const CfgField *t, size_t n, const uint8_t *in) {
+  for (size_t i = 0; i < n; i++) {
+    const CfgField &f = t[i];
+    size_t len = cfgFieldBytes(f);
+    if (f.type == CFG_ENUM) {
+      uint8_t idx = 0;
+      while (idx < in[0] && f.names[idx + 1]) idx++;
+      f.set(f.names[idx]);
+    } else if (f.type == CFG_IP) {
+      uint32_t ip;
+      memcpy(&ip, in, 4);
+      *(IPAddress *)f.ptr = IPAddress(ip);
+    } else if (f.type == CFG_STR || f.type == CFG_LABELS) {
+      for (size_t off = 0; off < len; off += f.size) {
+        configBlobStr((char *)f.ptr + off, f.size, (const char *)in + off, f.size);
+      }
+    } else {
+      memcpy(f.ptr, in, len);
+    }
+    if (f.apply) f.apply();
+    in += len;
+  }
+}
+
+#endif // CONFIG_SCHEMA_H
@@ -0,0 +1,165 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "config_blob.h"
+
+// ===== ÉCRITURES DE CONFIG ATOMIQUES ET REGROUPÉES =====
+// - Regroupement: POST /api/config marque la config modifiée; loop() écrit
+//   après CONFIG_SAVE_QUIET_MS sans nouvelle modification (au plus tard
+//   CONFIG_SAVE_MAX_MS après la première). Une rafale = une écriture flash,
+//   hors du traitement de la requête.
+// - Écritures inutiles évitées: contenu identique (CRC) au dernier écrit.
+// - /config.json: écrit dans CONFIG_TMP_SUFFIX puis renommé. Le texte porte
+//   son CRC-32 en dernière clé ("crc32", hexadécimal) et reste du JSON valide.
+//   Une coupure à n'importe quelle étape laisse l'ancien fichier ou le
+//   nouveau complet (configFileRecover au prochain import).
+// Aucune dépendance Arduino: système de fichiers via ConfigFsIo.
+
+#define CONFIG_SAVE_QUIET_MS 2000
+#define CONFIG_SAVE_MAX_MS 10000
+#define CONFIG_TMP_SUFFIX ".tmp"
+#define CONFIG_CRC_TAIL 19                  // "crc32":"xxxxxxxx"}
+
+struct ConfigSaveSched {
+  bool dirty;
+  uint32_t firstMs;                         // première modification non écrite
+  uint32_t lastMs;                          // dernière modification
+};
+
+static inline void configSaveMark(ConfigSaveSched &s, uint32_t now) {
+  if (!s.dirty) s.firstMs = now;
+  s.dirty = true;
+  s.lastMs = now;
+}
+
+static inline bool configSaveDue(const ConfigSaveSched &s, uint32_t now) {
+  if (!s.dirty) return false;
+  return now - s.lastMs >= CONFIG_SAVE_QUIET_MS || now - s.firstMs >= CONFIG_SAVE_MAX_MS;
+}
+
+// Octets flash d'un putBytes() NVS de len octets: entrées de 32 octets,
+// en-tête de bloc + données + index du blob (estimation)
+static inline uint32_t configNvsBytes(size_t len) {
+  return 32 * (2 + (uint32_t)((len + 31) / 32));
+}
+
+// ----- Texte JSON signé -----
+// buf contient un objet JSON de len octets ("{...}"); y ajoute la clé crc32
+// (CRC du texte sans elle). Renvoie la nouvelle taille, 0 si cap trop petit.
+static inline size_t configJsonSign(char *buf, size_t len, size_t cap) {
+  if (len < 2 || buf[len - 1] != '}' || len + CONFIG_CRC_TAIL + 1 > cap) return 0;
+  uint32_t crc = configCrc32(buf, len);
+  bool empty = (len == 2);
+  size_t n = snprintf(buf + len - 1, cap - len + 1, "%s\"crc32\":\"%08lx\"}", empty ? "" : ",",
+                      (unsigned long)crc);
+  return len - 1 + n;
+}
+
+enum ConfigFileStatus : uint8_t {
+  CFG_FILE_OK = 0,                          // CRC vérifié
+  CFG_FILE_UNSIGNED,                        // sans clé crc32 (fichier écrit à la main)
+  CFG_FILE_BAD_CRC,                         // tronqué ou corrompu
+  CFG_FILE_MISSING,
+};
+
+static inline const char *configFileStatusName(ConfigFileStatus s) {
+  switch (s) {
+    case CFG_FILE_OK: return "ok";
+    case CFG_FILE_UNSIGNED: return "unsigned";
+    case CFG_FILE_BAD_CRC: return "bad_crc";
+    default: return "missing";
+  }
+}
+
+static inline int configHexNibble(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static inline ConfigFileStatus configJsonVerify(const char *buf, size_t len) {
+  while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r' || buf[len - 1] == ' ')) len--;
+  if (len == 0) return CFG_FILE_BAD_CRC;
+  if (len < CONFIG_CRC_TAIL + 1 || memcmp(buf + len - CONFIG_CRC_TAIL, "\"crc32\":\"", 9) != 0) {
+    // Sans signature: seulement si le texte se termine comme un objet complet
+    return buf[len - 1] == '}' ? CFG_FILE_UNSIGNED : CFG_FILE_BAD_CRC;
+  }
+  const char *hex = buf + len - 10;
+  uint32_t want = 0;
+  for (int i = 0; i < 8; i++) {
+    int v = configHexNibble(hex[i]);
+    if (v < 0) return CFG_FILE_BAD_CRC;
+    want = (want << 4) | (uint32_t)v;
+  }
+  if (hex[8] != '"' || hex[9] != '}') return CFG_FILE_BAD_CRC;
+  // Texte signé = tout avant [,]"crc32" puis '}'
+  size_t body = len - CONFIG_CRC_TAIL;
+  if (buf[body - 1] == ',') body--;
+  uint32_t crc = configCrc32(buf, body);
+  crc = configCrc32("}", 1, crc);
+  return crc == want ? CFG_FILE_OK : CFG_FILE_BAD_CRC;
+}
+
+// ----- Fichier -----
+struct ConfigFsIo {
+  // Crée/tronque puis écrit tout; false si l'écriture est incomplète
+  bool (*write)(const char *path, const char *data, size_t len);
+  // Lit au plus cap octets; -1 si le fichier n'existe pas
+  long (*read)(const char *path, char *buf, size_t cap);
+  bool (*remove)(const char *path);
+  bool (*rename)(const char *from, const char *to);
+};
+
+// Étapes: 1) temporaire complet 2) suppression de l'ancien 3) renommage.
+// Coupure avant 2: l'ancien reste; entre 2 et 3: le temporaire (signé) est
+// repris par configFileRecover.
+static inline bool configFileWrite(const ConfigFsIo &io, const char *path, const char *data, size_t len) {
+  char tmp[40];
+  snprintf(tmp, sizeof(tmp), "%s%s", path, CONFIG_TMP_SUFFIX);
+  if (!io.write(tmp, data, len)) {
+    io.remove(tmp);
+    return false;
+  }
+  io.remove(path);
+  return io.rename(tmp, path);
+}
+
+// Lit path dans buf (terminé par '\0'), en reprenant le temporaire si le
+// fichier manque ou est invalide et que le temporaire est complet. *outLen =
+// taille lue.
+static inline ConfigFileStatus configFileRecover(const ConfigFsIo &io, const char *path, char *buf, size_t cap,
+                                                 size_t *outLen) {
+  char tmp[40];
+  snprintf(tmp, sizeof(tmp), "%s%s", path, CONFIG_TMP_SUFFIX);
+  *outLen = 0;
+  long n = io.read(path, buf, cap - 1);
+  ConfigFileStatus st = (n < 0) ? CFG_FILE_MISSING : configJsonVerify(buf, (size_t)n);
+  if (st == CFG_FILE_OK || st == CFG_FILE_UNSIGNED) {
+    buf[n] = '\0';
+    *outLen = (size_t)n;
+    io.remove(tmp);                        // reste d'une écriture interrompue
+    return st;
+  }
+  long t = io.read(tmp, buf, cap - 1);
+  if (t >= 0 && configJsonVerify(buf, (size_t)t) == CFG_FILE_OK) {
+    io.remove(path);
+    io.rename(tmp, path);
+    buf[t] = '\0';
+    *outLen = (size_t)t;
+    return CFG_FILE_OK;
+  }
+  // Rien de récupérable: contenu de path tel quel pour le diagnostic
+  n = io.read(path, buf, cap - 1);
+  if (n >= 0) {
+    buf[n] = '\0';
+    *outLen = (size_t)n;
+  }
+  return st;
+}
+
+#endif // CONFIG_STORE_H
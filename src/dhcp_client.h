@@ -0,0 +1,399 @@
+#ifndef DHCP_CLIENT_H
+#define DHCP_CLIENT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ===== CLIENT DHCP NON BLOQUANT =====
+// Le DHCP de la lib Ethernet attend les réponses dans Ethernet.begin() et
+// Ethernet.maintain() (jusqu'à 60 s au démarrage, 4 s par renouvellement).
+// Ici une machine d'états avancée depuis loop(): dhcpService() émet et gère
+// les délais, dhcpOnPacket() traite les réponses du serveur (port 67 -> 68).
+// - Démarrage à froid: DISCOVER -> OFFER -> REQUEST -> ACK
+// - Bail en cache (NVS): l'adresse est utilisée tout de suite, confirmée en
+//   arrière-plan (INIT-REBOOT, RFC 2131 §3.2); NAK -> DISCOVER
+// - T1: renouvellement unicast auprès du serveur, T2: diffusion, fin du bail:
+//   retour à DISCOVER
+// Aucune dépendance Arduino: émission et application de l'adresse via DhcpIo.
+// Adresses IPv4 en uint32_t dans l'ordre réseau des octets en mémoire
+// (comme IPAddress).
+
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
+#define DHCP_PACKET_MAX 548              // taille minimale garantie d'un message DHCP
+#define DHCP_RETRY_FIRST_MS 2000
+#define DHCP_RETRY_MAX_MS 32000
+#define DHCP_REBOOT_TRIES 2              // INIT-REBOOT sans réponse: DISCOVER
+#define DHCP_BROADCAST 0xFFFFFFFFUL
+
+enum DhcpState : uint8_t {
+  DHCP_ST_INIT = 0,
+  DHCP_ST_SELECTING,                     // DISCOVER émis, attente OFFER
+  DHCP_ST_REQUESTING,                    // REQUEST émis, attente ACK
+  DHCP_ST_REBOOTING,                     // bail en cache en cours de confirmation
+  DHCP_ST_BOUND,
+  DHCP_ST_RENEWING,                      // T1: unicast vers le serveur
+  DHCP_ST_REBINDING,                     // T2: diffusion
+};
+
+enum DhcpMsgType : uint8_t {
+  DHCP_DISCOVER = 1,
+  DHCP_OFFER = 2,
+  DHCP_REQUEST = 3,
+  DHCP_DECLINE = 4,
+  DHCP_ACK = 5,
+  DHCP_NAK = 6,
+  DHCP_RELEASE = 7,
+};
+
+struct DhcpLease {
+  uint32_t ip;
+  uint32_t mask;
+  uint32_t gateway;
+  uint32_t dns;
+  uint32_t server;
+  uint32_t leaseS;
+  uint32_t t1S;
+  uint32_t t2S;
+};
+
+struct DhcpIo {
+  bool (*send)(uint32_t dst, const uint8_t *buf, size_t len);   // 68 -> dst:67
+  void (*apply)(const DhcpLease &lease, bool changed);          // adresse à (re)configurer (ip 0: retirée)
+  void (*store)(const DhcpLease &lease);                        // bail à mettre en cache (optionnel)
+};
+
+struct DhcpStats {
+  uint32_t discovers;
+  uint32_t requests;
+  uint32_t acks;
+  uint32_t naks;
+  uint32_t renewals;                     // baux prolongés (RENEWING/REBINDING)
+  uint32_t expiries;
+};
+
+struct DhcpClient {
+  DhcpIo io;
+  uint8_t mac[6];
+  char hostname[32];
+  uint32_t xid;
+  DhcpState state;
+  DhcpLease lease;                       // bail courant (ou en cache)
+  bool haveAddress;                      // une adresse est appliquée
+  uint32_t offerIp;
+  uint32_t offerServer;
+  uint32_t boundS;                       // secondes écoulées depuis l'ACK, jusqu'à tickMs
+  uint32_t tickMs;                       // instant compté dans boundS (dhcpTick)
+  uint32_t lastTxMs;
+  uint32_t retryMs;
+  uint8_t tries;
+  uint32_t startMs;
+  uint32_t firstBoundMs;                 // démarrage -> premier ACK (0 = pas encore)
+  DhcpStats stats;
+};
+
+static inline void dhcpPut32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static inline uint32_t dhcpGet32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Adresse (ordre mémoire) <-> octets du paquet
+static inline void dhcpPutAddr(uint8_t *p, uint32_t addr) {
+  memcpy(p, &addr, 4);
+}
+
+static inline uint32_t dhcpGetAddr(const uint8_t *p) {
+  uint32_t a;
+  memcpy(&a, p, 4);
+  return a;
+}
+
+static inline void dhcpInit(DhcpClient &c, const DhcpIo &io, const uint8_t mac[6], const char *hostname,
+                            uint32_t xidSeed, uint32_t nowMs) {
+  memset(&c, 0, sizeof(c));
+  c.io = io;
+  memcpy(c.mac, mac, 6);
+  strncpy(c.hostname, hostname ? hostname : "", sizeof(c.hostname) - 1);
+  c.xid = xidSeed;
+  c.state = DHCP_ST_INIT;
+  c.startMs = nowMs;
+}
+
+// Bail en cache: appliqué tout de suite, confirmé en arrière-plan
+static inline void dhcpStartCached(DhcpClient &c, const DhcpLease &cached) {
+  c.lease = cached;
+  c.haveAddress = true;
+  c.state = DHCP_ST_REBOOTING;
+  c.tries = 0;
+  c.retryMs = 0;                         // première émission au prochain dhcpService()
+  c.io.apply(c.lease, true);
+}
+
+static inline size_t dhcpBuild(const DhcpClient &c, uint8_t type, uint32_t ciaddr, uint32_t requested,
+                               uint32_t server, uint16_t secs, uint8_t *out) {
+  memset(out, 0, 240);
+  out[0] = 1;                            // BOOTREQUEST
+  out[1] = 1;                            // Ethernet
+  out[2] = 6;
+  dhcpPut32(out + 4, c.xid);
+  out[8] = (uint8_t)(secs >> 8);
+  out[9] = (uint8_t)secs;
+  // Réponse en diffusion tant que l'adresse n'est pas configurée
+  if (ciaddr == 0) out[10] = 0x80;
+  dhcpPutAddr(out + 12, ciaddr);
+  memcpy(out + 28, c.mac, 6);
+  dhcpPut32(out + 236, 0x63825363);      // magic cookie
+
+  uint8_t *p = out + 240;
+  *p++ = 53; *p++ = 1; *p++ = type;
+  *p++ = 61; *p++ = 7; *p++ = 1;
+  memcpy(p, c.mac, 6);
+  p += 6;
+  size_t hn = strlen(c.hostname);
+  if (hn > 0) {
+    *p++ = 12;
+    *p++ = (uint8_t)hn;
+    memcpy(p, c.hostname, hn);
+    p += hn;
+  }
+  if (requested != 0) {
+    *p++ = 50; *p++ = 4;
+    dhcpPutAddr(p, requested);
+    p += 4;
+  }
+  if (server != 0) {
+    *p++ = 54; *p++ = 4;
+    dhcpPutAddr(p, server);
+    p += 4;
+  }
+  if (type == DHCP_DISCOVER || type == DHCP_REQUEST) {
+    static const uint8_t params[] = {1, 3, 6, 51, 58, 59};
+    *p++ = 55; *p++ = sizeof(params);
+    memcpy(p, params, sizeof(params));
+    p += sizeof(params);
+  }
+  *p++ = 255;
+  size_t len = (size_t)(p - out);
+  if (len < 300) {                       // taille BOOTP minimale (certains relais)
+    memset(p, 0, 300 - len);
+    len = 300;
+  }
+  return len;
+}
+
+static inline void dhcpSend(DhcpClient &c, uint32_t nowMs) {
+  uint8_t buf[DHCP_PACKET_MAX];
+  uint32_t elapsed = (nowMs - c.startMs) / 1000;
+  uint16_t secs = elapsed > 0xFFFF ? 0xFFFF : (uint16_t)elapsed;
+  uint32_t dst = DHCP_BROADCAST;
+  size_t n;
+  switch (c.state) {
+    case DHCP_ST_SELECTING:
+      n = dhcpBuild(c, DHCP_DISCOVER, 0, 0, 0, secs, buf);
+      break;
+    case DHCP_ST_REQUESTING:
+      n = dhcpBuild(c, DHCP_REQUEST, 0, c.offerIp, c.offerServer, secs, buf);
+      break;
+    case DHCP_ST_REBOOTING:
+      n = dhcpBuild(c, DHCP_REQUEST, 0, c.lease.ip, 0, secs, buf);
+      break;
+    case DHCP_ST_RENEWING:
+      n = dhcpBuild(c, DHCP_REQUEST, c.lease.ip, 0, 0, secs, buf);
+      dst = c.lease.server;
+      break;
+    default:                             // REBINDING
+      n = dhcpBuild(c, DHCP_REQUEST, c.lease.ip, 0, 0, secs, buf);
+      break;
+  }
+  if (c.state == DHCP_ST_SELECTING) c.stats.discovers++;
+  else c.stats.requests++;
+  c.io.send(dst, buf, n);
+  c.lastTxMs = nowMs;
+  c.tries++;
+}
+
+// Adresse plus utilisable (NAK, bail expiré): retirée de l'interface
+static inline void dhcpDrop(DhcpClient &c) {
+  if (!c.haveAddress) return;
+  c.haveAddress = false;
+  DhcpLease none;
+  memset(&none, 0, sizeof(none));
+  c.io.apply(none, true);
+}
+
+static inline void dhcpEnter(DhcpClient &c, DhcpState st, uint32_t nowMs) {
+  c.state = st;
+  c.tries = 0;
+  c.retryMs = DHCP_RETRY_FIRST_MS;
+  if (st == DHCP_ST_SELECTING || st == DHCP_ST_REBOOTING) c.xid++;
+  dhcpSend(c, nowMs);
+}
+
+// Âge du bail en secondes. nowMs (32 bits) repasse à 0 tous les 49,7 jours,
+// moins que certains baux: les secondes sont cumulées dans boundS à chaque
+// dhcpService(), seul l'écart depuis tickMs passe par les millisecondes.
+static inline uint32_t dhcpElapsedS(const DhcpClient &c, uint32_t nowMs) {
+  return c.boundS + (nowMs - c.tickMs) / 1000;
+}
+
+static inline void dhcpTick(DhcpClient &c, uint32_t nowMs) {
+  uint32_t s = (nowMs - c.tickMs) / 1000;
+  c.boundS += s;
+  c.tickMs += s * 1000;
+}
+
+// Délais, retransmissions et échéances du bail (à appeler à chaque loop())
+static inline void dhcpService(DhcpClient &c, uint32_t nowMs) {
+  dhcpTick(c, nowMs);
+  switch (c.state) {
+    case DHCP_ST_INIT:
+      dhcpEnter(c, DHCP_ST_SELECTING, nowMs);
+      return;
+    case DHCP_ST_BOUND:
+      if (dhcpElapsedS(c, nowMs) >= c.lease.t1S) dhcpEnter(c, DHCP_ST_RENEWING, nowMs);
+      return;
+    default:
+      break;
+  }
+
+  if (c.state == DHCP_ST_RENEWING || c.state == DHCP_ST_REBINDING) {
+    uint32_t el = dhcpElapsedS(c, nowMs);
+    if (el >= c.lease.leaseS) {
+      // Bail expiré: l'adresse n'est plus utilisable
+      c.stats.expiries++;
+      dhcpDrop(c);
+      c.state = DHCP_ST_INIT;
+      return;
+    }
+    if (c.state == DHCP_ST_RENEWING && el >= c.lease.t2S) {
+      dhcpEnter(c, DHCP_ST_REBINDING, nowMs);
+      return;
+    }
+  }
+
+  if (c.retryMs == 0) {                  // bail en cache: première émission
+    dhcpEnter(c, c.state, nowMs);
+    return;
+  }
+  if (nowMs - c.lastTxMs < c.retryMs) return;
+  if (c.state == DHCP_ST_REBOOTING && c.tries >= DHCP_REBOOT_TRIES) {
+    // Serveur muet: l'adresse en cache reste en place, nouvelle découverte
+    dhcpEnter(c, DHCP_ST_SELECTING, nowMs);
+    return;
+  }
+  if (c.state == DHCP_ST_REQUESTING && c.tries >= 4) {
+    dhcpEnter(c, DHCP_ST_SELECTING, nowMs);
+    return;
+  }
+  if (c.retryMs < DHCP_RETRY_MAX_MS) c.retryMs *= 2;
+  dhcpSend(c, nowMs);
+}
+
+struct DhcpReply {
+  uint8_t type;
+  uint32_t yiaddr;
+  DhcpLease lease;
+};
+
+static inline bool dhcpParse(const DhcpClient &c, const uint8_t *in, size_t len, DhcpReply &r) {
+  if (len < 241 || in[0] != 2 || dhcpGet32(in + 4) != c.xid) return false;
+  if (memcmp(in + 28, c.mac, 6) != 0 || dhcpGet32(in + 236) != 0x63825363) return false;
+  memset(&r, 0, sizeof(r));
+  r.yiaddr = dhcpGetAddr(in + 16);
+  r.lease.ip = r.yiaddr;
+  size_t i = 240;
+  while (i < len) {
+    uint8_t opt = in[i++];
+    if (opt == 255) break;
+    if (opt == 0) continue;
+    if (i >= len) return false;
+    uint8_t ol = in[i++];
+    if (i + ol > len) return false;
+    const uint8_t *v = in + i;
+    switch (opt) {
+      case 53: if (ol >= 1) r.type = v[0]; break;
+      case 1: if (ol >= 4) r.lease.mask = dhcpGetAddr(v); break;
+      case 3: if (ol >= 4) r.lease.gateway = dhcpGetAddr(v); break;
+      case 6: if (ol >= 4) r.lease.dns = dhcpGetAddr(v); break;
+      case 54: if (ol >= 4) r.lease.server = dhcpGetAddr(v); break;
+      case 51: if (ol >= 4) r.lease.leaseS = dhcpGet32(v); break;
+      case 58: if (ol >= 4) r.lease.t1S = dhcpGet32(v); break;
+      case 59: if (ol >= 4) r.lease.t2S = dhcpGet32(v); break;
+      default: break;
+    }
+    i += ol;
+  }
+  return r.type != 0;
+}
+
+// Réponse reçue sur le port 68. true si l'état a changé.
+static inline bool dhcpOnPacket(DhcpClient &c, const uint8_t *in, size_t len, uint32_t nowMs) {
+  DhcpReply r;
+  if (!dhcpParse(c, in, len, r)) return false;
+
+  if (r.type == DHCP_OFFER) {
+    if (c.state != DHCP_ST_SELECTING || r.yiaddr == 0 || r.lease.server == 0) return false;
+    c.offerIp = r.yiaddr;
+    c.offerServer = r.lease.server;
+    dhcpEnter(c, DHCP_ST_REQUESTING, nowMs);
+    return true;
+  }
+
+  if (r.type == DHCP_NAK) {
+    if (c.state == DHCP_ST_SELECTING || c.state == DHCP_ST_BOUND) return false;
+    c.stats.naks++;
+    // Adresse refusée (bail en cache invalide ou réseau changé)
+    dhcpDrop(c);
+    dhcpEnter(c, DHCP_ST_SELECTING, nowMs);
+    return true;
+  }
+
+  if (r.type != DHCP_ACK || c.state == DHCP_ST_SELECTING || c.state == DHCP_ST_BOUND || r.yiaddr == 0) return false;
+  DhcpLease l = r.lease;
+  if (l.server == 0) l.server = c.lease.server;
+  if (l.leaseS == 0) l.leaseS = 3600;
+  if (l.t1S == 0 || l.t1S >= l.leaseS) l.t1S = l.leaseS / 2;
+  if (l.t2S == 0 || l.t2S >= l.leaseS || l.t2S <= l.t1S) l.t2S = (uint32_t)((uint64_t)l.leaseS * 7 / 8);
+  bool renewal = c.state == DHCP_ST_RENEWING || c.state == DHCP_ST_REBINDING;
+  bool changed = !c.haveAddress || l.ip != c.lease.ip || l.mask != c.lease.mask ||
+                 l.gateway != c.lease.gateway || l.dns != c.lease.dns;
+  bool storeNeeded = changed || l.server != c.lease.server || l.leaseS != c.lease.leaseS;
+  c.lease = l;
+  c.haveAddress = true;
+  c.state = DHCP_ST_BOUND;
+  c.boundS = 0;
+  c.tickMs = nowMs;
+  c.tries = 0;
+  c.stats.acks++;
+  if (renewal) c.stats.renewals++;
+  if (c.firstBoundMs == 0) c.firstBoundMs = (nowMs - c.startMs) ? nowMs - c.startMs : 1;
+  c.io.apply(c.lease, changed);
+  if (storeNeeded && c.io.store) c.io.store(c.lease);
+  return true;
+}
+
+// Le socket UDP 68 n'est utile qu'en dehors de BOUND (et à l'approche de T1)
+static inline bool dhcpWantsSocket(const DhcpClient &c, uint32_t nowMs) {
+  return c.state != DHCP_ST_BOUND || dhcpElapsedS(c, nowMs) >= c.lease.t1S;
+}
+
+static inline const char *dhcpStateName(DhcpState st) {
+  switch (st) {
+    case DHCP_ST_SELECTING: return "selecting";
+    case DHCP_ST_REQUESTING: return "requesting";
+    case DHCP_ST_REBOOTING: return "rebooting";
+    case DHCP_ST_BOUND: return "bound";
+    case DHCP_ST_RENEWING: return "renewing";
+    case DHCP_ST_REBINDING: return "rebinding";
+    default: return "init";
+  }
+}
+
+#endif // DHCP_CLIENT_H
@@ -0,0 +1,95 @@
+#ifndef HA_DISCOVERY_H
+#define HA_DISCOVERY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "status_payload.h"
+
+// ===== HOME ASSISTANT MQTT DISCOVERY =====
+// Une config retenue par entité:
+//   <disc>/switch/<node>/relayN/config          relais 0..7
+//   <disc>/binary_sensor/<node>/inputN/config   entrées 0..7
+//   <disc>/sensor/<node>/temperature|humidity/config
+// Clés abrégées HA (stat_t, cmd_t...) pour limiter la taille des payloads.
+
+#define HA_ENTITY_COUNT 18
+#define HA_PAYLOAD_MAX 512
+
+struct HaDiscoveryContext {
+  const char *discoveryPrefix;   // "homeassistant"
+  const char *nodeId;            // unique par carte (MAC)
+  const char *topicPrefix;       // racine des topics par canal
+  const char *sensorTopic;
+  const char *availabilityTopic;
+  const char (*relayLabels)[16];
+  const char (*inputLabels)[16];
+};
+
+// Ajoute du texte formaté à pos; 0 si débordement
+static inline size_t haAppendf(char *buf, size_t cap, size_t pos, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+static inline size_t haAppendf(char *buf, size_t cap, size_t pos, const char *fmt, ...) {
+  if (pos == 0 || pos >= cap) return 0;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf + pos, cap - pos, fmt, ap);
+  va_end(ap);
+  if (n < 0 || (size_t)n >= cap - pos) return 0;
+  return pos + (size_t)n;
+}
+
+// Rend la config de l'entité idx (0..HA_ENTITY_COUNT-1): topic + payload.
+// Retourne la longueur du payload, 0 si un buffer est trop petit.
+static inline size_t haRenderEntity(const HaDiscoveryContext &c, int idx, char *topic, size_t tcap, char *buf, size_t cap) {
+  const char *component;
+  char objId[24];
+  const char *name;
+  if (idx < 8) {
+    component = "switch";
+    snprintf(objId, sizeof(objId), "relay%d", idx);
+    name = c.relayLabels[idx];
+  } else if (idx < 16) {
+    component = "binary_sensor";
+    snprintf(objId, sizeof(objId), "input%d", idx - 8);
+    name = c.inputLabels[idx - 8];
+  } else {
+    component = "sensor";
+    snprintf(objId, sizeof(objId), "%s", (idx == 16) ? "temperature" : "humidity");
+    name = (idx == 16) ? "Temperature" : "Humidity";
+  }
+
+  int n = snprintf(topic, tcap, "%s/%s/%s/%s/config", c.discoveryPrefix, component, c.nodeId, objId);
+  if (n <= 0 || (size_t)n >= tcap) return 0;
+
+  if (cap < 10) return 0;
+  memcpy(buf, "{\"name\":", 8);
+  size_t pos = jsonAppendString(buf, cap, 8, name);
+  pos = haAppendf(buf, cap, pos, ",\"uniq_id\":\"%s_%s\",\"obj_id\":\"%s_%s\"", c.nodeId, objId, c.nodeId, objId);
+
+  if (idx < 8) {
+    pos = haAppendf(buf, cap, pos, ",\"stat_t\":\"%s/relay/%d/state\",\"cmd_t\":\"%s/relay/%d/set\"",
+                    c.topicPrefix, idx, c.topicPrefix, idx);
+  } else if (idx < 16) {
+    pos = haAppendf(buf, cap, pos, ",\"stat_t\":\"%s/input/%d/state\"", c.topicPrefix, idx - 8);
+  } else if (idx == 16) {
+    pos = haAppendf(buf, cap, pos,
+                    ",\"stat_t\":\"%s\",\"val_tpl\":\"{{ value_json.temperature }}\",\"dev_cla\":\"temperature\","
+                    "\"unit_of_meas\":\"\xC2\xB0" "C\",\"stat_cla\":\"measurement\"",
+                    c.sensorTopic);
+  } else {
+    pos = haAppendf(buf, cap, pos,
+                    ",\"stat_t\":\"%s\",\"val_tpl\":\"{{ value_json.humidity }}\",\"dev_cla\":\"humidity\","
+                    "\"unit_of_meas\":\"%%\",\"stat_cla\":\"measurement\"",
+                    c.sensorTopic);
+  }
+
+  pos = haAppendf(buf, cap, pos,
+                  ",\"avty_t\":\"%s\",\"dev\":{\"ids\":[\"%s\"],\"name\":\"%s\","
+                  "\"mf\":\"Waveshare\",\"mdl\":\"ESP32-S3-ETH-8DI-8RO\"}}",
+                  c.availabilityTopic, c.nodeId, c.nodeId);
+  return pos;
+}
+
+#endif // HA_DISCOVERY_H
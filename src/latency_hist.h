@@ -0,0 +1,45 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== HISTOGRAMME DE LATENCE (µs, bornes fixes) =====
+// Enregistrement O(1) sans heap, utilisable depuis un callback.
+// Bucket i compte les mesures < LATENCY_HIST_BOUNDS_US[i]; le dernier
+// bucket compte tout ce qui dépasse la dernière borne.
+
+#define LATENCY_HIST_BUCKETS 8
+
+static const uint32_t LATENCY_HIST_BOUNDS_US[LATENCY_HIST_BUCKETS - 1] = {
+  50, 100, 200, 500, 1000, 2000, 5000
+};
+
+struct LatencyHistogram {
+  uint32_t counts[LATENCY_HIST_BUCKETS];
+  uint32_t samples;
+  uint32_t maxUs;
+  uint64_t totalUs;
+};
+
+static inline void latencyHistReset(LatencyHistogram &h) {
+  for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) h.counts[i] = 0;
+  h.samples = 0;
+  h.maxUs = 0;
+  h.totalUs = 0;
+}
+
+static inline void latencyHistRecord(LatencyHistogram &h, uint32_t us) {
+  int i = 0;
+  while (i < LATENCY_HIST_BUCKETS - 1 && us >= LATENCY_HIST_BOUNDS_US[i]) i++;
+  h.counts[i]++;
+  h.samples++;
+  h.totalUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+}
+
+static inline uint32_t latencyHistAvgUs(const LatencyHistogram &h) {
+  return h.samples ? (uint32_t)(h.totalUs / h.samples) : 0;
+}
+
+#endif // LATENCY_HIST_H
@@ -0,0 +1,324 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+// ===== JOURNAL BINAIRE EN ANNEAU =====
+// Zone fixe de mots de 32 bits où chaque appel de log écrit un record
+// compact: tampon, instant, format (pointeur vers le littéral), arguments
+// bruts. Le texte n'est produit qu'à la lecture (GET /api/logs, console).
+// - Écriture sans verrou, depuis n'importe quelle tâche ou ISR: la place est
+//   réservée par un seul fetch_add sur head, les mots sont écrits, puis le
+//   tampon (premier mot) publie le record. Les plus anciens sont écrasés.
+// - Lecture: un record n'est retenu que si son tampon désigne bien sa
+//   position et qu'aucun écrivain ne l'a rattrapé pendant la copie (même
+//   principe qu'un seqlock). Un record réservé mais pas encore publié est
+//   un trou, que le lecteur saute ou attend.
+// - Arguments: entiers (1 mot, 2 pour 64 bits), flottants (double, 2 mots),
+//   chaînes copiées avec leur zéro final (LOG_STR_MAX octets au plus).
+//   Conversions reconnues: %d i u x X o c s p e f g E G a A (hh h l ll z j t),
+//   sans '*' pour la largeur ou la précision.
+// Aucune dépendance Arduino.
+
+#define LOG_RECORD_MAX_WORDS 63            // tampon compris (6 bits)
+#define LOG_STR_MAX 96                     // octets copiés par chaîne, zéro compris
+#define LOG_PTR_WORDS (sizeof(const char *) / 4)
+#define LOG_RECORD_HEADER_WORDS (2 + LOG_PTR_WORDS)   // tampon, ms, format
+#define LOG_ARGS_MAX_WORDS (LOG_RECORD_MAX_WORDS - LOG_RECORD_HEADER_WORDS)
+
+// Tampon: niveau (2 bits), longueur en mots (6 bits), position (24 bits)
+#define LOG_STAMP_POS_MASK 0x00FFFFFFUL
+
+enum LogLevel : uint8_t {
+  LOG_LEVEL_INFO = 0,
+  LOG_LEVEL_WARN = 1,
+  LOG_LEVEL_ERROR = 2,
+};
+
+struct LogRing {
+  uint32_t *words;
+  uint32_t mask;                           // mots - 1 (puissance de 2)
+  uint32_t head;                           // mots réservés depuis le démarrage
+  uint32_t records;                        // records écrits depuis le démarrage
+};
+
+#define LOG_RING_INIT(mem) {(mem), (uint32_t)(sizeof(mem) / sizeof((mem)[0])) - 1, 0, 0}
+
+// Arguments d'un appel, mis bout à bout avant la réservation
+struct LogPack {
+  uint32_t n;
+  bool cut;                                // arguments tronqués ou perdus (place)
+  uint32_t w[LOG_ARGS_MAX_WORDS];
+};
+
+// Record relu (copie stable)
+struct LogRecord {
+  uint32_t pos;
+  uint32_t words;                          // longueur totale, tampon compris
+  uint32_t ms;
+  uint8_t level;
+  const char *fmt;
+  uint32_t argWords;
+  uint32_t args[LOG_ARGS_MAX_WORDS];
+};
+
+static inline uint32_t logStamp(uint32_t pos, uint8_t level, uint32_t words) {
+  return ((uint32_t)(level & 3) << 30) | (words << 24) | (pos & LOG_STAMP_POS_MASK);
+}
+
+static inline uint32_t logStampWords(uint32_t s) {
+  return (s >> 24) & 0x3F;
+}
+
+static inline bool logStampValid(uint32_t s, uint32_t pos) {
+  uint32_t n = logStampWords(s);
+  return (s & LOG_STAMP_POS_MASK) == (pos & LOG_STAMP_POS_MASK) && n >= LOG_RECORD_HEADER_WORDS;
+}
+
+// ----- Arguments -----
+
+static inline void logPackWords(LogPack &p, uint64_t v, uint32_t words) {
+  if (p.n + words > LOG_ARGS_MAX_WORDS) {
+    p.cut = true;
+    return;
+  }
+  p.w[p.n++] = (uint32_t)v;
+  if (words == 2) p.w[p.n++] = (uint32_t)(v >> 32);
+}
+
+static inline void logPackArg(LogPack &p, const char *s) {
+  if (!s) s = "(null)";
+  uint32_t room = (LOG_ARGS_MAX_WORDS - p.n) * 4;
+  if (room == 0) {
+    p.cut = true;
+    return;
+  }
+  if (room > LOG_STR_MAX) room = LOG_STR_MAX;
+  size_t len = strnlen(s, room);
+  if (len == room) {
+    len = room - 1;
+    p.cut = true;
+  }
+  char *dst = (char *)&p.w[p.n];
+  memcpy(dst, s, len);
+  uint32_t words = (uint32_t)(len / 4 + 1);
+  memset(dst + len, 0, words * 4 - len);
+  p.n += words;
+}
+
+static inline void logPackArg(LogPack &p, char *s) {
+  logPackArg(p, (const char *)s);
+}
+
+static inline void logPackArg(LogPack &p, double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  logPackWords(p, bits, 2);
+}
+
+template <typename T>
+static inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+logPackArg(LogPack &p, T v) {
+  logPackWords(p, (uint64_t)(int64_t)v, sizeof(T) > 4 ? 2 : 1);
+}
+
+template <typename T>
+static inline void logPackArg(LogPack &p, const T *v) {
+  logPackWords(p, (uint64_t)(uintptr_t)v, sizeof(v) > 4 ? 2 : 1);
+}
+
+static inline void logPackArgs(LogPack &) {}
+
+template <typename T, typename... R>
+static inline void logPackArgs(LogPack &p, T v, R... rest) {
+  logPackArg(p, v);
+  logPackArgs(p, rest...);
+}
+
+// ----- Écriture -----
+
+static inline void logRingWrite(LogRing &r, uint8_t level, uint32_t ms, const char *fmt, const LogPack &p) {
+  uint32_t n = LOG_RECORD_HEADER_WORDS + p.n;
+  uint32_t pos = __atomic_fetch_add(&r.head, n, __ATOMIC_RELAXED);
+  // Un lecteur qui voit un mot écrit ci-dessous voit aussi head avancé
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  uint32_t hdr[LOG_RECORD_HEADER_WORDS];
+  hdr[1] = ms;
+  memcpy(&hdr[2], &fmt, sizeof(fmt));
+  for (uint32_t i = 1; i < LOG_RECORD_HEADER_WORDS; i++) {
+    __atomic_store_n(&r.words[(pos + i) & r.mask], hdr[i], __ATOMIC_RELAXED);
+  }
+  for (uint32_t i = 0; i < p.n; i++) {
+    __atomic_store_n(&r.words[(pos + LOG_RECORD_HEADER_WORDS + i) & r.mask], p.w[i], __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&r.words[pos & r.mask], logStamp(pos, level, n), __ATOMIC_RELEASE);
+  __atomic_fetch_add(&r.records, 1, __ATOMIC_RELAXED);
+}
+
+// ----- Lecture -----
+
+static inline uint32_t logRingHead(const LogRing &r) {
+  return __atomic_load_n(&r.head, __ATOMIC_ACQUIRE);
+}
+
+// Copie du record commençant à pos; false si pos n'est pas (ou plus) un record publié
+static inline bool logRingRead(const LogRing &r, uint32_t pos, LogRecord &rec) {
+  uint32_t s = __atomic_load_n(&r.words[pos & r.mask], __ATOMIC_ACQUIRE);
+  if (!logStampValid(s, pos)) return false;
+  uint32_t n = logStampWords(s);
+  uint32_t hdr[LOG_RECORD_HEADER_WORDS];
+  for (uint32_t i = 1; i < LOG_RECORD_HEADER_WORDS; i++) {
+    hdr[i] = __atomic_load_n(&r.words[(pos + i) & r.mask], __ATOMIC_RELAXED);
+  }
+  rec.argWords = n - LOG_RECORD_HEADER_WORDS;
+  for (uint32_t i = 0; i < rec.argWords; i++) {
+    rec.args[i] = __atomic_load_n(&r.words[(pos + LOG_RECORD_HEADER_WORDS + i) & r.mask], __ATOMIC_RELAXED);
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&r.head, __ATOMIC_RELAXED) - pos > r.mask + 1) return false;  // rattrapé pendant la copie
+  rec.pos = pos;
+  rec.words = n;
+  rec.ms = hdr[1];
+  rec.level = (uint8_t)(s >> 30);
+  memcpy(&rec.fmt, &hdr[2], sizeof(rec.fmt));
+  return true;
+}
+
+// Premier record publié dans [from, head), head si aucun
+static inline uint32_t logRingSeek(const LogRing &r, uint32_t from, uint32_t head) {
+  for (uint32_t p = from; p != head; p++) {
+    uint32_t s = __atomic_load_n(&r.words[p & r.mask], __ATOMIC_ACQUIRE);
+    if (logStampValid(s, p) && logStampWords(s) <= head - p) return p;
+  }
+  return head;
+}
+
+// Plus ancien record encore présent
+static inline uint32_t logRingOldest(const LogRing &r, uint32_t head) {
+  uint32_t cap = r.mask + 1;
+  if (head <= cap) return 0;
+  return logRingSeek(r, head - cap, head);
+}
+
+// ----- Mise en forme -----
+
+static inline uint64_t logRecordWords(const LogRecord &rec, uint32_t &ai, uint32_t words, bool &missing) {
+  if (ai + words > rec.argWords) {
+    missing = true;
+    return 0;
+  }
+  uint64_t v = rec.args[ai++];
+  if (words == 2) v |= (uint64_t)rec.args[ai++] << 32;
+  return v;
+}
+
+// Texte du record dans out (toujours terminé); "..." en fin si tronqué.
+// Un argument absent ou illisible s'affiche "?".
+static inline size_t logRecordFormat(const LogRecord &rec, char *out, size_t size) {
+  const char *f = rec.fmt;
+  size_t len = 0;
+  uint32_t ai = 0;
+  bool cut = false;
+  while (*f && !cut) {
+    if (len >= size - 1) {
+      cut = true;
+      break;
+    }
+    if (*f != '%') {
+      out[len++] = *f++;
+      continue;
+    }
+    const char *spec = f++;
+    if (*f == '%') {
+      out[len++] = '%';
+      f++;
+      continue;
+    }
+    while (*f && strchr("-+ #0", *f)) f++;
+    while (*f >= '0' && *f <= '9') f++;
+    if (*f == '.') {
+      f++;
+      while (*f >= '0' && *f <= '9') f++;
+    }
+    char mod = 0;                          // 'H' pour hh, 'L' pour ll
+    if (*f == 'h') {
+      mod = 'h';
+      if (*++f == 'h') mod = 'H', f++;
+    } else if (*f == 'l') {
+      mod = 'l';
+      if (*++f == 'l') mod = 'L', f++;
+    } else if (*f == 'z' || *f == 'j' || *f == 't') {
+      mod = *f++;
+    }
+    char conv = *f;
+    if (!conv) break;
+    f++;
+    char sp[24];
+    size_t spLen = (size_t)(f - spec);
+    if (spLen >= sizeof(sp)) {
+      out[len++] = '?';
+      continue;
+    }
+    memcpy(sp, spec, spLen);
+    sp[spLen] = '\0';
+
+    size_t room = size - len;
+    int w = -1;
+    bool missing = false;
+    if (strchr("diouxXc", conv)) {
+      size_t bytes = mod == 'L' ? sizeof(long long) : mod == 'l' ? sizeof(long)
+                   : mod == 'z' ? sizeof(size_t) : mod == 'j' ? sizeof(intmax_t)
+                   : mod == 't' ? sizeof(ptrdiff_t) : sizeof(int);
+      uint64_t v = logRecordWords(rec, ai, bytes > 4 ? 2 : 1, missing);
+      if (!missing) {
+        switch (mod) {
+          case 'L': w = snprintf(out + len, room, sp, (long long)v); break;
+          case 'l': w = snprintf(out + len, room, sp, (long)v); break;
+          case 'z': w = snprintf(out + len, room, sp, (size_t)v); break;
+          case 'j': w = snprintf(out + len, room, sp, (intmax_t)v); break;
+          case 't': w = snprintf(out + len, room, sp, (ptrdiff_t)v); break;
+          default: w = snprintf(out + len, room, sp, (int)v); break;
+        }
+      }
+    } else if (strchr("eEfFgGaA", conv) && mod != 'L') {
+      uint64_t bits = logRecordWords(rec, ai, 2, missing);
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      if (!missing) w = snprintf(out + len, room, sp, d);
+    } else if (conv == 'p') {
+      uint64_t v = logRecordWords(rec, ai, sizeof(void *) > 4 ? 2 : 1, missing);
+      if (!missing) w = snprintf(out + len, room, sp, (void *)(uintptr_t)v);
+    } else if (conv == 's' && mod == 0 && ai < rec.argWords) {
+      const char *s = (const char *)&rec.args[ai];
+      size_t max = (rec.argWords - ai) * 4;
+      size_t n = strnlen(s, max);
+      if (n < max) {
+        ai += (uint32_t)(n / 4 + 1);
+        w = snprintf(out + len, room, sp, s);
+      } else {
+        ai = rec.argWords;
+      }
+    }
+    if (w < 0) {
+      out[len++] = '?';
+    } else if ((size_t)w >= room) {
+      len = size - 1;
+      cut = true;
+    } else {
+      len += (size_t)w;
+    }
+  }
+  if (cut && size >= 4) {
+    if (len > size - 4) len = size - 4;
+    memcpy(out + len, "...", 3);
+    len += 3;
+  }
+  out[len] = '\0';
+  return len;
+}
+
+#endif // LOG_RING_H
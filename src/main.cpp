@@ -9,12 +9,42 @@
 #include <Update.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include "sensor_report.h"
+#include "mqtt_command.h"
+#include "status_payload.h"
+#include "mqtt_queue.h"
+#include "mqtt_packet.h"
+#include "latency_hist.h"
+#include "topic_router.h"
+#include "ha_discovery.h"
+#include "sparkplug.h"
+#include "modbus_tcp.h"
+#include "modbus_rtu.h"
+#include "w5500_client.h"
+#include "w5500_irq.h"
+#include "socket_budget.h"
+#include "udp_ctrl.h"
+#include "peer_link.h"
+#include "dhcp_client.h"
+#include "req_arena.h"
+#include "alloc_trace.h"
+#include "log_ring.h"
 #include "web_config.h"
 
 #ifndef ENABLE_OTA_HTTP
 #define ENABLE_OTA_HTTP 0
 #endif
 
+// Bancs de débit /api/bench/upload et /api/bench/download (désactivés en production)
+#ifndef ENABLE_BENCH_HTTP
+#define ENABLE_BENCH_HTTP 0
+#endif
+
+// Service réseau piloté par la broche INTn du W5500 (0 = interrogation à chaque loop())
+#ifndef W5500_USE_IRQ
+#define W5500_USE_IRQ 1
+#endif
+
 // ESP32 Arduino core's Server interface requires begin(uint16_t).
 // The Arduino Ethernet library's EthernetServer implements begin() with no args.
 // Adapter to bridge the signature mismatch.
@@ -35,6 +65,9 @@ public:
 #define ETH_RST_PIN  39   // W5500 Reset
 #define ETH_IRQ_PIN  12   // W5500 Interrupt
 
+#define RS485_TX_PIN 17   // RS485 TXD (transceiver à direction automatique)
+#define RS485_RX_PIN 18   // RS485 RXD
+
 #define DHT_PIN      21   // DHT22 Data (connecteur interne: GPIO21)
 #define DHT_TYPE     DHT22
 
@@ -42,8 +75,9 @@ public:
 #define I2C_SCL_PIN  41   // TCA9554 SCL (I2C) - WAVESHARE OFFICIEL
 #define TCA9554_ADDR 0x20 // Adresse TCA9554
 
-// MAC Ethernet
+// MAC Ethernet (remplacée au démarrage par la MAC propre à la carte, voir netMacFromEfuse)
 byte mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED};
+bool dhcpEnabled = false;   // sinon staticIP/gateway/subnet/dns1
 IPAddress staticIP(192, 168, 1, 50);
 IPAddress gateway(192, 168, 1, 1);
 IPAddress subnet(255, 255, 255, 0);
@@ -55,8 +89,9 @@ uint16_t mqttPort = 1883;
 // ========================= MQTT IDENTIFIANTS =========================
 // Identifiants MQTT utilisés par le firmware:
 // - Fallback "en dur": DEFAULT_MQTT_USER / DEFAULT_MQTT_PASSWORD (ci-dessous)
-// - Si SPIFFS est disponible, ces valeurs peuvent être SURCHARGÉES depuis /config.json
-//   via loadMQTTConfig() dans src/web_config.h (configurable depuis l'interface Web /api/config).
+// - Ces valeurs peuvent être SURCHARGÉES par la config enregistrée (instantané NVS, importé
+//   de /config.json), via loadMQTTConfig() dans src/web_config.h (configurable depuis
+//   l'interface Web /api/config).
 //
 // NOTE: mettre des identifiants en dur n'est pas recommandé (ne pas commit sur Git).
 #ifndef DEFAULT_MQTT_USER
@@ -79,6 +114,32 @@ char topicRelayStatus[100] = "waveshare/relay/status";
 char topicInputStatus[100] = "waveshare/input/status";
 char topicSensorStatus[100] = "waveshare/sensor/status";
 char topicSystemStatus[100] = "waveshare/system/status";
+char topicRelayAck[100] = "waveshare/relay/ack";
+// Racine des topics par canal: <prefix>/relay/<n|label>/set|state, <prefix>/input/<n|label>/state
+char topicPrefix[64] = "waveshare";
+// Topics par canal précompilés (prefix, labels); reconstruit au changement de labels
+TopicRouter topicRouter;
+// LWT: "online"/"offline" retenu (référencé par la discovery Home Assistant)
+char topicAvailability[100] = "waveshare/system/availability";
+// Home Assistant discovery
+bool haDiscoveryEnabled = true;
+char haDiscoveryPrefix[32] = "homeassistant";
+char haNodeId[32] = "";
+// Encodage des statuts: JSON (historique), Sparkplug B, ou les deux
+enum MqttPayloadMode : uint8_t {
+  MQTT_PAYLOAD_JSON = 0,
+  MQTT_PAYLOAD_SPARKPLUG,
+  MQTT_PAYLOAD_BOTH,
+};
+MqttPayloadMode mqttPayloadMode = MQTT_PAYLOAD_JSON;
+char sparkplugGroup[32] = "waveshare";
+char spTopicNbirth[96] = "";
+char spTopicNdata[96] = "";
+char spTopicNcmd[96] = "";
+char spTopicNdeath[96] = "";
+
+// Topic des événements horodatés (fronts d'entrées), rejoués après une coupure broker
+const char *topicInputEvent = "waveshare/input/event";
 
 // Labels I/O (utilisés pour la publication MQTT "_named" et via /api/config)
 char relayLabels[8][16] = {"relay1", "relay2", "relay3", "relay4", "relay5", "relay6", "relay7", "relay8"};
@@ -91,8 +152,11 @@ const int digitalInputs[8] = {4, 5, 6, 7, 8, 9, 10, 11};
 DHT dht(DHT_PIN, DHT_TYPE);
 
 // État de l'application
-float temperature = 0.0;
-float humidity = 0.0;
+// temperature/humidity = dernière mesure valide (NAN tant qu'aucune lecture n'a réussi)
+float temperature = NAN;
+float humidity = NAN;
+SensorChannel sensorTemp;
+SensorChannel sensorHum;
 bool relayStates[8] = {false};
 bool inputStates[8] = {false};
 bool serverStarted = false;
@@ -102,66 +166,338 @@ bool spiffsReady = false;
 
 // Variables pour serveur HTTP simple
 uint16_t httpPort = 80;
+static const uint16_t MODBUS_TCP_PORT = 502;
 EthernetServerESP32 webServer(80);
+EthernetServerESP32 modbusServer(MODBUS_TCP_PORT);
+uint8_t modbusUnitId = 1;   // Unit ID local; les autres sont relayés vers le RS485
+
+// Modbus RTU (RS485) - configurable via /config.json
+bool rtuEnabled = false;
+uint32_t rtuBaud = 9600;
+char rtuFormat[4] = "8N1";
+uint32_t rtuTimeoutMs = 200;
+uint32_t rtuCacheMs = 1000;
+char rtuPolls[160] = "";    // "unit:fc:addr:count:period_ms;..."
+RtuMaster rtuMaster;
+
+// Protocole UDP binaire (udp_ctrl.h) - configurable via /config.json
+bool udpEnabled = false;
+uint16_t udpPort = 5005;             // commandes unicast
+IPAddress udpGroup(239, 255, 8, 8);  // état multicast
+uint16_t udpStatePort = 5006;
+uint32_t udpStateMs = 1000;
+char udpKey[64] = "";
+UdpCtrl udpCtrl;
+EthernetUDP udpCmd;
+EthernetUDP udpState;
+bool udpActive = false;
+uint8_t udpLastRelays = 0;
+uint8_t udpLastInputs = 0;
+unsigned long udpLastStateMs = 0;
+LatencyHistogram udpCmdLatency = {{0}, 0, 0, 0};   // datagramme lu -> ACK émis
+
+// Liens directs entrée locale -> relais d'une autre carte (peer_link.h)
+char peerLinks[160] = "";   // "ip:entrée:relais:mode:repli;..." (entrée/relais 1..8)
+uint32_t peerRetryMs = 20;
+uint32_t peerHeartbeatMs = 500;
+uint32_t peerTimeoutMs = 1500;
+PeerLink peerLink;
+bool peerLinkActive = false;
 
 // MQTT Client
-EthernetClient ethClient;
-PubSubClient mqttClient(ethClient);
+// Transport TCP à connexion non bloquante (voir w5500_client.h)
+W5500AsyncClient mqttTransport;
+PubSubClient mqttClient(mqttTransport);
 bool mqttConnected = false;
 unsigned long lastMqttPublish = 0;
 const unsigned long mqttPublishInterval = 5000;  // Publier chaque 5s
 unsigned long lastMqttReconnectAttempt = 0;
-const unsigned long mqttReconnectIntervalMs = 3000;
+
+// Machine d'état de connexion MQTT, avancée d'un pas par appel de mqttReconnect()
+enum MqttConnPhase : uint8_t {
+  MQTT_PHASE_IDLE = 0,     // attente du backoff
+  MQTT_PHASE_TCP,          // SYN envoyé, attente ESTABLISHED
+  MQTT_PHASE_CONNECT,      // CONNECT écrit sans attente (mqtt_packet.h)
+  MQTT_PHASE_CONNACK,      // attente des 4 octets du CONNACK
+  MQTT_PHASE_SUBSCRIBE,    // SUBSCRIBE + publication initiale
+  MQTT_PHASE_CONNECTED,
+};
+MqttConnPhase mqttPhase = MQTT_PHASE_IDLE;
+unsigned long mqttPhaseStart = 0;
+unsigned long mqttConnackMs = 0;
+const unsigned long mqttTcpConnectTimeoutMs = 3000;
+const unsigned long mqttConnackTimeoutMs = 3000;
+const uint16_t mqttKeepAliveS = 30;
+unsigned long mqttConnackWaitStart = 0;
+// Backoff exponentiel avec jitter (évite qu'une flotte reconnecte en même temps)
+const unsigned long mqttBackoffBaseMs = 1000;
+const unsigned long mqttBackoffMaxMs = 60000;
+unsigned long mqttBackoffMs = 0;
+uint8_t mqttConsecutiveFailures = 0;
+
+struct MqttConnStats {
+  uint32_t attempts;
+  uint32_t connects;
+  uint32_t tcpFailures;     // refus / timeout TCP / pas de socket libre
+  uint32_t mqttFailures;    // CONNECT refusé ou CONNACK absent
+  uint32_t disconnects;     // pertes de connexion établie
+  uint32_t lastConnectMs;   // durée de la dernière connexion réussie (SYN -> SUBACK envoyé)
+  int lastError;            // PubSubClient::state() ou -100 (TCP)
+};
+MqttConnStats mqttConnStats = {0, 0, 0, 0, 0, 0, 0};
+
+// Durée max d'une itération de loop() (fenêtre glissante de 10 s)
+uint32_t loopMaxUs = 0;
+uint32_t loopMaxUsWindow = 0;
+unsigned long loopMaxWindowStart = 0;
+
+// ===== SERVICE RÉSEAU PILOTÉ PAR IRQ (W5500 INTn) =====
+// Un sous-système (serveurs HTTP/Modbus, MQTT) n'est interrogé que pendant
+// NET_HOT_MS après un événement sur l'un de ses sockets, et au plus tard
+// toutes les NET_*_FALLBACK_MS (réarmement des sockets d'écoute, keepalive
+// MQTT, IRQ manquée). Sans travail en attente, loop() dort jusqu'à l'IRQ.
+static const uint32_t NET_HOT_MS = 50;
+static const uint32_t NET_SERVER_FALLBACK_MS = 100;
+static const uint32_t NET_MQTT_FALLBACK_MS = 250;
+volatile bool w5500IrqFlag = false;
+volatile uint32_t w5500IrqStampUs = 0;
+volatile uint32_t w5500IrqCount = 0;
+static TaskHandle_t loopTaskHandle = nullptr;
+bool netIrqActive = false;
+unsigned long netServerHotUntil = 0;
+unsigned long netMqttHotUntil = 0;
+unsigned long netLastServerPoll = 0;
+unsigned long netLastMqttPoll = 0;
+uint32_t netIdleSleeps = 0;
+LatencyHistogram netAcceptLatency = {{0}, 0, 0, 0};   // IRQ CON -> prise en charge dans loop()
+
+// Changement d'adresse à chaud (POST /api/config): appliqué sans redémarrage,
+// confirmé par une requête HTTP reçue sur la nouvelle adresse ou par la
+// reconnexion MQTT, sinon retour à l'adresse précédente après le délai.
+static const uint32_t NET_RECONF_CONFIRM_MS = 30000;
+enum NetReconfState : uint8_t {
+  NET_RECONF_IDLE = 0,
+  NET_RECONF_PENDING,
+  NET_RECONF_CONFIRMED,
+  NET_RECONF_REVERTED,
+};
+NetReconfState netReconfState = NET_RECONF_IDLE;
+bool netReconfRequested = false;      // appliqué par loop() après la réponse HTTP
+IPAddress netPrevIp, netPrevGw, netPrevMask, netPrevDns;
+unsigned long netReconfStartMs = 0;
+uint32_t netReconfApplyUs = 0;        // écriture des registres + fermeture des connexions
+uint32_t netReconfConfirmMs = 0;      // application -> première confirmation
+uint32_t netReconfChanges = 0;
+uint32_t netReconfReverts = 0;
+const char *netReconfBy = "";
+
+// DHCP non bloquant (dhcp_client.h), bail en cache dans la NVS
+DhcpClient dhcpClient;
+EthernetUDP dhcpUdp;
+bool dhcpUdpOpen = false;
+
+// Temps de démarrage (millis depuis la mise sous tension)
+const char *bootNetMode = "static";   // static, dhcp_cold ou dhcp_cached
+uint32_t bootNetReadyMs = 0;          // adresse utilisable
+uint32_t bootFirstPublishMs = 0;      // premier publish MQTT réussi
+
+// ===== SÉQUENCE DE DÉMARRAGE =====
+// Relais d'abord (état restauré depuis la NVS), puis config, W5500 et
+// serveurs; le lien et le réseau sont suivis depuis loop(). Chaque étape est
+// horodatée (µs depuis le lancement de l'application), voir GET /api/boot.
+enum RelayBootPolicy : uint8_t {
+  RELAY_BOOT_OFF = 0,                 // tous les relais OFF au démarrage
+  RELAY_BOOT_RESTORE,                 // dernier état enregistré
+};
+struct BootPhase {
+  const char *name;
+  uint32_t us;
+};
+static const uint8_t BOOT_PHASES_MAX = 16;
+BootPhase bootPhases[BOOT_PHASES_MAX];
+uint8_t bootPhaseCount = 0;
+uint8_t relayBootPolicy = RELAY_BOOT_RESTORE;   // "relay_boot" dans /config.json (copié en NVS)
+uint8_t relayBootRestored = 0;                   // masque appliqué au démarrage
+// État des relais en NVS: écrit après RELAY_PERSIST_DELAY_MS sans changement
+static const uint32_t RELAY_PERSIST_DELAY_MS = 1000;
+uint8_t relayPersistSaved = 0;
+uint8_t relayPersistSeen = 0;
+unsigned long relayPersistChangeMs = 0;
+uint32_t relayPersistWrites = 0;
+
+// Transactions SPI par seconde (dernière seconde et minimum sur 10 s = plancher au repos)
+uint32_t spiPerSec = 0;
+uint32_t spiPerSecMin = 0;
+uint32_t spiPerSecMinWindow = UINT32_MAX;
+uint32_t spiWindowCount = 0;
+unsigned long spiWindowStart = 0;
+unsigned long spiMinWindowStart = 0;
+
+// ===== BUDGET DES SOCKETS W5500 (socket_budget.h) =====
+// Réservé / plafond / inactivité par service. 8 sockets: MQTT garde toujours
+// le sien, HTTP et Modbus ne peuvent pas se prendre leur dernier socket.
+#ifndef SOCK_HTTP_MAX
+#define SOCK_HTTP_MAX 4              // écoute comprise
+#endif
+#ifndef SOCK_MODBUS_MAX
+#define SOCK_MODBUS_MAX 3
+#endif
+static const uint32_t SOCK_HTTP_IDLE_MS = 5000;      // connexions "préouvertes" des navigateurs
+static const uint32_t SOCK_MODBUS_IDLE_MS = 60000;
+static const uint32_t SOCK_BUDGET_PERIOD_MS = 250;
+SockBudget netSockets;
+unsigned long netLastSockRefresh = 0;
+
+// Rejeu de la file MQTT après reconnexion (limité pour ne pas saturer le broker)
+unsigned long lastMqttReplay = 0;
+const unsigned long mqttReplayIntervalMs = 20;
+
+// Détection des fronts d'entrées
+uint8_t lastInputMask = 0;
+unsigned long lastInputPoll = 0;
+const unsigned long inputPollIntervalMs = 20;
+
+// IP courante pré-formatée (mise à jour uniquement sur changement réseau)
+char ethIpStr[16] = "0.0.0.0";
+// Incrémenté à chaque modification des labels I/O (invalide les payloads nommés)
+uint32_t ioLabelsVersion = 0;
 
 // Suivi du lien Ethernet (W5500)
 int lastEthLinkStatus = -1;
 unsigned long lastEthLinkCheck = 0;
 const unsigned long ethLinkCheckIntervalMs = 1000;
+bool ethLinkSeen = false;   // premier lien monté (suivi rapide avant)
 
 // ===== FONCTIONS FORWARD =====
 void setRelay(int relay, bool state);
+uint8_t relayMask();
+uint8_t inputMask();
+void refreshCachedIp();
+void applyRelayMask(uint8_t mask, uint8_t values);
 void readInputs();
 void readSensors();
-String getHtmlPage();
 void handleHttpConnections();
 
 // ===== LOGS HTTP À DISTANCE (sans USB / sans MQTT) =====
-// Buffer circulaire en RAM, lisible via GET /api/logs
-static const size_t LOG_RING_LINES = 80;
-static String logRing[LOG_RING_LINES];
-static size_t logRingHead = 0;
-static size_t logRingCount = 0;
-
-static void logRingAddLine(const String &line) {
-  String s = line;
-  s.replace("\r", "");
-  // Limiter une ligne pour éviter l'explosion RAM
-  if (s.length() > 240) s = s.substring(0, 240) + "...";
-  logRing[logRingHead] = s;
-  logRingHead = (logRingHead + 1) % LOG_RING_LINES;
-  if (logRingCount < LOG_RING_LINES) logRingCount++;
-}
-
-static void logLine(const String &line) {
-  Serial.println(line);
-  logRingAddLine(line);
-}
-
-static void logLinef(const char *fmt, ...) {
-  char buf[256];
-  va_list ap;
-  va_start(ap, fmt);
-  vsnprintf(buf, sizeof(buf), fmt, ap);
-  va_end(ap);
-  Serial.println(buf);
-  logRingAddLine(String(buf));
+// Journal binaire en anneau (log_ring.h), lisible via GET /api/logs. Un
+// appel ne fait que copier ses arguments: pas de mise en forme, pas d'écho
+// série, pas de verrou; utilisable depuis une autre tâche ou une ISR. Le
+// texte est produit à la lecture, et la console série le reçoit depuis
+// loop() (logConsoleService). fmt doit être un littéral (gardé par pointeur).
+#ifndef LOG_RING_BYTES
+#define LOG_RING_BYTES 8192                // puissance de 2
+#endif
+#define LOG_LINE_MAX 160                   // ligne mise en forme (tronquée avec "...")
+#define LOG_CONSOLE_BURST 8                // lignes écrites sur la console par itération
+#define LOG_CONSOLE_GAP_MS 100             // record réservé mais jamais publié: sauté après ce délai
+
+static_assert((LOG_RING_BYTES & (LOG_RING_BYTES - 1)) == 0, "LOG_RING_BYTES: puissance de 2 attendue");
+
+static uint32_t logRingMem[LOG_RING_BYTES / 4];
+LogRing logRing = LOG_RING_INIT(logRingMem);
+
+// Coût d'un appel (cycles CPU, GET /api/mem)
+struct LogWriteStats {
+  uint32_t calls;
+  uint32_t cycles;
+  uint32_t maxCycles;
+};
+LogWriteStats logWriteStats = {0, 0, 0};
+
+static void logCommit(uint8_t level, const char *fmt, const LogPack &p, uint32_t t0) {
+  logRingWrite(logRing, level, millis(), fmt, p);
+  uint32_t c = ESP.getCycleCount() - t0;
+  __atomic_fetch_add(&logWriteStats.calls, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&logWriteStats.cycles, c, __ATOMIC_RELAXED);
+  if (c > logWriteStats.maxCycles) logWriteStats.maxCycles = c;
+}
+
+template <typename... A>
+static void logWrite(uint8_t level, const char *fmt, A... args) {
+  uint32_t t0 = ESP.getCycleCount();
+  LogPack p;
+  p.n = 0;
+  p.cut = false;
+  logPackArgs(p, args...);
+  logCommit(level, fmt, p, t0);
+}
+
+template <size_t N, typename... A>
+static inline void logLinef(const char (&fmt)[N], A... args) {
+  logWrite(LOG_LEVEL_INFO, fmt, args...);
+}
+
+template <size_t N, typename... A>
+static inline void logWarnf(const char (&fmt)[N], A... args) {
+  logWrite(LOG_LEVEL_WARN, fmt, args...);
+}
+
+// Ligne de /api/logs: "[s.mmm] " puis "W "/"E " selon le niveau
+static size_t logRecordLine(const LogRecord &rec, char *out, size_t size) {
+  static const char *const levels[] = {"", "W ", "E ", "? "};
+  int n = snprintf(out, size, "[%lu.%03lu] %s", (unsigned long)(rec.ms / 1000), (unsigned long)(rec.ms % 1000),
+                   levels[rec.level & 3]);
+  return (size_t)n + logRecordFormat(rec, out + n, size - (size_t)n);
+}
+
+// Écho sur la console série des records écrits depuis le dernier passage
+static uint32_t logConsolePos = 0;
+static uint32_t logConsoleGapPos = 0;
+static uint32_t logConsoleGapSince = 0;
+
+static void logConsoleService() {
+  uint32_t head = logRingHead(logRing);
+  if (head - logConsolePos > logRing.mask + 1) {
+    logConsolePos = logRingOldest(logRing, head);
+    Serial.println("(journal: lignes perdues sur la console)");
+  }
+  LogRecord rec;
+  char line[LOG_LINE_MAX];
+  for (int i = 0; i < LOG_CONSOLE_BURST && logConsolePos != head; i++) {
+    if (!logRingRead(logRing, logConsolePos, rec)) {
+      // Écrivain pas encore arrivé au bout (autre tâche, ISR): attendre un peu
+      if (logConsoleGapPos != logConsolePos || logConsoleGapSince == 0) {
+        logConsoleGapPos = logConsolePos;
+        logConsoleGapSince = millis() | 1;
+        return;
+      }
+      if (millis() - logConsoleGapSince < LOG_CONSOLE_GAP_MS) return;
+      logConsoleGapSince = 0;
+      logConsolePos = logRingSeek(logRing, logConsolePos + 1, head);
+      continue;
+    }
+    logConsoleGapSince = 0;
+    logRecordFormat(rec, line, sizeof(line));
+    Serial.println(line);
+    logConsolePos += rec.words;
+  }
 }
 void handleHttpLoop();
 void setupWebServer();
+void modbusService();
+void setupW5500Irq();
+void setupRs485();
+void setupUdpCtrl();
+void udpCtrlPoll();
+void udpCtrlStateService(unsigned long now);
+void udpCtrlSaveFloors();
+void setupPeerLinks();
 void setupMqtt();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
+void mqttDrainCommandLog();
+void mqttSendCommandAcks();
+void rebuildTopicRouter();
+void mqttPublishChannelStates();
+void haDiscoveryService();
+void sparkplugService();
 void mqttPublishStatus();
+void mqttPublishSensors();
+void mqttQueueService();
+void pollInputEdges();
 void mqttReconnect();
+void mqttResetConnection(bool immediate);
+void netReconfigConfirm(const char *by);
+void bootMark(const char *name);
 
 // ===== FONCTIONS IMPLÉMENTATION =====
 
@@ -195,6 +531,134 @@ void setRelay(int relay, bool state) {
   }
 }
 
+uint8_t relayMask() {
+  uint8_t m = 0;
+  for (int i = 0; i < 8; i++) {
+    if (relayStates[i]) m |= (uint8_t)(1 << i);
+  }
+  return m;
+}
+
+// Première étape mesurée de chaque nom (les suivantes sont ignorées)
+void bootMark(const char *name) {
+  for (uint8_t i = 0; i < bootPhaseCount; i++) {
+    if (strcmp(bootPhases[i].name, name) == 0) return;
+  }
+  if (bootPhaseCount >= BOOT_PHASES_MAX) return;
+  bootPhases[bootPhaseCount].name = name;
+  bootPhases[bootPhaseCount].us = micros();
+  bootPhaseCount++;
+}
+
+// Premier geste de setup(): relais à leur état restauré. Le registre de sortie
+// est écrit avant le passage des broches en sortie (au reset le TCA9554 a
+// toutes ses broches en entrée, relais retombés): aucune impulsion parasite.
+static void bootRestoreRelays() {
+  Preferences prefs;
+  prefs.begin("relays", true);
+  relayBootPolicy = prefs.getUChar("policy", RELAY_BOOT_RESTORE);
+  uint8_t saved = prefs.getUChar("mask", 0);
+  prefs.end();
+  uint8_t output = (relayBootPolicy == RELAY_BOOT_RESTORE) ? saved : 0;
+
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN); // SDA=42, SCL=41 (Waveshare official)
+  Wire.setClock(100000);
+  // Registres TCA9554: 0x00 Input, 0x01 Output, 0x02 Polarity, 0x03 Configuration
+  // Relais: logique active HIGH (bit HIGH = relais ON)
+  Wire.beginTransmission(TCA9554_ADDR);
+  Wire.write(0x01);
+  Wire.write(output);
+  Wire.endTransmission();
+  Wire.beginTransmission(TCA9554_ADDR);
+  Wire.write(0x02);   // Polarity: pas d'inversion
+  Wire.write(0x00);
+  Wire.endTransmission();
+  Wire.beginTransmission(TCA9554_ADDR);
+  Wire.write(0x03);   // Configuration: tous en OUTPUT
+  Wire.write(0x00);
+  Wire.endTransmission();
+
+  for (int i = 0; i < 8; i++) relayStates[i] = (output >> i) & 1;
+  relayBootRestored = output;
+  relayPersistSaved = saved;
+  relayPersistSeen = output;
+}
+
+// Politique lue dans /config.json, recopiée en NVS pour le prochain démarrage
+// (la config SPIFFS n'est chargée qu'après les relais)
+static void relayBootSyncPolicy(uint8_t policy) {
+  Preferences prefs;
+  prefs.begin("relays", false);
+  if (prefs.getUChar("policy", RELAY_BOOT_RESTORE) != policy) prefs.putUChar("policy", policy);
+  prefs.end();
+}
+
+// Enregistre l'état des relais une fois stable (usure de la flash)
+static void relayPersistService(unsigned long now) {
+  if (relayBootPolicy != RELAY_BOOT_RESTORE) return;
+  uint8_t m = relayMask();
+  if (m != relayPersistSeen) {
+    relayPersistSeen = m;
+    relayPersistChangeMs = now;
+  }
+  if (m == relayPersistSaved || now - relayPersistChangeMs < RELAY_PERSIST_DELAY_MS) return;
+  Preferences prefs;
+  prefs.begin("relays", false);
+  prefs.putUChar("mask", m);
+  prefs.end();
+  relayPersistSaved = m;
+  relayPersistWrites++;
+}
+
+static const char *resetReasonName(esp_reset_reason_t r) {
+  switch (r) {
+    case ESP_RST_POWERON: return "poweron";
+    case ESP_RST_EXT: return "external";
+    case ESP_RST_SW: return "software";
+    case ESP_RST_PANIC: return "panic";
+    case ESP_RST_INT_WDT: return "int_wdt";
+    case ESP_RST_TASK_WDT: return "task_wdt";
+    case ESP_RST_WDT: return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default: return "unknown";
+  }
+}
+
+// Applique plusieurs relais en une seule écriture TCA9554 (sans log série:
+// appelé depuis le callback MQTT).
+void applyRelayMask(uint8_t mask, uint8_t values) {
+  uint8_t output = (uint8_t)((relayMask() & ~mask) | (values & mask));
+  for (int i = 0; i < 8; i++) {
+    relayStates[i] = (output >> i) & 1;
+  }
+
+  Wire.beginTransmission(TCA9554_ADDR);
+  Wire.write(0x01); // Output port register
+  Wire.write(output);
+  Wire.endTransmission();
+}
+
+uint8_t inputMask() {
+  uint8_t m = 0;
+  for (int i = 0; i < 8; i++) {
+    if (inputStates[i]) m |= (uint8_t)(1 << i);
+  }
+  return m;
+}
+
+void refreshCachedIp() {
+  IPAddress ip = Ethernet.localIP();
+  renderIp(ethIpStr, sizeof(ethIpStr), ip[0], ip[1], ip[2], ip[3]);
+}
+
+// Adresse en texte dans buf (16 octets) au lieu d'un IPAddress::toString().
+// char * (non const): ArduinoJson copie la chaîne dans le document.
+static char *ipText(char *buf, IPAddress ip) {
+  renderIp(buf, 16, ip[0], ip[1], ip[2], ip[3]);
+  return buf;
+}
+
 void readInputs() {
   for (int i = 0; i < 8; i++) {
     // Entrées en INPUT_PULLUP: actif = niveau bas (0)
@@ -203,23 +667,95 @@ void readInputs() {
 }
 
 void readSensors() {
-  temperature = dht.readTemperature();
-  humidity = dht.readHumidity();
-  if (isnan(temperature)) temperature = 0.0;
-  if (isnan(humidity)) humidity = 0.0;
+  uint32_t now = millis();
+  sensorSample(sensorTemp, dht.readTemperature(), now);
+  sensorSample(sensorHum, dht.readHumidity(), now);
+  temperature = sensorTemp.value;
+  humidity = sensorHum.value;
+}
+
+// Valeur affichable ("--" si mesure invalide ou périmée), écrite dans buf
+static const char *sensorDisplay(const SensorChannel &ch, char *buf, size_t size) {
+  if (sensorState(ch, millis()) != SENSOR_OK) return "--";
+  snprintf(buf, size, "%.1f", ch.value);
+  return buf;
+}
+
+// Ajoute "<key>": valeur|null et "<key>_state" à un document JSON
+static void sensorToJson(JsonDocument &doc, const char *key, const char *stateKey, const SensorChannel &ch, uint32_t now) {
+  SensorState st = sensorState(ch, now);
+  if (st == SENSOR_OK) {
+    doc[key] = ch.value;
+  } else {
+    doc[key] = (char *)0;
+  }
+  doc[stateKey] = sensorStateName(st);
 }
 
-String getHtmlPage() {
-  String ipStr = Ethernet.localIP().toString();
-  String cfgStaticIpStr = staticIP.toString();
-  String cfgGatewayStr = gateway.toString();
-  String cfgSubnetStr = subnet.toString();
-  String cfgDnsStr = dns1.toString();
+// Page d'environ 18 Ko, plus grande que l'arène HTTP: écrite par morceaux
+// dans un tampon (pris dans l'arène) vidé vers le socket à chaque
+// remplissage, sans String ni réallocations (sert aussi pour /api/logs)
+#define HTML_CHUNK 1460                    // un segment TCP
+
+struct HtmlOut {
+  Print &sink;
+  char *buf;
+  size_t cap;
+  size_t len;
+  size_t total;                            // octets envoyés
+
+  HtmlOut(Print &out, char *mem, size_t size) : sink(out), buf(mem), cap(size), len(0), total(0) {}
 
-  String mqttStr = mqttServer.toString();
-  String mqttState = mqttConnected ? "CONNECTE" : "DECONNECTE";
+  void flush() {
+    if (len == 0) return;
+    total += sink.write((const uint8_t *)buf, len);
+    len = 0;
+  }
+  void append(const char *s, size_t n) {
+    while (n > 0) {
+      if (len == cap) flush();
+      size_t k = (cap - len < n) ? cap - len : n;
+      memcpy(buf + len, s, k);
+      len += k;
+      s += k;
+      n -= k;
+    }
+  }
+  HtmlOut &operator+=(const char *s) {
+    append(s, strlen(s));
+    return *this;
+  }
+  HtmlOut &operator+=(int v) {
+    char num[12];
+    append(num, (size_t)snprintf(num, sizeof(num), "%d", v));
+    return *this;
+  }
+  // Texte configurable (topics...): < > & " échappés
+  void appendEscaped(const char *s) {
+    for (; *s; s++) {
+      switch (*s) {
+        case '<': append("&lt;", 4); break;
+        case '>': append("&gt;", 4); break;
+        case '&': append("&amp;", 5); break;
+        case '"': append("&quot;", 6); break;
+        default: append(s, 1);
+      }
+    }
+  }
+};
 
-  String html = "<!DOCTYPE html><html><head>";
+static void writeHtmlPage(HtmlOut &html) {
+  char ipStr[16], cfgStaticIpStr[16], cfgGatewayStr[16], cfgSubnetStr[16], cfgDnsStr[16], mqttStr[16];
+  ipText(ipStr, Ethernet.localIP());
+  ipText(cfgStaticIpStr, staticIP);
+  ipText(cfgGatewayStr, gateway);
+  ipText(cfgSubnetStr, subnet);
+  ipText(cfgDnsStr, dns1);
+  ipText(mqttStr, mqttServer);
+  const char *mqttState = mqttConnected ? "CONNECTE" : "DECONNECTE";
+  char tempStr[12], humStr[12];
+
+  html += "<!DOCTYPE html><html><head>";
   html += "<meta charset='utf-8'>";
   html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
   html += "<title>ESP32-8DI8RO Dashboard</title>";
@@ -271,10 +807,10 @@ String getHtmlPage() {
   html += "<h2>Capteurs</h2>";
   html += "<div class='grid2'>";
   html += "<div class='stat'><div class='stat-value' id='temp_val'>";
-  html += String(temperature, 1);
+  html += sensorDisplay(sensorTemp, tempStr, sizeof(tempStr));
   html += "°C</div><div class='stat-label'>Temperature</div></div>";
   html += "<div class='stat'><div class='stat-value' id='hum_val'>";
-  html += String(humidity, 1);
+  html += sensorDisplay(sensorHum, humStr, sizeof(humStr));
   html += "%</div><div class='stat-label'>Humidite</div></div>";
   html += "</div></div>";
 
@@ -290,7 +826,7 @@ String getHtmlPage() {
   html += "</div><div class='stat-label'>MQTT (";
   html += mqttStr;
   html += ":";
-  html += String(mqttPort);
+  html += mqttPort;
   html += ")</div></div>";
   html += "</div></div>";
   
@@ -301,26 +837,26 @@ String getHtmlPage() {
   for (int i = 0; i < 8; i++) {
     bool isOn = relayStates[i];
     html += "<div id='relay_";
-    html += String(i + 1);
+    html += i + 1;
     html += "' class='relay-item ";
     html += (isOn ? "on" : "off");
     html += "'><div class='relay-num'>Relais ";
-    html += String(i+1);
+    html += i + 1;
     html += "<span class='io-label' id='relay_label_";
-    html += String(i + 1);
+    html += i + 1;
     html += "'>";
     html += relayLabels[i];
     html += "</span></div><div class='relay-status' id='relay_status_";
-    html += String(i + 1);
+    html += i + 1;
     html += "'>";
     html += (isOn ? "ON" : "OFF");
     html += "</div>";
     html += "<button id='relay_btn_";
-    html += String(i + 1);
+    html += i + 1;
     html += "' type='button' class='relay-btn ";
     html += (isOn ? "on" : "off");
     html += "' onclick='toggleRelay(";
-    html += String(i + 1);
+    html += i + 1;
     html += ")'>";
     html += (isOn ? "Toggle (actuellement ON)" : "Toggle (actuellement OFF)");
     html += "</button></div>";
@@ -339,18 +875,18 @@ String getHtmlPage() {
     // inputStates[i] == true  => entrée ACTIVE (niveau bas, INPUT_PULLUP)
     bool isActive = inputStates[i];
     html += "<div id='input_";
-    html += String(i + 1);
+    html += i + 1;
     html += "' class='input-item ";
     // Couleurs conservées: HIGH=bleu, LOW=jaune
     html += (isActive ? "low" : "high");
     html += "'><div class='input-num'>Entrée ";
-    html += String(i+1);
+    html += i + 1;
     html += "<span class='io-label' id='input_label_";
-    html += String(i + 1);
+    html += i + 1;
     html += "'>";
     html += inputLabels[i];
     html += "</span></div><div class='input-status' id='input_status_";
-    html += String(i + 1);
+    html += i + 1;
     html += "'>";
     html += (isActive ? "ACTIVE" : "INACTIVE");
     html += "</div></div>";
@@ -377,10 +913,10 @@ String getHtmlPage() {
   html += mqttStr;
   html += "'></div>";
   html += "<div class='cfg-field'><label>Port MQTT</label><input id='cfg_mqtt_port' placeholder='";
-  html += String(mqttPort);
+  html += mqttPort;
   html += "'></div>";
   html += "<div class='cfg-field'><label>Utilisateur MQTT</label><input id='cfg_mqtt_user' placeholder='";
-  html += String(mqttUser);
+  html += mqttUser;
   html += "'></div>";
   html += "<div class='cfg-field'><label>Mot de passe MQTT</label><input id='cfg_mqtt_pass' type='password' placeholder='(laisser vide pour ne pas changer)'></div>";
   html += "</div>";
@@ -397,9 +933,9 @@ String getHtmlPage() {
   html += "<div>";
   for (int i = 0; i < 8; i++) {
     html += "<div class='cfg-field'><label>Relais ";
-    html += String(i + 1);
+    html += i + 1;
     html += "</label><input id='cfg_rl_";
-    html += String(i + 1);
+    html += i + 1;
     html += "' maxlength='15' placeholder='";
     html += relayLabels[i];
     html += "'></div>";
@@ -408,9 +944,9 @@ String getHtmlPage() {
   html += "<div>";
   for (int i = 0; i < 8; i++) {
     html += "<div class='cfg-field'><label>Entree ";
-    html += String(i + 1);
+    html += i + 1;
     html += "</label><input id='cfg_il_";
-    html += String(i + 1);
+    html += i + 1;
     html += "' maxlength='15' placeholder='";
     html += inputLabels[i];
     html += "'></div>";
@@ -447,8 +983,8 @@ String getHtmlPage() {
   html += "function setClass(el, onClass, offClass, isOn){ if(!el) return; var want=isOn?onClass:offClass; if(el.classList.contains(want)) return; el.classList.remove(onClass); el.classList.remove(offClass); el.classList.add(want); }";
   html += "function sameArr(a,b){ if(!Array.isArray(a)||!Array.isArray(b)||a.length!==b.length) return false; for(var k=0;k<a.length;k++){ if(!!a[k]!==!!b[k]) return false; } return true; }";
   html += "function pollStatus(){ if(pollInFlight) return; pollInFlight=true; fetch('/api/status',{cache:'no-store'}).then(function(r){return r.json();}).then(function(s){";
-  html += "var tStr=(Number(s.t)||0).toFixed(1)+'°C'; if(last.t!==tStr){ last.t=tStr; setText('temp_val',tStr);}";
-  html += "var hStr=(Number(s.h)||0).toFixed(1)+'%'; if(last.h!==hStr){ last.h=hStr; setText('hum_val',hStr);}";
+  html += "var tStr=((s.t===null||s.t===undefined)?'--':Number(s.t).toFixed(1))+'°C'; if(last.t!==tStr){ last.t=tStr; setText('temp_val',tStr);}";
+  html += "var hStr=((s.h===null||s.h===undefined)?'--':Number(s.h).toFixed(1))+'%'; if(last.h!==hStr){ last.h=hStr; setText('hum_val',hStr);}";
   html += "var mqttStr=(s.mqtt? 'CONNECTE':'DECONNECTE'); if(last.mqtt!==mqttStr){ last.mqtt=mqttStr; setText('sys_mqtt',mqttStr); setText('sb_mqtt',mqttStr);}";
   html += "if(Array.isArray(s.r) && !sameArr(last.r,s.r)){ last.r=s.r.slice(0,8); for(var i=0;i<Math.min(8,s.r.length);i++){var n=i+1; var isOn=!!s.r[i]; var box=document.getElementById('relay_'+n); setClass(box,'on','off',isOn); setText('relay_status_'+n, isOn?'ON':'OFF'); var btn=document.getElementById('relay_btn_'+n); if(btn){ setClass(btn,'on','off',isOn); var bt=isOn?'Toggle (actuellement ON)':'Toggle (actuellement OFF)'; if(btn.textContent!==bt) btn.textContent=bt; } } }";
   html += "if(Array.isArray(s.i) && !sameArr(last.i,s.i)){ last.i=s.i.slice(0,8); for(var j=0;j<Math.min(8,s.i.length);j++){var n2=j+1; var isActive=!!s.i[j]; var ib=document.getElementById('input_'+n2); setClass(ib,'low','high',isActive); setText('input_status_'+n2, isActive?'ACTIVE':'INACTIVE'); } }";
@@ -477,342 +1013,1724 @@ String getHtmlPage() {
   html += "var pw=getVal('cfg_mqtt_pass'); if(pw) payload.password=pw;";
   html += "var rlbl=[]; var ilbl=[]; for(var x=1;x<=8;x++){rlbl.push(getLabelFromInput('cfg_rl_'+x,'relay_label_'+x,'relay'+x)); ilbl.push(getLabelFromInput('cfg_il_'+x,'input_label_'+x,'input'+x));} payload.relay_labels=rlbl; payload.input_labels=ilbl;";
   html += "fetch('/api/config',{method:'POST',headers:{'Content-Type':'application/json'},body:JSON.stringify(payload)}).then(function(r){return r.json();}).then(function(res){";
-  html += "if(!res || res.ok!==1){setMsg('Erreur sauvegarde: '+((res&&res.error)?res.error:'inconnue')); return;}";
-  html += "if(res && res.restart){setMsg('OK. Redemarrage...'); setTimeout(function(){ if(res.new_ip){location.href='http://'+res.new_ip+'/';} else {location.reload();}},1500);}";
+  html += "if(!res || res.ok!==1){setMsg('Erreur sauvegarde: '+((res&&res.error)?res.error:'inconnue')+((res&&res.field)?' ('+res.field+': '+res.reason+')':'')); return;}";
+  html += "if(res && res.reconfig){setMsg('OK. Nouvelle adresse '+res.new_ip+'...'); setTimeout(function(){location.href='http://'+res.new_ip+'/';},500);}";
   html += "else {setMsg('OK. Sauvegarde faite.'); var pwEl=document.getElementById('cfg_mqtt_pass'); if(pwEl) pwEl.value=''; loadConfig(); setTimeout(pollStatus,200);}";
   html += "}).catch(function(){setMsg('Erreur sauvegarde');});";
   html += "}";
   html += "loadConfig();";
   html += "pollStatus(); setInterval(pollStatus,1500);";
   html += "</script>";
-  html += "<footer>API JSON: /api/status | Config: /api/config | Controle: /relay?num=N&action=toggle | MQTT: waveshare/relay/status_named & waveshare/input/status_named</footer>";
+  html += "<footer>API JSON: /api/status | Config: /api/config | Controle: /relay?num=N&action=toggle | MQTT: ";
+  html.appendEscaped(topicRouter.relayNamedTopic);
+  html += " &amp; ";
+  html.appendEscaped(topicRouter.inputNamedTopic);
+  html += "</footer>";
   html += "</body></html>";
-  
-  return html;
 }
 
 // ===== FONCTIONS MQTT =====
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  // Traiter les commandes reçues via MQTT
-  String topicStr(topic);
-  String payloadStr("");
-  for (unsigned int i = 0; i < length; i++) {
-    payloadStr += (char)payload[i];
+static void mqttPublishBuf(const char *topic, const char *buf, size_t len) {
+  if (len == 0) return;
+  mqttClient.publish(topic, (const uint8_t *)buf, (unsigned int)len);
+}
+
+// Journal des commandes MQTT: rempli par le callback (sans I/O série),
+// vidé depuis loop() pour ne pas bloquer le traitement des messages.
+struct MqttCmdLogEntry {
+  uint8_t result;
+  uint8_t mask;
+  uint8_t values;
+  uint32_t us;
+};
+static const uint8_t MQTT_CMD_LOG_SIZE = 8;
+static MqttCmdLogEntry mqttCmdLog[MQTT_CMD_LOG_SIZE];
+static uint8_t mqttCmdLogHead = 0;
+static uint8_t mqttCmdLogCount = 0;
+static uint32_t mqttCmdLogDropped = 0;
+uint32_t mqttCmdCount = 0;
+uint32_t mqttCmdErrors = 0;
+uint32_t mqttCmdDuplicates = 0;
+uint32_t mqttCmdAcksDropped = 0;
+// Réception -> écriture TCA9554 terminée (commandes appliquées uniquement)
+LatencyHistogram mqttCmdLatency = {{0}, 0, 0, 0};
+
+static void mqttCmdLogPush(MqttCmdResult result, const RelayCommand &cmd, uint32_t us) {
+  if (mqttCmdLogCount == MQTT_CMD_LOG_SIZE) {
+    mqttCmdLogDropped++;
+    return;
   }
-  
-  Serial.printf("\n📨 MQTT Reçu:\n");
-  Serial.printf("   Topic: %s\n", topic);
-  Serial.printf("   Payload: %s\n", payloadStr.c_str());
-  Serial.printf("   Expected: %s\n", topicRelayCmd);
-  Serial.printf("   Match: %s\n", (topicStr == topicRelayCmd) ? "OUI" : "NON");
-  
-  // Parser commandes de relais: waveshare/relay/cmd
-  if (topicStr == topicRelayCmd) {
-    Serial.println("✓ Topic reconnu - parsing...");
-    
-    // Format: "0:on" ou "1:off" ou "ALL:on"
-    int colonPos = payloadStr.indexOf(':');
-    Serial.printf("   Colon position: %d\n", colonPos);
-    
-    if (colonPos > 0) {
-      String relayStr = payloadStr.substring(0, colonPos);
-      String stateStr = payloadStr.substring(colonPos + 1);
-      stateStr.toLowerCase();
-      
-      Serial.printf("   Relay: %s, State: %s\n", relayStr.c_str(), stateStr.c_str());
-      
-      bool isOn = (stateStr == "on" || stateStr == "1");
-      
-      if (relayStr == "ALL") {
-        // Tous les relais
-        for (int i = 0; i < 8; i++) {
-          setRelay(i, isOn);
-        }
-        Serial.println("✓ Tous les relais: " + stateStr);
-      } else {
-        // Relais spécifique
-        int relayNum = relayStr.toInt();
-        Serial.printf("   Relais numero: %d\n", relayNum);
-        
-        if (relayNum >= 0 && relayNum < 8) {
-          setRelay(relayNum, isOn);
-          Serial.printf("✓ Relais %d: %s\n", relayNum, stateStr.c_str());
-        } else {
-          Serial.printf("✗ Numero relais invalide: %d\n", relayNum);
-        }
-      }
+  MqttCmdLogEntry &e = mqttCmdLog[(mqttCmdLogHead + mqttCmdLogCount) % MQTT_CMD_LOG_SIZE];
+  e.result = result;
+  e.mask = cmd.mask;
+  e.values = cmd.values;
+  e.us = us;
+  mqttCmdLogCount++;
+}
+
+void mqttDrainCommandLog() {
+  while (mqttCmdLogCount > 0) {
+    const MqttCmdLogEntry &e = mqttCmdLog[mqttCmdLogHead];
+    if (e.result == MQTT_CMD_OK) {
+      logLinef("MQTT cmd: mask=0x%02X values=0x%02X (%lu us)", e.mask, e.values, (unsigned long)e.us);
     } else {
-      Serial.println("✗ Format invalide (attendu: 0:on ou ALL:off)");
+      logWarnf("MQTT cmd rejetee: %s", mqttCmdResultName((MqttCmdResult)e.result));
     }
-  } else {
-    Serial.println("✗ Topic non reconnu");
+    mqttCmdLogHead = (mqttCmdLogHead + 1) % MQTT_CMD_LOG_SIZE;
+    mqttCmdLogCount--;
+  }
+  if (mqttCmdLogDropped > 0) {
+    logWarnf("MQTT cmd: %lu entrees de log perdues", (unsigned long)mqttCmdLogDropped);
+    mqttCmdLogDropped = 0;
   }
 }
 
-void mqttPublishStatus() {
-  if (!mqttClient.connected()) return;
-  
-  // État des relais
-  StaticJsonDocument<256> relayDoc;
-  for (int i = 0; i < 8; i++) {
-    relayDoc[i] = relayStates[i] ? 1 : 0;
+// Suppression des doublons: empreinte FNV-1a des derniers ids vus.
+// Une redélivrance QoS1 dans la fenêtre n'est pas réappliquée (mais acquittée).
+static const uint8_t MQTT_CMD_DEDUP_SIZE = 16;
+static const uint32_t MQTT_CMD_DEDUP_WINDOW_MS = 10000;
+struct MqttCmdSeenId {
+  uint32_t hash;
+  uint32_t ms;
+};
+static MqttCmdSeenId mqttCmdSeen[MQTT_CMD_DEDUP_SIZE];
+static uint8_t mqttCmdSeenNext = 0;
+
+static uint32_t mqttCmdIdHash(CmdSlice id) {
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < id.len; i++) {
+    h ^= (uint8_t)id.p[i];
+    h *= 16777619UL;
   }
-  String relayStatus;
-  serializeJson(relayDoc, relayStatus);
-  mqttClient.publish(topicRelayStatus, relayStatus.c_str());
+  return h ? h : 1;  // 0 = entrée libre
+}
 
-  // État des relais "nommé" (clé = label)
-  StaticJsonDocument<384> relayNamedDoc;
-  for (int i = 0; i < 8; i++) {
-    relayNamedDoc[relayLabels[i]] = relayStates[i] ? 1 : 0;
+// true si l'id a déjà été vu dans la fenêtre; sinon l'enregistre
+static bool mqttCmdSeenRecently(CmdSlice id, uint32_t now) {
+  uint32_t h = mqttCmdIdHash(id);
+  for (uint8_t i = 0; i < MQTT_CMD_DEDUP_SIZE; i++) {
+    if (mqttCmdSeen[i].hash == h && now - mqttCmdSeen[i].ms < MQTT_CMD_DEDUP_WINDOW_MS) return true;
   }
-  String relayNamed;
-  serializeJson(relayNamedDoc, relayNamed);
-  mqttClient.publish("waveshare/relay/status_named", relayNamed.c_str());
-  
-  // État des entrées
-  StaticJsonDocument<256> inputDoc;
-  for (int i = 0; i < 8; i++) {
-    inputDoc[i] = inputStates[i] ? 1 : 0;
+  mqttCmdSeen[mqttCmdSeenNext].hash = h;
+  mqttCmdSeen[mqttCmdSeenNext].ms = now;
+  mqttCmdSeenNext = (mqttCmdSeenNext + 1) % MQTT_CMD_DEDUP_SIZE;
+  return false;
+}
+
+// Acquittements en attente: l'id est copié car le payload vit dans le buffer
+// de PubSubClient, réutilisé par publish(). Envoyés depuis loop().
+struct MqttCmdAck {
+  char id[MQTT_CMD_ID_MAX + 1];
+  uint8_t result;
+  uint8_t mask;
+  uint8_t values;
+  uint8_t relays;
+  uint32_t us;
+};
+static const uint8_t MQTT_CMD_ACK_SIZE = 8;
+static MqttCmdAck mqttCmdAcks[MQTT_CMD_ACK_SIZE];
+static uint8_t mqttCmdAckHead = 0;
+static uint8_t mqttCmdAckCount = 0;
+
+static void mqttCmdAckPush(CmdSlice id, MqttCmdResult result, const RelayCommand &cmd, uint32_t us) {
+  if (mqttCmdAckCount == MQTT_CMD_ACK_SIZE) {
+    mqttCmdAcksDropped++;
+    return;
   }
-  String inputStatus;
-  serializeJson(inputDoc, inputStatus);
-  mqttClient.publish(topicInputStatus, inputStatus.c_str());
+  MqttCmdAck &a = mqttCmdAcks[(mqttCmdAckHead + mqttCmdAckCount) % MQTT_CMD_ACK_SIZE];
+  memcpy(a.id, id.p, id.len);
+  a.id[id.len] = '\0';
+  a.result = result;
+  a.mask = cmd.mask;
+  a.values = cmd.values;
+  a.relays = relayMask();
+  a.us = us;
+  mqttCmdAckCount++;
+}
 
-  // État des entrées "nommé" (clé = label)
-  StaticJsonDocument<384> inputNamedDoc;
-  for (int i = 0; i < 8; i++) {
-    inputNamedDoc[inputLabels[i]] = inputStates[i] ? 1 : 0;
+// {"id":"..","result":"ok","mask":5,"values":1,"relays":3,"latency_us":412}
+void mqttSendCommandAcks() {
+  static char ackBuf[160];
+  while (mqttCmdAckCount > 0) {
+    const MqttCmdAck &a = mqttCmdAcks[mqttCmdAckHead];
+    if (!mqttClient.connected()) {
+      mqttCmdAcksDropped++;
+    } else {
+      size_t len = jsonAppendString(ackBuf, sizeof(ackBuf), 6, a.id);
+      if (len > 0) {
+        memcpy(ackBuf, "{\"id\":", 6);
+        int n = snprintf(ackBuf + len, sizeof(ackBuf) - len,
+                         ",\"result\":\"%s\",\"mask\":%u,\"values\":%u,\"relays\":%u,\"latency_us\":%lu}",
+                         mqttCmdResultName((MqttCmdResult)a.result), a.mask, a.values, a.relays, (unsigned long)a.us);
+        if (n > 0 && (size_t)n < sizeof(ackBuf) - len) mqttPublishBuf(topicRelayAck, ackBuf, len + (size_t)n);
+      }
+    }
+    mqttCmdAckHead = (mqttCmdAckHead + 1) % MQTT_CMD_ACK_SIZE;
+    mqttCmdAckCount--;
   }
-  String inputNamed;
-  serializeJson(inputNamedDoc, inputNamed);
-  mqttClient.publish("waveshare/input/status_named", inputNamed.c_str());
-  
-  // État des capteurs
-  StaticJsonDocument<128> sensorDoc;
-  sensorDoc["temperature"] = temperature;
-  sensorDoc["humidity"] = humidity;
-  String sensorStatus;
-  serializeJson(sensorDoc, sensorStatus);
-  mqttClient.publish(topicSensorStatus, sensorStatus.c_str());
-  
-  // État du système
-  StaticJsonDocument<128> systemDoc;
-  systemDoc["ip"] = Ethernet.localIP().toString();
-  systemDoc["mqtt"] = "connected";
-  systemDoc["uptime"] = millis() / 1000;
-  String systemStatus;
-  serializeJson(systemDoc, systemStatus);
-  mqttClient.publish(topicSystemStatus, systemStatus.c_str());
 }
 
-void mqttReconnect() {
-  // Reconnexion MQTT NON-BLOQUANTE (important pour garder HTTP réactif)
-  if (mqttClient.connected()) {
-    mqttConnected = true;
-    return;
+// ===== SPARKPLUG B =====
+// spBv1.0/<groupe>/NBIRTH|NDATA|NCMD|NDEATH/<node>; métriques et alias: sparkplug.h.
+// Horodatage: millis() (pas d'horloge murale sur la carte).
+static uint8_t spSeq = 0;
+static uint8_t spBdSeq = 0;                // 1..255 (jamais 0: voir sparkplugBuildDeath)
+static bool spRebirthPending = false;
+static int spPublishedRelays = -1;
+static int spPublishedInputs = -1;
+static float spPublishedTemp = NAN;
+static float spPublishedHum = NAN;
+static uint8_t spPayloadBuf[HA_PAYLOAD_MAX];
+static char spDeathBuf[32];
+uint32_t spBirths = 0;
+uint32_t spEncodeUs = 0;
+
+static size_t spNcmdTopicLen = 0;
+
+static bool sparkplugIsNcmd(const char *topic, size_t len) {
+  return mqttPayloadMode != MQTT_PAYLOAD_JSON && len == spNcmdTopicLen && memcmp(topic, spTopicNcmd, len) == 0;
+}
+
+const char *mqttPayloadModeName() {
+  switch (mqttPayloadMode) {
+    case MQTT_PAYLOAD_SPARKPLUG: return "sparkplug";
+    case MQTT_PAYLOAD_BOTH: return "both";
+    default: return "json";
   }
+}
 
-  mqttConnected = false;
+void mqttSetPayloadMode(const char *name) {
+  if (!name) return;
+  if (strcmp(name, "sparkplug") == 0) mqttPayloadMode = MQTT_PAYLOAD_SPARKPLUG;
+  else if (strcmp(name, "both") == 0) mqttPayloadMode = MQTT_PAYLOAD_BOTH;
+  else if (strcmp(name, "json") == 0) mqttPayloadMode = MQTT_PAYLOAD_JSON;
+}
 
-  // Ne pas spammer des tentatives si le lien Ethernet est down
-  if (Ethernet.hardwareStatus() == EthernetNoHardware) {
-    return;
+void sparkplugBuildTopics() {
+  snprintf(spTopicNbirth, sizeof(spTopicNbirth), "spBv1.0/%s/NBIRTH/%s", sparkplugGroup, haNodeId);
+  snprintf(spTopicNdata, sizeof(spTopicNdata), "spBv1.0/%s/NDATA/%s", sparkplugGroup, haNodeId);
+  snprintf(spTopicNcmd, sizeof(spTopicNcmd), "spBv1.0/%s/NCMD/%s", sparkplugGroup, haNodeId);
+  snprintf(spTopicNdeath, sizeof(spTopicNdeath), "spBv1.0/%s/NDEATH/%s", sparkplugGroup, haNodeId);
+  spNcmdTopicLen = strlen(spTopicNcmd);
+}
+
+// NDEATH pour le LWT: PubSubClient prend le message de will en chaîne C (strlen),
+// il ne doit donc contenir aucun octet nul: pas de timestamp et bdSeq != 0.
+const char *sparkplugBuildDeath() {
+  if (++spBdSeq == 0) spBdSeq = 1;
+  size_t len = spEncodeDeath((uint8_t *)spDeathBuf, sizeof(spDeathBuf) - 1, spBdSeq);
+  spDeathBuf[len] = '\0';
+  return spDeathBuf;
+}
+
+static void sparkplugPublishBirth() {
+  uint32_t t0 = micros();
+  uint8_t relays = relayMask();
+  uint8_t inputs = inputMask();
+  uint32_t now = millis();
+  float t = (sensorState(sensorTemp, now) == SENSOR_OK) ? sensorTemp.value : NAN;
+  float h = (sensorState(sensorHum, now) == SENSOR_OK) ? sensorHum.value : NAN;
+
+  SpNodeSnapshot snap = {relays, inputs, t, h, now, ethIpStr};
+  spSeq = 0;
+  size_t len = spEncodeBirth(spPayloadBuf, sizeof(spPayloadBuf), now, spBdSeq, snap, spSeq++);
+  spEncodeUs = micros() - t0;
+  if (len == 0) return;
+
+  if (mqttClient.publish(spTopicNbirth, spPayloadBuf, (unsigned int)len, false)) {
+    spBirths++;
+    spPublishedRelays = relays;
+    spPublishedInputs = inputs;
+    spPublishedTemp = t;
+    spPublishedHum = h;
+    spRebirthPending = false;
   }
-  if (Ethernet.linkStatus() == LinkOFF) {
-    return;
+}
+
+static bool spFloatChanged(float a, float b) {
+  if (a != a || b != b) return (a != a) != (b != b);
+  return a != b;
+}
+
+// NDATA par exception: seulement les métriques modifiées (+ uptime si periodic)
+static void sparkplugPublishData(bool periodic) {
+  uint8_t relays = relayMask();
+  uint8_t inputs = inputMask();
+  uint32_t now = millis();
+  float t = (sensorState(sensorTemp, now) == SENSOR_OK) ? sensorTemp.value : NAN;
+  float h = (sensorState(sensorHum, now) == SENSOR_OK) ? sensorHum.value : NAN;
+  uint8_t relayChanged = (uint8_t)(relays ^ spPublishedRelays);
+  uint8_t inputChanged = (uint8_t)(inputs ^ spPublishedInputs);
+  bool tChanged = spFloatChanged(t, spPublishedTemp);
+  bool hChanged = spFloatChanged(h, spPublishedHum);
+  if (!periodic && !relayChanged && !inputChanged && !tChanged && !hChanged) return;
+
+  uint32_t t0 = micros();
+  SpNodeSnapshot snap = {relays, inputs, t, h, now, ethIpStr};
+  SpDataChanges changes = {relayChanged, inputChanged, tChanged, hChanged, periodic};
+  size_t len = spEncodeData(spPayloadBuf, sizeof(spPayloadBuf), now, snap, changes, spSeq);
+  spEncodeUs = micros() - t0;
+  if (len == 0) return;
+
+  if (mqttClient.publish(spTopicNdata, spPayloadBuf, (unsigned int)len, false)) {
+    spSeq++;
+    spPublishedRelays = relays;
+    spPublishedInputs = inputs;
+    spPublishedTemp = t;
+    spPublishedHum = h;
   }
+}
 
-  unsigned long now = millis();
-  if (now - lastMqttReconnectAttempt < mqttReconnectIntervalMs) {
+// Appelé à chaque itération quand connecté: rebirth demandé ou changement d'état
+void sparkplugService() {
+  if (mqttPayloadMode == MQTT_PAYLOAD_JSON || !mqttClient.connected()) return;
+  if (spRebirthPending) {
+    sparkplugPublishBirth();
     return;
   }
-  lastMqttReconnectAttempt = now;
+  sparkplugPublishData(false);
+}
 
-  Serial.print("Tentative MQTT... ");
+static int channelRelayPublished = -1;   // -1: tout republier
+static int channelInputPublished = -1;
 
-  // Assainir le socket avant de retenter (utile après coupure de câble / reset)
-  ethClient.stop();
+void rebuildTopicRouter() {
+  topicRouterBuild(topicRouter, topicPrefix, topicRelayCmd, relayLabels, inputLabels);
+  channelRelayPublished = -1;
+  channelInputPublished = -1;
+}
 
-  bool ok = false;
-  if (mqttUser[0] == '\0') {
-    ok = mqttClient.connect(mqttClientID);
-  } else {
-    ok = mqttClient.connect(mqttClientID, mqttUser, mqttPassword);
-  }
+// Payload des topics .../set: on/off/1/0/true/false ou "toggle"
+static MqttCmdResult mqttParseChannelSet(const uint8_t *payload, size_t length, int relay, RelayCommand &cmd) {
+  CmdSlice s = cmdTrim(CmdSlice{(const char *)payload, length});
+  if (s.len == 0) return MQTT_CMD_EMPTY;
+  bool on;
+  if (cmdEquals(s, "toggle")) on = !relayStates[relay];
+  else if (!cmdParseState(s, on)) return MQTT_CMD_BAD_STATE;
+  cmd.mask = (uint8_t)(1u << relay);
+  cmd.values = on ? cmd.mask : 0;
+  return MQTT_CMD_OK;
+}
 
-  if (ok) {
-    Serial.println("✓ Connecté");
-    mqttConnected = true;
-    mqttClient.subscribe(topicRelayCmd);
-    Serial.println("✓ Souscrit à " + String(topicRelayCmd));
-    mqttPublishStatus();
-  } else {
-    Serial.printf("✗ Erreur: code %d\n", mqttClient.state());
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  // Parsing direct du buffer PubSubClient (aucune copie, aucun String)
+  uint32_t t0 = micros();
+  RelayCommand cmd = {0, 0};
+  CmdSlice id = {nullptr, 0};
+  MqttCmdResult result = MQTT_CMD_UNKNOWN_TOPIC;
+
+  int relay = -1;
+  size_t topicLen = strlen(topic);
+  TopicRoute route = topicRouterMatch(topicRouter, topic, topicLen, relay);
+  if (route == TOPIC_ROUTE_NONE && sparkplugIsNcmd(topic, topicLen)) {
+    bool rebirth = false;
+    result = spParseNcmd(payload, length, cmd, rebirth);
+    if (rebirth) spRebirthPending = true;
+  } else if (route == TOPIC_ROUTE_RELAY_CMD) {
+    result = mqttParseRelayCommand(payload, length, cmd, &id);
+    if (result == MQTT_CMD_OK && id.len > 0 && mqttCmdSeenRecently(id, millis())) {
+      result = MQTT_CMD_DUPLICATE;
+      mqttCmdDuplicates++;
+    }
+  } else if (route == TOPIC_ROUTE_RELAY_SET) {
+    result = mqttParseChannelSet(payload, length, relay, cmd);
+  }
+  if (result == MQTT_CMD_OK && cmd.mask != 0) {
+    applyRelayMask(cmd.mask, cmd.values);
   }
+
+  uint32_t us = micros() - t0;
+  mqttCmdCount++;
+  if (result == MQTT_CMD_OK) latencyHistRecord(mqttCmdLatency, us);
+  else if (result != MQTT_CMD_DUPLICATE) mqttCmdErrors++;
+  mqttCmdLogPush(result, cmd, us);
+  if (id.len > 0) mqttCmdAckPush(id, result, cmd, us);
 }
 
-void setupMqtt() {
-  Serial.println("\n=== Configuration MQTT ===");
-  
-  // Configurer le serveur MQTT
-  mqttClient.setServer(mqttServer, mqttPort);
-  mqttClient.setCallback(mqttCallback);
-  mqttClient.setKeepAlive(30);
-  mqttClient.setSocketTimeout(2);
-  
-  Serial.printf("Broker: %d.%d.%d.%d:%d\n", 
-    mqttServer[0], mqttServer[1], mqttServer[2], mqttServer[3], mqttPort);
-  
-  // Tentative de connexion
-  mqttReconnect();
+// <prefix>/<kind>/<n>/state (retenu) + alias <prefix>/<kind>/<label>/state
+static void mqttPublishChannel(const char *kind, int index, const char *slug, bool on) {
+  char topic[TOPIC_ROUTER_PREFIX_MAX + 40];
+  const char *payload = on ? "ON" : "OFF";
+  int n = snprintf(topic, sizeof(topic), "%s/%s/%d/state", topicPrefix, kind, index);
+  if (n > 0 && (size_t)n < sizeof(topic)) mqttClient.publish(topic, payload, true);
+  if (slug[0] == '\0') return;
+  n = snprintf(topic, sizeof(topic), "%s/%s/%s/state", topicPrefix, kind, slug);
+  if (n > 0 && (size_t)n < sizeof(topic)) mqttClient.publish(topic, payload, true);
 }
 
-static void sendHttp(EthernetClient &client, const char *status, const char *contentType, const String &body) {
-  client.print("HTTP/1.1 ");
-  client.println(status);
-  client.println("Connection: close");
-  client.print("Content-Type: ");
-  client.println(contentType);
-  client.print("Content-Length: ");
-  client.println(body.length());
-  client.println();
-
-  const char *ptr = body.c_str();
-  size_t remaining = body.length();
-  while (remaining > 0 && client.connected()) {
-    size_t chunk = remaining;
-    if (chunk > 1024) chunk = 1024;
-    size_t written = client.write((const uint8_t *)ptr, chunk);
-    if (written == 0) {
-      delay(1);
-      continue;
+// Publie uniquement les canaux dont l'état a changé depuis la dernière publication
+void mqttPublishChannelStates() {
+  if (!mqttClient.connected()) return;
+  uint8_t relays = relayMask();
+  if (channelRelayPublished != relays) {
+    uint8_t changed = (channelRelayPublished < 0) ? 0xFF : (uint8_t)(relays ^ channelRelayPublished);
+    for (int i = 0; i < 8; i++) {
+      if (changed & (1u << i)) mqttPublishChannel("relay", i, topicRouter.relaySlug[i], (relays >> i) & 1);
+    }
+    channelRelayPublished = relays;
+  }
+  uint8_t inputs = inputMask();
+  if (channelInputPublished != inputs) {
+    uint8_t changed = (channelInputPublished < 0) ? 0xFF : (uint8_t)(inputs ^ channelInputPublished);
+    for (int i = 0; i < 8; i++) {
+      if (changed & (1u << i)) mqttPublishChannel("input", i, topicRouter.inputSlug[i], (inputs >> i) & 1);
     }
-    ptr += written;
-    remaining -= written;
+    channelInputPublished = inputs;
   }
-  client.flush();
 }
 
-static String getQueryParam(const String &query, const char *key) {
-  // query without leading '?'
-  String k = String(key) + "=";
-  int start = query.indexOf(k);
-  if (start < 0) return "";
-  start += k.length();
-  int end = query.indexOf('&', start);
-  if (end < 0) end = query.length();
-  return query.substring(start, end);
+// Publication de la discovery HA: toutes les entités d'un coup, regroupées en
+// un minimum de SEND (cork) et sans attendre d'acquittement entre messages.
+// Si le buffer TX du socket est plein, la suite part à l'itération suivante.
+static int haDiscoveryNext = -1;             // prochaine entité, -1 = rien en cours
+static uint32_t haDiscoveryVersion = UINT32_MAX;
+static bool haDiscoveryWaitAck = false;
+static uint32_t haDiscoveryStartMs = 0;
+uint32_t haDiscoveryMs = 0;                  // CONNACK (ou changement labels) -> dernier SEND_OK
+uint32_t haDiscoveryBursts = 0;
+
+static void haDiscoveryRequest(uint32_t startMs) {
+  if (!haDiscoveryEnabled) return;
+  haDiscoveryNext = 0;
+  haDiscoveryStartMs = startMs;
 }
 
-static void handleRelayQuery(const String &query) {
-  // Supported:
-  //  /relay?num=1&action=toggle
-  //  /relay?action=all_toggle
-  String action = getQueryParam(query, "action");
-  String numStr = getQueryParam(query, "num");
+void haDiscoveryService() {
+  if (!haDiscoveryEnabled || !mqttClient.connected()) return;
+  if (haDiscoveryNext < 0 && haDiscoveryVersion != ioLabelsVersion) haDiscoveryRequest(millis());
+
+  if (haDiscoveryNext >= 0) {
+    static char haTopic[128];
+    static char haPayload[HA_PAYLOAD_MAX];
+    HaDiscoveryContext ctx = {haDiscoveryPrefix, haNodeId, topicPrefix, topicSensorStatus,
+                              topicAvailability, relayLabels, inputLabels};
+    mqttTransport.cork();
+    while (haDiscoveryNext < HA_ENTITY_COUNT) {
+      size_t len = haRenderEntity(ctx, haDiscoveryNext, haTopic, sizeof(haTopic), haPayload, sizeof(haPayload));
+      if (len == 0) {
+        haDiscoveryNext++;
+        continue;
+      }
+      // Paquet PUBLISH: en-tête fixe (<= 5) + longueur topic (2) + topic + payload
+      size_t packet = 7 + strlen(haTopic) + len;
+      if (mqttTransport.txFree() < packet) break;
+      if (!mqttClient.publish(haTopic, (const uint8_t *)haPayload, (unsigned int)len, true)) break;
+      haDiscoveryNext++;
+    }
+    mqttTransport.uncork();
+    if (haDiscoveryNext >= HA_ENTITY_COUNT) {
+      haDiscoveryNext = -1;
+      haDiscoveryVersion = ioLabelsVersion;
+      haDiscoveryWaitAck = true;
+    }
+  }
 
-  if (action == "all_toggle") {
-    for (int i = 0; i < 8; i++) setRelay(i, !relayStates[i]);
-    return;
+  if (haDiscoveryWaitAck && mqttTransport.sendIdle()) {
+    haDiscoveryWaitAck = false;
+    haDiscoveryMs = millis() - haDiscoveryStartMs;
+    haDiscoveryBursts++;
+    logLinef("HA discovery: %d entites publiees en %lu ms", HA_ENTITY_COUNT, (unsigned long)haDiscoveryMs);
   }
+}
 
-  int relayNum = numStr.toInt();
-  if (relayNum < 1 || relayNum > 8) return;
-  int relayIndex = relayNum - 1;
+// Payloads de statut rendus dans des buffers fixes; les parties relais/entrées
+// ne sont régénérées que si l'état ou les labels ont changé.
+static char statusRelayBuf[20];
+static char statusRelayNamedBuf[320];
+static char statusInputBuf[20];
+static char statusInputNamedBuf[320];
+static char statusSystemBuf[96];
+static size_t statusRelayLen = 0;
+static size_t statusRelayNamedLen = 0;
+static size_t statusInputLen = 0;
+static size_t statusInputNamedLen = 0;
+static int statusRelayRendered = -1;
+static int statusInputRendered = -1;
+static uint32_t statusLabelsRendered = UINT32_MAX;
+uint32_t statusPublishUs = 0;
 
-  if (action == "toggle") {
-    setRelay(relayIndex, !relayStates[relayIndex]);
-  } else if (action == "on") {
-    setRelay(relayIndex, true);
-  } else if (action == "off") {
-    setRelay(relayIndex, false);
+void mqttPublishStatus() {
+  if (!mqttClient.connected()) return;
+  if (mqttPayloadMode != MQTT_PAYLOAD_JSON && spBirths > 0) sparkplugPublishData(true);
+  if (mqttPayloadMode == MQTT_PAYLOAD_SPARKPLUG) return;
+  uint32_t t0 = micros();
+
+  bool labelsChanged = (statusLabelsRendered != ioLabelsVersion);
+  uint8_t relays = relayMask();
+  if (labelsChanged || statusRelayRendered != relays) {
+    statusRelayLen = renderBitArray(statusRelayBuf, sizeof(statusRelayBuf), relays);
+    statusRelayNamedLen = renderNamedBits(statusRelayNamedBuf, sizeof(statusRelayNamedBuf), relayLabels, relays);
+    statusRelayRendered = relays;
+  }
+  uint8_t inputs = inputMask();
+  if (labelsChanged || statusInputRendered != inputs) {
+    statusInputLen = renderBitArray(statusInputBuf, sizeof(statusInputBuf), inputs);
+    statusInputNamedLen = renderNamedBits(statusInputNamedBuf, sizeof(statusInputNamedBuf), inputLabels, inputs);
+    statusInputRendered = inputs;
   }
+  statusLabelsRendered = ioLabelsVersion;
+
+  // Le système change à chaque cycle (uptime): rendu direct
+  int n = snprintf(statusSystemBuf, sizeof(statusSystemBuf), "{\"ip\":\"%s\",\"mqtt\":\"connected\",\"uptime\":%lu}",
+                   ethIpStr, (unsigned long)(millis() / 1000));
+  size_t systemLen = (n > 0 && (size_t)n < sizeof(statusSystemBuf)) ? (size_t)n : 0;
+
+  mqttPublishBuf(topicRelayStatus, statusRelayBuf, statusRelayLen);
+  mqttPublishBuf(topicRouter.relayNamedTopic, statusRelayNamedBuf, statusRelayNamedLen);
+  mqttPublishBuf(topicInputStatus, statusInputBuf, statusInputLen);
+  mqttPublishBuf(topicRouter.inputNamedTopic, statusInputNamedBuf, statusInputNamedLen);
+  // Les capteurs ont leur propre cadence (deadband): voir mqttPublishSensors()
+  mqttPublishBuf(topicSystemStatus, statusSystemBuf, systemLen);
+
+  statusPublishUs = micros() - t0;
 }
 
-void setupWebServer() {
-  webServer.begin(httpPort);
-  Serial.println("✓ HTTP server started (W5500) port 80");
+// "key":valeur|null,"key_state":"..." (sans accolades)
+static size_t renderSensorFields(char *buf, size_t cap, const char *key, const SensorChannel &ch, uint32_t now) {
+  SensorState st = sensorState(ch, now);
+  int n;
+  if (st == SENSOR_OK) {
+    n = snprintf(buf, cap, "\"%s\":%.1f,\"%s_state\":\"ok\"", key, ch.value, key);
+  } else {
+    n = snprintf(buf, cap, "\"%s\":null,\"%s_state\":\"%s\"", key, key, sensorStateName(st));
+  }
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
 }
 
-void handleHttpLoop() {
-  EthernetClient client = webServer.available();
-  if (!client) return;
+// Identifiants de topics pour la file store-and-forward
+enum MqttQueueTopic : uint8_t {
+  MQTT_Q_INPUT_EVENT = 0,
+  MQTT_Q_SENSOR = 1,
+};
 
-  client.setTimeout(200);
+static const char *mqttQueueTopicName(uint8_t id) {
+  return (id == MQTT_Q_SENSOR) ? topicSensorStatus : topicInputEvent;
+}
 
-  // Read request line (e.g. "GET /path?x=y HTTP/1.1")
-  String requestLine = client.readStringUntil('\n');
-  requestLine.trim();
+// Publie directement si possible, sinon met en file (ordre préservé:
+// tant que la file n'est pas vide, tout passe par elle).
+void mqttPublishEvent(uint8_t topicId, const char *payload, size_t len) {
+  if (mqttClient.connected() && mqttQueueDepth() == 0) {
+    if (mqttClient.publish(mqttQueueTopicName(topicId), (const uint8_t *)payload, (unsigned int)len)) return;
+  }
+  mqttQueuePush(topicId, millis(), payload, len);
+}
 
-  size_t contentLength = 0;
-  String otaKeyHeader = "";
-  bool isChunked = false;
-  // Read headers
-  while (client.connected()) {
-    String line = client.readStringUntil('\n');
-    line.trim();
-    if (line.length() == 0) break;
-    String lower = line;
-    lower.toLowerCase();
-    if (lower.startsWith("content-length:")) {
-      int colon = line.indexOf(':');
-      if (colon >= 0) {
-        String v = line.substring(colon + 1);
-        v.trim();
-        contentLength = (size_t)v.toInt();
-      }
-    } else if (lower.startsWith("transfer-encoding:")) {
-      if (lower.indexOf("chunked") >= 0) {
-        isChunked = true;
-      }
-    } else if (lower.startsWith("x-ota-key:")) {
-      int colon = line.indexOf(':');
-      otaKeyHeader = (colon >= 0) ? line.substring(colon + 1) : "";
-      otaKeyHeader.trim();
-    }
+// Rejoue un message de la file par intervalle tant que le broker est joignable
+void mqttQueueService() {
+  if (mqttQueueDepth() == 0 || !mqttClient.connected()) return;
+  unsigned long now = millis();
+  if (now - lastMqttReplay < mqttReplayIntervalMs) return;
+  lastMqttReplay = now;
+
+  MqttQueuedMsg m;
+  if (!mqttQueuePeek(m)) return;
+  if (mqttClient.publish(mqttQueueTopicName(m.topic), (const uint8_t *)m.payload, m.len)) {
+    mqttQueuePop();
+    mqttQueueStats.replayed++;
+  }
+}
+
+// Publie les capteurs uniquement si un canal a franchi son deadband,
+// changé d'état (ok/invalid/stale) ou atteint son intervalle max.
+// Broker injoignable: l'échantillon est horodaté et mis en file.
+void mqttPublishSensors() {
+  uint32_t now = millis();
+  if (!sensorReportDue(sensorTemp, now) && !sensorReportDue(sensorHum, now)) return;
+
+  static char sensorBuf[128];
+  int n = snprintf(sensorBuf, sizeof(sensorBuf), "{\"ts\":%lu,", (unsigned long)now);
+  size_t len = (n > 0) ? (size_t)n : 0;
+  len += renderSensorFields(sensorBuf + len, sizeof(sensorBuf) - len, "temperature", sensorTemp, now);
+  sensorBuf[len++] = ',';
+  len += renderSensorFields(sensorBuf + len, sizeof(sensorBuf) - len, "humidity", sensorHum, now);
+  sensorBuf[len++] = '}';
+
+  mqttPublishEvent(MQTT_Q_SENSOR, sensorBuf, len);
+  sensorMarkReported(sensorTemp, now);
+  sensorMarkReported(sensorHum, now);
+}
+
+// Front sur une entrée: événement horodaté {"ts":..,"inputs":[..],"changed":mask}
+void pollInputEdges() {
+  readInputs();
+  uint8_t mask = inputMask();
+  uint8_t changed = mask ^ lastInputMask;
+  if (changed == 0) return;
+  lastInputMask = mask;
+
+  char bits[20];
+  renderBitArray(bits, sizeof(bits), mask);
+  char buf[80];
+  int n = snprintf(buf, sizeof(buf), "{\"ts\":%lu,\"inputs\":%s,\"changed\":%u}",
+                   (unsigned long)millis(), bits, (unsigned)changed);
+  if (n > 0 && (size_t)n < sizeof(buf)) mqttPublishEvent(MQTT_Q_INPUT_EVENT, buf, (size_t)n);
+}
+
+static const char *mqttPhaseName(MqttConnPhase p) {
+  switch (p) {
+    case MQTT_PHASE_TCP: return "tcp";
+    case MQTT_PHASE_CONNECT: return "connect";
+    case MQTT_PHASE_CONNACK: return "connack";
+    case MQTT_PHASE_SUBSCRIBE: return "subscribe";
+    case MQTT_PHASE_CONNECTED: return "connected";
+    default: return "idle";
   }
+}
+
+static void mqttScheduleRetry() {
+  if (mqttConsecutiveFailures < 16) mqttConsecutiveFailures++;
+  unsigned long exp = mqttBackoffBaseMs << (mqttConsecutiveFailures - 1);
+  if (exp > mqttBackoffMaxMs || exp < mqttBackoffBaseMs) exp = mqttBackoffMaxMs;
+  // Jitter: délai tiré dans [exp/2, exp]
+  mqttBackoffMs = exp / 2 + (unsigned long)(esp_random() % (exp / 2 + 1));
+  mqttPhase = MQTT_PHASE_IDLE;
+}
 
-  // Parse path
-  String method;
-  String target;
-  int sp1 = requestLine.indexOf(' ');
-  int sp2 = requestLine.indexOf(' ', sp1 + 1);
-  if (sp1 > 0 && sp2 > sp1) {
-    method = requestLine.substring(0, sp1);
-    target = requestLine.substring(sp1 + 1, sp2);
+// Coupe la connexion (ou la tentative en cours) et revient en IDLE.
+// immediate: prochaine tentative sans attendre le backoff.
+void mqttResetConnection(bool immediate) {
+  if (mqttPhase == MQTT_PHASE_CONNECTED) {
+    mqttConnStats.disconnects++;
+    // Déconnexion volontaire: le broker n'envoie pas le LWT
+    if (mqttClient.connected()) {
+      mqttClient.publish(topicAvailability, "offline", true);
+      if (mqttPayloadMode != MQTT_PAYLOAD_JSON) mqttClient.publish(spTopicNdeath, (const char *)spDeathBuf);
+    }
+  }
+  mqttConnected = false;
+  mqttClient.disconnect();
+  mqttTransport.stop();
+  mqttPhase = MQTT_PHASE_IDLE;
+  if (immediate) {
+    mqttBackoffMs = 0;
+    mqttConsecutiveFailures = 0;
+  } else {
+    mqttScheduleRetry();
   }
+  lastMqttReconnectAttempt = millis();
+}
 
-  String path = target;
-  String query = "";
-  int q = target.indexOf('?');
-  if (q >= 0) {
-    path = target.substring(0, q);
-    query = target.substring(q + 1);
+// Paramètres du CONNECT, partagés par l'écriture directe et PubSubClient::connect().
+// newDeath: nouveau bdSeq (CONNECT émis), sinon le NDEATH déjà envoyé.
+static MqttConnectOpts mqttConnectOpts(bool newDeath) {
+  MqttConnectOpts o;
+  o.clientId = mqttClientID;
+  o.user = mqttUser[0] ? mqttUser : nullptr;
+  o.pass = mqttUser[0] ? mqttPassword : nullptr;
+  o.willTopic = topicAvailability;
+  o.willMsg = "offline";
+  o.willQos = 0;
+  o.willRetain = true;
+  if (mqttPayloadMode != MQTT_PAYLOAD_JSON) {
+    o.willTopic = spTopicNdeath;
+    o.willMsg = newDeath ? sparkplugBuildDeath() : (const char *)spDeathBuf;
+    o.willQos = 1;
+    o.willRetain = false;
   }
+  o.cleanSession = true;
+  o.keepAliveS = mqttKeepAliveS;
+  return o;
+}
 
-#if ENABLE_OTA_HTTP
-  if (method == "POST" && path == "/api/ota") {
-    DynamicJsonDocument resp(256);
+void mqttReconnect() {
+  // Reconnexion MQTT NON-BLOQUANTE: une étape par appel depuis loop()
+  // (TCP -> CONNECT -> CONNACK -> SUBSCRIBE), jamais d'attente du timeout socket.
+  unsigned long now = millis();
 
-    if (otaKey[0] == '\0') {
-      resp["ok"] = 0;
-      resp["error"] = "ota_key_not_set";
-      String out;
-      serializeJson(resp, out);
-      sendHttp(client, "403 Forbidden", "application/json", out);
-      delay(5);
-      client.stop();
+  switch (mqttPhase) {
+    case MQTT_PHASE_CONNECTED:
       return;
-    }
 
-    if (otaKeyHeader.length() == 0 || otaKeyHeader != String(otaKey)) {
+    case MQTT_PHASE_IDLE: {
+      mqttConnected = false;
+      // Ne pas spammer des tentatives si le lien Ethernet est down
+      if (Ethernet.hardwareStatus() == EthernetNoHardware) return;
+      if (Ethernet.linkStatus() == LinkOFF) return;
+      if (now - lastMqttReconnectAttempt < mqttBackoffMs) return;
+
+      lastMqttReconnectAttempt = now;
+      mqttConnStats.attempts++;
+      // Socket réservé: peut fermer une connexion HTTP/Modbus en surnombre
+      sockBudgetRefresh(netSockets, now);
+      if (!sockBudgetMayOpen(netSockets, SOCK_SVC_MQTT, now) || !mqttTransport.beginConnect(mqttServer, mqttPort)) {
+        mqttConnStats.tcpFailures++;
+        mqttConnStats.lastError = -100;
+        mqttScheduleRetry();
+        return;
+      }
+      mqttPhase = MQTT_PHASE_TCP;
+      mqttPhaseStart = now;
+      return;
+    }
+
+    case MQTT_PHASE_TCP: {
+      uint8_t st = mqttTransport.socketStatus();
+      if (st == SnSR::ESTABLISHED) {
+        mqttPhase = MQTT_PHASE_CONNECT;
+        return;
+      }
+      if (st == SnSR::CLOSED || now - mqttPhaseStart > mqttTcpConnectTimeoutMs) {
+        mqttTransport.stop();
+        mqttConnStats.tcpFailures++;
+        mqttConnStats.lastError = -100;
+        mqttScheduleRetry();
+      }
+      return;
+    }
+
+    case MQTT_PHASE_CONNECT: {
+      // CONNECT écrit directement sur le socket établi: aucune attente ici.
+      // LWT: retenu "offline" sur le topic de disponibilité, ou NDEATH en
+      // Sparkplug (un seul will possible par connexion MQTT)
+      MqttConnectOpts o = mqttConnectOpts(true);
+      uint8_t pkt[320];                   // pire cas: topics, utilisateur et mot de passe pleins (~265)
+      size_t n = mqttEncodeConnect(pkt, sizeof(pkt), o);
+      if (n == 0 || mqttTransport.write(pkt, n) != n) {
+        mqttTransport.stop();
+        mqttConnStats.tcpFailures++;
+        mqttConnStats.lastError = -100;
+        mqttScheduleRetry();
+        return;
+      }
+      mqttPhase = MQTT_PHASE_CONNACK;
+      mqttConnackWaitStart = now;
+      return;
+    }
+
+    case MQTT_PHASE_CONNACK: {
+      // CONNACK complet dans le buffer RX: PubSubClient::connect() le lit sans
+      // attendre; son CONNECT (identique) est écarté par le transport
+      if (mqttTransport.available() < MQTT_CONNACK_LEN) {
+        if (mqttTransport.socketStatus() != SnSR::CLOSED && now - mqttConnackWaitStart <= mqttConnackTimeoutMs) return;
+        mqttTransport.stop();
+        mqttConnStats.mqttFailures++;
+        mqttConnStats.lastError = MQTT_CONNECTION_TIMEOUT;
+        logWarnf("MQTT: pas de CONNACK en %lu ms", (unsigned long)(now - mqttConnackWaitStart));
+        mqttScheduleRetry();
+        return;
+      }
+      MqttConnectOpts o = mqttConnectOpts(false);
+      mqttTransport.discardNextWrite();
+      if (!mqttClient.connect(o.clientId, o.user, o.pass, o.willTopic, o.willQos, o.willRetain, o.willMsg)) {
+        mqttTransport.stop();
+        mqttConnStats.mqttFailures++;
+        mqttConnStats.lastError = mqttClient.state();
+        logWarnf("MQTT: CONNECT refuse (code %d)", mqttClient.state());
+        mqttScheduleRetry();
+        return;
+      }
+      mqttPhase = MQTT_PHASE_SUBSCRIBE;
+      mqttConnackMs = now;
+      return;
+    }
+
+    case MQTT_PHASE_SUBSCRIBE: {
+      // QoS1: les commandes perdues pendant une micro-coupure sont redélivrées
+      // (les doublons sont filtrés par id, voir mqttCmdSeenRecently)
+      char setFilter[TOPIC_ROUTER_PREFIX_MAX + 16];
+      snprintf(setFilter, sizeof(setFilter), "%s/relay/+/set", topicPrefix);
+      if (!mqttClient.subscribe(topicRelayCmd, 1) || !mqttClient.subscribe(setFilter, 1) ||
+          (mqttPayloadMode != MQTT_PAYLOAD_JSON && !mqttClient.subscribe(spTopicNcmd, 0))) {
+        mqttResetConnection(false);
+        return;
+      }
+      mqttPhase = MQTT_PHASE_CONNECTED;
+      mqttConnected = true;
+      mqttConsecutiveFailures = 0;
+      mqttBackoffMs = mqttBackoffBaseMs;
+      mqttConnStats.connects++;
+      mqttConnStats.lastConnectMs = now - mqttPhaseStart;
+      mqttConnStats.lastError = 0;
+      logLinef("MQTT: connecte en %lu ms, souscrit a %s", (unsigned long)mqttConnStats.lastConnectMs, topicRelayCmd);
+      netReconfigConfirm("mqtt");
+
+      if (mqttClient.publish(topicAvailability, "online", true) && bootFirstPublishMs == 0) {
+        bootFirstPublishMs = millis();
+        bootMark("first_publish");
+        logLinef("Démarrage: premier publish MQTT à %lu ms (%s)", (unsigned long)bootFirstPublishMs, bootNetMode);
+      }
+      if (mqttPayloadMode != MQTT_PAYLOAD_JSON) sparkplugPublishBirth();
+      haDiscoveryRequest(mqttConnackMs);
+      mqttPublishStatus();
+      channelRelayPublished = -1;
+      channelInputPublished = -1;
+      mqttPublishChannelStates();
+      sensorReportReset(sensorTemp);
+      sensorReportReset(sensorHum);
+      mqttPublishSensors();
+      return;
+    }
+  }
+}
+
+void setupMqtt() {
+  Serial.println("\n=== Configuration MQTT ===");
+  
+  // Configurer le serveur MQTT
+  mqttClient.setServer(mqttServer, mqttPort);
+  mqttClient.setCallback(mqttCallback);
+  mqttClient.setKeepAlive(mqttKeepAliveS);
+  // connect() n'est appelé qu'avec le CONNACK déjà reçu (phase CONNACK):
+  // ce délai ne borne plus que la lecture des paquets suivants
+  mqttClient.setSocketTimeout(1);
+  // Payloads de discovery HA jusqu'à HA_PAYLOAD_MAX + topic
+  mqttClient.setBufferSize(HA_PAYLOAD_MAX + 160);
+  rebuildTopicRouter();
+
+  // Identifiant unique de carte (MAC eFuse) et topic de disponibilité
+  uint64_t efuse = ESP.getEfuseMac();
+  snprintf(haNodeId, sizeof(haNodeId), "esp32s3_8di8ro_%02x%02x%02x%02x%02x%02x",
+           (unsigned)(efuse & 0xFF), (unsigned)((efuse >> 8) & 0xFF), (unsigned)((efuse >> 16) & 0xFF),
+           (unsigned)((efuse >> 24) & 0xFF), (unsigned)((efuse >> 32) & 0xFF), (unsigned)((efuse >> 40) & 0xFF));
+  snprintf(topicAvailability, sizeof(topicAvailability), "%s/system/availability", topicPrefix);
+  sparkplugBuildTopics();
+  
+  Serial.printf("Broker: %d.%d.%d.%d:%d\n", 
+    mqttServer[0], mqttServer[1], mqttServer[2], mqttServer[3], mqttPort);
+  
+  // Première tentative sans backoff (avancée ensuite depuis loop())
+  mqttReconnect();
+}
+
+// Émission des réponses HTTP: le socket accepté par la lib est repris en TX
+// par W5500AsyncClient (copies en rafales SPI, en-têtes + corps en un SEND par
+// buffer plein au lieu d'un SEND par print()). La réception reste à la lib.
+static W5500AsyncClient httpTx;
+#define HTTP_SEND_TIMEOUT_MS 3000
+
+static size_t httpHeader(char *buf, size_t size, const char *status, const char *contentType, size_t contentLength) {
+  int n = snprintf(buf, size,
+                   "HTTP/1.1 %s\r\nConnection: close\r\nContent-Type: %s\r\nContent-Length: %u\r\n\r\n",
+                   status, contentType, (unsigned)contentLength);
+  if (n < 0) return 0;
+  return ((size_t)n < size) ? (size_t)n : size - 1;
+}
+
+static void sendHttpRaw(EthernetClient &client, const char *status, const char *contentType, const char *body,
+                        size_t len) {
+  char head[192];
+  size_t headLen = httpHeader(head, sizeof(head), status, contentType, len);
+
+  httpTx.attach(client.getSocketNumber());
+  httpTx.cork();
+  httpTx.write((const uint8_t *)head, headLen);
+  if (len > 0) httpTx.write((const uint8_t *)body, len);
+  httpTx.flushSend(HTTP_SEND_TIMEOUT_MS);
+  httpTx.detach();
+}
+
+static void sendHttp(EthernetClient &client, const char *status, const char *contentType, const char *body) {
+  sendHttpRaw(client, status, contentType, body, strlen(body));
+}
+
+// ===== ARÈNE DES REQUÊTES HTTP (req_arena.h) =====
+// Documents JSON, corps et réponses d'une requête: pris dans httpArenaMem,
+// rendus en bloc par handleHttpLoop(). Pics par route: GET /api/mem.
+#ifndef HTTP_ARENA_SIZE
+#define HTTP_ARENA_SIZE 12288
+#endif
+#define HTTP_BODY_MAX 4096                 // corps POST lu au plus (JSON de config)
+
+static uint8_t httpArenaMem[HTTP_ARENA_SIZE] __attribute__((aligned(REQ_ARENA_ALIGN)));
+ReqArena httpArena = REQ_ARENA_INIT(httpArenaMem);
+
+// Allocateur ArduinoJson (BasicJsonDocument) sur l'arène
+struct HttpArenaAllocator {
+  void *allocate(size_t n) { return reqAlloc(httpArena, n); }
+  void deallocate(void *p) { reqFree(httpArena, p); }
+  void *reallocate(void *p, size_t n) { return reqRealloc(httpArena, p, n); }
+};
+typedef BasicJsonDocument<HttpArenaAllocator> HttpJsonDocument;
+
+// Routes suivies: "<méthode> <chemin>", la dernière reçoit le reste
+enum HttpRoute : uint8_t {
+  HTTP_ROUTE_STATUS = 0,
+  HTTP_ROUTE_CONFIG_GET,
+  HTTP_ROUTE_CONFIG_POST,
+  HTTP_ROUTE_BOOT,
+  HTTP_ROUTE_MEM,
+  HTTP_ROUTE_LOGS,
+  HTTP_ROUTE_CONFIG_RAW,
+  HTTP_ROUTE_PAGE,
+  HTTP_ROUTE_RELAY,
+  HTTP_ROUTE_OTA,
+  HTTP_ROUTE_BENCH_UP,
+  HTTP_ROUTE_BENCH_DOWN,
+  HTTP_ROUTE_OTHER,
+  HTTP_ROUTE_COUNT
+};
+
+ReqArenaRoute httpRoutes[HTTP_ROUTE_COUNT] = {
+  {"GET /api/status"}, {"GET /api/config"}, {"POST /api/config"}, {"GET /api/boot"},
+  {"GET /api/mem"}, {"GET /api/logs"}, {"GET /api/config_raw"}, {"GET /"},
+  {"GET /relay"}, {"POST /api/ota"}, {"POST /api/bench/upload"}, {"GET /api/bench/download"},
+  {"other"},
+};
+
+static uint8_t httpRouteOf(const char *method, const char *path) {
+  size_t m = strlen(method);
+  for (uint8_t i = 0; i < HTTP_ROUTE_OTHER; i++) {
+    const char *name = httpRoutes[i].name;
+    if (strncmp(name, method, m) == 0 && name[m] == ' ' && strcmp(name + m + 1, path) == 0) return i;
+  }
+  return HTTP_ROUTE_OTHER;
+}
+
+// Réponse sérialisée dans l'arène (plus de String sur le tas)
+static void sendHttpJson(EthernetClient &client, const char *status, const JsonDocument &doc) {
+  size_t len = measureJson(doc);
+  char *out = (char *)reqAlloc(httpArena, len + 1);
+  if (!out) {
+    sendHttpRaw(client, "503 Service Unavailable", "text/plain", "no_memory", 9);
+    return;
+  }
+  serializeJson(doc, out, len + 1);
+  sendHttpRaw(client, status, "application/json", out, len);
+  reqFree(httpArena, out);
+}
+
+// Valeur de key dans query (sans le '?'), copiée dans out; "" si absente
+static const char *getQueryParam(const char *query, const char *key, char *out, size_t size) {
+  size_t k = strlen(key);
+  out[0] = '\0';
+  for (const char *p = query; *p;) {
+    if (strncmp(p, key, k) == 0 && p[k] == '=') {
+      p += k + 1;
+      size_t n = strcspn(p, "&");
+      if (n >= size) n = size - 1;
+      memcpy(out, p, n);
+      out[n] = '\0';
+      break;
+    }
+    p = strchr(p, '&');
+    if (!p) break;
+    p++;
+  }
+  return out;
+}
+
+static void handleRelayQuery(const char *query) {
+  // Supported:
+  //  /relay?num=1&action=toggle
+  //  /relay?action=all_toggle
+  char action[16], numStr[8];
+  getQueryParam(query, "action", action, sizeof(action));
+  getQueryParam(query, "num", numStr, sizeof(numStr));
+
+  if (strcmp(action, "all_toggle") == 0) {
+    for (int i = 0; i < 8; i++) setRelay(i, !relayStates[i]);
+    return;
+  }
+
+  int relayNum = atoi(numStr);
+  if (relayNum < 1 || relayNum > 8) return;
+  int relayIndex = relayNum - 1;
+
+  if (strcmp(action, "toggle") == 0) {
+    setRelay(relayIndex, !relayStates[relayIndex]);
+  } else if (strcmp(action, "on") == 0) {
+    setRelay(relayIndex, true);
+  } else if (strcmp(action, "off") == 0) {
+    setRelay(relayIndex, false);
+  }
+}
+
+// Ligne de requête ou d'en-tête dans buf, sans fin de ligne ni blancs
+// finaux. Une ligne plus longue est tronquée (le reste est consommé).
+#define HTTP_LINE_MAX 256
+
+static size_t httpReadLine(EthernetClient &client, char *buf, size_t size) {
+  size_t n = client.readBytesUntil('\n', buf, size - 1);
+  if (n == size - 1) {
+    char c;
+    while (client.readBytes(&c, 1) == 1 && c != '\n') {
+    }
+  }
+  while (n > 0 && (buf[n - 1] == '\r' || buf[n - 1] == ' ' || buf[n - 1] == '\t')) n--;
+  buf[n] = '\0';
+  return n;
+}
+
+// Valeur de l'en-tête name si la ligne le porte (nom sans casse), sinon nullptr
+static const char *httpHeaderValue(const char *line, const char *name) {
+  size_t n = strlen(name);
+  if (strncasecmp(line, name, n) != 0 || line[n] != ':') return nullptr;
+  const char *v = line + n + 1;
+  while (*v == ' ' || *v == '\t') v++;
+  return v;
+}
+
+// ===== W5500 IRQ =====
+static void IRAM_ATTR w5500Isr() {
+  if (!w5500IrqFlag) w5500IrqStampUs = micros();
+  w5500IrqFlag = true;
+  w5500IrqCount++;
+  if (loopTaskHandle) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(loopTaskHandle, &woken);
+    if (woken) portYIELD_FROM_ISR();
+  }
+}
+
+void setupW5500Irq() {
+#if W5500_USE_IRQ
+  if (Ethernet.hardwareStatus() == EthernetNoHardware) return;
+  w5500IrqEnable();
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  attachInterrupt(digitalPinToInterrupt(ETH_IRQ_PIN), w5500Isr, FALLING);
+  netIrqActive = true;
+  Serial.printf("✓ W5500 IRQ actif (GPIO%d)\n", ETH_IRQ_PIN);
+#endif
+}
+
+static bool netHot(unsigned long hotUntil, unsigned long now) {
+  return (long)(hotUntil - now) > 0;
+}
+
+// Acquitte les événements socket et ouvre la fenêtre des sous-systèmes concernés.
+// INTn reste bas tant qu'un événement n'est pas acquitté: le niveau rattrape un front manqué.
+static void netCollectEvents(unsigned long now) {
+  if (!netIrqActive) return;
+  bool fromIsr = w5500IrqFlag;
+  if (!fromIsr && digitalRead(ETH_IRQ_PIN) == HIGH) return;
+  uint32_t stampUs = w5500IrqStampUs;
+  w5500IrqFlag = false;
+
+  uint8_t conMask;
+  uint8_t socks = w5500IrqCollect(conMask);
+  uint8_t mqttSock = mqttTransport.socketNumber();
+  uint8_t mqttBit = (mqttSock < MAX_SOCK_NUM) ? (uint8_t)(1u << mqttSock) : 0;
+  if (socks & mqttBit) netMqttHotUntil = now + NET_HOT_MS;
+  if (socks & ~mqttBit) netServerHotUntil = now + NET_HOT_MS;
+  if (fromIsr && (conMask & ~mqttBit)) latencyHistRecord(netAcceptLatency, micros() - stampUs);
+}
+
+static bool netServersDue(unsigned long now) {
+  if (!netIrqActive || netHot(netServerHotUntil, now)) return true;
+  return now - netLastServerPoll >= NET_SERVER_FALLBACK_MS;
+}
+
+static bool netMqttDue(unsigned long now) {
+  if (!netIrqActive || netHot(netMqttHotUntil, now)) return true;
+  return now - netLastMqttPoll >= NET_MQTT_FALLBACK_MS;
+}
+
+static void netUpdateSpiRate(unsigned long now) {
+  if (now - spiWindowStart < 1000) return;
+  uint32_t count = spiTransactionCount;
+  spiPerSec = count - spiWindowCount;
+  spiWindowCount = count;
+  spiWindowStart = now;
+  if (spiPerSec < spiPerSecMinWindow) spiPerSecMinWindow = spiPerSec;
+  if (now - spiMinWindowStart >= 10000) {
+    spiMinWindowStart = now;
+    spiPerSecMin = spiPerSecMinWindow;
+    spiPerSecMinWindow = UINT32_MAX;
+  }
+}
+
+// ===== MODBUS TCP (port 502) =====
+// Trames lues sans bloquer: une ADU partielle reste dans le buffer du socket
+// jusqu'à l'itération suivante. Registres servis directement depuis l'état
+// courant (voir modbus_tcp.h).
+struct ModbusConn {
+  uint8_t buf[MODBUS_MAX_ADU];
+  uint16_t len;
+  uint32_t lastMs;
+  bool pending;             // requête relayée vers le RS485, réponse attendue
+  uint8_t mbap[MODBUS_MBAP_LEN];
+};
+static ModbusConn modbusConns[MAX_SOCK_NUM];
+ModbusStats modbusStats = {0, 0, 0};
+static const uint32_t MODBUS_PARTIAL_TIMEOUT_MS = 1000;
+static const uint8_t MODBUS_FRAMES_PER_LOOP = 4;
+
+// ----- Accès à la table des sockets pour socket_budget.h -----
+static uint8_t netSockStatus(uint8_t s) {
+  w5500SpiBeginTransaction();
+  uint8_t st = W5100.readSnSR(s);
+  SPI.endTransaction();
+  return st;
+}
+
+static uint16_t netSockRxSize(uint8_t s) {
+  w5500SpiBeginTransaction();
+  uint16_t n = W5100.readSnRX_RSR(s);
+  SPI.endTransaction();
+  return n;
+}
+
+static uint8_t netSockService(uint8_t s) {
+  if (s == mqttTransport.socketNumber()) return SOCK_SVC_MQTT;
+  uint16_t port = EthernetServer::server_port[s];
+  if (port == httpPort) return SOCK_SVC_HTTP;
+  if (port == MODBUS_TCP_PORT) return SOCK_SVC_MODBUS;
+  if (udpActive) {
+    w5500SpiBeginTransaction();
+    uint8_t mr = W5100.readSnMR(s);
+    uint16_t local = W5100.readSnPORT(s);
+    SPI.endTransaction();
+    if ((mr & 0x0F) == SnMR::UDP && (local == udpPort || local == udpStatePort)) return SOCK_SVC_UDP;
+  }
+  return SOCK_SVC_OTHER;
+}
+
+static void netSockClose(uint8_t s) {
+  w5500SpiBeginTransaction();
+  W5100.execCmdSn(s, Sock_CLOSE);
+  W5100.writeSnIR(s, 0xFF);
+  SPI.endTransaction();
+  EthernetServer::server_port[s] = 0;
+  modbusConns[s].len = 0;
+  modbusConns[s].pending = false;
+}
+
+static void setupSocketBudget() {
+  static const SockBudgetIo io = {netSockStatus, netSockRxSize, netSockService, netSockClose};
+  sockBudgetInit(netSockets, io, MAX_SOCK_NUM);
+  sockBudgetSetService(netSockets, SOCK_SVC_MQTT, 1, 1, 0);
+  sockBudgetSetService(netSockets, SOCK_SVC_HTTP, 1, SOCK_HTTP_MAX, SOCK_HTTP_IDLE_MS);
+  sockBudgetSetService(netSockets, SOCK_SVC_MODBUS, 1, SOCK_MODBUS_MAX, SOCK_MODBUS_IDLE_MS);
+  if (udpEnabled) sockBudgetSetService(netSockets, SOCK_SVC_UDP, 2, 2, 0);
+  sockBudgetRefresh(netSockets, millis());
+}
+
+static void netSocketBudgetService(unsigned long now) {
+  if (now - netLastSockRefresh < SOCK_BUDGET_PERIOD_MS) return;
+  netLastSockRefresh = now;
+  sockBudgetRefresh(netSockets, now);
+}
+
+// EthernetServer::available() sans réouverture inconditionnelle de l'écoute:
+// le socket d'écoute n'est rouvert que si le budget du service le permet
+// (sinon les SYN suivants sont refusés par le W5500 jusqu'à libération).
+// Renvoie le premier socket avec des données hors de skipMask (bit s: socket s).
+static EthernetClient netServerAccept(EthernetServerESP32 &server, uint16_t port, uint8_t svc, uint8_t skipMask = 0) {
+  bool listening = false;
+  uint8_t ready = MAX_SOCK_NUM;
+  w5500SpiBeginTransaction();
+  for (uint8_t s = 0; s < MAX_SOCK_NUM; s++) {
+    if (EthernetServer::server_port[s] != port) continue;
+    uint8_t st = W5100.readSnSR(s);
+    if (st == SnSR::ESTABLISHED || st == SnSR::CLOSE_WAIT) {
+      if (W5100.readSnRX_RSR(s) > 0) {
+        if (ready == MAX_SOCK_NUM && !(skipMask & (1 << s))) ready = s;
+      } else if (st == SnSR::CLOSE_WAIT) {
+        W5100.execCmdSn(s, Sock_DISCON);
+      }
+    } else if (st == SnSR::LISTEN) {
+      listening = true;
+    } else if (st == SnSR::CLOSED) {
+      EthernetServer::server_port[s] = 0;
+    }
+  }
+  SPI.endTransaction();
+
+  unsigned long now = millis();
+  if (!listening) {
+    sockBudgetRefresh(netSockets, now);
+    if (sockBudgetMayOpen(netSockets, svc, now)) server.begin();
+  }
+  if (ready < MAX_SOCK_NUM) sockBudgetTouch(netSockets, ready, now);
+  return EthernetClient(ready);
+}
+
+// Nouvelle adresse écrite directement dans les registres du W5500: pas de
+// reset logiciel (Ethernet.begin), les sockets d'écoute HTTP/Modbus/UDP
+// restent ouverts et l'IRQ reste armée. Seules les connexions TCP établies,
+// liées à l'ancienne adresse, sont fermées.
+static void netApplyAddress(const IPAddress &ip, const IPAddress &gw, const IPAddress &mask, const IPAddress &dns) {
+  uint32_t t0 = micros();
+  Ethernet.setLocalIP(ip);
+  Ethernet.setGatewayIP(gw);
+  Ethernet.setSubnetMask(mask);
+  Ethernet.setDnsServerIP(dns);
+  if (netSockets.count == 0) {
+    // Démarrage: aucun service réseau encore ouvert
+    refreshCachedIp();
+    return;
+  }
+  unsigned long now = millis();
+  sockBudgetRefresh(netSockets, now);
+  for (uint8_t s = 0; s < netSockets.count; s++) {
+    uint8_t owner = netSockets.owner[s];
+    if ((owner == SOCK_SVC_HTTP || owner == SOCK_SVC_MODBUS) && sockBudgetConnected(netSockets.lastStatus[s])) {
+      netSockClose(s);
+    }
+  }
+  netReconfApplyUs = micros() - t0;
+  refreshCachedIp();
+  mqttResetConnection(true);
+}
+
+static const char *netReconfStateName(NetReconfState st) {
+  switch (st) {
+    case NET_RECONF_PENDING: return "pending";
+    case NET_RECONF_CONFIRMED: return "confirmed";
+    case NET_RECONF_REVERTED: return "reverted";
+    default: return "idle";
+  }
+}
+
+// La nouvelle adresse est joignable (requête HTTP reçue) ou routée (broker MQTT atteint)
+void netReconfigConfirm(const char *by) {
+  if (netReconfState != NET_RECONF_PENDING) return;
+  netReconfState = NET_RECONF_CONFIRMED;
+  netReconfConfirmMs = millis() - netReconfStartMs;
+  netReconfBy = by;
+  logLinef("Réseau: %s confirmée par %s en %lu ms", ethIpStr, by, (unsigned long)netReconfConfirmMs);
+}
+
+static void netReconfigService(unsigned long now) {
+  if (netReconfRequested) {
+    netReconfRequested = false;
+    netApplyAddress(staticIP, gateway, subnet, dns1);
+    netReconfState = NET_RECONF_PENDING;
+    netReconfStartMs = millis();
+    netReconfChanges++;
+    logLinef("Réseau: %s appliquée en %lu us (confirmation attendue %lu s)", ethIpStr,
+             (unsigned long)netReconfApplyUs, (unsigned long)(NET_RECONF_CONFIRM_MS / 1000));
+    return;
+  }
+  if (netReconfState != NET_RECONF_PENDING || now - netReconfStartMs < NET_RECONF_CONFIRM_MS) return;
+
+  staticIP = netPrevIp;
+  gateway = netPrevGw;
+  subnet = netPrevMask;
+  dns1 = netPrevDns;
+  netApplyAddress(staticIP, gateway, subnet, dns1);
+  netReconfState = NET_RECONF_REVERTED;
+  netReconfReverts++;
+  configSaveLater();
+  logWarnf("Réseau: pas de confirmation -> retour à %s", ethIpStr);
+}
+
+// ----- DHCP -----
+// MAC propre à la carte, comme esp_read_mac(ESP_MAC_ETH): MAC de base eFuse + 3
+// (Wi-Fi STA, AP, Bluetooth puis Ethernet). La MAC fixe d'origine était la
+// même sur toutes les cartes.
+static void netMacFromEfuse(byte *out) {
+  uint64_t efuse = ESP.getEfuseMac();   // octet 0 de la MAC en poids faible
+  for (int i = 0; i < 6; i++) out[i] = (byte)((efuse >> (8 * i)) & 0xFF);
+  out[5] += 3;
+}
+
+static bool dhcpSendPacket(uint32_t dst, const uint8_t *buf, size_t len) {
+  if (!dhcpUdpOpen || !dhcpUdp.beginPacket(IPAddress(dst), DHCP_SERVER_PORT)) return false;
+  dhcpUdp.write(buf, len);
+  return dhcpUdp.endPacket() == 1;
+}
+
+static void dhcpApplyLease(const DhcpLease &l, bool changed) {
+  if (l.ip != 0 && bootNetReadyMs == 0) {
+    bootNetReadyMs = millis();
+    bootMark("ip_ready");
+  }
+  if (!changed) return;
+  netApplyAddress(IPAddress(l.ip), IPAddress(l.gateway), IPAddress(l.mask), IPAddress(l.dns));
+  if (l.ip != 0) logLinef("DHCP: adresse %s (bail %lu s)", ethIpStr, (unsigned long)l.leaseS);
+  else logLinef("DHCP: adresse retirée");
+}
+
+static void dhcpStoreLease(const DhcpLease &l) {
+  Preferences prefs;
+  prefs.begin("dhcp", false);
+  prefs.putBytes("lease", &l, sizeof(l));
+  prefs.end();
+}
+
+// Remplace Ethernet.begin(mac) (bloquant): l'interface démarre sur le bail en
+// cache s'il existe, sinon sans adresse; la suite se fait dans loop()
+static void setupDhcp() {
+  DhcpLease cached;
+  Preferences prefs;
+  prefs.begin("dhcp", true);
+  bool haveCache = prefs.getBytes("lease", &cached, sizeof(cached)) == sizeof(cached) && cached.ip != 0;
+  prefs.end();
+
+  IPAddress none(0, 0, 0, 0);
+  Ethernet.begin(mac, none, none, none, none);
+  dhcpUdpOpen = dhcpUdp.begin(DHCP_CLIENT_PORT) == 1;
+
+  char host[32];
+  snprintf(host, sizeof(host), "esp32s3-8di8ro-%02x%02x%02x", mac[3], mac[4], mac[5]);
+  static const DhcpIo io = {dhcpSendPacket, dhcpApplyLease, dhcpStoreLease};
+  dhcpInit(dhcpClient, io, mac, host, esp_random(), millis());
+  if (haveCache) {
+    bootNetMode = "dhcp_cached";
+    dhcpStartCached(dhcpClient, cached);
+  } else {
+    bootNetMode = "dhcp_cold";
+  }
+}
+
+// Socket UDP 68 ouvert seulement pendant un échange (1 socket W5500 de moins au repos)
+static void netDhcpService(unsigned long now) {
+  if (!dhcpEnabled) return;
+  bool want = dhcpWantsSocket(dhcpClient, now);
+  if (want && !dhcpUdpOpen) {
+    dhcpUdpOpen = dhcpUdp.begin(DHCP_CLIENT_PORT) == 1;
+    if (!dhcpUdpOpen) return;   // aucun socket libre: nouvel essai au tour suivant
+  }
+  if (dhcpUdpOpen) {
+    uint8_t buf[DHCP_PACKET_MAX];
+    int size;
+    while ((size = dhcpUdp.parsePacket()) > 0) {
+      if (dhcpUdp.remotePort() != DHCP_SERVER_PORT || size > (int)sizeof(buf)) continue;
+      int len = dhcpUdp.read(buf, (size_t)size);
+      if (len > 0) dhcpOnPacket(dhcpClient, buf, (size_t)len, now);
+    }
+  }
+  dhcpService(dhcpClient, now);
+  if (!dhcpWantsSocket(dhcpClient, now) && dhcpUdpOpen) {
+    dhcpUdp.stop();
+    dhcpUdpOpen = false;
+  }
+}
+
+void setupWebServer() {
+  setupSocketBudget();
+  webServer.begin(httpPort);
+  Serial.println("✓ HTTP server started (W5500) port 80");
+  modbusServer.begin(MODBUS_TCP_PORT);
+  Serial.println("✓ Modbus TCP server started (W5500) port 502");
+}
+
+static uint16_t modbusInputRegister(uint16_t index) {
+  uint32_t now = millis();
+  const SensorChannel &ch = (index == 0) ? sensorTemp : sensorHum;
+  return (uint16_t)sensorRegisterValue(ch, now);
+}
+
+static const ModbusBank modbusBank = {relayMask, inputMask, modbusInputRegister, 2, applyRelayMask};
+static bool modbusGatewayAdu(EthernetClient &client, uint8_t sock, ModbusConn &mc, uint8_t *resp);
+
+// Complète mc.buf jusqu'à target octets sans attendre; true si atteint
+static bool modbusFill(EthernetClient &client, ModbusConn &mc, size_t target) {
+  if (mc.len >= target) return true;
+  int avail = client.available();
+  if (avail <= 0) return false;
+  size_t want = target - mc.len;
+  if ((size_t)avail < want) want = (size_t)avail;
+  int got = client.read(mc.buf + mc.len, want);
+  if (got > 0) mc.len += (uint16_t)got;
+  return mc.len >= target;
+}
+
+// Une trame par client et par tour, clients servis chacun leur tour: un
+// client en attente de la passerelle RTU ou en trame partielle est écarté
+// (skip) pour le reste de l'appel, un client servi (served, gardé d'un appel
+// à l'autre) ne repasse qu'une fois les autres servis. Sans cela, le socket
+// de plus petit numéro avec des données repassait en tête à chaque trame et
+// affamait les autres.
+void modbusService() {
+  static uint8_t resp[MODBUS_MAX_ADU];
+  static uint8_t served = 0;
+  uint8_t skip = 0, frames = 0;
+  while (frames < MODBUS_FRAMES_PER_LOOP) {
+    EthernetClient client = netServerAccept(modbusServer, MODBUS_TCP_PORT, SOCK_SVC_MODBUS, skip | served);
+    uint8_t sock = client.getSocketNumber();
+    if (!client || sock >= MAX_SOCK_NUM) {
+      if (!served) return;
+      served = 0;                                // nouveau tour (borné: il faut avoir servi)
+      continue;
+    }
+    frames++;
+    ModbusConn &mc = modbusConns[sock];
+    if (mc.pending) {
+      skip |= 1 << sock;
+      continue;
+    }
+    uint32_t now = millis();
+    if (mc.len > 0 && now - mc.lastMs > MODBUS_PARTIAL_TIMEOUT_MS) mc.len = 0;
+    mc.lastMs = now;
+
+    // En-tête MBAP puis le corps annoncé, uniquement ce qui est déjà arrivé
+    size_t need = modbusFill(client, mc, MODBUS_MBAP_LEN) ? modbusAduLength(mc.buf) : 0;
+    if (mc.len >= MODBUS_MBAP_LEN && need == 0) {
+      client.stop();
+      mc.len = 0;
+      skip |= 1 << sock;
+      continue;
+    }
+    if (need == 0 || !modbusFill(client, mc, need)) {
+      skip |= 1 << sock;
+      continue;
+    }
+    served |= 1 << sock;
+
+    if (modbusGatewayAdu(client, sock, mc, resp)) {
+      mc.len = 0;
+      continue;
+    }
+    size_t n = modbusHandleAdu(modbusBank, mc.buf, mc.len, resp, modbusStats);
+    mc.len = 0;
+    if (n > 0) client.write(resp, n);
+  }
+}
+
+// ===== PROTOCOLE UDP BINAIRE (udp_ctrl.h) =====
+// Commandes relais en unicast sur udpPort (ACK immédiat), état en multicast
+// sur udpGroup:udpStatePort toutes les udpStateMs et à chaque changement
+// relais/entrées. Désactivé sans clé: aucune commande non authentifiée.
+static const uint8_t UDP_CTRL_FRAMES_PER_LOOP = 4;
+
+void setupUdpCtrl() {
+  if (!udpEnabled) return;
+  if (udpKey[0] == '\0') {
+    Serial.println("⚠️ UDP: udp_key vide -> protocole désactivé");
+    return;
+  }
+  unsigned long now = millis();
+  sockBudgetRefresh(netSockets, now);
+  if (!sockBudgetMayOpen(netSockets, SOCK_SVC_UDP, now) || !udpCmd.begin(udpPort)) {
+    Serial.println("✗ UDP: pas de socket pour les commandes");
+    return;
+  }
+  sockBudgetRefresh(netSockets, now);
+  if (!sockBudgetMayOpen(netSockets, SOCK_SVC_UDP, now) || !udpState.beginMulticast(udpGroup, udpStatePort)) {
+    udpCmd.stop();
+    Serial.println("✗ UDP: pas de socket pour le multicast");
+    return;
+  }
+  udpCtrlInit(udpCtrl, udpKey, 0);
+  // Planchers anti-rejeu du démarrage précédent (même clé)
+  UdpCtrlFloors floors;
+  Preferences prefs;
+  prefs.begin("udp", true);
+  size_t floorsLen = prefs.getBytes("floors", &floors, sizeof(floors));
+  prefs.end();
+  if (udpCtrlImportFloors(udpCtrl, floors, floorsLen)) {
+    Serial.printf("✓ UDP: %u émetteur(s) connus (anti-rejeu)\n", udpCtrlPeerCount(udpCtrl));
+  }
+  udpActive = true;
+  udpLastRelays = relayMask();
+  udpLastInputs = inputMask();
+  udpLastStateMs = now - udpStateMs;   // premier état tout de suite
+  Serial.printf("✓ UDP: commandes port %u, état %s:%u toutes les %lu ms\n", udpPort,
+                udpGroup.toString().c_str(), udpStatePort, (unsigned long)udpStateMs);
+}
+
+void udpCtrlPoll() {
+  if (!udpActive) return;
+  for (uint8_t frames = 0; frames < UDP_CTRL_FRAMES_PER_LOOP; frames++) {
+    int size = udpCmd.parsePacket();
+    if (size <= 0) break;
+    uint32_t t0 = micros();
+    uint8_t in[UDP_CTRL_MAX_LEN];
+    if (size > (int)sizeof(in)) {
+      udpCtrl.stats.malformed++;
+      continue;  // reste du datagramme jeté par le parsePacket() suivant
+    }
+    int len = udpCmd.read(in, (size_t)size);
+    if (len <= 0) continue;
+    IPAddress from = udpCmd.remoteIP();
+    uint8_t type = udpCtrlType(in, (size_t)len);
+    uint32_t seq;
+    uint8_t status, mask, values;
+    if (type == UDP_CTRL_ACK) {
+      // Réponse d'une carte pilotée par nos liens
+      uint8_t relays, inputs;
+      if (peerLinkActive && udpCtrlDecodeAck(udpCtrl, in, (size_t)len, seq, status, relays, inputs) &&
+          status == UDP_CTRL_OK) {
+        peerLinkOnAck(peerLink, (uint32_t)from, seq, millis(), micros());
+      }
+      continue;
+    }
+    if (type == UDP_CTRL_LINK) {
+      if (!peerLinkOnLink(peerLink, (uint32_t)from, in, (size_t)len, millis(), seq, status)) continue;
+    } else {
+      if (!udpCtrlHandleCmd(udpCtrl, (uint32_t)from, in, (size_t)len, millis(), seq, status, mask, values)) continue;
+      if (status == UDP_CTRL_OK && mask != 0) applyRelayMask(mask, values);
+    }
+
+    uint8_t out[UDP_CTRL_MAX_LEN];
+    size_t n = udpCtrlEncodeAck(udpCtrl, seq, status, relayMask(), inputMask(), out);
+    udpCmd.beginPacket(from, udpCmd.remotePort());
+    udpCmd.write(out, n);
+    udpCmd.endPacket();
+    latencyHistRecord(udpCmdLatency, micros() - t0);
+  }
+  // États multicast des autres cartes: pas encore exploités, vidés pour libérer le buffer
+  while (udpState.parsePacket() > 0) {
+  }
+}
+
+// Planchers anti-rejeu en NVS: écriture paresseuse (udp_ctrl.h)
+void udpCtrlSaveFloors() {
+  if (!udpActive || !udpCtrl.floorsDirty) return;
+  UdpCtrlFloors floors;
+  udpCtrlExportFloors(udpCtrl, floors);
+  Preferences prefs;
+  prefs.begin("udp", false);
+  if (prefs.putBytes("floors", &floors, sizeof(floors)) == sizeof(floors)) udpCtrl.floorsDirty = false;
+  prefs.end();
+}
+
+void udpCtrlStateService(unsigned long now) {
+  if (!udpActive) return;
+  uint8_t relays = relayMask();
+  uint8_t inputs = inputMask();
+  bool changed = relays != udpLastRelays || inputs != udpLastInputs;
+  if (!changed && now - udpLastStateMs < udpStateMs) return;
+
+  UdpCtrlState st;
+  st.relays = relays;
+  st.inputs = inputs;
+  st.reason = changed ? UDP_CTRL_CHANGE : UDP_CTRL_PERIODIC;
+  st.tempX10 = sensorRegisterValue(sensorTemp, now);
+  st.humX10 = sensorRegisterValue(sensorHum, now);
+  st.uptimeMs = now;
+  uint8_t out[UDP_CTRL_MAX_LEN];
+  size_t n = udpCtrlEncodeState(udpCtrl, st, out);
+  udpState.beginPacket(udpGroup, udpStatePort);
+  udpState.write(out, n);
+  udpState.endPacket();
+  udpLastRelays = relays;
+  udpLastInputs = inputs;
+  udpLastStateMs = now;
+}
+
+// ===== LIENS ENTRE CARTES (peer_link.h) =====
+// Entrée locale -> relais d'une autre carte, en LINK unicast sur son port de
+// commandes. Réservé aux verrouillages rapides entre tableaux: la scrutation
+// des entrées liées se fait à chaque loop(), pas toutes les 20 ms.
+static bool peerSend(uint32_t addr, uint16_t port, const uint8_t *buf, size_t len) {
+  if (!udpCmd.beginPacket(IPAddress(addr), port)) return false;
+  udpCmd.write(buf, len);
+  return udpCmd.endPacket() == 1;
+}
+
+// Heartbeats: n'écrit le TCA9554 que si l'état change vraiment
+static void peerApplyRelays(uint8_t mask, uint8_t values) {
+  if (((relayMask() ^ values) & mask) == 0) return;
+  applyRelayMask(mask, values);
+}
+
+// Seq des LINK strictement croissants d'un démarrage à l'autre
+static void peerReserveSeq(uint32_t next) {
+  Preferences prefs;
+  prefs.begin("peer", false);
+  prefs.putUInt("seq", next);
+  prefs.end();
+}
+
+static uint8_t peerParseMode(const char *m) {
+  if (strcmp(m, "invert") == 0) return PEER_MODE_INVERT;
+  if (strcmp(m, "toggle") == 0) return PEER_MODE_TOGGLE;
+  return PEER_MODE_FOLLOW;
+}
+
+static uint8_t peerParseFailsafe(const char *f) {
+  if (strcmp(f, "off") == 0) return PEER_FS_OFF;
+  if (strcmp(f, "on") == 0) return PEER_FS_ON;
+  return PEER_FS_HOLD;
+}
+
+void setupPeerLinks() {
+  // La carte réceptrice n'a besoin que du protocole UDP (LINK traité dans udpCtrlPoll)
+  static const PeerLinkIo io = {peerSend, peerApplyRelays, peerReserveSeq};
+  peerLinkInit(peerLink, &udpCtrl, io, peerRetryMs, peerHeartbeatMs, (uint16_t)peerTimeoutMs, 0);
+  if (!udpActive) return;
+  peerLinkActive = true;
+
+  const char *p = peerLinks;
+  while (*p) {
+    char ip[16], mode[8] = "follow", fs[8] = "hold";
+    unsigned input, relay;
+    IPAddress addr;
+    int n = sscanf(p, "%15[^:]:%u:%u:%7[^:;]:%7[^;]", ip, &input, &relay, mode, fs);
+    if (n >= 3 && addr.fromString(ip) && input >= 1 && relay >= 1 &&
+        peerLinkAddBinding(peerLink, (uint32_t)addr, udpPort, (uint8_t)(input - 1), (uint8_t)(relay - 1),
+                           peerParseMode(mode), peerParseFailsafe(fs))) {
+      Serial.printf("✓ Lien: entrée %u -> %s relais %u (%s, repli %s)\n", input, ip, relay, mode, fs);
+    } else {
+      logWarnf("Lien ignoré: %.40s", p);
+    }
+    const char *next = strchr(p, ';');
+    if (!next) break;
+    p = next + 1;
+  }
+  if (peerLink.bindingCount > 0) {
+    Preferences prefs;
+    prefs.begin("peer", true);
+    uint32_t first = prefs.getUInt("seq", 0);
+    prefs.end();
+    peerLinkStartSeq(peerLink, first);
+    readInputs();
+    peerLinkInputs(peerLink, inputMask(), millis(), micros());
+  }
+}
+
+// ===== MODBUS RTU (RS485) =====
+// Maître non bloquant (modbus_rtu.h) sur Serial1. Fin de trame: timeout RX
+// de l'UART (silence >= 4 caractères), signalé par onReceive().
+static volatile bool rtuRxIdle = false;
+
+static void rtuOnRxTimeout() {
+  rtuRxIdle = true;
+}
+
+static int rtuPortAvailable() {
+  return Serial1.available();
+}
+
+static int rtuPortRead(uint8_t *buf, size_t len) {
+  return (int)Serial1.read(buf, len);
+}
+
+static size_t rtuPortWrite(const uint8_t *buf, size_t len) {
+  return Serial1.write(buf, len);
+}
+
+static bool rtuPortTakeIdle() {
+  if (!rtuRxIdle) return false;
+  rtuRxIdle = false;
+  return true;
+}
+
+// Réponse RTU d'une requête passerelle: renvoyée avec l'en-tête MBAP d'origine
+static void rtuGatewayReply(uint8_t tag, const uint8_t *pdu, size_t len) {
+  if (tag >= MAX_SOCK_NUM) return;
+  ModbusConn &mc = modbusConns[tag];
+  if (!mc.pending) return;
+  mc.pending = false;
+  uint8_t resp[MODBUS_MAX_ADU];
+  if (len + MODBUS_MBAP_LEN > sizeof(resp)) return;
+  memcpy(resp, mc.mbap, MODBUS_MBAP_LEN);
+  mbPut16(resp + 4, (uint16_t)(len + 1));
+  memcpy(resp + MODBUS_MBAP_LEN, pdu, len);
+  EthernetClient client(tag);
+  if (client.connected()) client.write(resp, MODBUS_MBAP_LEN + len);
+}
+
+// ADU destinée à un esclave RS485: servie par le cache ou mise en file.
+// false si la trame est pour la carte elle-même.
+static bool modbusGatewayAdu(EthernetClient &client, uint8_t sock, ModbusConn &mc, uint8_t *resp) {
+  uint8_t unit = mc.buf[6];
+  if (!rtuEnabled || unit == modbusUnitId || unit == 0 || unit == 255) return false;
+  if (mbGet16(mc.buf + 2) != 0) return true;   // protocole inconnu: ignorée
+
+  size_t pduLen = 0;
+  RtuGatewayResult r = rtuGatewayRequest(rtuMaster, sock, unit, mc.buf + MODBUS_MBAP_LEN, mc.len - MODBUS_MBAP_LEN,
+                                         millis(), resp + MODBUS_MBAP_LEN, pduLen);
+  if (r == RTU_GW_QUEUED) {
+    memcpy(mc.mbap, mc.buf, MODBUS_MBAP_LEN);
+    mc.pending = true;
+    return true;
+  }
+  memcpy(resp, mc.buf, MODBUS_MBAP_LEN);
+  mbPut16(resp + 4, (uint16_t)(pduLen + 1));
+  client.write(resp, MODBUS_MBAP_LEN + pduLen);
+  return true;
+}
+
+static uint32_t rtuSerialConfig(const char *fmt) {
+  if (strcmp(fmt, "8E1") == 0) return SERIAL_8E1;
+  if (strcmp(fmt, "8O1") == 0) return SERIAL_8O1;
+  if (strcmp(fmt, "8N2") == 0) return SERIAL_8N2;
+  return SERIAL_8N1;
+}
+
+// "1:4:0:10:1000;2:3:100:2:500" -> liste de scrutation
+static void rtuParsePolls(const char *spec) {
+  const char *p = spec;
+  while (*p) {
+    unsigned unit, fc, addr, count;
+    unsigned long period;
+    if (sscanf(p, "%u:%u:%u:%u:%lu", &unit, &fc, &addr, &count, &period) == 5) {
+      if (!rtuAddPoll(rtuMaster, (uint8_t)unit, (uint8_t)fc, (uint16_t)addr, (uint16_t)count, (uint32_t)period)) {
+        logWarnf("RTU: scrutation ignorée (%u:%u:%u:%u)", unit, fc, addr, count);
+      }
+    }
+    const char *next = strchr(p, ';');
+    if (!next) break;
+    p = next + 1;
+  }
+}
+
+void setupRs485() {
+  if (!rtuEnabled) return;
+  // Buffers logiciels: write() rend la main immédiatement, la réponse s'accumule sans bloquer
+  Serial1.setRxBufferSize(512);
+  Serial1.setTxBufferSize(RTU_MAX_FRAME);
+  Serial1.begin(rtuBaud, rtuSerialConfig(rtuFormat), RS485_RX_PIN, RS485_TX_PIN);
+  Serial1.setRxTimeout(4);
+  Serial1.onReceive(rtuOnRxTimeout, true);
+
+  static const RtuPort port = {rtuPortAvailable, rtuPortRead, rtuPortWrite, rtuPortTakeIdle};
+  rtuInit(rtuMaster, port, rtuBaud, rtuTimeoutMs, rtuCacheMs);
+  rtuMaster.onGatewayReply = rtuGatewayReply;
+  rtuParsePolls(rtuPolls);
+  Serial.printf("✓ Modbus RTU (RS485) %lu %s, %u scrutation(s)\n", (unsigned long)rtuBaud, rtuFormat, rtuMaster.pollCount);
+}
+
+static void httpServe(EthernetClient &client, uint8_t &route) {
+  client.setTimeout(200);
+
+  // Read request line (e.g. "GET /path?x=y HTTP/1.1"), découpée sur place
+  char requestLine[HTTP_LINE_MAX];
+  httpReadLine(client, requestLine, sizeof(requestLine));
+
+  size_t contentLength = 0;
+  char otaKeyHeader[sizeof(otaKey) + 1] = "";   // +1: une clé trop longue ne peut pas correspondre
+  bool isChunked = false;
+  // Read headers
+  char line[HTTP_LINE_MAX];
+  while (client.connected()) {
+    if (httpReadLine(client, line, sizeof(line)) == 0) break;
+    const char *v;
+    if ((v = httpHeaderValue(line, "content-length")) != nullptr) {
+      contentLength = (size_t)atol(v);
+    } else if ((v = httpHeaderValue(line, "transfer-encoding")) != nullptr) {
+      for (; *v && !isChunked; v++) isChunked = (strncasecmp(v, "chunked", 7) == 0);
+    } else if ((v = httpHeaderValue(line, "x-ota-key")) != nullptr) {
+      strlcpy(otaKeyHeader, v, sizeof(otaKeyHeader));
+    }
+  }
+
+  // Parse path: "<méthode> <cible> <version>", sinon méthode et chemin vides
+  const char *method = "";
+  const char *path = "";
+  const char *query = "";
+  char *sp1 = strchr(requestLine, ' ');
+  char *sp2 = sp1 ? strchr(sp1 + 1, ' ') : nullptr;
+  if (sp1 > requestLine && sp2) {
+    *sp1 = '\0';
+    *sp2 = '\0';
+    method = requestLine;
+    path = sp1 + 1;
+    char *q = strchr(sp1 + 1, '?');
+    if (q) {
+      *q = '\0';
+      query = q + 1;
+    }
+  }
+  route = httpRouteOf(method, path);
+  // Routes de consultation (tableau de bord, supervision): sans allocation
+  AllocHotSection hot(route == HTTP_ROUTE_STATUS || route == HTTP_ROUTE_CONFIG_GET || route == HTTP_ROUTE_BOOT ||
+                      route == HTTP_ROUTE_MEM || route == HTTP_ROUTE_LOGS || route == HTTP_ROUTE_PAGE ||
+                      route == HTTP_ROUTE_RELAY);
+
+#if ENABLE_OTA_HTTP
+  if (route == HTTP_ROUTE_OTA) {
+    HttpJsonDocument resp(256);
+
+    if (otaKey[0] == '\0') {
+      resp["ok"] = 0;
+      resp["error"] = "ota_key_not_set";
+      sendHttpJson(client, "403 Forbidden", resp);
+      delay(5);
+      client.stop();
+      return;
+    }
+
+    if (otaKeyHeader[0] == '\0' || strcmp(otaKeyHeader, otaKey) != 0) {
       resp["ok"] = 0;
       resp["error"] = "bad_ota_key";
-      String out;
-      serializeJson(resp, out);
-      sendHttp(client, "401 Unauthorized", "application/json", out);
+      sendHttpJson(client, "401 Unauthorized", resp);
       delay(5);
       client.stop();
       return;
@@ -821,9 +2739,7 @@ void handleHttpLoop() {
     if (contentLength == 0) {
       resp["ok"] = 0;
       resp["error"] = "missing_content_length";
-      String out;
-      serializeJson(resp, out);
-      sendHttp(client, "411 Length Required", "application/json", out);
+      sendHttpJson(client, "411 Length Required", resp);
       delay(5);
       client.stop();
       return;
@@ -834,17 +2750,16 @@ void handleHttpLoop() {
       resp["ok"] = 0;
       resp["error"] = "update_begin_failed";
       resp["code"] = (int)Update.getError();
-      String out;
-      serializeJson(resp, out);
-      sendHttp(client, "500 Internal Server Error", "application/json", out);
+      sendHttpJson(client, "500 Internal Server Error", resp);
       delay(5);
       client.stop();
       return;
     }
 
     size_t received = 0;
-    uint32_t lastData = millis();
-    uint8_t buf[1024];
+    uint32_t otaStart = millis();
+    uint32_t lastData = otaStart;
+    uint8_t buf[2048];
     while (received < contentLength && client.connected()) {
       int avail = client.available();
       if (avail > 0) {
@@ -859,9 +2774,7 @@ void handleHttpLoop() {
             resp["ok"] = 0;
             resp["error"] = "update_write_failed";
             resp["code"] = (int)Update.getError();
-            String out;
-            serializeJson(resp, out);
-            sendHttp(client, "500 Internal Server Error", "application/json", out);
+            sendHttpJson(client, "500 Internal Server Error", resp);
             delay(5);
             client.stop();
             return;
@@ -881,9 +2794,7 @@ void handleHttpLoop() {
       resp["error"] = "incomplete_upload";
       resp["received"] = (unsigned)received;
       resp["expected"] = (unsigned)contentLength;
-      String out;
-      serializeJson(resp, out);
-      sendHttp(client, "400 Bad Request", "application/json", out);
+      sendHttpJson(client, "400 Bad Request", resp);
       delay(5);
       client.stop();
       return;
@@ -894,54 +2805,131 @@ void handleHttpLoop() {
       resp["ok"] = 0;
       resp["error"] = "update_end_failed";
       resp["code"] = (int)Update.getError();
-      String out;
-      serializeJson(resp, out);
-      sendHttp(client, "500 Internal Server Error", "application/json", out);
+      sendHttpJson(client, "500 Internal Server Error", resp);
       delay(5);
       client.stop();
       return;
     }
 
+    uint32_t otaMs = millis() - otaStart;
     resp["ok"] = 1;
     resp["reboot"] = 1;
-    String out;
-    serializeJson(resp, out);
-    sendHttp(client, "200 OK", "application/json", out);
+    resp["duration_ms"] = otaMs;
+    resp["kbps"] = otaMs ? (uint32_t)((uint64_t)received * 8 / otaMs) : 0;
+    sendHttpJson(client, "200 OK", resp);
 
+    configSaveFlush();
+    udpCtrlSaveFloors();
     delay(250);
     ESP.restart();
     return;
   }
 #endif
 
-  String body = "";
-  if (method == "POST") {
-    if (contentLength > 0) {
-      body.reserve(contentLength + 1);
+#if ENABLE_BENCH_HTTP
+  // Bancs de débit réseau (tools/tests/bench_w5500_throughput.py), même clé que l'OTA
+  if (route == HTTP_ROUTE_BENCH_UP || route == HTTP_ROUTE_BENCH_DOWN) {
+    HttpJsonDocument resp(256);
+    if (otaKey[0] == '\0' || strcmp(otaKeyHeader, otaKey) != 0) {
+      resp["ok"] = 0;
+      resp["error"] = "bad_ota_key";
+      sendHttpJson(client, "401 Unauthorized", resp);
+      delay(5);
+      client.stop();
+      return;
+    }
+
+    uint8_t buf[2048];
+    if (route == HTTP_ROUTE_BENCH_UP) {
+      // Corps lu et jeté: mesure la réception seule (sans écriture flash)
+      size_t received = 0;
+      uint32_t start = millis();
+      uint32_t lastData = start;
+      while (received < contentLength && client.connected()) {
+        size_t want = contentLength - received;
+        if (want > sizeof(buf)) want = sizeof(buf);
+        int n = client.available() > 0 ? client.read(buf, want) : 0;
+        if (n > 0) {
+          received += (size_t)n;
+          lastData = millis();
+        } else {
+          if (millis() - lastData > 5000) break;
+          delay(1);
+        }
+      }
+      uint32_t ms = millis() - start;
+      resp["ok"] = (received == contentLength) ? 1 : 0;
+      resp["bytes"] = (unsigned)received;
+      resp["duration_ms"] = ms;
+      resp["kbps"] = ms ? (uint32_t)((uint64_t)received * 8 / ms) : 0;
+      sendHttpJson(client, "200 OK", resp);
+      delay(5);
+      client.stop();
+      return;
+    }
+
+    if (route == HTTP_ROUTE_BENCH_DOWN) {
+      char bytes[12];
+      size_t total = (size_t)atol(getQueryParam(query, "bytes", bytes, sizeof(bytes)));
+      if (total == 0) total = 100 * 1024;
+      if (total > 1024 * 1024) total = 1024 * 1024;
+      for (size_t i = 0; i < sizeof(buf); i++) buf[i] = (uint8_t)('A' + (i % 26));
+
+      char head[192];
+      size_t headLen = httpHeader(head, sizeof(head), "200 OK", "application/octet-stream", total);
+      uint32_t start = millis();
+      httpTx.attach(client.getSocketNumber());
+      httpTx.cork();
+      httpTx.write((const uint8_t *)head, headLen);
+      size_t sent = 0;
+      while (sent < total) {
+        size_t n = total - sent;
+        if (n > sizeof(buf)) n = sizeof(buf);
+        size_t w = httpTx.write(buf, n);
+        if (w == 0) break;
+        sent += w;
+      }
+      httpTx.flushSend(HTTP_SEND_TIMEOUT_MS);
+      httpTx.detach();
+      Serial.printf("Bench: %u octets envoyés en %lu ms\n", (unsigned)sent, (unsigned long)(millis() - start));
+      delay(5);
+      client.stop();
+      return;
+    }
+  }
+#endif
+
+  // Corps dans l'arène (HTTP_BODY_MAX octets au plus), terminé par '\0'
+  char *body = nullptr;
+  size_t bodyLen = 0;
+  bool isConfigPost = (route == HTTP_ROUTE_CONFIG_POST);
+  if (strcmp(method, "POST") == 0) {
+    size_t cap = (contentLength > 0) ? contentLength : (isChunked && isConfigPost) ? HTTP_BODY_MAX : 0;
+    if (cap > HTTP_BODY_MAX) cap = HTTP_BODY_MAX;
+    body = (char *)reqAlloc(httpArena, cap + 1);
+    if (!body) cap = 0;
+    if (contentLength > 0 && body) {
       uint32_t start = millis();
-      while (body.length() < contentLength && client.connected()) {
-        if (client.available()) {
-          body += (char)client.read();
+      while (bodyLen < cap && client.connected()) {
+        int n = client.available() > 0 ? client.read((uint8_t *)body + bodyLen, cap - bodyLen) : 0;
+        if (n > 0) {
+          bodyLen += (size_t)n;
           start = millis();
         } else {
           if (millis() - start > 500) break;
           delay(1);
         }
       }
-    } else if (isChunked && path == "/api/config") {
+    } else if (isChunked && isConfigPost && body) {
       // Décodage minimal du chunked encoding (suffisant pour le JSON de config)
-      const size_t MAX_BODY = 2048;
       uint32_t start = millis();
       while (client.connected()) {
         if (millis() - start > 2000) break;
-        String sizeLine = client.readStringUntil('\n');
-        sizeLine.trim();
-        if (sizeLine.length() == 0) continue;
-        char *endptr = nullptr;
-        unsigned long chunkSize = strtoul(sizeLine.c_str(), &endptr, 16);
+        if (httpReadLine(client, line, sizeof(line)) == 0) continue;
+        unsigned long chunkSize = strtoul(line, nullptr, 16);
         if (chunkSize == 0) {
           // Consommer la ligne vide finale si présente
-          client.readStringUntil('\n');
+          httpReadLine(client, line, sizeof(line));
           break;
         }
         while (client.connected() && client.available() < (int)chunkSize) {
@@ -951,13 +2939,14 @@ void handleHttpLoop() {
         for (unsigned long i = 0; i < chunkSize && client.connected(); i++) {
           int c = client.read();
           if (c < 0) break;
-          if (body.length() < MAX_BODY) body += (char)c;
+          if (bodyLen < cap) body[bodyLen++] = (char)c;
         }
         // Consommer CRLF après le chunk
-        client.readStringUntil('\n');
+        httpReadLine(client, line, sizeof(line));
         start = millis();
       }
     }
+    if (body) body[bodyLen] = '\0';
   }
 
   auto sanitizeJsonForLog = [](String s) -> String {
@@ -976,20 +2965,39 @@ void handleHttpLoop() {
   };
 
   // Routing
-  if (method == "GET" && path == "/api/logs") {
-    // Retourne les dernières lignes de log (buffer circulaire RAM)
-    String out;
-    out.reserve(logRingCount * 64);
-    size_t start = (logRingCount == LOG_RING_LINES) ? logRingHead : 0;
-    for (size_t i = 0; i < logRingCount; i++) {
-      size_t idx = (start + i) % LOG_RING_LINES;
-      if (logRing[idx].length() == 0) continue;
-      out += logRing[idx];
-      out += "\n";
-    }
-    sendHttp(client, "200 OK", "text/plain; charset=utf-8", out);
-  } else if (method == "GET" && path == "/api/config_raw") {
-    // Diagnostic: renvoie le contenu brut de /config.json (si présent)
+  if (route == HTTP_ROUTE_LOGS) {
+    // Records du journal mis en forme à la volée, du plus ancien au dernier
+    // publié avant la requête. Taille inconnue d'avance: pas de Content-Length.
+    static const char head[] = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: text/plain; charset=utf-8\r\n\r\n";
+    char *mem = (char *)reqAlloc(httpArena, HTML_CHUNK);
+    httpTx.attach(client.getSocketNumber());
+    httpTx.cork();
+    httpTx.write((const uint8_t *)head, sizeof(head) - 1);
+    if (mem) {
+      HtmlOut out(httpTx, mem, HTML_CHUNK);
+      LogRecord rec;
+      char line[LOG_LINE_MAX + 16];
+      uint32_t end = logRingHead(logRing);
+      uint32_t pos = logRingOldest(logRing, end);
+      while (pos != end) {
+        if (!logRingRead(logRing, pos, rec)) {
+          // Trou (record pas encore publié) ou déjà écrasé
+          pos = logRingSeek(logRing, pos + 1, end);
+          continue;
+        }
+        size_t n = logRecordLine(rec, line, sizeof(line));
+        line[n++] = '\n';
+        out.append(line, n);
+        pos += rec.words;
+      }
+      out.flush();
+    }
+    httpTx.flushSend(HTTP_SEND_TIMEOUT_MS);
+    httpTx.detach();
+    reqFree(httpArena, mem);
+  } else if (route == HTTP_ROUTE_CONFIG_RAW) {
+    // Diagnostic: renvoie le contenu brut de /config.json (export, si présent)
+    initSPIFFS();
     if (!spiffsReady || !SPIFFS.exists(CONFIG_FILE)) {
       sendHttp(client, "404 Not Found", "text/plain; charset=utf-8", "config_not_found");
     } else {
@@ -997,62 +3005,306 @@ void handleHttpLoop() {
       if (!f) {
         sendHttp(client, "500 Internal Server Error", "text/plain; charset=utf-8", "config_open_failed");
       } else {
-        String content = f.readString();
-        f.close();
-        sendHttp(client, "200 OK", "application/json", content);
+        size_t len = f.size();
+        char *text = (char *)reqAlloc(httpArena, len + 1);
+        if (!text) {
+          f.close();
+          sendHttp(client, "503 Service Unavailable", "text/plain; charset=utf-8", "no_memory");
+        } else {
+          len = f.read((uint8_t *)text, len);
+          f.close();
+          sendHttpRaw(client, "200 OK", "application/json", text, len);
+          reqFree(httpArena, text);
+        }
       }
     }
-  } else if (method == "GET" && path == "/api/status") {
-    DynamicJsonDocument doc(768);
+  } else if (route == HTTP_ROUTE_STATUS) {
+    HttpJsonDocument doc(4864);
+    char ipBuf[16];
     JsonArray r = doc.createNestedArray("r");
     JsonArray i = doc.createNestedArray("i");
     for (int k = 0; k < 8; k++) {
       r.add(relayStates[k] ? 1 : 0);
       i.add(inputStates[k] ? 1 : 0);
     }
-    doc["t"] = temperature;
-    doc["h"] = humidity;
+    uint32_t now = millis();
+    sensorToJson(doc, "t", "t_state", sensorTemp, now);
+    sensorToJson(doc, "h", "h_state", sensorHum, now);
     doc["mqtt"] = mqttConnected ? 1 : 0;
+    JsonObject q = doc.createNestedObject("mqtt_queue");
+    q["ram"] = mqttQueueRamDepth();
+    q["ram_cap"] = mqttQueueRamCapacity();
+    q["flash"] = mqttQueueFlashDepth();
+    q["flash_cap"] = MQTT_QUEUE_FLASH_RECORDS;
+    q["flash_state"] = mqttQueueFlashState;
+    q["dropped"] = mqttQueueStats.dropped;
+    q["replayed"] = mqttQueueStats.replayed;
+    q["flash_errors"] = mqttQueueStats.flashErrors;
+    q["header_writes"] = mqttQueueStats.headerWrites;
+    q["drop_policy"] = mqttQueueDropPolicyName();
+    JsonObject mc = doc.createNestedObject("mqtt_conn");
+    mc["phase"] = mqttPhaseName(mqttPhase);
+    mc["attempts"] = mqttConnStats.attempts;
+    mc["connects"] = mqttConnStats.connects;
+    mc["tcp_failures"] = mqttConnStats.tcpFailures;
+    mc["mqtt_failures"] = mqttConnStats.mqttFailures;
+    mc["disconnects"] = mqttConnStats.disconnects;
+    mc["last_connect_ms"] = mqttConnStats.lastConnectMs;
+    mc["last_error"] = mqttConnStats.lastError;
+    mc["backoff_ms"] = mqttBackoffMs;
+    doc["loop_max_us"] = loopMaxUs;
+    JsonObject w5 = doc.createNestedObject("w5500");
+    w5["irq"] = netIrqActive ? 1 : 0;
+    w5["irq_count"] = w5500IrqCount;
+    w5["idle_sleeps"] = netIdleSleeps;
+    w5["spi_per_s"] = spiPerSec;
+    w5["spi_per_s_min"] = spiPerSecMin;
+    JsonObject acc = w5.createNestedObject("accept_latency");
+    acc["samples"] = netAcceptLatency.samples;
+    acc["avg_us"] = latencyHistAvgUs(netAcceptLatency);
+    acc["max_us"] = netAcceptLatency.maxUs;
+    JsonObject bt = doc.createNestedObject("boot_timing");
+    bt["net_mode"] = bootNetMode;
+    bt["net_ready_ms"] = bootNetReadyMs;
+    bt["first_publish_ms"] = bootFirstPublishMs;
+    if (dhcpEnabled) {
+      JsonObject dh = doc.createNestedObject("dhcp");
+      dh["state"] = dhcpStateName(dhcpClient.state);
+      dh["server"] = ipText(ipBuf, IPAddress(dhcpClient.lease.server));
+      dh["lease_s"] = dhcpClient.lease.leaseS;
+      dh["bound_age_s"] = (dhcpClient.state == DHCP_ST_BOUND) ? dhcpElapsedS(dhcpClient, millis()) : 0;
+      dh["first_bound_ms"] = dhcpClient.firstBoundMs;
+      dh["discovers"] = dhcpClient.stats.discovers;
+      dh["requests"] = dhcpClient.stats.requests;
+      dh["acks"] = dhcpClient.stats.acks;
+      dh["naks"] = dhcpClient.stats.naks;
+      dh["renewals"] = dhcpClient.stats.renewals;
+      dh["expiries"] = dhcpClient.stats.expiries;
+    }
+    JsonObject nr = doc.createNestedObject("net_reconfig");
+    nr["state"] = netReconfStateName(netReconfState);
+    nr["changes"] = netReconfChanges;
+    nr["reverts"] = netReconfReverts;
+    nr["apply_us"] = netReconfApplyUs;
+    nr["confirm_ms"] = netReconfConfirmMs;
+    nr["confirmed_by"] = netReconfBy;
+    JsonObject cs = doc.createNestedObject("config_store");
+    cs["pending"] = configSave.dirty ? 1 : 0;
+    cs["requests"] = configStore.requests;
+    cs["writes"] = configStore.writes;
+    cs["unchanged"] = configStore.unchanged;
+    cs["failures"] = configStore.failures;
+    cs["nvs_bytes"] = configStore.nvsBytes;
+    cs["file_bytes"] = configStore.fileBytes;
+    cs["last_us"] = configStore.lastUs;
+    JsonObject sk = doc.createNestedObject("sockets");
+    sk["free"] = netSockets.free;
+    for (uint8_t i = SOCK_SVC_HTTP; i < SOCK_SVC_COUNT; i++) {
+      const SockServiceBudget &sb = netSockets.svc[i];
+      JsonObject so = sk.createNestedObject(sockServiceName(i));
+      so["used"] = sb.used;
+      so["reserved"] = sb.reserved;
+      so["cap"] = sb.cap;
+      so["refusals"] = sb.refusals;
+      so["evictions"] = sb.evictions;
+    }
+    if (udpActive) {
+      JsonObject ud = doc.createNestedObject("udp");
+      ud["commands"] = udpCtrl.stats.commands;
+      ud["bad_mac"] = udpCtrl.stats.badMac;
+      ud["replays"] = udpCtrl.stats.replays;
+      ud["refused"] = udpCtrl.stats.refused;
+      ud["peers"] = udpCtrlPeerCount(udpCtrl);
+      ud["peers_max"] = UDP_CTRL_PEERS;
+      ud["malformed"] = udpCtrl.stats.malformed;
+      ud["states_sent"] = udpCtrl.stats.statesSent;
+      JsonObject ul = ud.createNestedObject("cmd_latency");
+      ul["samples"] = udpCmdLatency.samples;
+      ul["avg_us"] = latencyHistAvgUs(udpCmdLatency);
+      ul["max_us"] = udpCmdLatency.maxUs;
+    }
+    if (peerLinkActive) {
+      JsonObject pl = doc.createNestedObject("peer_links");
+      pl["bindings"] = peerLink.bindingCount;
+      JsonArray po = pl.createNestedArray("out");
+      for (uint8_t i = 0; i < peerLink.outCount; i++) {
+        const PeerLinkOut &o = peerLink.out[i];
+        JsonObject e = po.createNestedObject();
+        e["ip"] = ipText(ipBuf, IPAddress(o.addr));
+        e["up"] = o.up ? 1 : 0;
+        e["relays"] = o.want.values;
+        e["sent"] = o.sent;
+        e["retransmits"] = o.retransmits;
+        e["link_downs"] = o.linkDowns;
+      }
+      JsonArray pi = pl.createNestedArray("in");
+      for (uint8_t i = 0; i < PEER_LINK_MAX_PEERS; i++) {
+        const PeerLinkIn &src = peerLink.in[i];
+        if (src.addr == 0) continue;
+        JsonObject e = pi.createNestedObject();
+        e["ip"] = ipText(ipBuf, IPAddress(src.addr));
+        e["mask"] = src.mask;
+        e["failed"] = src.failed ? 1 : 0;
+        e["failsafes"] = src.failsafes;
+      }
+      JsonObject pll = pl.createNestedObject("latency");
+      pll["samples"] = peerLink.latency.samples;
+      pll["avg_us"] = latencyHistAvgUs(peerLink.latency);
+      pll["max_us"] = peerLink.latency.maxUs;
+    }
+    JsonObject ha = doc.createNestedObject("ha_discovery");
+    ha["enabled"] = haDiscoveryEnabled ? 1 : 0;
+    ha["node_id"] = (const char *)haNodeId;
+    ha["bursts"] = haDiscoveryBursts;
+    ha["last_ms"] = haDiscoveryMs;
+    JsonObject mb = doc.createNestedObject("modbus");
+    mb["requests"] = modbusStats.requests;
+    mb["exceptions"] = modbusStats.exceptions;
+    mb["writes"] = modbusStats.writes;
+    if (rtuEnabled) {
+      const RtuStats &rs = rtuMaster.stats;
+      JsonObject rtu = doc.createNestedObject("modbus_rtu");
+      rtu["transactions"] = rs.transactions;
+      rtu["timeouts"] = rs.timeouts;
+      rtu["crc_errors"] = rs.crcErrors;
+      rtu["exceptions"] = rs.exceptions;
+      rtu["cache_hits"] = rs.cacheHits;
+      rtu["cache_misses"] = rs.cacheMisses;
+      rtu["cache_hit_pct"] = rtuCacheHitRate(rs);
+      rtu["cycle_ms"] = rs.cycleMs;
+      rtu["cycle_max_ms"] = rs.cycleMaxMs;
+    }
+    JsonObject sp = doc.createNestedObject("sparkplug");
+    sp["mode"] = mqttPayloadModeName();
+    sp["seq"] = spSeq;
+    sp["bd_seq"] = spBdSeq;
+    sp["births"] = spBirths;
+    sp["encode_us"] = spEncodeUs;
+    doc["mqtt_cmds"] = mqttCmdCount;
+    doc["mqtt_cmd_errors"] = mqttCmdErrors;
+    doc["mqtt_cmd_duplicates"] = mqttCmdDuplicates;
+    doc["mqtt_cmd_acks_dropped"] = mqttCmdAcksDropped;
+    JsonObject lat = doc.createNestedObject("mqtt_cmd_latency");
+    JsonArray latBounds = lat.createNestedArray("bounds_us");
+    for (int k = 0; k < LATENCY_HIST_BUCKETS - 1; k++) latBounds.add(LATENCY_HIST_BOUNDS_US[k]);
+    JsonArray latCounts = lat.createNestedArray("counts");
+    for (int k = 0; k < LATENCY_HIST_BUCKETS; k++) latCounts.add(mqttCmdLatency.counts[k]);
+    lat["samples"] = mqttCmdLatency.samples;
+    lat["avg_us"] = latencyHistAvgUs(mqttCmdLatency);
+    lat["max_us"] = mqttCmdLatency.maxUs;
     doc["uptime_ms"] = millis();
-    doc["ip"] = Ethernet.localIP().toString();
-    doc["ip_cfg"] = staticIP.toString();
-    doc["gw_cfg"] = gateway.toString();
-    doc["subnet_cfg"] = subnet.toString();
-    doc["dns1_cfg"] = dns1.toString();
-
-    String body;
-    serializeJson(doc, body);
-    sendHttp(client, "200 OK", "application/json", body);
-  } else if (method == "GET" && path == "/api/config") {
-    DynamicJsonDocument doc(1024);
-    doc["static_ip"] = staticIP.toString();
-    doc["gateway"] = gateway.toString();
-    doc["subnet"] = subnet.toString();
-    doc["dns1"] = dns1.toString();
-    doc["broker_ip"] = mqttServer.toString();
-    doc["broker_port"] = mqttPort;
-    doc["username"] = mqttUser;
-    doc["ota_key_set"] = (otaKey[0] != '\0') ? 1 : 0;
-    doc["mqtt_connected"] = mqttConnected ? 1 : 0;
-
-    JsonArray rlbl = doc.createNestedArray("relay_labels");
-    JsonArray ilbl = doc.createNestedArray("input_labels");
-    for (int i = 0; i < 8; i++) {
-      rlbl.add(relayLabels[i]);
-      ilbl.add(inputLabels[i]);
+    doc["ip"] = (const char *)ethIpStr;
+    doc["status_pub_us"] = statusPublishUs;
+    doc["ip_cfg"] = ipText(ipBuf, staticIP);
+    doc["gw_cfg"] = ipText(ipBuf, gateway);
+    doc["subnet_cfg"] = ipText(ipBuf, subnet);
+    doc["dns1_cfg"] = ipText(ipBuf, dns1);
+
+    sendHttpJson(client, "200 OK", doc);
+  } else if (route == HTTP_ROUTE_BOOT) {
+    HttpJsonDocument doc(1280);
+    doc["reset_reason"] = resetReasonName(esp_reset_reason());
+    doc["relay_boot"] = relayBootPolicy == RELAY_BOOT_RESTORE ? "restore" : "off";
+    doc["relays_restored"] = relayBootRestored;
+    doc["relay_saves"] = relayPersistWrites;
+    doc["net_mode"] = bootNetMode;
+    JsonObject cfg = doc.createNestedObject("config");
+    cfg["source"] = configLoad.source;
+    cfg["nvs"] = configBlobStatusName(configLoad.blob);
+    cfg["json_error"] = configLoad.jsonError;
+    cfg["load_us"] = configLoad.loadUs;
+    cfg["heap_peak"] = configLoad.heapPeak;
+    cfg["heap_kept"] = configLoad.heapKept;
+    cfg["blob_bytes"] = (uint32_t)configBlobBytes();
+    JsonArray ph = doc.createNestedArray("phases");
+    for (uint8_t i = 0; i < bootPhaseCount; i++) {
+      JsonObject e = ph.createNestedObject();
+      e["name"] = bootPhases[i].name;
+      e["us"] = bootPhases[i].us;
+    }
+    sendHttpJson(client, "200 OK", doc);
+  } else if (route == HTTP_ROUTE_MEM) {
+    // Tas (plus grand bloc libre = fragmentation), arène HTTP par route,
+    // allocations du tas (alloc_trace.h; ?reset=1 les remet à zéro après la
+    // réponse) et journal (log_ring.h)
+    HttpJsonDocument doc(JSON_OBJECT_SIZE(6) + JSON_OBJECT_SIZE(6) + JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(HTTP_ROUTE_COUNT) +
+                         HTTP_ROUTE_COUNT * JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(12) + JSON_OBJECT_SIZE(2) +
+                         JSON_ARRAY_SIZE(ALLOC_TAG_COUNT) + ALLOC_TAG_COUNT * JSON_OBJECT_SIZE(4) + 16);
+    doc["heap_free"] = ESP.getFreeHeap();
+    doc["heap_min"] = ESP.getMinFreeHeap();
+    doc["heap_largest"] = ESP.getMaxAllocHeap();
+    JsonObject ar = doc.createNestedObject("arena");
+    ar["size"] = HTTP_ARENA_SIZE;
+    ar["body_max"] = HTTP_BODY_MAX;
+    ar["heap_fallbacks"] = httpArena.heapFallbacks;
+    JsonArray routes = ar.createNestedArray("routes");
+    for (uint8_t k = 0; k < HTTP_ROUTE_COUNT; k++) {
+      const ReqArenaRoute &rt = httpRoutes[k];
+      if (rt.requests == 0) continue;
+      JsonObject e = routes.createNestedObject();
+      e["route"] = rt.name;
+      e["n"] = rt.requests;
+      e["peak"] = rt.peak;
+      e["last"] = rt.last;
+      e["heap"] = rt.heapAllocs;
+    }
+    JsonObject al = doc.createNestedObject("alloc");
+    al["active"] = allocTrace.active ? 1 : 0;
+    al["trap"] = ALLOC_TRAP;
+    al["since_ms"] = millis() - allocTrace.resetMs;
+    al["iterations"] = allocTrace.iterations;
+    al["iter_last"] = allocTrace.iterLast;
+    al["iter_max"] = allocTrace.iterMax;
+    al["iter_dirty"] = allocTrace.iterDirty;
+    al["hot"] = allocTrace.hotAllocs;
+    if (allocTrace.hotAllocs) {
+      char caller[12];
+      snprintf(caller, sizeof(caller), "0x%08lx", (unsigned long)allocTrace.hotCaller);
+      al["hot_caller"] = caller;
+      al["hot_tag"] = ALLOC_TAG_NAMES[allocTrace.hotTag];
+    }
+    JsonObject ot = al.createNestedObject("other_tasks");
+    ot["allocs"] = allocTrace.otherAllocs;
+    ot["frees"] = allocTrace.otherFrees;
+    JsonArray tags = al.createNestedArray("tags");
+    for (uint8_t k = 0; k < ALLOC_TAG_COUNT; k++) {
+      const AllocTagStats &t = allocTrace.tags[k];
+      if (t.allocs == 0 && t.frees == 0) continue;
+      JsonObject e = tags.createNestedObject();
+      e["tag"] = ALLOC_TAG_NAMES[k];
+      e["allocs"] = t.allocs;
+      e["frees"] = t.frees;
+      e["bytes"] = t.bytes;
     }
+    // Octets par record: moyenne depuis le démarrage (head compte les mots réservés)
+    JsonObject lg = doc.createNestedObject("log");
+    uint32_t logRecords = logRing.records;
+    uint32_t logAvg = logRecords ? logRingHead(logRing) * 4 / logRecords : 0;
+    uint32_t mhz = getCpuFrequencyMhz();
+    lg["bytes"] = LOG_RING_BYTES;
+    lg["records"] = logRecords;
+    lg["record_bytes"] = logAvg;
+    lg["lines_fit"] = logAvg ? LOG_RING_BYTES / logAvg : 0;
+    lg["write_ns"] = logWriteStats.calls ? (uint32_t)((uint64_t)logWriteStats.cycles * 1000 / mhz / logWriteStats.calls) : 0;
+    lg["write_ns_max"] = (uint32_t)((uint64_t)logWriteStats.maxCycles * 1000 / mhz);
+    sendHttpJson(client, "200 OK", doc);
+    char reset[4];
+    if (strcmp(getQueryParam(query, "reset", reset, sizeof(reset)), "1") == 0) allocTraceReset();
+  } else if (route == HTTP_ROUTE_CONFIG_GET) {
+    // Tous les champs de la table; secrets remplacés par "<clé>_set"
+    HttpJsonDocument doc(cfgDocSize(CONFIG_FIELDS, CONFIG_FIELD_COUNT, false, 1));
+    cfgToJson(CONFIG_FIELDS, CONFIG_FIELD_COUNT, doc.to<JsonObject>(), false);
+    doc["mqtt_connected"] = mqttConnected ? 1 : 0;
 
-    String out;
-    serializeJson(doc, out);
-    sendHttp(client, "200 OK", "application/json", out);
-  } else if (method == "POST" && path == "/api/config") {
-    DynamicJsonDocument doc(1024);
-    DynamicJsonDocument resp(256);
+    sendHttpJson(client, "200 OK", doc);
+  } else if (isConfigPost) {
+    HttpJsonDocument doc(cfgParseDocSize(CONFIG_FIELDS, CONFIG_FIELD_COUNT, CONFIG_EXTRA_KEYS));
+    HttpJsonDocument resp(JSON_OBJECT_SIZE(12) + JSON_ARRAY_SIZE(8) + 3 * 16);
 
-    logLine("\n[HTTP] POST /api/config");
+    logLinef("[HTTP] POST /api/config");
     logLinef("  Content-Length: %u", (unsigned)contentLength);
-    logLinef("  Body length: %u", (unsigned)body.length());
-    if (body.length() > 0) {
+    logLinef("  Body length: %u", (unsigned)bodyLen);
+    if (bodyLen > 0) {
       String preview = body;
       if (preview.length() > 512) preview = preview.substring(0, 512) + "...";
       logLinef("  Body preview: %s", sanitizeJsonForLog(preview).c_str());
@@ -1062,106 +3314,40 @@ void handleHttpLoop() {
     IPAddress oldGw = gateway;
     IPAddress oldMask = subnet;
     IPAddress oldDns = dns1;
-    IPAddress oldMqtt = mqttServer;
-    uint16_t oldPort = mqttPort;
 
-    DeserializationError err = deserializeJson(doc, body);
-    if (err) {
-      logLinef("  JSON error: %s", err.c_str());
+    // Lecture en place: les chaînes du document pointent dans body
+    uint32_t parseStart = micros();
+    DeserializationError err = deserializeJson(doc, body, bodyLen);
+    CfgApplyResult r;
+    bool valid = !err && doc.is<JsonObject>() &&
+                 cfgFromJson(CONFIG_FIELDS, CONFIG_FIELD_COUNT, doc.as<JsonObjectConst>(), true, r);
+    uint32_t parseUs = micros() - parseStart;
+    if (err || !doc.is<JsonObject>()) {
+      logWarnf("  JSON error: %s", err ? err.c_str() : "not an object");
       resp["ok"] = 0;
       resp["error"] = "bad_json";
-      resp["body_len"] = (unsigned)body.length();
+      resp["body_len"] = (unsigned)bodyLen;
       resp["content_len"] = (unsigned)contentLength;
-      String out;
-      serializeJson(resp, out);
-      sendHttp(client, "400 Bad Request", "application/json", out);
+      sendHttpJson(client, "400 Bad Request", resp);
+    } else if (!valid) {
+      // Rien n'est appliqué
+      logWarnf("  Refused: %s (%s)", r.badKey, r.reason);
+      resp["ok"] = 0;
+      resp["error"] = "invalid";
+      resp["field"] = r.badKey;
+      resp["reason"] = r.reason;
+      sendHttpJson(client, "400 Bad Request", resp);
     } else {
-      logLine("  JSON OK -> applying fields");
-      if (doc.containsKey("static_ip")) {
-        String ipStr = doc["static_ip"].as<String>();
-        IPAddress parsed;
-        uint32_t parts[4];
-        if (sscanf(ipStr.c_str(), "%lu.%lu.%lu.%lu", &parts[0], &parts[1], &parts[2], &parts[3]) == 4) {
-          parsed = IPAddress(parts[0], parts[1], parts[2], parts[3]);
-          staticIP = parsed;
-        }
-      }
-      if (doc.containsKey("gateway")) {
-        String ipStr = doc["gateway"].as<String>();
-        uint32_t parts[4];
-        if (sscanf(ipStr.c_str(), "%lu.%lu.%lu.%lu", &parts[0], &parts[1], &parts[2], &parts[3]) == 4) {
-          gateway = IPAddress(parts[0], parts[1], parts[2], parts[3]);
-        }
-      }
-      if (doc.containsKey("subnet")) {
-        String ipStr = doc["subnet"].as<String>();
-        uint32_t parts[4];
-        if (sscanf(ipStr.c_str(), "%lu.%lu.%lu.%lu", &parts[0], &parts[1], &parts[2], &parts[3]) == 4) {
-          subnet = IPAddress(parts[0], parts[1], parts[2], parts[3]);
-        }
-      }
-      if (doc.containsKey("dns1")) {
-        String ipStr = doc["dns1"].as<String>();
-        uint32_t parts[4];
-        if (sscanf(ipStr.c_str(), "%lu.%lu.%lu.%lu", &parts[0], &parts[1], &parts[2], &parts[3]) == 4) {
-          dns1 = IPAddress(parts[0], parts[1], parts[2], parts[3]);
-        }
-      }
-      if (doc.containsKey("broker_ip")) {
-        String ipStr = doc["broker_ip"].as<String>();
-        uint32_t parts[4];
-        if (sscanf(ipStr.c_str(), "%lu.%lu.%lu.%lu", &parts[0], &parts[1], &parts[2], &parts[3]) == 4) {
-          mqttServer = IPAddress(parts[0], parts[1], parts[2], parts[3]);
-        }
-      }
-      if (doc.containsKey("broker_port")) {
-        mqttPort = (uint16_t)doc["broker_port"].as<int>();
-      }
-      if (doc.containsKey("username")) {
-        strlcpy(mqttUser, doc["username"].as<const char*>(), sizeof(mqttUser));
-      }
-      if (doc.containsKey("password")) {
-        const char *pw = doc["password"].as<const char*>();
-        if (pw && strlen(pw) > 0) {
-          strlcpy(mqttPassword, pw, sizeof(mqttPassword));
-        }
+      if (r.fx & CFG_FX_LABELS) {
+        ioLabelsVersion++;
+        rebuildTopicRouter();
       }
 
-      if (doc.containsKey("ota_key")) {
-        const char *k = doc["ota_key"].as<const char*>();
-        if (k) {
-          strlcpy(otaKey, k, sizeof(otaKey));
-        }
-      }
+      // Écriture flash depuis loop(), regroupée avec les requêtes qui suivent
+      if (r.changed) configSaveLater();
 
-      // Mise à jour des labels (optionnel)
-      if (doc.containsKey("relay_labels") && doc["relay_labels"].is<JsonArray>()) {
-        JsonArray arr = doc["relay_labels"].as<JsonArray>();
-        for (int i = 0; i < 8 && i < (int)arr.size(); i++) {
-          const char *v = arr[i] | "";
-          if (v && strlen(v) > 0) strlcpy(relayLabels[i], v, sizeof(relayLabels[i]));
-        }
-      }
-      if (doc.containsKey("input_labels") && doc["input_labels"].is<JsonArray>()) {
-        JsonArray arr = doc["input_labels"].as<JsonArray>();
-        for (int i = 0; i < 8 && i < (int)arr.size(); i++) {
-          const char *v = arr[i] | "";
-          if (v && strlen(v) > 0) strlcpy(inputLabels[i], v, sizeof(inputLabels[i]));
-        }
-      }
-
-      if (!saveMQTTConfig()) {
-        resp["ok"] = 0;
-        resp["error"] = "spiffs_save_failed";
-        String out;
-        serializeJson(resp, out);
-        sendHttp(client, "500 Internal Server Error", "application/json", out);
-        delay(5);
-        client.stop();
-        return;
-      }
-
-      logLinef("  Saved. IP=%s GW=%s MQTT=%s:%u user=%s pass_set=%s",
+      logLinef("  Applied %u field(s). IP=%s GW=%s MQTT=%s:%u user=%s pass_set=%s",
+               (unsigned)r.changed,
                staticIP.toString().c_str(),
                gateway.toString().c_str(),
                mqttServer.toString().c_str(),
@@ -1169,215 +3355,287 @@ void handleHttpLoop() {
                mqttUser,
                (mqttPassword[0] != '\0') ? "YES" : "NO");
 
-      bool needRestart = (oldIp != staticIP) || (oldGw != gateway) || (oldMask != subnet) || (oldDns != dns1);
+      // Adresse modifiée: appliquée à chaud par loop() une fois cette réponse partie
+      bool reconfig = !dhcpEnabled && (r.fx & CFG_FX_NET);
+      if (reconfig) {
+        // Une modification encore non confirmée ne devient pas l'adresse de repli
+        if (netReconfState != NET_RECONF_PENDING) {
+          netPrevIp = oldIp;
+          netPrevGw = oldGw;
+          netPrevMask = oldMask;
+          netPrevDns = oldDns;
+        }
+        netReconfRequested = true;
+      }
       resp["ok"] = 1;
-      resp["restart"] = needRestart ? 1 : 0;
-      if (needRestart) resp["new_ip"] = staticIP.toString();
+      resp["restart"] = (r.fx & CFG_FX_RESTART) ? 1 : 0;
+      resp["save_ms"] = r.changed ? CONFIG_SAVE_QUIET_MS : 0;
+      resp["reconfig"] = reconfig ? 1 : 0;
+      if (reconfig) {
+        resp["new_ip"] = staticIP.toString();
+        resp["confirm_ms"] = NET_RECONF_CONFIRM_MS;
+      }
       resp["current_ip"] = Ethernet.localIP().toString();
       resp["desired_ip"] = staticIP.toString();
+      JsonArray changed = resp.createNestedArray("changed");
+      for (uint8_t i = 0; i < r.changed && i < 8; i++) changed.add(r.changedKeys[i]);
+      resp["unknown"] = r.unknown;
+      resp["parse_us"] = parseUs;
 
-      String out;
-      serializeJson(resp, out);
-      sendHttp(client, "200 OK", "application/json", out);
+      sendHttpJson(client, "200 OK", resp);
 
-      if (!needRestart) {
-        if (oldMqtt != mqttServer || oldPort != mqttPort) {
-          mqttClient.setServer(mqttServer, mqttPort);
-        }
-        mqttClient.disconnect();
-        mqttReconnect();
-      }
-
-      if (needRestart) {
-        delay(250);
-        ESP.restart();
+      if (r.fx & CFG_FX_MQTT) {
+        mqttClient.setServer(mqttServer, mqttPort);
+        // Reconfiguration réseau: MQTT se reconnecte de toute façon
+        if (!reconfig) mqttResetConnection(true);
       }
     }
-  } else if (method == "GET" && path == "/relay") {
+  } else if (route == HTTP_ROUTE_RELAY) {
     handleRelayQuery(query);
     sendHttp(client, "200 OK", "text/plain", "OK");
-  } else if (method == "GET" && path == "/") {
-    // Render snapshot HTML (auto-refresh like in docs)
-    String page = getHtmlPage();
-    sendHttp(client, "200 OK", "text/html; charset=utf-8", page);
+  } else if (route == HTTP_ROUTE_PAGE) {
+    // Render snapshot HTML (auto-refresh like in docs). Taille inconnue
+    // d'avance: pas de Content-Length, la fermeture marque la fin.
+    static const char head[] = "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: text/html; charset=utf-8\r\n\r\n";
+    char *mem = (char *)reqAlloc(httpArena, HTML_CHUNK);
+    httpTx.attach(client.getSocketNumber());
+    httpTx.cork();
+    httpTx.write((const uint8_t *)head, sizeof(head) - 1);
+    if (mem) {
+      HtmlOut html(httpTx, mem, HTML_CHUNK);
+      writeHtmlPage(html);
+      html.flush();
+    }
+    httpTx.flushSend(HTTP_SEND_TIMEOUT_MS);
+    httpTx.detach();
+    reqFree(httpArena, mem);
   } else {
     sendHttp(client, "404 Not Found", "text/plain", "Not Found");
   }
 
+  reqFree(httpArena, body);
   delay(5);
   client.stop();
 }
 
+void handleHttpLoop() {
+  EthernetClient client = netServerAccept(webServer, httpPort, SOCK_SVC_HTTP);
+  if (!client) return;
+  netReconfigConfirm("http");
+  bootMark("first_http");
+
+  uint8_t route = HTTP_ROUTE_OTHER;
+  httpServe(client, route);
+  // Tout ce que la requête a pris dans l'arène est rendu d'un coup
+  reqArenaEnd(httpArena, httpRoutes[route]);
+}
+
 
 void setup() {
-  Serial.begin(9600);
-  delay(3000);  // Extra long delay for monitor to connect
-  
-  Serial.write(0x00); Serial.write(0xFF);  // Flush
-  delay(500);
+  // 1) Relais: état restauré avant toute autre initialisation
+  bootMark("setup");
+  bootRestoreRelays();
+  bootMark("relays");
+  allocTraceBegin();
 
-  // Initialisation SPIFFS et chargement config AVANT Ethernet.begin (pour appliquer l'IP)
-  initSPIFFS();
-  loadMQTTConfig();
-  Serial.printf("MQTT user (boot): %s\n", mqttUser);
-  Serial.printf("MQTT pass set (boot): %s\n", (mqttPassword[0] != '\0') ? "YES" : "NO");
+  Serial.begin(9600);
   Serial.println("\n\n╔════════════════════════════════════════╗");
   Serial.println("║ === DÉMARRAGE ESP32-S3-ETH-8DI-8RO ═══ ║");
   Serial.println("╚════════════════════════════════════════╝");
-  delay(500);
-  
-  // Initialisation I2C pour TCA9554
-  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN); // SDA=42, SCL=41 (Waveshare official)
-  Wire.setClock(100000);
-  Serial.println("✓ I2C initialisé (SDA=42, SCL=41)");
-  
-  // Configuration TCA9554 @ 0x20
-  // Registres TCA9554: 0x00 Input, 0x01 Output, 0x02 Polarity, 0x03 Configuration
-  // Relais: logique active HIGH (bit HIGH = relais ON)
-  delay(100);
-
-  // Polarity: pas d'inversion
-  Wire.beginTransmission(TCA9554_ADDR);
-  Wire.write(0x02);
-  Wire.write(0x00);
-  Wire.endTransmission();
-
-  // Configuration: tous en OUTPUT
-  Wire.beginTransmission(TCA9554_ADDR);
-  Wire.write(0x03);
-  Wire.write(0x00);
-  Wire.endTransmission();
+  Serial.printf("✓ TCA9554 configuré (relais 0x%02X, %s), reset: %s\n", relayBootRestored,
+                relayBootPolicy == RELAY_BOOT_RESTORE ? "restaurés" : "OFF", resetReasonName(esp_reset_reason()));
 
-  // Outputs: tous LOW => relais OFF
-  Wire.beginTransmission(TCA9554_ADDR);
-  Wire.write(0x01);
-  Wire.write(0x00);
-  Wire.endTransmission();
-
-  for (int i = 0; i < 8; i++) relayStates[i] = false;
-  Serial.println("✓ TCA9554 configuré (8 relais OFF au démarrage)");
-  
-  // Initialisation DHT22
-  dht.begin();
-  Serial.println("✓ DHT22 initialisé");
-  
-  // Configuration des entrées digitales
+  // Entrées (lues par loop() et par les liens entre cartes)
   for (int i = 0; i < 8; i++) {
     pinMode(digitalInputs[i], INPUT_PULLUP);
   }
-  Serial.println("✓ Entrées digitales configurées");
 
-  // Initialisation SPI pour W5500
-  Serial.println("Configuration SPI...");
-  SPI.begin(ETH_SCK_PIN, ETH_MISO_PIN, ETH_MOSI_PIN, ETH_CS_PIN);
-  Serial.printf("✓ SPI: SCK=%d, MISO=%d, MOSI=%d, CS=%d\n", 
-                ETH_SCK_PIN, ETH_MISO_PIN, ETH_MOSI_PIN, ETH_CS_PIN);
+  // 2) Config: canaux capteurs (valeurs par défaut, surchargées par la config),
+  // instantané NVS (ou import de /config.json) AVANT Ethernet.begin (pour appliquer l'IP)
+  // DHT22: -40..80 °C, 0..100 %
+  sensorChannelInit(sensorTemp, "temperature", -40.0f, 80.0f, 0.2f, 5000, 300000);
+  sensorChannelInit(sensorHum, "humidity", 0.0f, 100.0f, 1.0f, 5000, 300000);
+  loadMQTTConfig();
+  relayBootSyncPolicy(relayBootPolicy);
+  mqttQueueInit();
+  Serial.printf("MQTT user (boot): %s\n", mqttUser);
+  Serial.printf("MQTT pass set (boot): %s\n", (mqttPassword[0] != '\0') ? "YES" : "NO");
+  dht.begin();
+  bootMark("config");
 
-  // Configuration des pins
+  // 3) W5500: impulsion de reset (>= 500 µs selon la fiche technique). La lib
+  // Ethernet attend encore 560 ms dans Ethernet.begin() (W5100Class::init),
+  // ce qui couvre le verrouillage de la PLL: plus de délai fixe ici.
+  SPI.begin(ETH_SCK_PIN, ETH_MISO_PIN, ETH_MOSI_PIN, ETH_CS_PIN);
   pinMode(ETH_CS_PIN, OUTPUT);
   pinMode(ETH_RST_PIN, OUTPUT);
-  pinMode(ETH_IRQ_PIN, INPUT);
-  
+  pinMode(ETH_IRQ_PIN, INPUT_PULLUP);   // INTn actif bas
   digitalWrite(ETH_CS_PIN, HIGH);
-  
-  // Reset du W5500
-  Serial.printf("Reset W5500 (pin %d)...\n", ETH_RST_PIN);
   digitalWrite(ETH_RST_PIN, LOW);
-  delay(100);
+  delayMicroseconds(1000);
   digitalWrite(ETH_RST_PIN, HIGH);
-  delay(1000);
-  
-  Serial.println("✓ Reset W5500 terminé");
-  
-  // Initialisation Ethernet W5500
+
   Ethernet.init(ETH_CS_PIN);
-  Serial.print("Initialisation Ethernet...");
-  Ethernet.begin(mac, staticIP, dns1, gateway, subnet);
-  delay(2000);
-  
-  // Vérification statut Ethernet
+  w5500SpiBegin(ETH_CS_PIN);
+  netMacFromEfuse(mac);
+  Serial.printf("MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  if (dhcpEnabled) {
+    setupDhcp();
+  } else {
+    Ethernet.begin(mac, staticIP, dns1, gateway, subnet);
+    bootNetReadyMs = millis();
+    bootMark("ip_ready");
+  }
+  bootMark("w5500");
   if (Ethernet.hardwareStatus() == EthernetNoHardware) {
-    Serial.println(" ✗");
     Serial.println("❌ W5500 non détecté!");
-  } else if (Ethernet.linkStatus() == LinkOFF) {
-    Serial.println(" ⚠️");
-    Serial.println("⚠️ W5500 détecté mais pas de câble");
-  } else {
-    Serial.println(" ✓");
-    Serial.print("✓ IP Ethernet: ");
-    Serial.println(Ethernet.localIP());
   }
 
+  // Lien suivi par loop() (négociation en cours): les sockets d'écoute sont
+  // ouverts tout de suite et répondent dès que le lien monte
   lastEthLinkStatus = Ethernet.linkStatus();
+  refreshCachedIp();
+
+  // Interruptions socket (après Ethernet.begin: le reset logiciel efface les masques)
+  setupW5500Irq();
   
+  // 4) Services
   serverStarted = true;
-  Serial.println("✓ Serveur HTTP sur port 80");
-  Serial.print("  Accès: http://");
-  Serial.println(Ethernet.localIP());
-  
+  // RS485 / Modbus RTU (indépendant du réseau)
+  setupRs485();
+
   // Configuration HTTP Web Server
   setupWebServer();
+
+  // Protocole UDP binaire (après le budget des sockets)
+  setupUdpCtrl();
+  setupPeerLinks();
+  bootMark("servers");
   
-  // Configuration MQTT
+  // Configuration MQTT (connexion non bloquante, avancée par loop())
   setupMqtt();
+  bootMark("setup_done");
   
-  Serial.println("\n=== Système prêt ===\n");
-  Serial.println("Accès interface web: http://");
-  Serial.print(Ethernet.localIP());
-  Serial.println("/");
+  Serial.printf("\n=== Système prêt en %lu ms === http://%s/\n", (unsigned long)millis(), ethIpStr);
 }
 
 void loop() {
-  // Maintenir la connexion Ethernet
-  Ethernet.maintain();
+  uint32_t loopStartUs = micros();
+  allocTraceIteration();
+  allocTag(ALLOC_TAG_NET);
+  // Bail DHCP (non bloquant; Ethernet.maintain() n'a rien à faire: begin() statique)
+  netDhcpService(millis());
 
   // Surveiller le lien Ethernet et déclencher une reconnexion MQTT si besoin
+  // (toutes les 50 ms tant que le premier lien n'est pas monté)
   unsigned long now = millis();
-  if (now - lastEthLinkCheck >= ethLinkCheckIntervalMs) {
+  unsigned long linkCheckMs = ethLinkSeen ? ethLinkCheckIntervalMs : 50;
+  if (now - lastEthLinkCheck >= linkCheckMs) {
     lastEthLinkCheck = now;
     int link = Ethernet.linkStatus();
     if (link != lastEthLinkStatus) {
       lastEthLinkStatus = link;
       if (link == LinkOFF) {
         Serial.println("⚠️ Ethernet link OFF -> MQTT disconnect");
-        mqttConnected = false;
-        mqttClient.disconnect();
-        ethClient.stop();
+        mqttResetConnection(true);
       } else if (link == LinkON) {
+        ethLinkSeen = true;
+        bootMark("link_up");
         Serial.println("✓ Ethernet link ON -> MQTT reconnect pending");
-        mqttConnected = false;
-        mqttClient.disconnect();
-        ethClient.stop();
-        lastMqttReconnectAttempt = 0;
+        refreshCachedIp();
+        mqttResetConnection(true);
       } else {
         Serial.println("⚠️ Ethernet link status unknown");
       }
     }
   }
   
-  // Gestion HTTP Web Server
-  handleHttpLoop();
+  // Événements socket W5500 (IRQ): ne servir que ce qui a du travail
+  netCollectEvents(now);
+  netUpdateSpiRate(now);
+  netSocketBudgetService(now);
+  netReconfigService(now);
+  allocTag(ALLOC_TAG_STORE);
+  relayPersistService(now);
+  configSaveService(now);
+
+  if (netServersDue(now)) {
+    netLastServerPoll = now;
+    // Gestion HTTP Web Server
+    allocTag(ALLOC_TAG_HTTP);
+    handleHttpLoop();
+    // Modbus TCP (non bloquant, quelques trames par itération)
+    allocTag(ALLOC_TAG_MODBUS);
+    modbusService();
+    // Commandes UDP binaires
+    allocTag(ALLOC_TAG_NET);
+    udpCtrlPoll();
+  }
+  allocTag(ALLOC_TAG_NET);
+  udpCtrlStateService(now);
+  if (udpCtrlFloorsDue(udpCtrl, now)) udpCtrlSaveFloors();
+
+  // Liens entre cartes: entrées liées lues à chaque tour (8 digitalRead)
+  if (peerLinkActive) {
+    if (peerLink.bindingCount > 0) {
+      readInputs();
+      peerLinkInputs(peerLink, inputMask(), millis(), micros());
+    }
+    peerLinkService(peerLink, millis());
+  }
+
+  // Modbus RTU: scrutation RS485 et requêtes passerelle
+  allocTag(ALLOC_TAG_MODBUS);
+  if (rtuEnabled) rtuService(rtuMaster, millis());
   
   // Gestion MQTT
-  if (!mqttClient.connected()) {
+  allocTag(ALLOC_TAG_MQTT);
+  if (mqttPhase != MQTT_PHASE_CONNECTED) {
     mqttReconnect();
   } else {
-    // loop() retourne false quand la connexion est perdue; on force disconnect pour relancer mqttReconnect()
-    if (!mqttClient.loop()) {
-      mqttConnected = false;
-      mqttClient.disconnect();
-      ethClient.stop();
+    // Connecté: réception, acquittements et publications sans allocation
+    AllocHotSection hot;
+    // loop() retourne false quand la connexion est perdue: retour en IDLE avec backoff.
+    // Appelé sur événement du socket MQTT, sinon toutes les NET_MQTT_FALLBACK_MS (keepalive).
+    bool mqttAlive = true;
+    if (netMqttDue(now)) {
+      netLastMqttPoll = now;
+      mqttAlive = mqttClient.loop();
+    }
+    if (!mqttAlive) {
+      logWarnf("MQTT: connexion perdue");
+      mqttResetConnection(false);
     } else {
-      mqttConnected = true;
+      // Réponses aux commandes reçues pendant mqttClient.loop()
+      mqttSendCommandAcks();
+      // Topics par canal: seulement les changements
+      mqttPublishChannelStates();
+      // Discovery HA (après connexion ou changement de labels)
+      haDiscoveryService();
+      // Sparkplug: NDATA par exception, rebirth sur NCMD
+      sparkplugService();
       // Publier l'état régulièrement
       if (millis() - lastMqttPublish >= mqttPublishInterval) {
         lastMqttPublish = millis();
         mqttPublishStatus();
       }
+      // Rejeu des événements mis en file pendant une coupure
+      mqttQueueService();
     }
   }
+  mqttQueueSync(millis());
+  mqttDrainCommandLog();
+
+  // Entrées: détection de fronts (publiés ou mis en file)
+  allocTag(ALLOC_TAG_IO);
+  if (millis() - lastInputPoll >= inputPollIntervalMs) {
+    lastInputPoll = millis();
+    AllocHotSection hot;
+    pollInputEdges();
+  }
   
   // Traitement des commandes sériales
+  allocTag(ALLOC_TAG_SERIAL);
   if (Serial.available() > 0) {
     String cmd = Serial.readStringUntil('\n');
     cmd.trim();
@@ -1408,25 +3666,76 @@ void loop() {
         setRelay(i, false);
       }
       Serial.println("✓ Test complet\n");
+    } else if (cmd == "dhcp forget") {
+      // Prochain démarrage DHCP à froid (mesure du temps de démarrage)
+      Preferences prefs;
+      prefs.begin("dhcp", false);
+      prefs.remove("lease");
+      prefs.end();
+      Serial.println("✓ Bail DHCP en cache effacé");
+    } else if (cmd == "udp forget") {
+      // Libère la table pleine (émetteur remplacé, nouvelle IP)
+      udpCtrlForgetPeers(udpCtrl, millis());
+      udpCtrlSaveFloors();
+      Serial.println("✓ Table des émetteurs UDP vidée");
+    } else if (cmd == "config import") {
+      // /config.json modifié hors de la carte (uploadfs): réimport puis instantané NVS
+      if (importConfigJson() && saveMQTTConfig()) {
+        Serial.println("✓ Config importée, redémarrage...");
+        udpCtrlSaveFloors();
+        delay(100);
+        ESP.restart();
+      } else {
+        Serial.printf("✗ Import impossible (%s)\n", configLoad.jsonError[0] ? configLoad.jsonError : "absent");
+      }
     } else if (cmd == "help") {
       Serial.println("\nCommandes disponibles:");
       Serial.println("  relay X on/off  - Allume/éteint relais X (0-7)");
       Serial.println("  test            - Test tous les relais");
+      Serial.println("  dhcp forget     - Efface le bail DHCP en cache");
+      Serial.println("  udp forget      - Vide la table des émetteurs UDP (anti-rejeu)");
+      Serial.println("  config import   - Réimporte /config.json et redémarre");
       Serial.println("  help            - Affiche cette aide\n");
     }
   }
   
+  // Journal: écho console des records écrits depuis le dernier tour
+  allocTag(ALLOC_TAG_LOG);
+  logConsoleService();
+
   // Lecture des capteurs et entrées toutes les 2 secondes
+  allocTag(ALLOC_TAG_IO);
   static uint32_t lastSensorRead = 0;
   if (millis() - lastSensorRead > 2000) {
     lastSensorRead = millis();
+    AllocHotSection hot;
     readSensors();
-    readInputs();
+    // Capteurs: seulement sur variation significative / heartbeat
+    mqttPublishSensors();
     
-    Serial.printf("Temp=%.1f°C Hum=%.1f%% | Relais: ", temperature, humidity);
+    char tempStr[12], humStr[12];
+    Serial.printf("Temp=%s°C Hum=%s%% | Relais: ", sensorDisplay(sensorTemp, tempStr, sizeof(tempStr)),
+                  sensorDisplay(sensorHum, humStr, sizeof(humStr)));
     for (int i = 0; i < 8; i++) Serial.printf("%d ", relayStates[i] ? 1 : 0);
     Serial.print("| Entrées: ");
     for (int i = 0; i < 8; i++) Serial.printf("%d ", inputStates[i] ? 1 : 0);
     Serial.println();
   }
+
+  // Mesure du temps d'itération (max sur une fenêtre de 10 s)
+  allocTag(ALLOC_TAG_LOOP);
+  uint32_t loopUs = micros() - loopStartUs;
+  if (loopUs > loopMaxUsWindow) loopMaxUsWindow = loopUs;
+  if (millis() - loopMaxWindowStart >= 10000) {
+    loopMaxWindowStart = millis();
+    loopMaxUs = loopMaxUsWindow;
+    loopMaxUsWindow = 0;
+  }
+
+  // Rien en attente côté réseau: dormir jusqu'à la prochaine IRQ W5500 (1 tick max)
+  unsigned long idleNow = millis();
+  if (netIrqActive && !w5500IrqFlag && !netHot(netServerHotUntil, idleNow) && !netHot(netMqttHotUntil, idleNow)) {
+    netIdleSleeps++;
+    ulTaskNotifyTake(pdTRUE, 1);
+  }
 }
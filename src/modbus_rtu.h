@@ -0,0 +1,424 @@
+#ifndef MODBUS_RTU_H
+#define MODBUS_RTU_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ===== MODBUS RTU MAÎTRE (RS485) + CACHE + PASSERELLE TCP -> RTU =====
+// Maître non bloquant: rtuService() envoie une trame puis rend la main; la fin
+// de la réponse est détectée par l'inactivité de la ligne (timeout RX de
+// l'UART, >= 3,5 caractères) ou dès que la longueur attendue est reçue.
+// Aucune dépendance Arduino: le port série est fourni par RtuPort, ce qui
+// permet de tester le maître sous Linux (paire de pseudo-terminaux).
+//
+// - Liste de scrutation (RTU_MAX_POLLS lectures FC 01..04 périodiques),
+//   résultats gardés en cache.
+// - Passerelle: une lecture déjà en cache et plus récente que cacheMs est
+//   servie sans transaction RTU; sinon la requête passe devant la scrutation.
+//   Les écritures sont toujours transmises et invalident le cache de l'esclave.
+
+#define RTU_MAX_FRAME 256
+#define RTU_MAX_POLLS 8
+#define RTU_CACHE_SLOTS 16          // RTU_MAX_POLLS fixes + slots passerelle (LRU)
+#define RTU_CACHE_DATA 128          // octets de données par bloc (64 registres / 1024 bits)
+#define RTU_GW_QUEUE 4
+
+// Exceptions passerelle (Modbus Application Protocol, 6.11/6.12)
+#define RTU_EX_GW_PATH_UNAVAILABLE 0x0A
+#define RTU_EX_GW_TARGET_NO_RESPONSE 0x0B
+
+struct RtuPort {
+  int (*available)();
+  int (*read)(uint8_t *buf, size_t len);
+  size_t (*write)(const uint8_t *buf, size_t len);
+  bool (*takeIdle)();               // true (une fois) après un silence de fin de trame
+};
+
+struct RtuPoll {
+  uint8_t unit;
+  uint8_t fc;                       // 1..4
+  uint16_t addr;
+  uint16_t count;
+  uint32_t periodMs;
+  uint32_t nextMs;
+};
+
+struct RtuCacheEntry {
+  uint8_t unit;
+  uint8_t fc;                       // 0 = slot libre
+  uint16_t addr;
+  uint16_t count;
+  uint8_t byteCount;
+  uint8_t data[RTU_CACHE_DATA];
+  bool valid;
+  uint32_t stampMs;
+  uint32_t usedMs;
+};
+
+struct RtuGatewayRequest {
+  uint8_t tag;                      // identifiant de l'appelant (socket TCP)
+  uint8_t unit;
+  uint8_t pdu[RTU_MAX_FRAME - 3];
+  uint8_t len;
+};
+
+struct RtuStats {
+  uint32_t transactions;
+  uint32_t timeouts;
+  uint32_t crcErrors;
+  uint32_t exceptions;
+  uint32_t cacheHits;
+  uint32_t cacheMisses;
+  uint32_t cycleMs;                 // durée du dernier tour complet de la liste
+  uint32_t cycleMaxMs;
+};
+
+enum RtuState : uint8_t {
+  RTU_STATE_IDLE = 0,
+  RTU_STATE_WAIT_REPLY,
+};
+
+enum RtuGatewayResult : uint8_t {
+  RTU_GW_CACHED = 0,                // réponse déjà écrite dans outPdu
+  RTU_GW_QUEUED,                    // réponse via onGatewayReply()
+  RTU_GW_REJECTED,                  // exception écrite dans outPdu
+};
+
+struct RtuMaster {
+  RtuPort port;
+  void (*onGatewayReply)(uint8_t tag, const uint8_t *pdu, size_t len);
+  uint32_t timeoutMs;
+  uint32_t cacheMs;
+  uint32_t gapMs;                   // silence minimal entre deux trames
+
+  RtuPoll polls[RTU_MAX_POLLS];
+  uint8_t pollCount;
+  uint8_t pollCursor;
+  RtuCacheEntry cache[RTU_CACHE_SLOTS];
+  RtuGatewayRequest gwQueue[RTU_GW_QUEUE];
+  uint8_t gwHead;
+  uint8_t gwCount;
+
+  RtuState state;
+  int8_t curPoll;                   // -1 = transaction passerelle
+  uint8_t curTag;
+  uint8_t tx[RTU_MAX_FRAME];
+  uint16_t txLen;
+  uint8_t rx[RTU_MAX_FRAME];
+  uint16_t rxLen;
+  uint32_t sentMs;
+  uint32_t lastFrameMs;
+
+  uint8_t cycleDone;                // bit i = scrutation i faite pendant le tour
+  uint32_t cycleStartMs;
+  RtuStats stats;
+};
+
+// ----- Utilitaires -----
+static inline uint16_t rtuCrc16(const uint8_t *p, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= p[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+  }
+  return crc;
+}
+
+static inline uint16_t rtuGet16(const uint8_t *p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline bool rtuIsReadFc(uint8_t fc) {
+  return fc >= 1 && fc <= 4;
+}
+
+// Octets de données d'une lecture de count éléments
+static inline uint16_t rtuReadByteCount(uint8_t fc, uint16_t count) {
+  return (fc <= 2) ? (uint16_t)((count + 7) / 8) : (uint16_t)(count * 2);
+}
+
+// Silence de 3,5 caractères (11 bits) arrondi à la ms; 1,75 ms au-delà de 19200 bauds
+static inline uint32_t rtuGapMs(uint32_t baud) {
+  if (baud == 0 || baud > 19200) return 2;
+  return (38500UL + baud - 1) / baud + 1;
+}
+
+static inline void rtuInit(RtuMaster &m, const RtuPort &port, uint32_t baud, uint32_t timeoutMs, uint32_t cacheMs) {
+  memset(&m, 0, sizeof(m));
+  m.port = port;
+  m.timeoutMs = timeoutMs;
+  m.cacheMs = cacheMs;
+  m.gapMs = rtuGapMs(baud);
+  m.curPoll = -1;
+}
+
+// Ajoute une lecture périodique; false si liste pleine ou paramètres invalides
+static inline bool rtuAddPoll(RtuMaster &m, uint8_t unit, uint8_t fc, uint16_t addr, uint16_t count, uint32_t periodMs) {
+  if (m.pollCount >= RTU_MAX_POLLS || unit < 1 || unit > 247 || !rtuIsReadFc(fc)) return false;
+  if (count < 1 || rtuReadByteCount(fc, count) > RTU_CACHE_DATA) return false;
+  uint8_t i = m.pollCount++;
+  RtuPoll &p = m.polls[i];
+  p.unit = unit;
+  p.fc = fc;
+  p.addr = addr;
+  p.count = count;
+  p.periodMs = periodMs ? periodMs : 1000;
+  p.nextMs = 0;
+  RtuCacheEntry &c = m.cache[i];
+  memset(&c, 0, sizeof(c));
+  c.unit = unit;
+  c.fc = fc;
+  c.addr = addr;
+  c.count = count;
+  return true;
+}
+
+// ----- Cache -----
+static inline bool rtuCacheCovers(const RtuCacheEntry &c, uint8_t unit, uint8_t fc, uint16_t addr, uint16_t count) {
+  return c.fc == fc && c.unit == unit && addr >= c.addr && (uint32_t)addr + count <= (uint32_t)c.addr + c.count;
+}
+
+// Copie [addr, addr+count) depuis l'entrée c dans un PDU de réponse
+static inline size_t rtuCacheExtract(const RtuCacheEntry &c, uint16_t addr, uint16_t count, uint8_t *outPdu) {
+  uint16_t off = (uint16_t)(addr - c.addr);
+  uint16_t bytes = rtuReadByteCount(c.fc, count);
+  outPdu[0] = c.fc;
+  outPdu[1] = (uint8_t)bytes;
+  if (c.fc >= 3) {
+    memcpy(outPdu + 2, c.data + off * 2, bytes);
+  } else {
+    memset(outPdu + 2, 0, bytes);
+    for (uint16_t i = 0; i < count; i++) {
+      uint16_t src = (uint16_t)(off + i);
+      if (c.data[src >> 3] & (1u << (src & 7))) outPdu[2 + (i >> 3)] |= (uint8_t)(1u << (i & 7));
+    }
+  }
+  return 2 + (size_t)bytes;
+}
+
+static inline const RtuCacheEntry *rtuCacheLookup(const RtuMaster &m, uint8_t unit, uint8_t fc, uint16_t addr, uint16_t count, uint32_t nowMs) {
+  for (int i = 0; i < RTU_CACHE_SLOTS; i++) {
+    const RtuCacheEntry &c = m.cache[i];
+    if (c.valid && rtuCacheCovers(c, unit, fc, addr, count) && nowMs - c.stampMs <= m.cacheMs) return &c;
+  }
+  return nullptr;
+}
+
+// Enregistre une réponse de lecture (PDU fc, byteCount, données)
+static inline void rtuCacheStore(RtuMaster &m, int slot, uint8_t unit, uint16_t addr, uint16_t count, const uint8_t *pdu, uint32_t nowMs) {
+  uint8_t bytes = pdu[1];
+  if (bytes > RTU_CACHE_DATA || bytes != rtuReadByteCount(pdu[0], count)) return;
+  if (slot < 0) {
+    // Passerelle: même bloc, sinon slot libre, sinon le moins récemment utilisé
+    int victim = -1;
+    for (int i = RTU_MAX_POLLS; i < RTU_CACHE_SLOTS; i++) {
+      const RtuCacheEntry &c = m.cache[i];
+      if (c.fc == pdu[0] && c.unit == unit && c.addr == addr && c.count == count) {
+        slot = i;
+        break;
+      }
+      if (victim >= 0 && m.cache[victim].fc == 0) continue;
+      if (victim < 0 || c.fc == 0 || (int32_t)(c.usedMs - m.cache[victim].usedMs) < 0) victim = i;
+    }
+    if (slot < 0) slot = victim;
+  }
+  RtuCacheEntry &c = m.cache[slot];
+  c.unit = unit;
+  c.fc = pdu[0];
+  c.addr = addr;
+  c.count = count;
+  c.byteCount = bytes;
+  memcpy(c.data, pdu + 2, bytes);
+  c.valid = true;
+  c.stampMs = nowMs;
+  c.usedMs = nowMs;
+}
+
+// Écriture réussie: les lectures de la même table sur cet esclave sont périmées
+static inline void rtuCacheInvalidate(RtuMaster &m, uint8_t unit, uint8_t writeFc, uint32_t nowMs) {
+  uint8_t readFc = (writeFc == 5 || writeFc == 15) ? 1 : 3;
+  for (int i = 0; i < RTU_CACHE_SLOTS; i++) {
+    RtuCacheEntry &c = m.cache[i];
+    if (c.unit != unit || c.fc != readFc) continue;
+    c.valid = false;
+    if (i < m.pollCount) m.polls[i].nextMs = nowMs;
+  }
+}
+
+// ----- Transactions -----
+static inline void rtuSend(RtuMaster &m, uint8_t unit, const uint8_t *pdu, size_t len, uint32_t nowMs) {
+  m.tx[0] = unit;
+  memcpy(m.tx + 1, pdu, len);
+  uint16_t crc = rtuCrc16(m.tx, len + 1);
+  m.tx[len + 1] = (uint8_t)crc;
+  m.tx[len + 2] = (uint8_t)(crc >> 8);
+  m.txLen = (uint16_t)(len + 3);
+
+  // Octets parasites / réponse tardive de la transaction précédente
+  uint8_t drop[32];
+  while (m.port.available() > 0) {
+    if (m.port.read(drop, sizeof(drop)) <= 0) break;
+  }
+  m.port.takeIdle();
+  m.rxLen = 0;
+  m.port.write(m.tx, m.txLen);
+  m.sentMs = nowMs;
+  m.state = RTU_STATE_WAIT_REPLY;
+  m.stats.transactions++;
+}
+
+// Longueur attendue de la réponse d'après les octets reçus, 0 si inconnue
+static inline uint16_t rtuExpectedLength(const RtuMaster &m) {
+  if (m.rxLen < 2) return 0;
+  uint8_t fc = m.rx[1];
+  if (fc & 0x80) return 5;
+  if (rtuIsReadFc(fc)) return (m.rxLen >= 3) ? (uint16_t)(5 + m.rx[2]) : 0;
+  if (fc == 5 || fc == 6 || fc == 15 || fc == 16) return 8;
+  return 0;
+}
+
+static inline void rtuCompletePoll(RtuMaster &m, int idx, const uint8_t *pdu, size_t len, uint32_t nowMs) {
+  RtuPoll &p = m.polls[idx];
+  p.nextMs = nowMs + p.periodMs;
+  if (pdu && len >= 2 && pdu[0] == p.fc) {
+    rtuCacheStore(m, idx, p.unit, p.addr, p.count, pdu, nowMs);
+  } else {
+    m.cache[idx].valid = false;
+  }
+
+  if (m.cycleDone == 0) m.cycleStartMs = m.sentMs;
+  m.cycleDone |= (uint8_t)(1u << idx);
+  uint8_t all = (uint8_t)((1u << m.pollCount) - 1);
+  if (m.cycleDone == all) {
+    m.stats.cycleMs = nowMs - m.cycleStartMs;
+    if (m.stats.cycleMs > m.stats.cycleMaxMs) m.stats.cycleMaxMs = m.stats.cycleMs;
+    m.cycleDone = 0;
+  }
+}
+
+static inline void rtuCompleteGateway(RtuMaster &m, const uint8_t *pdu, size_t len, uint32_t nowMs) {
+  const RtuGatewayRequest &g = m.gwQueue[m.gwHead];
+  uint8_t ex[2];
+  if (!pdu) {
+    ex[0] = (uint8_t)(g.pdu[0] | 0x80);
+    ex[1] = RTU_EX_GW_TARGET_NO_RESPONSE;
+    pdu = ex;
+    len = 2;
+  } else if (!(pdu[0] & 0x80)) {
+    if (rtuIsReadFc(pdu[0]) && g.len >= 5) {
+      rtuCacheStore(m, -1, g.unit, rtuGet16(g.pdu + 1), rtuGet16(g.pdu + 3), pdu, nowMs);
+    } else if (!rtuIsReadFc(pdu[0])) {
+      rtuCacheInvalidate(m, g.unit, pdu[0], nowMs);
+    }
+  }
+  m.gwHead = (uint8_t)((m.gwHead + 1) % RTU_GW_QUEUE);
+  m.gwCount--;
+  if (m.onGatewayReply) m.onGatewayReply(m.curTag, pdu, len);
+}
+
+static inline void rtuFinish(RtuMaster &m, bool ok, uint32_t nowMs) {
+  const uint8_t *pdu = nullptr;
+  size_t len = 0;
+  if (ok) {
+    if (m.rxLen < 4 || m.rx[0] != m.tx[0] || rtuCrc16(m.rx, m.rxLen - 2) != (uint16_t)(m.rx[m.rxLen - 2] | (m.rx[m.rxLen - 1] << 8))) {
+      m.stats.crcErrors++;
+    } else if ((m.rx[1] & 0x7F) != m.tx[1]) {
+      m.stats.crcErrors++;
+    } else {
+      pdu = m.rx + 1;
+      len = m.rxLen - 3;
+      if (pdu[0] & 0x80) m.stats.exceptions++;
+    }
+  } else {
+    m.stats.timeouts++;
+  }
+
+  if (m.curPoll >= 0) rtuCompletePoll(m, m.curPoll, pdu, len, nowMs);
+  else rtuCompleteGateway(m, pdu, len, nowMs);
+  m.state = RTU_STATE_IDLE;
+  m.lastFrameMs = nowMs;
+}
+
+// À appeler à chaque itération de loop(): ne bloque jamais
+static inline void rtuService(RtuMaster &m, uint32_t nowMs) {
+  if (m.state == RTU_STATE_WAIT_REPLY) {
+    // Silence lu avant les octets: tout ce qui le précède est déjà disponible
+    bool idle = m.port.takeIdle();
+    int avail = m.port.available();
+    if (avail > 0 && m.rxLen < RTU_MAX_FRAME) {
+      size_t want = RTU_MAX_FRAME - m.rxLen;
+      if ((size_t)avail < want) want = (size_t)avail;
+      int got = m.port.read(m.rx + m.rxLen, want);
+      if (got > 0) m.rxLen = (uint16_t)(m.rxLen + got);
+    }
+    uint16_t expected = rtuExpectedLength(m);
+    if ((expected && m.rxLen >= expected) || (idle && m.rxLen > 0)) {
+      if (expected && m.rxLen > expected) m.rxLen = expected;
+      rtuFinish(m, true, nowMs);
+    } else if (nowMs - m.sentMs > m.timeoutMs) {
+      rtuFinish(m, false, nowMs);
+    }
+    return;
+  }
+
+  if (nowMs - m.lastFrameMs < m.gapMs) return;
+
+  // Passerelle en priorité, puis la scrutation (tourniquet)
+  if (m.gwCount > 0) {
+    const RtuGatewayRequest &g = m.gwQueue[m.gwHead];
+    m.curPoll = -1;
+    m.curTag = g.tag;
+    rtuSend(m, g.unit, g.pdu, g.len, nowMs);
+    return;
+  }
+  for (uint8_t n = 0; n < m.pollCount; n++) {
+    uint8_t i = (uint8_t)((m.pollCursor + n) % m.pollCount);
+    RtuPoll &p = m.polls[i];
+    if ((int32_t)(nowMs - p.nextMs) < 0) continue;
+    uint8_t pdu[5] = {p.fc, (uint8_t)(p.addr >> 8), (uint8_t)p.addr, (uint8_t)(p.count >> 8), (uint8_t)p.count};
+    m.curPoll = (int8_t)i;
+    m.pollCursor = (uint8_t)((i + 1) % m.pollCount);
+    rtuSend(m, p.unit, pdu, sizeof(pdu), nowMs);
+    return;
+  }
+}
+
+// Requête passerelle (PDU Modbus TCP sans MBAP). Une lecture couverte par le
+// cache est servie immédiatement; sinon la requête est mise en file.
+static inline RtuGatewayResult rtuGatewayRequest(RtuMaster &m, uint8_t tag, uint8_t unit, const uint8_t *pdu, size_t len,
+                                                 uint32_t nowMs, uint8_t *outPdu, size_t &outLen) {
+  if (len >= 5 && rtuIsReadFc(pdu[0])) {
+    uint16_t addr = rtuGet16(pdu + 1);
+    uint16_t count = rtuGet16(pdu + 3);
+    const RtuCacheEntry *c = rtuCacheLookup(m, unit, pdu[0], addr, count, nowMs);
+    if (c) {
+      m.stats.cacheHits++;
+      const_cast<RtuCacheEntry *>(c)->usedMs = nowMs;
+      outLen = rtuCacheExtract(*c, addr, count, outPdu);
+      return RTU_GW_CACHED;
+    }
+    m.stats.cacheMisses++;
+  }
+  if (len < 1 || len > sizeof(m.gwQueue[0].pdu) || unit < 1 || unit > 247 || m.gwCount >= RTU_GW_QUEUE) {
+    outPdu[0] = (uint8_t)((len ? pdu[0] : 0) | 0x80);
+    outPdu[1] = RTU_EX_GW_PATH_UNAVAILABLE;
+    outLen = 2;
+    return RTU_GW_REJECTED;
+  }
+  RtuGatewayRequest &g = m.gwQueue[(m.gwHead + m.gwCount) % RTU_GW_QUEUE];
+  g.tag = tag;
+  g.unit = unit;
+  memcpy(g.pdu, pdu, len);
+  g.len = (uint8_t)len;
+  m.gwCount++;
+  return RTU_GW_QUEUED;
+}
+
+// Pourcentage de lectures passerelle servies par le cache
+static inline uint8_t rtuCacheHitRate(const RtuStats &s) {
+  uint32_t total = s.cacheHits + s.cacheMisses;
+  return total ? (uint8_t)((uint64_t)s.cacheHits * 100 / total) : 0;
+}
+
+#endif // MODBUS_RTU_H
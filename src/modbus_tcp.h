@@ -0,0 +1,202 @@
+#ifndef MODBUS_TCP_H
+#define MODBUS_TCP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== MODBUS TCP: TRAITEMENT DES TRAMES (sans heap, sans copie d'état) =====
+// Les coils / entrées sont lus directement depuis les masques relais/entrées,
+// les registres depuis les capteurs (via ModbusBank). Une écriture multiple
+// (FC 0x0F / 0x10) est remise en un seul appel writeRelays(mask, values),
+// donc une seule écriture TCA9554.
+//
+// Plan d'adresses (voir docs/MODBUS.md); les adresses "x0000" historiques
+// sont acceptées comme alias des offsets 0..N:
+//   Coils 0..7                      relais            FC 01/05/0F
+//   Discrete inputs 0..7 | 10000..  entrées           FC 02
+//   Input registers 0..1 | 30000..  temp, hum (x10)   FC 04
+//   Holding register 0 | 40000      masque relais     FC 03/06/10
+
+#define MODBUS_MBAP_LEN 7
+#define MODBUS_MAX_ADU 260
+
+enum ModbusException : uint8_t {
+  MODBUS_EX_NONE = 0,
+  MODBUS_EX_ILLEGAL_FUNCTION = 0x01,
+  MODBUS_EX_ILLEGAL_ADDRESS = 0x02,
+  MODBUS_EX_ILLEGAL_VALUE = 0x03,
+};
+
+struct ModbusBank {
+  uint8_t (*relays)();
+  uint8_t (*inputs)();
+  uint16_t (*inputRegister)(uint16_t index);   // index 0..inputRegisterCount-1
+  uint16_t inputRegisterCount;
+  void (*writeRelays)(uint8_t mask, uint8_t values);
+};
+
+struct ModbusStats {
+  uint32_t requests;
+  uint32_t exceptions;
+  uint32_t writes;
+};
+
+static inline uint16_t mbGet16(const uint8_t *p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void mbPut16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+// Ramène une adresse "historique" (10000, 30000, 40000) sur un offset
+static inline uint16_t mbNormalize(uint16_t addr, uint16_t legacyBase) {
+  return (addr >= legacyBase && addr < legacyBase + 1000) ? (uint16_t)(addr - legacyBase) : addr;
+}
+
+// Lecture de bits depuis un masque 8 bits (FC 01/02)
+static inline uint8_t mbReadBits(uint8_t mask, uint16_t start, uint16_t count, uint8_t *resp, ModbusException &ex) {
+  if (count < 1 || count > 2000) { ex = MODBUS_EX_ILLEGAL_VALUE; return 0; }
+  if (start >= 8 || count > 8 - start) { ex = MODBUS_EX_ILLEGAL_ADDRESS; return 0; }
+  resp[1] = 1;
+  resp[2] = (uint8_t)((mask >> start) & ((1u << count) - 1));
+  return 3;
+}
+
+// Traite un PDU (fonction + données); écrit le PDU de réponse dans resp.
+// Retourne la longueur du PDU de réponse (exception comprise).
+static inline size_t modbusHandlePdu(const ModbusBank &bank, const uint8_t *req, size_t len, uint8_t *resp, ModbusStats &stats) {
+  stats.requests++;
+  ModbusException ex = MODBUS_EX_NONE;
+  uint8_t fc = req[0];
+  resp[0] = fc;
+  size_t out = 0;
+
+  bool known = (fc >= 0x01 && fc <= 0x06) || fc == 0x0F || fc == 0x10;
+  if (!known) ex = MODBUS_EX_ILLEGAL_FUNCTION;
+  else if (len < 5) ex = MODBUS_EX_ILLEGAL_VALUE;
+  uint16_t a = (len >= 3) ? mbGet16(req + 1) : 0;
+  uint16_t b = (len >= 5) ? mbGet16(req + 3) : 0;
+
+  if (ex == MODBUS_EX_NONE) {
+    switch (fc) {
+      case 0x01:  // Read Coils
+        out = mbReadBits(bank.relays(), a, b, resp, ex);
+        break;
+      case 0x02:  // Read Discrete Inputs
+        out = mbReadBits(bank.inputs(), mbNormalize(a, 10000), b, resp, ex);
+        break;
+      case 0x03: {  // Read Holding Registers
+        uint16_t start = mbNormalize(a, 40000);
+        if (b < 1 || b > 125) ex = MODBUS_EX_ILLEGAL_VALUE;
+        else if (start != 0 || b != 1) ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        else {
+          resp[1] = 2;
+          mbPut16(resp + 2, bank.relays());
+          out = 4;
+        }
+        break;
+      }
+      case 0x04: {  // Read Input Registers
+        uint16_t start = mbNormalize(a, 30000);
+        if (b < 1 || b > 125) ex = MODBUS_EX_ILLEGAL_VALUE;
+        else if (start >= bank.inputRegisterCount || b > bank.inputRegisterCount - start) ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        else {
+          resp[1] = (uint8_t)(b * 2);
+          for (uint16_t i = 0; i < b; i++) mbPut16(resp + 2 + 2 * i, bank.inputRegister((uint16_t)(start + i)));
+          out = 2 + (size_t)b * 2;
+        }
+        break;
+      }
+      case 0x05: {  // Write Single Coil
+        if (b != 0xFF00 && b != 0x0000) ex = MODBUS_EX_ILLEGAL_VALUE;
+        else if (a >= 8) ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        else {
+          uint8_t bit = (uint8_t)(1u << a);
+          bank.writeRelays(bit, b ? bit : 0);
+          stats.writes++;
+          for (int i = 1; i < 5; i++) resp[i] = req[i];
+          out = 5;
+        }
+        break;
+      }
+      case 0x06: {  // Write Single Register
+        if (mbNormalize(a, 40000) != 0) ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        else if (b > 0xFF) ex = MODBUS_EX_ILLEGAL_VALUE;
+        else {
+          bank.writeRelays(0xFF, (uint8_t)b);
+          stats.writes++;
+          for (int i = 1; i < 5; i++) resp[i] = req[i];
+          out = 5;
+        }
+        break;
+      }
+      case 0x0F: {  // Write Multiple Coils
+        if (len < 6 || b < 1 || b > 0x07B0 || req[5] != (b + 7) / 8 || len < 6 + (size_t)req[5]) ex = MODBUS_EX_ILLEGAL_VALUE;
+        else if (a >= 8 || b > 8 - a) ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        else {
+          uint8_t mask = (uint8_t)(((1u << b) - 1) << a);
+          uint8_t values = (uint8_t)(req[6] << a) & mask;
+          bank.writeRelays(mask, values);
+          stats.writes++;
+          for (int i = 1; i < 5; i++) resp[i] = req[i];
+          out = 5;
+        }
+        break;
+      }
+      case 0x10: {  // Write Multiple Registers
+        if (len < 6 || b < 1 || b > 123 || req[5] != b * 2 || len < 6 + (size_t)req[5]) ex = MODBUS_EX_ILLEGAL_VALUE;
+        else if (mbNormalize(a, 40000) != 0 || b != 1) ex = MODBUS_EX_ILLEGAL_ADDRESS;
+        else {
+          uint16_t v = mbGet16(req + 6);
+          if (v > 0xFF) ex = MODBUS_EX_ILLEGAL_VALUE;
+          else {
+            bank.writeRelays(0xFF, (uint8_t)v);
+            stats.writes++;
+            for (int i = 1; i < 5; i++) resp[i] = req[i];
+            out = 5;
+          }
+        }
+        break;
+      }
+      default:
+        ex = MODBUS_EX_ILLEGAL_FUNCTION;
+        break;
+    }
+  }
+
+  if (ex != MODBUS_EX_NONE) {
+    stats.exceptions++;
+    resp[0] = (uint8_t)(fc | 0x80);
+    resp[1] = ex;
+    return 2;
+  }
+  return out;
+}
+
+// Traite une ADU complète (MBAP + PDU) de adu[0..len); réponse dans resp
+// (MODBUS_MAX_ADU octets). Retourne la longueur de la réponse, 0 si la trame
+// est à ignorer (protocole != 0).
+static inline size_t modbusHandleAdu(const ModbusBank &bank, const uint8_t *adu, size_t len, uint8_t *resp, ModbusStats &stats) {
+  if (len < MODBUS_MBAP_LEN + 1) return 0;
+  if (mbGet16(adu + 2) != 0) return 0;
+  size_t pduLen = len - MODBUS_MBAP_LEN;
+  size_t outPdu = modbusHandlePdu(bank, adu + MODBUS_MBAP_LEN, pduLen, resp + MODBUS_MBAP_LEN, stats);
+  resp[0] = adu[0];
+  resp[1] = adu[1];
+  resp[2] = 0;
+  resp[3] = 0;
+  mbPut16(resp + 4, (uint16_t)(outPdu + 1));
+  resp[6] = adu[6];
+  return MODBUS_MBAP_LEN + outPdu;
+}
+
+// Longueur totale de l'ADU annoncée par l'en-tête MBAP (0 si invalide)
+static inline size_t modbusAduLength(const uint8_t *mbap) {
+  uint16_t l = mbGet16(mbap + 4);
+  if (l < 2 || l > MODBUS_MAX_ADU - 6) return 0;
+  return 6 + (size_t)l;
+}
+
+#endif // MODBUS_TCP_H
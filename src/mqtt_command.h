@@ -0,0 +1,290 @@
+#ifndef MQTT_COMMAND_H
+#define MQTT_COMMAND_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ===== PARSEUR DE COMMANDES RELAIS (zéro copie, sans heap) =====
+// Travaille directement sur le buffer payload/length de PubSubClient.
+// Formats acceptés (insensibles à la casse, espaces tolérés):
+//   "3:on"  "3:off"  "3:1"  "3:0"          relais 0..7
+//   "ALL:on"  "ALL:off"                     tous les relais
+//   "MASK:0x05"  "MASK:0b101/0x0F"          valeur[/masque] (défaut masque 0xFF)
+//   {"relay":3,"state":"on"}   {"relay":"all","state":false}
+//   {"mask":"0x0F","value":5}  ("mask" optionnel, défaut 0xFF)
+//   + "id" optionnel (chaîne ou nombre, 1..32 caractères) pour l'acquittement
+// Résultat: un masque des relais concernés + leurs états voulus,
+// appliqués ensuite en une seule écriture TCA9554.
+
+enum MqttCmdResult : uint8_t {
+  MQTT_CMD_OK = 0,
+  MQTT_CMD_EMPTY,
+  MQTT_CMD_BAD_FORMAT,
+  MQTT_CMD_BAD_RELAY,
+  MQTT_CMD_BAD_STATE,
+  MQTT_CMD_UNKNOWN_TOPIC,
+  MQTT_CMD_BAD_ID,
+  MQTT_CMD_DUPLICATE,     // id déjà traité récemment (redélivrance QoS1)
+};
+
+#define MQTT_CMD_ID_MAX 32
+
+struct RelayCommand {
+  uint8_t mask;     // relais concernés (bit i = relais i)
+  uint8_t values;   // état voulu pour les bits de mask
+};
+
+static inline const char *mqttCmdResultName(MqttCmdResult r) {
+  switch (r) {
+    case MQTT_CMD_OK: return "ok";
+    case MQTT_CMD_EMPTY: return "empty";
+    case MQTT_CMD_BAD_FORMAT: return "bad_format";
+    case MQTT_CMD_BAD_RELAY: return "bad_relay";
+    case MQTT_CMD_BAD_STATE: return "bad_state";
+    case MQTT_CMD_UNKNOWN_TOPIC: return "unknown_topic";
+    case MQTT_CMD_BAD_ID: return "bad_id";
+    case MQTT_CMD_DUPLICATE: return "duplicate";
+  }
+  return "?";
+}
+
+// Tranche [p, p+len) dans le payload (jamais copiée)
+struct CmdSlice {
+  const char *p;
+  size_t len;
+};
+
+static inline char cmdLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static inline bool cmdIsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline CmdSlice cmdTrim(CmdSlice s) {
+  while (s.len > 0 && cmdIsSpace(s.p[0])) { s.p++; s.len--; }
+  while (s.len > 0 && cmdIsSpace(s.p[s.len - 1])) s.len--;
+  return s;
+}
+
+// Comparaison insensible à la casse avec un littéral minuscule
+static inline bool cmdEquals(CmdSlice s, const char *lit) {
+  size_t i = 0;
+  for (; i < s.len; i++) {
+    if (lit[i] == '\0' || cmdLower(s.p[i]) != lit[i]) return false;
+  }
+  return lit[i] == '\0';
+}
+
+// Entier non signé: décimal, 0x.. (hex) ou 0b.. (binaire)
+static inline bool cmdParseUint(CmdSlice s, uint32_t &out) {
+  s = cmdTrim(s);
+  if (s.len == 0) return false;
+  uint32_t base = 10;
+  if (s.len > 2 && s.p[0] == '0' && (s.p[1] == 'x' || s.p[1] == 'X')) {
+    base = 16; s.p += 2; s.len -= 2;
+  } else if (s.len > 2 && s.p[0] == '0' && (s.p[1] == 'b' || s.p[1] == 'B')) {
+    base = 2; s.p += 2; s.len -= 2;
+  }
+  uint32_t v = 0;
+  for (size_t i = 0; i < s.len; i++) {
+    char c = cmdLower(s.p[i]);
+    uint32_t d;
+    if (c >= '0' && c <= '9') d = (uint32_t)(c - '0');
+    else if (c >= 'a' && c <= 'f') d = (uint32_t)(c - 'a' + 10);
+    else return false;
+    if (d >= base) return false;
+    v = v * base + d;
+    if (v > 0xFFFF) return false;
+  }
+  out = v;
+  return true;
+}
+
+// "on"/"1"/"true" => true, "off"/"0"/"false" => false
+static inline bool cmdParseState(CmdSlice s, bool &out) {
+  s = cmdTrim(s);
+  if (cmdEquals(s, "on") || cmdEquals(s, "1") || cmdEquals(s, "true")) { out = true; return true; }
+  if (cmdEquals(s, "off") || cmdEquals(s, "0") || cmdEquals(s, "false")) { out = false; return true; }
+  return false;
+}
+
+static inline MqttCmdResult cmdSingleRelay(uint32_t relay, bool on, RelayCommand &out) {
+  if (relay > 7) return MQTT_CMD_BAD_RELAY;
+  out.mask = (uint8_t)(1u << relay);
+  out.values = on ? out.mask : 0;
+  return MQTT_CMD_OK;
+}
+
+// ----- Format texte "X:Y" -----
+static inline MqttCmdResult cmdParseText(CmdSlice s, RelayCommand &out) {
+  size_t colon = 0;
+  while (colon < s.len && s.p[colon] != ':') colon++;
+  if (colon == 0 || colon >= s.len) return MQTT_CMD_BAD_FORMAT;
+
+  CmdSlice left = cmdTrim(CmdSlice{s.p, colon});
+  CmdSlice right = cmdTrim(CmdSlice{s.p + colon + 1, s.len - colon - 1});
+
+  if (cmdEquals(left, "mask")) {
+    size_t slash = 0;
+    while (slash < right.len && right.p[slash] != '/') slash++;
+    uint32_t value = 0;
+    uint32_t mask = 0xFF;
+    if (!cmdParseUint(CmdSlice{right.p, slash}, value) || value > 0xFF) return MQTT_CMD_BAD_STATE;
+    if (slash < right.len) {
+      if (!cmdParseUint(CmdSlice{right.p + slash + 1, right.len - slash - 1}, mask) || mask > 0xFF) return MQTT_CMD_BAD_STATE;
+    }
+    out.mask = (uint8_t)mask;
+    out.values = (uint8_t)(value & mask);
+    return MQTT_CMD_OK;
+  }
+
+  bool on = false;
+  if (!cmdParseState(right, on)) return MQTT_CMD_BAD_STATE;
+  if (cmdEquals(left, "all")) {
+    out.mask = 0xFF;
+    out.values = on ? 0xFF : 0x00;
+    return MQTT_CMD_OK;
+  }
+  uint32_t relay = 0;
+  if (!cmdParseUint(left, relay)) return MQTT_CMD_BAD_RELAY;
+  return cmdSingleRelay(relay, on, out);
+}
+
+// ----- Format JSON plat {"clé":valeur,...} -----
+// Pas d'objets/tableaux imbriqués; les chaînes restent des tranches du payload.
+struct CmdJsonValue {
+  CmdSlice raw;     // contenu (sans guillemets pour une chaîne)
+  bool isString;
+};
+
+static inline bool cmdJsonString(const char *&p, const char *end, CmdSlice &out) {
+  if (p >= end || *p != '"') return false;
+  p++;
+  const char *start = p;
+  while (p < end && *p != '"') {
+    // Échappement: saute le caractère suivant, sans dépasser la fin du buffer
+    if (*p == '\\' && ++p == end) return false;
+    p++;
+  }
+  if (p >= end) return false;
+  out = CmdSlice{start, (size_t)(p - start)};
+  p++;
+  return true;
+}
+
+static inline void cmdJsonSkipSpace(const char *&p, const char *end) {
+  while (p < end && cmdIsSpace(*p)) p++;
+}
+
+// Appelle onField(key, value) pour chaque membre; false si JSON invalide
+template <typename F>
+static inline bool cmdJsonForEach(CmdSlice s, F onField) {
+  const char *p = s.p;
+  const char *end = s.p + s.len;
+  cmdJsonSkipSpace(p, end);
+  if (p >= end || *p != '{') return false;
+  p++;
+  cmdJsonSkipSpace(p, end);
+  if (p < end && *p == '}') return true;
+  while (p < end) {
+    CmdSlice key;
+    cmdJsonSkipSpace(p, end);
+    if (!cmdJsonString(p, end, key)) return false;
+    cmdJsonSkipSpace(p, end);
+    if (p >= end || *p != ':') return false;
+    p++;
+    cmdJsonSkipSpace(p, end);
+
+    CmdJsonValue v;
+    if (p < end && *p == '"') {
+      if (!cmdJsonString(p, end, v.raw)) return false;
+      v.isString = true;
+    } else {
+      const char *start = p;
+      while (p < end && *p != ',' && *p != '}' && !cmdIsSpace(*p)) {
+        if (*p == '{' || *p == '[') return false;
+        p++;
+      }
+      v.raw = CmdSlice{start, (size_t)(p - start)};
+      v.isString = false;
+      if (v.raw.len == 0) return false;
+    }
+    onField(key, v);
+
+    cmdJsonSkipSpace(p, end);
+    if (p >= end) return false;
+    if (*p == '}') return true;
+    if (*p != ',') return false;
+    p++;
+  }
+  return false;
+}
+
+// id: renseigné (len > 0) seulement si le JSON est bien formé
+static inline MqttCmdResult cmdParseJson(CmdSlice s, RelayCommand &out, CmdSlice *id) {
+  bool hasRelay = false, relayAll = false, relayBad = false;
+  uint32_t relay = 0;
+  bool hasState = false, stateOk = true, on = false;
+  bool hasMask = false, hasValue = false, maskOk = true;
+  uint32_t mask = 0xFF, value = 0;
+  CmdSlice idRaw = {nullptr, 0};
+  bool idBad = false;
+
+  bool ok = cmdJsonForEach(s, [&](CmdSlice key, const CmdJsonValue &v) {
+    if (cmdEquals(key, "relay")) {
+      hasRelay = true;
+      if (v.isString && cmdEquals(v.raw, "all")) relayAll = true;
+      else if (!cmdParseUint(v.raw, relay)) relayBad = true;
+    } else if (cmdEquals(key, "state")) {
+      hasState = true;
+      stateOk = cmdParseState(v.raw, on);
+    } else if (cmdEquals(key, "mask")) {
+      hasMask = true;
+      maskOk = maskOk && cmdParseUint(v.raw, mask) && mask <= 0xFF;
+    } else if (cmdEquals(key, "value")) {
+      hasValue = true;
+      maskOk = maskOk && cmdParseUint(v.raw, value) && value <= 0xFF;
+    } else if (cmdEquals(key, "id")) {
+      idRaw = v.raw;
+      idBad = (idRaw.len == 0 || idRaw.len > MQTT_CMD_ID_MAX);
+      for (size_t i = 0; i < idRaw.len && !idBad; i++) {
+        if (idRaw.p[i] == '\\' || (unsigned char)idRaw.p[i] < 0x20) idBad = true;
+      }
+    }
+  });
+  if (!ok) return MQTT_CMD_BAD_FORMAT;
+  if (idBad) return MQTT_CMD_BAD_ID;
+  if (id) *id = idRaw;
+
+  if (hasValue) {
+    if (!maskOk) return MQTT_CMD_BAD_STATE;
+    out.mask = (uint8_t)mask;
+    out.values = (uint8_t)(value & mask);
+    return MQTT_CMD_OK;
+  }
+  if (hasMask) return MQTT_CMD_BAD_FORMAT;
+  if (!hasRelay || !hasState) return MQTT_CMD_BAD_FORMAT;
+  if (!stateOk) return MQTT_CMD_BAD_STATE;
+  if (relayAll) {
+    out.mask = 0xFF;
+    out.values = on ? 0xFF : 0x00;
+    return MQTT_CMD_OK;
+  }
+  if (relayBad) return MQTT_CMD_BAD_RELAY;
+  return cmdSingleRelay(relay, on, out);
+}
+
+// id (optionnel): tranche de l'identifiant de corrélation, len 0 si absent
+static inline MqttCmdResult mqttParseRelayCommand(const uint8_t *payload, size_t length, RelayCommand &out, CmdSlice *id = nullptr) {
+  out.mask = 0;
+  out.values = 0;
+  if (id) *id = CmdSlice{nullptr, 0};
+  CmdSlice s = cmdTrim(CmdSlice{(const char *)payload, length});
+  if (s.len == 0) return MQTT_CMD_EMPTY;
+  if (s.p[0] == '{') return cmdParseJson(s, out, id);
+  return cmdParseText(s, out);
+}
+
+#endif // MQTT_COMMAND_H
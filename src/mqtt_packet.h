@@ -0,0 +1,85 @@
+#ifndef MQTT_PACKET_H
+#define MQTT_PACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ===== CONNECT MQTT 3.1.1 ÉCRIT HORS DE PUBSUBCLIENT =====
+// PubSubClient::connect() émet CONNECT puis boucle jusqu'au CONNACK. Ici le
+// CONNECT est encodé et écrit sans attente sur le transport; loop() attend
+// les MQTT_CONNACK_LEN octets du CONNACK (phase CONNACK), puis
+// PubSubClient::connect() ne fait plus que lire ce CONNACK déjà reçu (son
+// propre CONNECT est écarté par le transport).
+// Mêmes octets que PubSubClient 2.8: niveau 4 ("MQTT"), will, utilisateur,
+// mot de passe seulement avec un utilisateur.
+// Aucune dépendance Arduino.
+
+#define MQTT_CONNACK_LEN 4
+
+struct MqttConnectOpts {
+  const char *clientId;
+  const char *user;                 // nullptr: ni utilisateur ni mot de passe
+  const char *pass;
+  const char *willTopic;            // nullptr: pas de will
+  const char *willMsg;
+  uint8_t willQos;
+  bool willRetain;
+  bool cleanSession;
+  uint16_t keepAliveS;
+};
+
+static inline size_t mqttPutString(uint8_t *p, const char *s) {
+  size_t n = strlen(s);
+  p[0] = (uint8_t)(n >> 8);
+  p[1] = (uint8_t)n;
+  memcpy(p + 2, s, n);
+  return 2 + n;
+}
+
+// Paquet complet dans buf; 0 si cap est trop petit
+static inline size_t mqttEncodeConnect(uint8_t *buf, size_t cap, const MqttConnectOpts &o) {
+  size_t rem = 10 + 2 + strlen(o.clientId);
+  if (o.willTopic) rem += 2 + strlen(o.willTopic) + 2 + strlen(o.willMsg);
+  if (o.user) {
+    rem += 2 + strlen(o.user);
+    if (o.pass) rem += 2 + strlen(o.pass);
+  }
+  uint8_t hdr[5];
+  size_t h = 0;
+  hdr[h++] = 0x10;
+  size_t r = rem;
+  do {
+    uint8_t b = (uint8_t)(r % 128);
+    r /= 128;
+    hdr[h++] = (uint8_t)(b | (r ? 0x80 : 0));
+  } while (r && h < sizeof(hdr));
+  if (r || h + rem > cap) return 0;
+
+  uint8_t flags = 0;
+  if (o.willTopic) flags = (uint8_t)(0x04 | (o.willQos << 3) | (o.willRetain ? 0x20 : 0));
+  if (o.cleanSession) flags |= 0x02;
+  if (o.user) {
+    flags |= 0x80;
+    if (o.pass) flags |= 0x40;
+  }
+  memcpy(buf, hdr, h);
+  uint8_t *p = buf + h;
+  p += mqttPutString(p, "MQTT");
+  *p++ = 4;
+  *p++ = flags;
+  *p++ = (uint8_t)(o.keepAliveS >> 8);
+  *p++ = (uint8_t)o.keepAliveS;
+  p += mqttPutString(p, o.clientId);
+  if (o.willTopic) {
+    p += mqttPutString(p, o.willTopic);
+    p += mqttPutString(p, o.willMsg);
+  }
+  if (o.user) {
+    p += mqttPutString(p, o.user);
+    if (o.pass) p += mqttPutString(p, o.pass);
+  }
+  return (size_t)(p - buf);
+}
+
+#endif // MQTT_PACKET_H
@@ -0,0 +1,244 @@
+#ifndef MQTT_QUEUE_H
+#define MQTT_QUEUE_H
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include "mqtt_queue_ring.h"
+
+// ===== FILE D'ATTENTE MQTT (store-and-forward) =====
+// Les événements (fronts d'entrées, échantillons capteurs) produits pendant une
+// coupure broker sont conservés puis rejoués dans l'ordre après reconnexion.
+//  - niveau 1: anneau en RAM interne
+//  - niveau 2: anneau de records fixes dans un fichier SPIFFS quand la RAM est pleine
+//    (format et relecture au démarrage: mqtt_queue_ring.h)
+// Ordre garanti: dès que le fichier contient des messages, les nouveaux y vont
+// aussi (la RAM contient toujours les plus anciens).
+
+#define MQTT_QUEUE_RAM_RECORDS 32
+#define MQTT_QUEUE_FLASH_RECORDS 512
+#define MQTT_QUEUE_FILE "/mqttq.bin"
+
+enum MqttQueueDropPolicy : uint8_t {
+  MQTT_QUEUE_DROP_OLDEST = 0,
+  MQTT_QUEUE_DROP_NEWEST = 1,
+};
+
+struct MqttQueueStats {
+  uint32_t enqueued;
+  uint32_t replayed;
+  uint32_t dropped;
+  uint32_t spilled;      // messages écrits en flash
+  uint32_t flashErrors;
+  uint32_t headerWrites; // écritures de l'en-tête flash (par lots)
+};
+
+static MqttQueuedMsg mqttQueueRam[MQTT_QUEUE_RAM_RECORDS];
+static uint16_t mqttQueueRamHead = 0;
+static uint16_t mqttQueueRamCount = 0;
+static File mqttQueueFile;
+static MqttQueueRing mqttQueueFlash = {0, 0, 1, 1, 0, 0};
+static bool mqttQueueFlashReady = false;
+static const char *mqttQueueFlashState = "off";   // état du niveau flash (/api/status)
+MqttQueueDropPolicy mqttQueueDropPolicy = MQTT_QUEUE_DROP_OLDEST;
+MqttQueueStats mqttQueueStats = {0, 0, 0, 0, 0, 0};
+
+extern bool spiffsReady;
+void initSPIFFS();
+
+static bool mqttQueueWriteHeader() {
+  MqttQueueFileHeader h = {MQTT_QUEUE_MAGIC, mqttQueueFlash.headSeq};
+  if (!mqttQueueFile.seek(0)) return false;
+  if (mqttQueueFile.write((const uint8_t *)&h, sizeof(h)) != sizeof(h)) return false;
+  mqttQueueFile.flush();
+  mqttQueueFlash.pending = 0;
+  mqttQueueStats.headerWrites++;
+  return true;
+}
+
+// Écrit l'en-tête si un lot de retraits est dû (appelé après chaque retrait
+// et depuis loop() pour le délai)
+void mqttQueueSync(uint32_t now) {
+  if (!mqttQueueFlashReady || !mqttQueueHeaderDue(mqttQueueFlash, now)) return;
+  if (!mqttQueueWriteHeader()) mqttQueueStats.flashErrors++;
+}
+
+static size_t mqttQueueSlotOffset(uint16_t slot) {
+  return sizeof(MqttQueueFileHeader) + (size_t)slot * MQTT_QUEUE_RECORD_SIZE;
+}
+
+// Relit tous les slots et reconstruit la file (en-tête = plancher seulement)
+static bool mqttQueueScan() {
+  MqttQueueFileHeader h;
+  uint32_t floorSeq = 0;
+  if (mqttQueueFile.seek(0) && mqttQueueFile.read((uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+      h.magic == MQTT_QUEUE_MAGIC) {
+    floorSeq = h.headSeq;
+  }
+  uint32_t *seqs = (uint32_t *)calloc(MQTT_QUEUE_FLASH_RECORDS, sizeof(uint32_t));
+  if (!seqs) return false;
+  MqttQueuedMsg m;
+  size_t size = mqttQueueFile.size();
+  for (uint16_t i = 0; i < MQTT_QUEUE_FLASH_RECORDS && mqttQueueSlotOffset(i) + sizeof(m) <= size; i++) {
+    if (mqttQueueFile.seek(mqttQueueSlotOffset(i)) && mqttQueueFile.read((uint8_t *)&m, sizeof(m)) == sizeof(m) &&
+        mqttQueueRecordValid(m)) {
+      seqs[i] = m.seq;
+    }
+  }
+  mqttQueueRebuild(seqs, MQTT_QUEUE_FLASH_RECORDS, floorSeq, mqttQueueFlash);
+  free(seqs);
+  return floorSeq == mqttQueueFlash.headSeq || mqttQueueWriteHeader();
+}
+
+void mqttQueueInit() {
+  // Niveau flash: reprend les messages non envoyés avant un redémarrage.
+  // La config vient de la NVS: SPIFFS est monté ici, pas avant.
+  mqttQueueFlashReady = false;
+  initSPIFFS();
+  if (!spiffsReady) {
+    mqttQueueFlashState = "no_fs";
+    return;
+  }
+  mqttQueueFlashState = "open_failed";
+  if (!SPIFFS.exists(MQTT_QUEUE_FILE)) {
+    File f = SPIFFS.open(MQTT_QUEUE_FILE, "w");
+    if (!f) return;
+    f.close();
+  }
+  mqttQueueFile = SPIFFS.open(MQTT_QUEUE_FILE, "r+");
+  if (!mqttQueueFile) return;
+
+  if (!mqttQueueScan()) {
+    mqttQueueFlashState = "header_failed";
+    return;
+  }
+  mqttQueueFlashReady = true;
+  mqttQueueFlashState = "ready";
+  if (mqttQueueFlash.count > 0) {
+    Serial.printf("✓ MQTT queue: %u messages en attente (flash)\n", mqttQueueFlash.count);
+  }
+}
+
+uint32_t mqttQueueDepth() {
+  return (uint32_t)mqttQueueRamCount + mqttQueueFlash.count;
+}
+
+uint16_t mqttQueueRamDepth() {
+  return mqttQueueRamCount;
+}
+
+uint16_t mqttQueueFlashDepth() {
+  return mqttQueueFlash.count;
+}
+
+uint16_t mqttQueueRamCapacity() {
+  return MQTT_QUEUE_RAM_RECORDS;
+}
+
+// Retourne le message le plus ancien sans le retirer
+bool mqttQueuePeek(MqttQueuedMsg &out) {
+  if (mqttQueueRamCount > 0) {
+    out = mqttQueueRam[mqttQueueRamHead];
+    return true;
+  }
+  if (mqttQueueFlash.count > 0 && mqttQueueFlashReady) {
+    if (!mqttQueueFile.seek(mqttQueueSlotOffset(mqttQueueFlash.head)) ||
+        mqttQueueFile.read((uint8_t *)&out, sizeof(out)) != sizeof(out)) {
+      mqttQueueStats.flashErrors++;
+      return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+void mqttQueuePop() {
+  if (mqttQueueRamCount > 0) {
+    mqttQueueRamHead = (uint16_t)((mqttQueueRamHead + 1) % MQTT_QUEUE_RAM_RECORDS);
+    mqttQueueRamCount--;
+    return;
+  }
+  if (mqttQueueFlash.count > 0) {
+    uint32_t now = millis();
+    mqttQueueRingPop(mqttQueueFlash, MQTT_QUEUE_FLASH_RECORDS, now);
+    mqttQueueSync(now);
+  }
+}
+
+// Ajout = un record scellé (séquence + CRC), sans écriture d'en-tête
+static bool mqttQueueFlashAppend(const MqttQueuedMsg &m) {
+  if (!mqttQueueFlashReady || mqttQueueFlash.count >= MQTT_QUEUE_FLASH_RECORDS) return false;
+  uint16_t slot = (uint16_t)((mqttQueueFlash.head + mqttQueueFlash.count) % MQTT_QUEUE_FLASH_RECORDS);
+  MqttQueuedMsg rec = m;
+  mqttQueueRecordSeal(rec, mqttQueueFlash.nextSeq);
+  if (!mqttQueueFile.seek(mqttQueueSlotOffset(slot)) ||
+      mqttQueueFile.write((const uint8_t *)&rec, sizeof(rec)) != sizeof(rec)) {
+    mqttQueueStats.flashErrors++;
+    return false;
+  }
+  mqttQueueFile.flush();
+  mqttQueueFlash.count++;
+  mqttQueueFlash.nextSeq++;
+  mqttQueueStats.spilled++;
+  return true;
+}
+
+static bool mqttQueueStore(const MqttQueuedMsg &m) {
+  // RAM seulement si rien n'attend en flash (sinon l'ordre serait cassé)
+  if (mqttQueueFlash.count == 0 && mqttQueueRamCount < MQTT_QUEUE_RAM_RECORDS) {
+    mqttQueueRam[(mqttQueueRamHead + mqttQueueRamCount) % MQTT_QUEUE_RAM_RECORDS] = m;
+    mqttQueueRamCount++;
+    return true;
+  }
+  // Flash pleine mais place en RAM: le plus ancien message flash passe en queue
+  // de RAM (il reste plus récent que tout ce qui est déjà en RAM).
+  if (mqttQueueFlash.count >= MQTT_QUEUE_FLASH_RECORDS && mqttQueueRamCount < MQTT_QUEUE_RAM_RECORDS) {
+    MqttQueuedMsg oldest;
+    if (mqttQueueFile.seek(mqttQueueSlotOffset(mqttQueueFlash.head)) &&
+        mqttQueueFile.read((uint8_t *)&oldest, sizeof(oldest)) == sizeof(oldest)) {
+      mqttQueueRingPop(mqttQueueFlash, MQTT_QUEUE_FLASH_RECORDS, millis());
+      oldest.seq = 0;
+      mqttQueueRam[(mqttQueueRamHead + mqttQueueRamCount) % MQTT_QUEUE_RAM_RECORDS] = oldest;
+      mqttQueueRamCount++;
+    }
+  }
+  return mqttQueueFlashAppend(m);
+}
+
+bool mqttQueuePush(uint8_t topic, uint32_t ts, const char *payload, size_t len) {
+  if (len > MQTT_QUEUE_PAYLOAD_MAX) {
+    mqttQueueStats.dropped++;
+    return false;
+  }
+  MqttQueuedMsg m;
+  m.ts = ts;
+  m.topic = topic;
+  m.seq = 0;
+  m.len = (uint8_t)len;
+  m.crc = 0;
+  memcpy(m.payload, payload, len);
+
+  if (mqttQueueStore(m)) {
+    mqttQueueStats.enqueued++;
+    return true;
+  }
+
+  // File pleine: appliquer la politique de rejet
+  mqttQueueStats.dropped++;
+  if (mqttQueueDropPolicy == MQTT_QUEUE_DROP_NEWEST || mqttQueueDepth() == 0) return false;
+  mqttQueuePop();
+  if (!mqttQueueStore(m)) return false;
+  mqttQueueStats.enqueued++;
+  return true;
+}
+
+const char *mqttQueueDropPolicyName() {
+  return (mqttQueueDropPolicy == MQTT_QUEUE_DROP_NEWEST) ? "newest" : "oldest";
+}
+
+void mqttQueueSetDropPolicy(const char *name) {
+  if (!name) return;
+  if (strcmp(name, "newest") == 0) mqttQueueDropPolicy = MQTT_QUEUE_DROP_NEWEST;
+  else if (strcmp(name, "oldest") == 0) mqttQueueDropPolicy = MQTT_QUEUE_DROP_OLDEST;
+}
+
+#endif // MQTT_QUEUE_H
@@ -0,0 +1,116 @@
+#ifndef MQTT_QUEUE_RING_H
+#define MQTT_QUEUE_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "config_blob.h"
+
+// ===== ANNEAU FLASH DE LA FILE MQTT: RECORDS ET RECONSTRUCTION =====
+// Chaque record porte un numéro de séquence (croissant, jamais réutilisé) et
+// un CRC: le fichier se relit sans en-tête à jour. L'en-tête ne garde que la
+// séquence du plus ancien message non envoyé (plancher) et n'est réécrit que
+// par lots (MQTT_QUEUE_HEADER_BATCH retraits ou MQTT_QUEUE_HEADER_MS).
+// Au démarrage: file = suite de records valides aux séquences consécutives
+// qui finit au plus récent, sans descendre sous le plancher.
+//  - ajouts: retrouvés par la relecture, aucune écriture d'en-tête
+//  - retraits non encore écrits: au plus un lot rejoué après une coupure
+//    d'alimentation (livraison au moins une fois)
+//  - record à moitié écrit: CRC faux, la suite s'arrête avant lui
+// Aucune dépendance Arduino.
+
+#define MQTT_QUEUE_RECORD_SIZE 128
+#define MQTT_QUEUE_PAYLOAD_MAX (MQTT_QUEUE_RECORD_SIZE - 12)
+#define MQTT_QUEUE_HEADER_BATCH 16
+#define MQTT_QUEUE_HEADER_MS 500
+#define MQTT_QUEUE_MAGIC 0x4D515132UL  // "MQQ2"
+
+struct MqttQueuedMsg {
+  uint32_t seq;      // séquence flash (0 en RAM ou slot vide)
+  uint32_t ts;       // millis() au moment de l'événement
+  uint8_t topic;     // identifiant de topic (résolu par l'appelant)
+  uint8_t len;
+  uint16_t crc;      // CRC-32 tronqué de seq..payload[len], crc à 0
+  char payload[MQTT_QUEUE_PAYLOAD_MAX];
+};
+
+static_assert(sizeof(MqttQueuedMsg) == MQTT_QUEUE_RECORD_SIZE, "record MQTT queue: taille fixe attendue");
+
+struct MqttQueueFileHeader {
+  uint32_t magic;
+  uint32_t headSeq;  // plancher: séquence du plus ancien message non envoyé
+};
+
+struct MqttQueueRing {
+  uint16_t head;     // slot du plus ancien message
+  uint16_t count;
+  uint32_t headSeq;
+  uint32_t nextSeq;  // séquence du prochain ajout
+  uint16_t pending;  // retraits pas encore écrits dans l'en-tête
+  uint32_t pendingSinceMs;
+};
+
+static inline uint16_t mqttQueueRecordCrc(const MqttQueuedMsg &m) {
+  MqttQueuedMsg c = m;
+  c.crc = 0;
+  size_t len = c.len <= MQTT_QUEUE_PAYLOAD_MAX ? c.len : MQTT_QUEUE_PAYLOAD_MAX;
+  return (uint16_t)configCrc32(&c, offsetof(MqttQueuedMsg, payload) + len);
+}
+
+static inline void mqttQueueRecordSeal(MqttQueuedMsg &m, uint32_t seq) {
+  m.seq = seq;
+  m.crc = mqttQueueRecordCrc(m);
+}
+
+static inline bool mqttQueueRecordValid(const MqttQueuedMsg &m) {
+  return m.seq != 0 && m.len <= MQTT_QUEUE_PAYLOAD_MAX && m.crc == mqttQueueRecordCrc(m);
+}
+
+// seqs[slot]: séquence du record valide du slot, 0 si vide ou corrompu.
+// floorSeq: headSeq de l'en-tête (0 si en-tête absent ou invalide).
+static inline void mqttQueueRebuild(const uint32_t *seqs, uint16_t slots, uint32_t floorSeq, MqttQueueRing &r) {
+  uint32_t maxSeq = 0;
+  uint16_t last = 0;
+  for (uint16_t i = 0; i < slots; i++) {
+    if (seqs[i] > maxSeq) {
+      maxSeq = seqs[i];
+      last = i;
+    }
+  }
+  memset(&r, 0, sizeof(r));
+  // Jamais de séquence réutilisée: un slot périmé ne doit pas revenir dans la file
+  r.nextSeq = maxSeq + 1 > floorSeq ? maxSeq + 1 : floorSeq;
+  if (r.nextSeq == 0) r.nextSeq = 1;
+  r.headSeq = r.nextSeq;
+  if (maxSeq == 0 || maxSeq < floorSeq) return;
+  // En remontant depuis le plus récent: la suite s'arrête au premier slot vide,
+  // corrompu ou périmé (les records plus anciens derrière un trou sont abandonnés)
+  r.count = 1;
+  while (r.count < slots) {
+    uint32_t want = maxSeq - r.count;
+    if (want == 0 || want < floorSeq || seqs[(last + slots - r.count) % slots] != want) break;
+    r.count++;
+  }
+  r.head = (uint16_t)((last + slots + 1 - r.count) % slots);
+  r.headSeq = maxSeq + 1 - r.count;
+}
+
+static inline void mqttQueueRingPop(MqttQueueRing &r, uint16_t slots, uint32_t now) {
+  if (r.count == 0) return;
+  r.head = (uint16_t)((r.head + 1) % slots);
+  r.count--;
+  r.headSeq++;
+  if (r.count == 0) {
+    r.head = 0;
+    r.headSeq = r.nextSeq;
+  }
+  if (r.pending++ == 0) r.pendingSinceMs = now;
+}
+
+// En-tête à écrire: lot complet, délai écoulé ou file vidée
+static inline bool mqttQueueHeaderDue(const MqttQueueRing &r, uint32_t now) {
+  if (r.pending == 0) return false;
+  return r.pending >= MQTT_QUEUE_HEADER_BATCH || r.count == 0 || now - r.pendingSinceMs >= MQTT_QUEUE_HEADER_MS;
+}
+
+#endif // MQTT_QUEUE_RING_H
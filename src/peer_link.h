@@ -0,0 +1,286 @@
+#ifndef PEER_LINK_H
+#define PEER_LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "udp_ctrl.h"
+#include "latency_hist.h"
+
+// ===== LIENS DIRECTS ENTRE CARTES (entrée locale -> relais distant) =====
+// Sans passer par le broker: chaque carte distante reçoit en LINK (udp_ctrl.h)
+// l'état voulu de ses relais liés, calculé depuis nos entrées.
+// - Changement d'entrée: LINK immédiat, répété toutes les retryMs jusqu'à l'ACK
+//   (chaque envoi a un seq neuf: l'état est idempotent, l'anti-rejeu reste strict)
+// - Ensuite battement de cœur toutes les heartbeatMs (même état); sans ACK
+//   au-delà de timeoutMs, les répétitions repassent à ce rythme
+// - Côté récepteur: sans LINK d'une source pendant son délai (timeoutMs, porté
+//   par la trame), les relais de son masque de repli passent à l'état de repli
+// Aucune dépendance Arduino: envoi et relais fournis par PeerLinkIo.
+
+#define PEER_LINK_MAX_BINDINGS 8
+#define PEER_LINK_MAX_PEERS 4       // cartes distantes pilotées / sources reçues
+#define PEER_LINK_SEQ_BLOCK 0x100000UL  // seq réservés d'avance en mémoire non volatile
+
+enum PeerLinkMode : uint8_t {
+  PEER_MODE_FOLLOW = 0,             // relais = entrée
+  PEER_MODE_INVERT,                 // relais = !entrée
+  PEER_MODE_TOGGLE,                 // front montant: inverse le relais
+};
+
+enum PeerLinkFailsafe : uint8_t {
+  PEER_FS_HOLD = 0,                 // garde le dernier état
+  PEER_FS_OFF,
+  PEER_FS_ON,
+};
+
+struct PeerLinkIo {
+  bool (*send)(uint32_t addr, uint16_t port, const uint8_t *buf, size_t len);
+  void (*applyRelays)(uint8_t mask, uint8_t values);
+  // Mémorise le premier seq utilisable au prochain démarrage (optionnel):
+  // le récepteur refuse un seq déjà vu, un redémarrage ne doit pas reculer
+  void (*reserveSeq)(uint32_t next);
+};
+
+struct PeerBinding {
+  uint8_t peer;                     // index dans PeerLink::out
+  uint8_t input;                    // 0..7 (local)
+  uint8_t relay;                    // 0..7 (distant)
+  uint8_t mode;
+  uint8_t failsafe;
+};
+
+struct PeerLinkOut {
+  uint32_t addr;
+  uint16_t port;
+  UdpCtrlLink want;
+  uint32_t firstSeq;                // premier seq portant l'état courant
+  uint32_t lastSeq;
+  uint32_t lastTxMs;
+  uint32_t lastAckMs;
+  uint32_t changeMs;
+  uint32_t changeUs;                // horodatage du changement en attente d'ACK
+  bool acked;
+  bool measuring;
+  bool up;
+  uint32_t sent;
+  uint32_t retransmits;
+  uint32_t linkDowns;
+};
+
+struct PeerLinkIn {
+  uint32_t addr;                    // 0 = libre
+  uint8_t mask;
+  uint8_t fsMask;
+  uint8_t fsValues;
+  uint16_t timeoutMs;
+  uint32_t lastMs;
+  bool failed;
+  uint32_t failsafes;
+};
+
+struct PeerLink {
+  UdpCtrl *ctrl;                    // clé et anti-rejeu partagés avec udp_ctrl
+  PeerLinkIo io;
+  uint32_t retryMs;
+  uint32_t heartbeatMs;
+  uint16_t timeoutMs;
+  uint32_t txSeq;
+  uint32_t seqLimit;                // fin du bloc réservé
+
+  PeerBinding bindings[PEER_LINK_MAX_BINDINGS];
+  uint8_t bindingCount;
+  PeerLinkOut out[PEER_LINK_MAX_PEERS];
+  uint8_t outCount;
+  PeerLinkIn in[PEER_LINK_MAX_PEERS];
+  uint8_t toggles[PEER_LINK_MAX_PEERS];  // état des relais en mode bascule, par carte
+  uint8_t lastInputs;
+  bool inputsKnown;
+  LatencyHistogram latency;         // changement d'entrée -> ACK de la carte distante (µs)
+};
+
+static inline void peerLinkInit(PeerLink &l, UdpCtrl *ctrl, const PeerLinkIo &io, uint32_t retryMs,
+                                uint32_t heartbeatMs, uint16_t timeoutMs, uint32_t seqSeed) {
+  memset(&l, 0, sizeof(l));
+  l.ctrl = ctrl;
+  l.io = io;
+  l.retryMs = retryMs;
+  l.heartbeatMs = heartbeatMs;
+  l.timeoutMs = timeoutMs;
+  l.txSeq = seqSeed;
+  l.seqLimit = seqSeed + PEER_LINK_SEQ_BLOCK;
+}
+
+// Premier seq de ce démarrage (lu en mémoire non volatile): réserve le bloc suivant
+static inline void peerLinkStartSeq(PeerLink &l, uint32_t first) {
+  l.txSeq = first;
+  l.seqLimit = first + PEER_LINK_SEQ_BLOCK;
+  if (l.io.reserveSeq) l.io.reserveSeq(l.seqLimit);
+}
+
+static inline bool peerLinkAddBinding(PeerLink &l, uint32_t addr, uint16_t port, uint8_t input, uint8_t relay,
+                                      uint8_t mode, uint8_t failsafe) {
+  if (l.bindingCount >= PEER_LINK_MAX_BINDINGS || input > 7 || relay > 7 || addr == 0) return false;
+  uint8_t p = 0;
+  while (p < l.outCount && !(l.out[p].addr == addr && l.out[p].port == port)) p++;
+  if (p == l.outCount) {
+    if (l.outCount >= PEER_LINK_MAX_PEERS) return false;
+    l.out[p].addr = addr;
+    l.out[p].port = port;
+    l.outCount++;
+  }
+  PeerBinding &b = l.bindings[l.bindingCount++];
+  b.peer = p;
+  b.input = input;
+  b.relay = relay;
+  b.mode = mode;
+  b.failsafe = failsafe;
+  PeerLinkOut &o = l.out[p];
+  o.want.mask |= (uint8_t)(1u << relay);
+  o.want.timeoutMs = l.timeoutMs;
+  if (failsafe != PEER_FS_HOLD) o.want.fsMask |= (uint8_t)(1u << relay);
+  if (failsafe == PEER_FS_ON) o.want.fsValues |= (uint8_t)(1u << relay);
+  return true;
+}
+
+static inline void peerLinkSend(PeerLink &l, PeerLinkOut &o, uint32_t nowMs) {
+  uint8_t buf[UDP_CTRL_LINK_LEN];
+  o.lastSeq = ++l.txSeq;
+  if (l.txSeq == l.seqLimit) {
+    l.seqLimit += PEER_LINK_SEQ_BLOCK;
+    if (l.io.reserveSeq) l.io.reserveSeq(l.seqLimit);
+  }
+  size_t n = udpCtrlEncodeLink(*l.ctrl, o.lastSeq, o.want, buf);
+  l.io.send(o.addr, o.port, buf, n);
+  o.lastTxMs = nowMs;
+  o.sent++;
+}
+
+// Nouvel état des entrées locales: recalcule les relais voulus de chaque carte
+// et envoie tout de suite ce qui a changé
+static inline void peerLinkInputs(PeerLink &l, uint8_t inputs, uint32_t nowMs, uint32_t nowUs) {
+  uint8_t rising = l.inputsKnown ? (uint8_t)(inputs & ~l.lastInputs) : 0;
+  bool first = !l.inputsKnown;
+  l.lastInputs = inputs;
+  l.inputsKnown = true;
+
+  uint8_t values[PEER_LINK_MAX_PEERS];
+  for (uint8_t p = 0; p < l.outCount; p++) values[p] = 0;
+  for (uint8_t i = 0; i < l.bindingCount; i++) {
+    const PeerBinding &b = l.bindings[i];
+    uint8_t bit = (uint8_t)(1u << b.relay);
+    bool in = (inputs >> b.input) & 1;
+    bool on;
+    if (b.mode == PEER_MODE_TOGGLE) {
+      if (rising & (1u << b.input)) l.toggles[b.peer] ^= bit;
+      on = (l.toggles[b.peer] & bit) != 0;
+    } else {
+      on = (b.mode == PEER_MODE_INVERT) ? !in : in;
+    }
+    if (on) values[b.peer] |= bit;
+  }
+
+  for (uint8_t p = 0; p < l.outCount; p++) {
+    PeerLinkOut &o = l.out[p];
+    if (!first && values[p] == o.want.values) continue;
+    o.want.values = values[p];
+    o.acked = false;
+    o.measuring = !first;
+    o.changeMs = nowMs;
+    o.changeUs = nowUs;
+    peerLinkSend(l, o, nowMs);
+    o.firstSeq = o.lastSeq;
+  }
+}
+
+// ACK reçu d'une carte distante (réponse à un LINK)
+static inline void peerLinkOnAck(PeerLink &l, uint32_t addr, uint32_t seq, uint32_t nowMs, uint32_t nowUs) {
+  for (uint8_t p = 0; p < l.outCount; p++) {
+    PeerLinkOut &o = l.out[p];
+    if (o.addr != addr || seq < o.firstSeq || seq > o.lastSeq) continue;
+    o.lastAckMs = nowMs;
+    o.up = true;
+    if (!o.acked && o.measuring) latencyHistRecord(l.latency, nowUs - o.changeUs);
+    o.acked = true;
+    o.measuring = false;
+    return;
+  }
+}
+
+// LINK reçu d'une source: applique l'état voulu et arme son délai de repli.
+// true si un ACK doit être renvoyé (seq/status remplis).
+static inline bool peerLinkOnLink(PeerLink &l, uint32_t addr, const uint8_t *in, size_t len, uint32_t nowMs,
+                                  uint32_t &seq, uint8_t &status) {
+  UdpCtrlLink link;
+  if (!udpCtrlDecodeLink(*l.ctrl, in, len, seq, link)) {
+    l.ctrl->stats.badMac++;
+    return false;
+  }
+  status = udpCtrlAcceptSeq(*l.ctrl, addr, seq, nowMs);
+  if (status == UDP_CTRL_REPLAY) l.ctrl->stats.replays++;
+  if (status == UDP_CTRL_FULL) l.ctrl->stats.refused++;
+  if (status != UDP_CTRL_OK) return true;
+  PeerLinkIn *src = nullptr;
+  for (uint8_t i = 0; i < PEER_LINK_MAX_PEERS && !src; i++) {
+    if (l.in[i].addr == addr) src = &l.in[i];
+  }
+  for (uint8_t i = 0; i < PEER_LINK_MAX_PEERS && !src; i++) {
+    if (l.in[i].addr == 0) src = &l.in[i];
+  }
+  if (!src) {
+    // Table pleine: remplace la source muette depuis le plus longtemps
+    src = &l.in[0];
+    for (uint8_t i = 1; i < PEER_LINK_MAX_PEERS; i++) {
+      if (nowMs - l.in[i].lastMs > nowMs - src->lastMs) src = &l.in[i];
+    }
+    src->failsafes = 0;
+  }
+  src->addr = addr;
+  src->mask = link.mask;
+  src->fsMask = (uint8_t)(link.fsMask & link.mask);
+  src->fsValues = link.fsValues;
+  src->timeoutMs = link.timeoutMs;
+  src->lastMs = nowMs;
+  src->failed = false;
+  if (link.mask != 0) l.io.applyRelays(link.mask, link.values);
+  l.ctrl->stats.commands++;
+  status = UDP_CTRL_OK;
+  return true;
+}
+
+// Retransmissions, battements de cœur, état des liens et repli des sources muettes
+static inline void peerLinkService(PeerLink &l, uint32_t nowMs) {
+  for (uint8_t p = 0; p < l.outCount; p++) {
+    PeerLinkOut &o = l.out[p];
+    // Répétition rapide jusqu'à l'ACK, au rythme du battement de cœur au-delà
+    // du délai de lien (carte distante absente)
+    bool fast = !o.acked && nowMs - o.changeMs < l.timeoutMs;
+    if (nowMs - o.lastTxMs >= (fast ? l.retryMs : l.heartbeatMs)) {
+      peerLinkSend(l, o, nowMs);
+      if (!o.acked) o.retransmits++;
+    }
+    if (o.up && nowMs - o.lastAckMs > l.timeoutMs) {
+      o.up = false;
+      o.linkDowns++;
+    }
+  }
+
+  for (uint8_t i = 0; i < PEER_LINK_MAX_PEERS; i++) {
+    PeerLinkIn &src = l.in[i];
+    if (src.addr == 0 || src.failed || src.timeoutMs == 0) continue;
+    if (nowMs - src.lastMs <= src.timeoutMs) continue;
+    src.failed = true;
+    src.failsafes++;
+    if (src.fsMask != 0) l.io.applyRelays(src.fsMask, src.fsValues);
+  }
+}
+
+static inline const char *peerLinkModeName(uint8_t mode) {
+  switch (mode) {
+    case PEER_MODE_INVERT: return "invert";
+    case PEER_MODE_TOGGLE: return "toggle";
+    default: return "follow";
+  }
+}
+
+#endif // PEER_LINK_H
@@ -0,0 +1,130 @@
+#ifndef REQ_ARENA_H
+#define REQ_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ===== ARÈNE PAR REQUÊTE =====
+// Zone fixe (statique dans main.cpp) où une requête HTTP prend ses documents
+// JSON, son corps et sa réponse sérialisée. Une allocation avance un index,
+// et tout est rendu d'un coup en fin de requête (reqArenaEnd). Les quelques
+// Ko pris et rendus à chaque requête ne passent plus par le tas, qui ne se
+// fragmente plus autour des allocations durables (MQTT, logs...).
+// - Ordre pile: reqFree rend le dernier bloc (et seulement lui), reqRealloc
+//   agrandit le dernier bloc sur place. Les autres blocs attendent la fin de
+//   la requête.
+// - Zone pleine: repli sur malloc, compté par route pour dimensionner la
+//   zone d'après les pics observés.
+// Aucune dépendance Arduino.
+
+#define REQ_ARENA_ALIGN 8
+#define REQ_ARENA_NONE 0xFFFFFFFFUL
+
+// En-tête de chaque bloc (REQ_ARENA_ALIGN octets)
+struct ReqArenaBlock {
+  uint32_t size;                           // octets demandés
+  uint32_t prev;                           // en-tête du bloc précédent (REQ_ARENA_NONE: aucun)
+};
+
+struct ReqArena {
+  uint8_t *base;
+  uint32_t size;
+  uint32_t used;
+  uint32_t last;                           // en-tête du dernier bloc
+  uint32_t peak;                           // pic de la requête en cours (en-têtes compris)
+  uint32_t heapAllocs;                     // replis sur le tas, requête en cours
+  uint32_t heapFallbacks;                  // replis sur le tas, total
+};
+
+#define REQ_ARENA_INIT(mem) {(mem), sizeof(mem), 0, REQ_ARENA_NONE, 0, 0, 0}
+
+// Pics par route (GET /api/mem)
+struct ReqArenaRoute {
+  const char *name;                        // "GET /api/status"...
+  uint32_t requests;
+  uint32_t peak;                           // octets au plus haut, toutes requêtes
+  uint32_t last;                           // octets au plus haut, dernière requête
+  uint32_t heapAllocs;                     // replis sur le tas
+};
+
+static inline uint32_t reqArenaRound(size_t n) {
+  return (uint32_t)((n + REQ_ARENA_ALIGN - 1) & ~(size_t)(REQ_ARENA_ALIGN - 1));
+}
+
+static inline bool reqArenaOwns(const ReqArena &a, const void *p) {
+  return (const uint8_t *)p >= a.base && (const uint8_t *)p < a.base + a.size;
+}
+
+static inline ReqArenaBlock *reqArenaHeader(const ReqArena &a, uint32_t off) {
+  return (ReqArenaBlock *)(a.base + off);
+}
+
+// Dans la zone seulement; nullptr si elle est pleine
+static inline void *reqArenaTake(ReqArena &a, size_t n) {
+  uint32_t need = sizeof(ReqArenaBlock) + reqArenaRound(n);
+  if (n > a.size || need > a.size - a.used) return nullptr;
+  ReqArenaBlock *h = reqArenaHeader(a, a.used);
+  h->size = (uint32_t)n;
+  h->prev = a.last;
+  a.last = a.used;
+  a.used += need;
+  if (a.used > a.peak) a.peak = a.used;
+  return h + 1;
+}
+
+static inline void *reqAlloc(ReqArena &a, size_t n) {
+  void *p = reqArenaTake(a, n);
+  if (p) return p;
+  p = malloc(n);
+  if (p) {
+    a.heapAllocs++;
+    a.heapFallbacks++;
+  }
+  return p;
+}
+
+static inline void reqFree(ReqArena &a, void *p) {
+  if (!p) return;
+  if (!reqArenaOwns(a, p)) {
+    free(p);
+    return;
+  }
+  if (a.last == REQ_ARENA_NONE || (uint8_t *)p != (uint8_t *)(reqArenaHeader(a, a.last) + 1)) return;
+  a.used = a.last;
+  a.last = reqArenaHeader(a, a.last)->prev;
+}
+
+static inline void *reqRealloc(ReqArena &a, void *p, size_t n) {
+  if (!p) return reqAlloc(a, n);
+  if (!reqArenaOwns(a, p)) return realloc(p, n);
+  ReqArenaBlock *h = (ReqArenaBlock *)p - 1;
+  uint32_t off = (uint32_t)((uint8_t *)h - a.base);
+  if (off == a.last && n <= a.size && reqArenaRound(n) <= a.size - off - sizeof(ReqArenaBlock)) {
+    h->size = (uint32_t)n;
+    a.used = off + sizeof(ReqArenaBlock) + reqArenaRound(n);
+    if (a.used > a.peak) a.peak = a.used;
+    return p;
+  }
+  void *q = reqAlloc(a, n);
+  if (!q) return nullptr;
+  memcpy(q, p, h->size < n ? h->size : n);
+  reqFree(a, p);
+  return q;
+}
+
+// Fin de requête: pics de la route puis zone vidée. Les blocs repliés sur
+// le tas ont été rendus par leurs propriétaires (documents, tampons).
+static inline void reqArenaEnd(ReqArena &a, ReqArenaRoute &r) {
+  r.requests++;
+  r.last = a.peak;
+  if (a.peak > r.peak) r.peak = a.peak;
+  r.heapAllocs += a.heapAllocs;
+  a.used = 0;
+  a.last = REQ_ARENA_NONE;
+  a.peak = 0;
+  a.heapAllocs = 0;
+}
+
+#endif // REQ_ARENA_H
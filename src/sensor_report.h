@@ -0,0 +1,145 @@
+#ifndef SENSOR_REPORT_H
+#define SENSOR_REPORT_H
+
+#include <stdint.h>
+#include <math.h>
+
+// ===== REPORTING CAPTEURS (deadband + intervalles min/max) =====
+// Chaque canal garde sa dernière mesure valide et l'état de son dernier rapport.
+// Une lecture ratée ne remplace plus la valeur par 0.0: le canal passe "invalid"
+// (jamais de mesure valide) ou "stale" (dernière mesure valide trop ancienne).
+// Les mêmes fonctions servent à MQTT, /api/status et aux registres Modbus.
+// Aucune dépendance Arduino.
+
+enum SensorState : uint8_t {
+  SENSOR_OK = 0,
+  SENSOR_INVALID = 1,
+  SENSOR_STALE = 2,
+};
+
+// Valeur de registre Modbus (int16 x10) signalant une mesure indisponible
+#define SENSOR_REGISTER_INVALID ((int16_t)0x8000)
+
+// Plancher du deadband relatif: à 0 (ou près de 0), |valeur| x % tombe à 0
+// et la moindre variation de bruit serait publiée
+#define SENSOR_DEADBAND_MIN 1e-3f
+
+struct SensorChannel {
+  const char *name;
+  // Bornes physiques: une lecture hors plage est traitée comme un échec
+  float minValid;
+  float maxValid;
+
+  // Paramètres de reporting (configurables via /config.json)
+  float deadbandAbs;         // variation absolue minimale (0 = désactivé)
+  float deadbandPct;         // variation relative minimale en % (0 = désactivé), voir sensorDeadband()
+  uint32_t minIntervalMs;    // pas deux rapports plus rapprochés que ça
+  uint32_t maxIntervalMs;    // rapport forcé (heartbeat) au-delà (0 = jamais)
+  uint32_t staleMs;          // sans mesure valide depuis ce délai => "stale"
+
+  // Mesure
+  float value;               // dernière mesure valide (NAN si aucune)
+  bool lastReadOk;
+  uint32_t lastGoodMs;
+  uint32_t readErrors;
+
+  // Dernier rapport émis
+  bool reported;
+  SensorState reportedState;
+  float reportedValue;
+  uint32_t lastReportMs;
+};
+
+static inline void sensorChannelInit(SensorChannel &ch, const char *name, float minValid, float maxValid,
+                                     float deadbandAbs, uint32_t minIntervalMs, uint32_t maxIntervalMs) {
+  ch.name = name;
+  ch.minValid = minValid;
+  ch.maxValid = maxValid;
+  ch.deadbandAbs = deadbandAbs;
+  ch.deadbandPct = 0.0f;
+  ch.minIntervalMs = minIntervalMs;
+  ch.maxIntervalMs = maxIntervalMs;
+  ch.staleMs = 30000;
+  ch.value = NAN;
+  ch.lastReadOk = false;
+  ch.lastGoodMs = 0;
+  ch.readErrors = 0;
+  ch.reported = false;
+  ch.reportedState = SENSOR_INVALID;
+  ch.reportedValue = NAN;
+  ch.lastReportMs = 0;
+}
+
+// Enregistre une lecture brute (NAN = échec capteur)
+static inline void sensorSample(SensorChannel &ch, float raw, uint32_t now) {
+  if (isnan(raw) || raw < ch.minValid || raw > ch.maxValid) {
+    ch.lastReadOk = false;
+    ch.readErrors++;
+    return;
+  }
+  ch.value = raw;
+  ch.lastReadOk = true;
+  ch.lastGoodMs = now;
+}
+
+static inline SensorState sensorState(const SensorChannel &ch, uint32_t now) {
+  if (isnan(ch.value)) return SENSOR_INVALID;
+  if (ch.staleMs > 0 && (now - ch.lastGoodMs) > ch.staleMs) return SENSOR_STALE;
+  return SENSOR_OK;
+}
+
+static inline const char *sensorStateName(SensorState st) {
+  switch (st) {
+    case SENSOR_OK: return "ok";
+    case SENSOR_STALE: return "stale";
+    default: return "invalid";
+  }
+}
+
+// Variation minimale à publier (0 = toute variation).
+// Relatif: max(|dernière valeur publiée| x deadbandPct / 100, deadbandAbs,
+// SENSOR_DEADBAND_MIN); deadbandAbs sert alors de plancher près de zéro.
+static inline float sensorDeadband(const SensorChannel &ch) {
+  if (ch.deadbandPct <= 0.0f) return ch.deadbandAbs > 0.0f ? ch.deadbandAbs : 0.0f;
+  float t = fabsf(ch.reportedValue) * ch.deadbandPct / 100.0f;
+  if (t < ch.deadbandAbs) t = ch.deadbandAbs;
+  if (t < SENSOR_DEADBAND_MIN) t = SENSOR_DEADBAND_MIN;
+  return t;
+}
+
+// Vrai si le canal doit être republié maintenant
+static inline bool sensorReportDue(const SensorChannel &ch, uint32_t now) {
+  SensorState st = sensorState(ch, now);
+  if (!ch.reported) return true;
+  // Un changement d'état (ok -> stale, invalid -> ok...) part immédiatement
+  if (st != ch.reportedState) return true;
+
+  uint32_t since = now - ch.lastReportMs;
+  if (since < ch.minIntervalMs) return false;
+  if (ch.maxIntervalMs > 0 && since >= ch.maxIntervalMs) return true;
+  if (st != SENSOR_OK) return false;
+
+  float delta = fabsf(ch.value - ch.reportedValue);
+  float deadband = sensorDeadband(ch);
+  return deadband > 0.0f ? delta >= deadband : delta > 0.0f;
+}
+
+static inline void sensorMarkReported(SensorChannel &ch, uint32_t now) {
+  ch.reported = true;
+  ch.reportedState = sensorState(ch, now);
+  ch.reportedValue = ch.value;
+  ch.lastReportMs = now;
+}
+
+// Force un rapport complet au prochain passage (ex: après reconnexion MQTT)
+static inline void sensorReportReset(SensorChannel &ch) {
+  ch.reported = false;
+}
+
+// Registre Modbus: valeur x10 signée, SENSOR_REGISTER_INVALID si indisponible
+static inline int16_t sensorRegisterValue(const SensorChannel &ch, uint32_t now) {
+  if (sensorState(ch, now) != SENSOR_OK) return SENSOR_REGISTER_INVALID;
+  return (int16_t)lroundf(ch.value * 10.0f);
+}
+
+#endif // SENSOR_REPORT_H
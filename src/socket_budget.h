@@ -0,0 +1,196 @@
+#ifndef SOCKET_BUDGET_H
+#define SOCKET_BUDGET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ===== RÉPARTITION DES 8 SOCKETS MATÉRIELS DU W5500 =====
+// HTTP, Modbus TCP et MQTT prennent leurs sockets dans la même table sans
+// coordination: une rafale de connexions navigateur (chaque accept() rouvre
+// un socket d'écoute) peut occuper les 8 sockets et bloquer la reconnexion
+// MQTT. Ici chaque service a:
+// - reserved: sockets qu'aucun autre service ne peut lui prendre
+// - cap: nombre maximal de sockets (écoute comprise pour un serveur)
+// - idleMs: connexion établie sans activité fermée après ce délai (0 = jamais)
+// Un service en dessous de sa réservation peut évincer la connexion la plus
+// ancienne d'un service qui dépasse la sienne.
+// Aucune dépendance Arduino: la table des sockets est lue via SockBudgetIo,
+// ce qui permet de tester la logique sous Linux avec une table simulée.
+
+#define SOCK_BUDGET_MAX 8
+
+// Valeurs Sn_SR du W5500 utilisées ici
+#define SOCK_ST_CLOSED 0x00
+#define SOCK_ST_LISTEN 0x14
+#define SOCK_ST_ESTABLISHED 0x17
+#define SOCK_ST_CLOSE_WAIT 0x1C
+
+enum SockService : uint8_t {
+  SOCK_SVC_NONE = 0,                // socket fermé
+  SOCK_SVC_HTTP,
+  SOCK_SVC_MODBUS,
+  SOCK_SVC_MQTT,
+  SOCK_SVC_UDP,                     // protocole UDP binaire (udp_ctrl.h)
+  SOCK_SVC_OTHER,                   // DHCP/DNS de la lib Ethernet, etc.
+  SOCK_SVC_COUNT
+};
+
+struct SockBudgetIo {
+  uint8_t (*status)(uint8_t s);     // Sn_SR
+  uint16_t (*rxSize)(uint8_t s);    // Sn_RX_RSR
+  uint8_t (*service)(uint8_t s);    // propriétaire d'un socket ouvert (SockService)
+  void (*close)(uint8_t s);         // fermeture immédiate (socket CLOSED au retour)
+};
+
+struct SockServiceBudget {
+  uint8_t reserved;
+  uint8_t cap;
+  uint32_t idleMs;
+  uint8_t used;
+  bool blocked;                     // dernière demande refusée
+  uint32_t refusals;                // passages à l'état bloqué
+  uint32_t evictions;               // connexions de ce service fermées par le gestionnaire
+};
+
+struct SockBudget {
+  SockBudgetIo io;
+  uint8_t count;                    // sockets gérés (<= SOCK_BUDGET_MAX)
+  uint8_t free;
+  uint8_t owner[SOCK_BUDGET_MAX];
+  uint8_t lastStatus[SOCK_BUDGET_MAX];
+  uint16_t lastRx[SOCK_BUDGET_MAX];
+  uint32_t activeMs[SOCK_BUDGET_MAX];
+  SockServiceBudget svc[SOCK_SVC_COUNT];
+};
+
+static inline void sockBudgetInit(SockBudget &b, const SockBudgetIo &io, uint8_t count) {
+  memset(&b, 0, sizeof(b));
+  b.io = io;
+  b.count = (count > SOCK_BUDGET_MAX) ? SOCK_BUDGET_MAX : count;
+  b.free = b.count;
+  for (uint8_t i = 0; i < SOCK_SVC_COUNT; i++) b.svc[i].cap = b.count;
+}
+
+static inline void sockBudgetSetService(SockBudget &b, uint8_t svc, uint8_t reserved, uint8_t cap, uint32_t idleMs) {
+  if (svc == SOCK_SVC_NONE || svc >= SOCK_SVC_COUNT) return;
+  if (cap > b.count) cap = b.count;
+  if (reserved > cap) reserved = cap;
+  b.svc[svc].reserved = reserved;
+  b.svc[svc].cap = cap;
+  b.svc[svc].idleMs = idleMs;
+}
+
+// Activité constatée par le service (requête traitée): repousse l'éviction
+static inline void sockBudgetTouch(SockBudget &b, uint8_t s, uint32_t nowMs) {
+  if (s < b.count) b.activeMs[s] = nowMs;
+}
+
+static inline bool sockBudgetConnected(uint8_t st) {
+  return st == SOCK_ST_ESTABLISHED || st == SOCK_ST_CLOSE_WAIT;
+}
+
+static inline void sockBudgetEvict(SockBudget &b, uint8_t s) {
+  uint8_t owner = b.owner[s];
+  b.io.close(s);
+  b.svc[owner].evictions++;
+  b.svc[owner].used--;
+  b.owner[s] = SOCK_SVC_NONE;
+  b.lastStatus[s] = SOCK_ST_CLOSED;
+  b.free++;
+}
+
+// Relit la table, met à jour l'occupation et ferme les connexions inactives
+static inline void sockBudgetRefresh(SockBudget &b, uint32_t nowMs) {
+  for (uint8_t i = 1; i < SOCK_SVC_COUNT; i++) b.svc[i].used = 0;
+  b.free = 0;
+  for (uint8_t s = 0; s < b.count; s++) {
+    uint8_t st = b.io.status(s);
+    uint8_t owner = SOCK_SVC_NONE;
+    uint16_t rx = 0;
+    if (st != SOCK_ST_CLOSED) {
+      owner = b.io.service(s);
+      if (owner == SOCK_SVC_NONE || owner >= SOCK_SVC_COUNT) owner = SOCK_SVC_OTHER;
+      if (sockBudgetConnected(st)) rx = b.io.rxSize(s);
+    }
+    if (st != b.lastStatus[s] || owner != b.owner[s] || rx != b.lastRx[s]) b.activeMs[s] = nowMs;
+    b.lastStatus[s] = st;
+    b.lastRx[s] = rx;
+    b.owner[s] = owner;
+    if (owner == SOCK_SVC_NONE) {
+      b.free++;
+      continue;
+    }
+    b.svc[owner].used++;
+  }
+
+  for (uint8_t s = 0; s < b.count; s++) {
+    uint8_t owner = b.owner[s];
+    if (owner == SOCK_SVC_NONE || !sockBudgetConnected(b.lastStatus[s])) continue;
+    uint32_t idleMs = b.svc[owner].idleMs;
+    if (idleMs > 0 && nowMs - b.activeMs[s] > idleMs) sockBudgetEvict(b, s);
+  }
+}
+
+// Sockets libres que les autres services peuvent encore réclamer
+static inline uint8_t sockBudgetOwedToOthers(const SockBudget &b, uint8_t svc) {
+  uint8_t owed = 0;
+  for (uint8_t i = 1; i < SOCK_SVC_COUNT; i++) {
+    if (i == svc) continue;
+    if (b.svc[i].used < b.svc[i].reserved) owed += b.svc[i].reserved - b.svc[i].used;
+  }
+  return owed;
+}
+
+// Connexion la plus ancienne d'un service au-delà de sa réservation
+static inline uint8_t sockBudgetVictim(const SockBudget &b, uint8_t forSvc, uint32_t nowMs) {
+  uint8_t victim = SOCK_BUDGET_MAX;
+  uint32_t oldest = 0;
+  for (uint8_t s = 0; s < b.count; s++) {
+    uint8_t owner = b.owner[s];
+    if (owner == SOCK_SVC_NONE || owner == forSvc || owner == SOCK_SVC_OTHER) continue;
+    if (!sockBudgetConnected(b.lastStatus[s])) continue;
+    if (b.svc[owner].used <= b.svc[owner].reserved) continue;
+    uint32_t idle = nowMs - b.activeMs[s];
+    if (victim == SOCK_BUDGET_MAX || idle > oldest) {
+      victim = s;
+      oldest = idle;
+    }
+  }
+  return victim;
+}
+
+// Le service peut-il ouvrir un socket de plus? À appeler juste avant
+// l'ouverture (après sockBudgetRefresh()). Peut évincer une connexion d'un
+// autre service si svc n'a pas encore sa réservation.
+static inline bool sockBudgetMayOpen(SockBudget &b, uint8_t svc, uint32_t nowMs) {
+  if (svc == SOCK_SVC_NONE || svc >= SOCK_SVC_COUNT) return false;
+  SockServiceBudget &sb = b.svc[svc];
+  bool ok = false;
+  if (sb.used < sb.cap) {
+    ok = b.free > sockBudgetOwedToOthers(b, svc);
+    if (!ok && sb.used < sb.reserved) {
+      uint8_t victim = sockBudgetVictim(b, svc, nowMs);
+      if (victim < b.count) {
+        sockBudgetEvict(b, victim);
+        ok = b.free > sockBudgetOwedToOthers(b, svc);
+      }
+    }
+  }
+  if (!ok && !sb.blocked) sb.refusals++;
+  sb.blocked = !ok;
+  return ok;
+}
+
+static inline const char *sockServiceName(uint8_t svc) {
+  switch (svc) {
+    case SOCK_SVC_HTTP: return "http";
+    case SOCK_SVC_MODBUS: return "modbus";
+    case SOCK_SVC_MQTT: return "mqtt";
+    case SOCK_SVC_UDP: return "udp";
+    case SOCK_SVC_OTHER: return "other";
+    default: return "none";
+  }
+}
+
+#endif // SOCKET_BUDGET_H
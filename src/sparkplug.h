@@ -0,0 +1,358 @@
+#ifndef SPARKPLUG_H
+#define SPARKPLUG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "mqtt_command.h"
+
+// ===== SPARKPLUG B (protobuf minimal, buffers fixes) =====
+// Encodeur/décodeur réduit au sous-ensemble de sparkplug_b.proto utilisé ici:
+//   Payload { timestamp=1; repeated Metric metrics=2; seq=3 }
+//   Metric  { name=1; alias=2; timestamp=3; datatype=4; is_null=7;
+//             int_value=10; long_value=11; float_value=12; boolean_value=14; string_value=15 }
+// Pas de heap: l'appelant fournit le buffer; en cas de débordement
+// spFinish() retourne 0. timestamp 0 = champ omis.
+// Aucune dépendance Arduino: charges utiles de la carte (NBIRTH, NDATA,
+// NDEATH) et lecture des NCMD construites ici, publiées par main.cpp.
+
+// Types Sparkplug (DataType)
+enum SpDataType : uint8_t {
+  SP_TYPE_INT32 = 3,
+  SP_TYPE_UINT32 = 7,
+  SP_TYPE_UINT64 = 8,
+  SP_TYPE_FLOAT = 9,
+  SP_TYPE_BOOLEAN = 11,
+  SP_TYPE_STRING = 12,
+};
+
+// Alias des métriques de la carte (stables d'une naissance à l'autre)
+enum SpAlias : uint8_t {
+  SP_ALIAS_RELAY0 = 1,      // 1..8  Relays/0..7
+  SP_ALIAS_INPUT0 = 9,      // 9..16 Inputs/0..7
+  SP_ALIAS_TEMPERATURE = 17,
+  SP_ALIAS_HUMIDITY = 18,
+  SP_ALIAS_UPTIME = 19,
+  SP_ALIAS_IP = 20,
+  SP_ALIAS_REBIRTH = 21,
+};
+
+struct SpWriter {
+  uint8_t *buf;
+  size_t cap;
+  size_t pos;
+  bool overflow;
+  size_t metricStart;       // début du contenu de la métrique ouverte
+};
+
+static inline void spPutByte(SpWriter &w, uint8_t b) {
+  if (w.pos >= w.cap) {
+    w.overflow = true;
+    return;
+  }
+  w.buf[w.pos++] = b;
+}
+
+static inline void spPutVarint(SpWriter &w, uint64_t v) {
+  while (v >= 0x80) {
+    spPutByte(w, (uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  spPutByte(w, (uint8_t)v);
+}
+
+static inline void spPutTag(SpWriter &w, uint32_t field, uint8_t wireType) {
+  spPutVarint(w, ((uint64_t)field << 3) | wireType);
+}
+
+static inline void spPutBytes(SpWriter &w, uint32_t field, const char *p, size_t len) {
+  spPutTag(w, field, 2);
+  spPutVarint(w, len);
+  if (w.pos + len > w.cap) {
+    w.overflow = true;
+    return;
+  }
+  memcpy(w.buf + w.pos, p, len);
+  w.pos += len;
+}
+
+static inline void spBegin(SpWriter &w, uint8_t *buf, size_t cap, uint64_t timestamp) {
+  w.buf = buf;
+  w.cap = cap;
+  w.pos = 0;
+  w.overflow = false;
+  w.metricStart = 0;
+  if (timestamp) {
+    spPutTag(w, 1, 0);
+    spPutVarint(w, timestamp);
+  }
+}
+
+// Ouvre une métrique: la longueur (1 octet réservé) est fixée par spMetricEnd()
+static inline void spMetricBegin(SpWriter &w, const char *name, uint32_t alias, uint8_t datatype) {
+  spPutTag(w, 2, 2);
+  spPutByte(w, 0);
+  w.metricStart = w.pos;
+  if (name) spPutBytes(w, 1, name, strlen(name));
+  if (alias) {
+    spPutTag(w, 2, 0);
+    spPutVarint(w, alias);
+  }
+  if (datatype) {
+    spPutTag(w, 4, 0);
+    spPutVarint(w, datatype);
+  }
+}
+
+static inline void spMetricEnd(SpWriter &w) {
+  if (w.overflow) return;
+  size_t len = w.pos - w.metricStart;
+  if (len < 0x80) {
+    w.buf[w.metricStart - 1] = (uint8_t)len;
+    return;
+  }
+  // Longueur sur 2 octets (métrique >= 128 octets): décale le contenu
+  if (len >= 0x4000 || w.pos + 1 > w.cap) {
+    w.overflow = true;
+    return;
+  }
+  memmove(w.buf + w.metricStart + 1, w.buf + w.metricStart, len);
+  w.buf[w.metricStart - 1] = (uint8_t)(len | 0x80);
+  w.buf[w.metricStart] = (uint8_t)(len >> 7);
+  w.pos++;
+}
+
+static inline void spMetricBool(SpWriter &w, const char *name, uint32_t alias, bool withType, bool v) {
+  spMetricBegin(w, name, alias, withType ? SP_TYPE_BOOLEAN : 0);
+  spPutTag(w, 14, 0);
+  spPutByte(w, v ? 1 : 0);
+  spMetricEnd(w);
+}
+
+static inline void spMetricUInt64(SpWriter &w, const char *name, uint32_t alias, bool withType, uint64_t v) {
+  spMetricBegin(w, name, alias, withType ? SP_TYPE_UINT64 : 0);
+  spPutTag(w, 11, 0);
+  spPutVarint(w, v);
+  spMetricEnd(w);
+}
+
+// Float; NaN => is_null (mesure invalide ou périmée)
+static inline void spMetricFloat(SpWriter &w, const char *name, uint32_t alias, bool withType, float v) {
+  spMetricBegin(w, name, alias, withType ? SP_TYPE_FLOAT : 0);
+  if (v != v) {
+    spPutTag(w, 7, 0);
+    spPutByte(w, 1);
+  } else {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    spPutTag(w, 12, 5);
+    for (int i = 0; i < 4; i++) spPutByte(w, (uint8_t)(bits >> (8 * i)));
+  }
+  spMetricEnd(w);
+}
+
+static inline void spMetricString(SpWriter &w, const char *name, uint32_t alias, bool withType, const char *v) {
+  spMetricBegin(w, name, alias, withType ? SP_TYPE_STRING : 0);
+  spPutBytes(w, 15, v, strlen(v));
+  spMetricEnd(w);
+}
+
+// Termine le payload avec seq (0..255); retourne la longueur ou 0 si débordement
+static inline size_t spFinish(SpWriter &w, uint8_t seq, bool withSeq = true) {
+  if (withSeq) {
+    spPutTag(w, 3, 0);
+    spPutVarint(w, seq);
+  }
+  return w.overflow ? 0 : w.pos;
+}
+
+// ----- Charges utiles de la carte -----
+static const char *const SP_RELAY_NAMES[8] = {"Relays/0", "Relays/1", "Relays/2", "Relays/3",
+                                              "Relays/4", "Relays/5", "Relays/6", "Relays/7"};
+static const char *const SP_INPUT_NAMES[8] = {"Inputs/0", "Inputs/1", "Inputs/2", "Inputs/3",
+                                              "Inputs/4", "Inputs/5", "Inputs/6", "Inputs/7"};
+
+struct SpNodeSnapshot {
+  uint8_t relays;
+  uint8_t inputs;
+  float temperature;        // NaN: mesure invalide ou périmée
+  float humidity;
+  uint64_t uptimeMs;
+  const char *ip;
+};
+
+// Métriques de NDATA (par exception: seulement ce qui a changé)
+struct SpDataChanges {
+  uint8_t relays;           // bits des relais modifiés
+  uint8_t inputs;
+  bool temperature;
+  bool humidity;
+  bool uptime;              // publication périodique
+};
+
+// NBIRTH: toutes les métriques avec nom, alias et type
+static inline size_t spEncodeBirth(uint8_t *buf, size_t cap, uint64_t timestamp, uint8_t bdSeq,
+                                   const SpNodeSnapshot &s, uint8_t seq) {
+  SpWriter w;
+  spBegin(w, buf, cap, timestamp);
+  spMetricUInt64(w, "bdSeq", 0, true, bdSeq);
+  for (int i = 0; i < 8; i++) spMetricBool(w, SP_RELAY_NAMES[i], SP_ALIAS_RELAY0 + i, true, (s.relays >> i) & 1);
+  for (int i = 0; i < 8; i++) spMetricBool(w, SP_INPUT_NAMES[i], SP_ALIAS_INPUT0 + i, true, (s.inputs >> i) & 1);
+  spMetricFloat(w, "Sensors/Temperature", SP_ALIAS_TEMPERATURE, true, s.temperature);
+  spMetricFloat(w, "Sensors/Humidity", SP_ALIAS_HUMIDITY, true, s.humidity);
+  spMetricUInt64(w, "System/Uptime", SP_ALIAS_UPTIME, true, s.uptimeMs);
+  spMetricString(w, "System/IP", SP_ALIAS_IP, true, s.ip);
+  spMetricBool(w, "Node Control/Rebirth", SP_ALIAS_REBIRTH, true, false);
+  return spFinish(w, seq);
+}
+
+// NDATA: alias seuls, métriques de c uniquement
+static inline size_t spEncodeData(uint8_t *buf, size_t cap, uint64_t timestamp, const SpNodeSnapshot &s,
+                                  const SpDataChanges &c, uint8_t seq) {
+  SpWriter w;
+  spBegin(w, buf, cap, timestamp);
+  for (int i = 0; i < 8; i++) {
+    if (c.relays & (1u << i)) spMetricBool(w, nullptr, SP_ALIAS_RELAY0 + i, false, (s.relays >> i) & 1);
+  }
+  for (int i = 0; i < 8; i++) {
+    if (c.inputs & (1u << i)) spMetricBool(w, nullptr, SP_ALIAS_INPUT0 + i, false, (s.inputs >> i) & 1);
+  }
+  if (c.temperature) spMetricFloat(w, nullptr, SP_ALIAS_TEMPERATURE, false, s.temperature);
+  if (c.humidity) spMetricFloat(w, nullptr, SP_ALIAS_HUMIDITY, false, s.humidity);
+  if (c.uptime) spMetricUInt64(w, nullptr, SP_ALIAS_UPTIME, false, s.uptimeMs);
+  return spFinish(w, seq);
+}
+
+// NDEATH (message de will): bdSeq seul, sans timestamp ni seq. Avec
+// bdSeq != 0 le payload ne contient aucun octet nul.
+static inline size_t spEncodeDeath(uint8_t *buf, size_t cap, uint8_t bdSeq) {
+  SpWriter w;
+  spBegin(w, buf, cap, 0);
+  spMetricUInt64(w, "bdSeq", 0, true, bdSeq);
+  return spFinish(w, 0, false);
+}
+
+// ----- Décodage NCMD -----
+struct SpReader {
+  const uint8_t *p;
+  const uint8_t *end;
+};
+
+static inline bool spGetVarint(SpReader &r, uint64_t &v) {
+  v = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (r.p >= r.end) return false;
+    uint8_t b = *r.p++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+static inline bool spSkip(SpReader &r, uint8_t wireType) {
+  uint64_t n;
+  switch (wireType) {
+    case 0: return spGetVarint(r, n);
+    case 1: n = 8; break;
+    case 2: if (!spGetVarint(r, n)) return false; break;
+    case 5: n = 4; break;
+    default: return false;
+  }
+  if ((uint64_t)(r.end - r.p) < n) return false;
+  r.p += n;
+  return true;
+}
+
+struct SpCommandMetric {
+  const char *name;      // non terminé par '\0'
+  size_t nameLen;
+  uint32_t alias;
+  bool hasValue;
+  uint64_t value;        // boolean_value / int_value / long_value
+};
+
+// Appelle onMetric(m) pour chaque métrique; false si le protobuf est invalide
+template <typename F>
+static inline bool spDecodeMetrics(const uint8_t *payload, size_t len, F onMetric) {
+  SpReader r = {payload, payload + len};
+  while (r.p < r.end) {
+    uint64_t key;
+    if (!spGetVarint(r, key)) return false;
+    uint32_t field = (uint32_t)(key >> 3);
+    uint8_t wt = (uint8_t)(key & 7);
+    if (field != 2 || wt != 2) {
+      if (!spSkip(r, wt)) return false;
+      continue;
+    }
+    uint64_t mlen;
+    if (!spGetVarint(r, mlen) || (uint64_t)(r.end - r.p) < mlen) return false;
+    SpReader m = {r.p, r.p + mlen};
+    r.p += mlen;
+
+    SpCommandMetric cm = {nullptr, 0, 0, false, 0};
+    while (m.p < m.end) {
+      uint64_t mk;
+      if (!spGetVarint(m, mk)) return false;
+      uint32_t mf = (uint32_t)(mk >> 3);
+      uint8_t mwt = (uint8_t)(mk & 7);
+      uint64_t v;
+      if (mf == 1 && mwt == 2) {
+        if (!spGetVarint(m, v) || (uint64_t)(m.end - m.p) < v) return false;
+        cm.name = (const char *)m.p;
+        cm.nameLen = (size_t)v;
+        m.p += v;
+      } else if (mf == 2 && mwt == 0) {
+        if (!spGetVarint(m, v)) return false;
+        cm.alias = (uint32_t)v;
+      } else if ((mf == 10 || mf == 11 || mf == 14) && mwt == 0) {
+        if (!spGetVarint(m, v)) return false;
+        cm.hasValue = true;
+        cm.value = v;
+      } else if (!spSkip(m, mwt)) {
+        return false;
+      }
+    }
+    onMetric(cm);
+  }
+  return true;
+}
+
+// NCMD: écritures de relais (par alias ou nom "Relays/N") et "Node Control/Rebirth".
+// rebirth passe à true si une renaissance est demandée.
+static inline MqttCmdResult spParseNcmd(const uint8_t *payload, size_t length, RelayCommand &cmd, bool &rebirth) {
+  bool bad = false;
+  bool any = false;
+  bool ok = spDecodeMetrics(payload, length, [&](const SpCommandMetric &m) {
+    int alias = (int)m.alias;
+    if (alias == 0 && m.name) {
+      if (m.nameLen == 8 && memcmp(m.name, "Relays/", 7) == 0 && m.name[7] >= '0' && m.name[7] <= '7') {
+        alias = SP_ALIAS_RELAY0 + (m.name[7] - '0');
+      } else if (m.nameLen == 20 && memcmp(m.name, "Node Control/Rebirth", 20) == 0) {
+        alias = SP_ALIAS_REBIRTH;
+      }
+    }
+    if (!m.hasValue) {
+      bad = true;
+      return;
+    }
+    if (alias >= SP_ALIAS_RELAY0 && alias < SP_ALIAS_RELAY0 + 8) {
+      uint8_t bit = (uint8_t)(1u << (alias - SP_ALIAS_RELAY0));
+      cmd.mask |= bit;
+      if (m.value) cmd.values |= bit;
+      else cmd.values &= (uint8_t)~bit;
+      any = true;
+    } else if (alias == SP_ALIAS_REBIRTH) {
+      if (m.value) rebirth = true;
+      any = true;
+    } else {
+      bad = true;
+    }
+  });
+  if (!ok) return MQTT_CMD_BAD_FORMAT;
+  if (bad && cmd.mask == 0) return MQTT_CMD_BAD_RELAY;
+  if (!any) return MQTT_CMD_EMPTY;
+  // Rebirth seul: pas d'écriture relais, mais commande valide
+  return MQTT_CMD_OK;
+}
+
+#endif // SPARKPLUG_H
@@ -0,0 +1,77 @@
+#ifndef STATUS_PAYLOAD_H
+#define STATUS_PAYLOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// ===== RENDU DES PAYLOADS DE STATUT (buffers fixes, sans heap) =====
+// Chaque fonction écrit dans buf (capacité cap) et retourne la longueur
+// écrite, ou 0 si le buffer est trop petit.
+
+// Ajoute une chaîne JSON échappée (avec guillemets)
+static inline size_t jsonAppendString(char *buf, size_t cap, size_t pos, const char *s) {
+  if (pos >= cap) return 0;
+  buf[pos++] = '"';
+  for (; *s; s++) {
+    char c = *s;
+    if (c == '"' || c == '\\') {
+      if (pos + 2 >= cap) return 0;
+      buf[pos++] = '\\';
+      buf[pos++] = c;
+    } else if ((unsigned char)c < 0x20) {
+      if (pos + 6 >= cap) return 0;
+      pos += (size_t)snprintf(buf + pos, cap - pos, "\\u%04x", (unsigned)c);
+    } else {
+      if (pos + 1 >= cap) return 0;
+      buf[pos++] = c;
+    }
+  }
+  if (pos + 1 >= cap) return 0;
+  buf[pos++] = '"';
+  buf[pos] = '\0';
+  return pos;
+}
+
+// [b0,b1,...,b7] (1 = bit actif)
+static inline size_t renderBitArray(char *buf, size_t cap, uint8_t mask) {
+  if (cap < 18) return 0;
+  size_t pos = 0;
+  buf[pos++] = '[';
+  for (int i = 0; i < 8; i++) {
+    if (i) buf[pos++] = ',';
+    buf[pos++] = ((mask >> i) & 1) ? '1' : '0';
+  }
+  buf[pos++] = ']';
+  buf[pos] = '\0';
+  return pos;
+}
+
+// {"label0":b0,...,"label7":b7}
+static inline size_t renderNamedBits(char *buf, size_t cap, const char labels[8][16], uint8_t mask) {
+  if (cap < 2) return 0;
+  size_t pos = 0;
+  buf[pos++] = '{';
+  for (int i = 0; i < 8; i++) {
+    if (i) {
+      if (pos + 1 >= cap) return 0;
+      buf[pos++] = ',';
+    }
+    pos = jsonAppendString(buf, cap, pos, labels[i]);
+    if (pos == 0 || pos + 3 >= cap) return 0;
+    buf[pos++] = ':';
+    buf[pos++] = ((mask >> i) & 1) ? '1' : '0';
+  }
+  if (pos + 1 >= cap) return 0;
+  buf[pos++] = '}';
+  buf[pos] = '\0';
+  return pos;
+}
+
+// "a.b.c.d" dans un buffer d'au moins 16 octets
+static inline size_t renderIp(char *buf, size_t cap, uint8_t a, uint8_t b, uint8_t c, uint8_t d) {
+  int n = snprintf(buf, cap, "%u.%u.%u.%u", a, b, c, d);
+  return (n > 0 && (size_t)n < cap) ? (size_t)n : 0;
+}
+
+#endif // STATUS_PAYLOAD_H
@@ -0,0 +1,138 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+// ===== ROUTAGE DES TOPICS MQTT ENTRANTS =====
+// Topics par relais:  <prefix>/relay/<n>/set   (n = 0..7)
+//                     <prefix>/relay/<label>/set
+// Le label est réduit en "slug" (minuscules, [a-z0-9_]) pour former un segment
+// de topic valide. Les slugs sont rangés dans une table de hachage ouverte
+// précalculée (reconstruite au changement de labels): résolution O(1), sans
+// String ni strcmp sur la liste des relais.
+// Topics sortants dérivés du préfixe, calculés au même moment:
+//                     <prefix>/relay/status_named, <prefix>/input/status_named
+
+#define TOPIC_ROUTER_SLOTS 32     // puissance de 2, >= 2 x 8 labels
+#define TOPIC_ROUTER_PREFIX_MAX 64
+#define TOPIC_SLUG_MAX 16
+#define TOPIC_NAMED_MAX (TOPIC_ROUTER_PREFIX_MAX + 20)
+
+enum TopicRoute : uint8_t {
+  TOPIC_ROUTE_NONE = 0,
+  TOPIC_ROUTE_RELAY_CMD,      // topic de commande historique (payload "N:on", JSON...)
+  TOPIC_ROUTE_RELAY_SET,      // <prefix>/relay/<n|label>/set
+};
+
+struct TopicRouter {
+  char prefix[TOPIC_ROUTER_PREFIX_MAX];
+  size_t prefixLen;
+  const char *legacyCmd;
+  size_t legacyCmdLen;
+  char relaySlug[8][TOPIC_SLUG_MAX];   // "" si le label ne peut pas servir d'alias
+  char inputSlug[8][TOPIC_SLUG_MAX];
+  char relayNamedTopic[TOPIC_NAMED_MAX];  // état + labels (JSON) des relais
+  char inputNamedTopic[TOPIC_NAMED_MAX];
+  uint32_t slotHash[TOPIC_ROUTER_SLOTS];
+  int8_t slotRelay[TOPIC_ROUTER_SLOTS];   // -1 = libre
+};
+
+static inline uint32_t topicHash(const char *p, size_t len) {
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)p[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+// "Salle de bain" -> "salle_de_bain"; "" si vide ou réduit à un index (0..7)
+static inline void topicSlugify(const char *label, char out[TOPIC_SLUG_MAX]) {
+  size_t n = 0;
+  for (const char *p = label; *p && n < TOPIC_SLUG_MAX - 1; p++) {
+    char c = *p;
+    if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+    if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-')) c = '_';
+    out[n++] = c;
+  }
+  out[n] = '\0';
+  if (n == 1 && out[0] >= '0' && out[0] <= '7') out[0] = '\0';
+}
+
+static inline void topicSlugTable(const char labels[8][16], char slugs[8][TOPIC_SLUG_MAX]) {
+  for (int i = 0; i < 8; i++) topicSlugify(labels[i], slugs[i]);
+  // Deux labels identiques: ambigus, aucun des deux ne sert d'alias
+  bool dup[8] = {false};
+  for (int i = 0; i < 8; i++) {
+    for (int j = i + 1; j < 8; j++) {
+      if (slugs[i][0] && strcmp(slugs[i], slugs[j]) == 0) dup[i] = dup[j] = true;
+    }
+  }
+  for (int i = 0; i < 8; i++) {
+    if (dup[i]) slugs[i][0] = '\0';
+  }
+}
+
+static inline void topicRouterBuild(TopicRouter &r, const char *prefix, const char *legacyCmd,
+                                    const char relayLabels[8][16], const char inputLabels[8][16]) {
+  strncpy(r.prefix, prefix, sizeof(r.prefix) - 1);
+  r.prefix[sizeof(r.prefix) - 1] = '\0';
+  r.prefixLen = strlen(r.prefix);
+  r.legacyCmd = legacyCmd;
+  r.legacyCmdLen = strlen(legacyCmd);
+  snprintf(r.relayNamedTopic, sizeof(r.relayNamedTopic), "%s/relay/status_named", r.prefix);
+  snprintf(r.inputNamedTopic, sizeof(r.inputNamedTopic), "%s/input/status_named", r.prefix);
+  topicSlugTable(relayLabels, r.relaySlug);
+  topicSlugTable(inputLabels, r.inputSlug);
+
+  for (int s = 0; s < TOPIC_ROUTER_SLOTS; s++) r.slotRelay[s] = -1;
+  for (int i = 0; i < 8; i++) {
+    size_t len = strlen(r.relaySlug[i]);
+    if (len == 0) continue;
+    uint32_t h = topicHash(r.relaySlug[i], len);
+    uint32_t s = h & (TOPIC_ROUTER_SLOTS - 1);
+    while (r.slotRelay[s] >= 0) s = (s + 1) & (TOPIC_ROUTER_SLOTS - 1);
+    r.slotHash[s] = h;
+    r.slotRelay[s] = (int8_t)i;
+  }
+}
+
+// Segment <n|label> -> index relais, -1 si inconnu
+static inline int topicRouterRelay(const TopicRouter &r, const char *seg, size_t len) {
+  if (len == 1 && seg[0] >= '0' && seg[0] <= '7') return seg[0] - '0';
+  if (len == 0 || len >= TOPIC_SLUG_MAX) return -1;
+  uint32_t h = topicHash(seg, len);
+  uint32_t s = h & (TOPIC_ROUTER_SLOTS - 1);
+  while (r.slotRelay[s] >= 0) {
+    int idx = r.slotRelay[s];
+    if (r.slotHash[s] == h && memcmp(r.relaySlug[idx], seg, len) == 0 && r.relaySlug[idx][len] == '\0') return idx;
+    s = (s + 1) & (TOPIC_ROUTER_SLOTS - 1);
+  }
+  return -1;
+}
+
+static inline TopicRoute topicRouterMatch(const TopicRouter &r, const char *topic, size_t len, int &relay) {
+  relay = -1;
+  if (len == r.legacyCmdLen && memcmp(topic, r.legacyCmd, len) == 0) return TOPIC_ROUTE_RELAY_CMD;
+
+  // <prefix>/relay/<seg>/set
+  static const char RELAY_PART[] = "/relay/";
+  static const char SET_PART[] = "/set";
+  const size_t relayPartLen = sizeof(RELAY_PART) - 1;
+  const size_t setPartLen = sizeof(SET_PART) - 1;
+  if (len <= r.prefixLen + relayPartLen + setPartLen) return TOPIC_ROUTE_NONE;
+  if (memcmp(topic, r.prefix, r.prefixLen) != 0) return TOPIC_ROUTE_NONE;
+  if (memcmp(topic + r.prefixLen, RELAY_PART, relayPartLen) != 0) return TOPIC_ROUTE_NONE;
+  if (memcmp(topic + len - setPartLen, SET_PART, setPartLen) != 0) return TOPIC_ROUTE_NONE;
+
+  const char *seg = topic + r.prefixLen + relayPartLen;
+  size_t segLen = len - r.prefixLen - relayPartLen - setPartLen;
+  if (memchr(seg, '/', segLen) != nullptr) return TOPIC_ROUTE_NONE;
+  relay = topicRouterRelay(r, seg, segLen);
+  return (relay >= 0) ? TOPIC_ROUTE_RELAY_SET : TOPIC_ROUTE_NONE;
+}
+
+#endif // TOPIC_ROUTER_H
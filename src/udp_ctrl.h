@@ -0,0 +1,453 @@
+#ifndef UDP_CTRL_H
+#define UDP_CTRL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ===== PROTOCOLE UDP BINAIRE: COMMANDES RELAIS + ÉTAT EN MULTICAST =====
+// Datagrammes de taille fixe, entiers en big-endian, authentifiés par
+// HMAC-SHA256 tronqué à 16 octets (clé partagée "udp_key").
+//
+//   0  'W' '8'      magique
+//   2  version      UDP_CTRL_VERSION
+//   3  type         CMD / ACK / STATE
+//   4  seq          uint32, strictement croissant par émetteur
+//   8  charge utile (selon le type)
+//   .. tag          HMAC(clé, octets 0..fin de la charge)[0..15]
+//
+// CMD   (client -> carte, unicast)  : masque, valeurs            -> 26 octets
+// ACK   (carte -> client, unicast)  : statut, relais, entrées    -> 27 octets
+// STATE (carte -> groupe multicast) : relais, entrées, cause, 0,
+//                                     temp x10, hum x10, uptime ms -> 36 octets
+// LINK  (carte -> carte, unicast)   : masque, valeurs, masque repli,
+//                                     valeurs repli, délai ms      -> 30 octets
+//       état voulu pour des relais distants, répété en battement de cœur;
+//       sans LINK pendant le délai, le récepteur applique le repli (ACK en retour)
+//
+// Anti-rejeu: la carte garde le dernier seq accepté de chacun de ses
+// UDP_CTRL_PEERS émetteurs (plancher). La table n'évince jamais: pleine, un
+// émetteur inconnu est refusé (ACK UDP_CTRL_FULL) jusqu'à son effacement.
+// Les planchers survivent au redémarrage (NVS, liés à la clé par keyTag):
+// écrits aussitôt pour un nouvel émetteur, sinon au plus toutes les
+// UDP_CTRL_SAVE_MS. Seules les trames acceptées dans ce délai avant une
+// coupure d'alimentation peuvent être rejouées une fois après. Un client doit
+// partir d'un seq croissant entre ses redémarrages (ex: secondes Unix << 12).
+// Aucune dépendance Arduino (même code côté hôte: voir tools/tests/udp_ctrl.py).
+
+#define UDP_CTRL_VERSION 1
+#define UDP_CTRL_HDR_LEN 8
+#define UDP_CTRL_TAG_LEN 16
+#define UDP_CTRL_CMD_LEN (UDP_CTRL_HDR_LEN + 2 + UDP_CTRL_TAG_LEN)
+#define UDP_CTRL_ACK_LEN (UDP_CTRL_HDR_LEN + 3 + UDP_CTRL_TAG_LEN)
+#define UDP_CTRL_STATE_LEN (UDP_CTRL_HDR_LEN + 12 + UDP_CTRL_TAG_LEN)
+#define UDP_CTRL_LINK_LEN (UDP_CTRL_HDR_LEN + 6 + UDP_CTRL_TAG_LEN)
+#define UDP_CTRL_MAX_LEN UDP_CTRL_STATE_LEN
+#define UDP_CTRL_KEY_MAX 64
+#define UDP_CTRL_PEERS 8
+#define UDP_CTRL_SAVE_MS 30000
+#define UDP_CTRL_FLOORS_MAGIC 0x31534655UL  // "UFS1" en mémoire
+
+enum UdpCtrlType : uint8_t {
+  UDP_CTRL_CMD = 1,
+  UDP_CTRL_ACK = 2,
+  UDP_CTRL_STATE = 3,
+  UDP_CTRL_LINK = 4,
+};
+
+enum UdpCtrlStatus : uint8_t {
+  UDP_CTRL_OK = 0,
+  UDP_CTRL_REPLAY = 1,              // seq <= dernier seq accepté de cet émetteur
+  UDP_CTRL_FULL = 2,                // émetteur inconnu, table des émetteurs pleine
+};
+
+enum UdpCtrlReason : uint8_t {
+  UDP_CTRL_PERIODIC = 0,
+  UDP_CTRL_CHANGE = 1,
+};
+
+struct UdpCtrlLink {
+  uint8_t mask;
+  uint8_t values;
+  uint8_t fsMask;                   // relais mis à fsValues si le lien tombe (les autres gardent leur état)
+  uint8_t fsValues;
+  uint16_t timeoutMs;
+};
+
+struct UdpCtrlState {
+  uint8_t relays;
+  uint8_t inputs;
+  uint8_t reason;
+  int16_t tempX10;                  // SENSOR_REGISTER_INVALID si indisponible
+  int16_t humX10;
+  uint32_t uptimeMs;
+};
+
+// ----- SHA-256 / HMAC (FIPS 180-4, RFC 2104) -----
+struct UdpSha256 {
+  uint32_t h[8];
+  uint8_t buf[64];
+  uint32_t bufLen;
+  uint64_t total;
+};
+
+static inline uint32_t udpRotr(uint32_t x, uint8_t n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+static inline void udpSha256Block(UdpSha256 &c, const uint8_t *p) {
+  static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+  uint32_t w[64];
+  for (uint8_t i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)p[4 * i] << 24) | ((uint32_t)p[4 * i + 1] << 16) | ((uint32_t)p[4 * i + 2] << 8) | p[4 * i + 3];
+  }
+  for (uint8_t i = 16; i < 64; i++) {
+    uint32_t s0 = udpRotr(w[i - 15], 7) ^ udpRotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = udpRotr(w[i - 2], 17) ^ udpRotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = c.h[0], b = c.h[1], cc = c.h[2], d = c.h[3], e = c.h[4], f = c.h[5], g = c.h[6], h = c.h[7];
+  for (uint8_t i = 0; i < 64; i++) {
+    uint32_t t1 = h + (udpRotr(e, 6) ^ udpRotr(e, 11) ^ udpRotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+    uint32_t t2 = (udpRotr(a, 2) ^ udpRotr(a, 13) ^ udpRotr(a, 22)) + ((a & b) ^ (a & cc) ^ (b & cc));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = cc;
+    cc = b;
+    b = a;
+    a = t1 + t2;
+  }
+  c.h[0] += a;
+  c.h[1] += b;
+  c.h[2] += cc;
+  c.h[3] += d;
+  c.h[4] += e;
+  c.h[5] += f;
+  c.h[6] += g;
+  c.h[7] += h;
+}
+
+static inline void udpSha256Init(UdpSha256 &c) {
+  static const uint32_t H0[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  memcpy(c.h, H0, sizeof(H0));
+  c.bufLen = 0;
+  c.total = 0;
+}
+
+static inline void udpSha256Update(UdpSha256 &c, const uint8_t *p, size_t len) {
+  c.total += len;
+  while (len > 0) {
+    size_t n = 64 - c.bufLen;
+    if (n > len) n = len;
+    memcpy(c.buf + c.bufLen, p, n);
+    c.bufLen += (uint32_t)n;
+    p += n;
+    len -= n;
+    if (c.bufLen == 64) {
+      udpSha256Block(c, c.buf);
+      c.bufLen = 0;
+    }
+  }
+}
+
+static inline void udpSha256Final(UdpSha256 &c, uint8_t out[32]) {
+  uint64_t bits = c.total * 8;
+  uint8_t pad = 0x80;
+  udpSha256Update(c, &pad, 1);
+  pad = 0;
+  while (c.bufLen != 56) udpSha256Update(c, &pad, 1);
+  uint8_t len[8];
+  for (uint8_t i = 0; i < 8; i++) len[i] = (uint8_t)(bits >> (56 - 8 * i));
+  udpSha256Update(c, len, 8);
+  for (uint8_t i = 0; i < 8; i++) {
+    out[4 * i] = (uint8_t)(c.h[i] >> 24);
+    out[4 * i + 1] = (uint8_t)(c.h[i] >> 16);
+    out[4 * i + 2] = (uint8_t)(c.h[i] >> 8);
+    out[4 * i + 3] = (uint8_t)c.h[i];
+  }
+}
+
+static inline void udpHmacSha256(const uint8_t *key, size_t keyLen, const uint8_t *msg, size_t len, uint8_t out[32]) {
+  uint8_t k[64];
+  memset(k, 0, sizeof(k));
+  UdpSha256 c;
+  if (keyLen > 64) {
+    udpSha256Init(c);
+    udpSha256Update(c, key, keyLen);
+    udpSha256Final(c, k);
+  } else {
+    memcpy(k, key, keyLen);
+  }
+  uint8_t pad[64];
+  for (uint8_t i = 0; i < 64; i++) pad[i] = k[i] ^ 0x36;
+  uint8_t inner[32];
+  udpSha256Init(c);
+  udpSha256Update(c, pad, 64);
+  udpSha256Update(c, msg, len);
+  udpSha256Final(c, inner);
+  for (uint8_t i = 0; i < 64; i++) pad[i] = k[i] ^ 0x5c;
+  udpSha256Init(c);
+  udpSha256Update(c, pad, 64);
+  udpSha256Update(c, inner, 32);
+  udpSha256Final(c, out);
+}
+
+// ----- Trames -----
+struct UdpCtrlPeer {
+  uint32_t addr;                    // IPv4 de l'émetteur (0 = libre)
+  uint32_t lastSeq;                 // plancher: dernier seq accepté
+};
+
+// Planchers tels qu'écrits en NVS
+struct UdpCtrlFloors {
+  uint32_t magic;
+  uint32_t keyTag;                  // autre clé: planchers ignorés
+  UdpCtrlPeer peers[UDP_CTRL_PEERS];
+};
+
+struct UdpCtrlStats {
+  uint32_t commands;
+  uint32_t badMac;                  // tag invalide ou clé absente: ignoré sans réponse
+  uint32_t replays;
+  uint32_t refused;                 // émetteurs inconnus refusés (table pleine)
+  uint32_t malformed;
+  uint32_t statesSent;
+};
+
+struct UdpCtrl {
+  uint8_t key[UDP_CTRL_KEY_MAX];
+  uint8_t keyLen;
+  uint32_t txSeq;                   // seq des STATE émis (les ACK reprennent le seq de la commande)
+  UdpCtrlPeer peers[UDP_CTRL_PEERS];
+  uint32_t keyTag;
+  bool floorsDirty;                 // planchers modifiés depuis la dernière écriture
+  uint32_t floorsDirtyMs;
+  UdpCtrlStats stats;
+};
+
+static inline void udpCtrlInit(UdpCtrl &u, const char *key, uint32_t seqSeed) {
+  memset(&u, 0, sizeof(u));
+  size_t n = key ? strlen(key) : 0;
+  if (n > UDP_CTRL_KEY_MAX) n = UDP_CTRL_KEY_MAX;
+  if (n > 0) memcpy(u.key, key, n);
+  u.keyLen = (uint8_t)n;
+  u.txSeq = seqSeed;
+  uint8_t mac[32];
+  udpHmacSha256(u.key, u.keyLen, (const uint8_t *)"udp-floors", 10, mac);
+  u.keyTag = ((uint32_t)mac[0] << 24) | ((uint32_t)mac[1] << 16) | ((uint32_t)mac[2] << 8) | mac[3];
+}
+
+static inline void udpCtrlPut16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static inline void udpCtrlPut32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static inline uint16_t udpCtrlGet16(const uint8_t *p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t udpCtrlGet32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// En-tête + tag autour d'une charge déjà écrite à out + UDP_CTRL_HDR_LEN
+static inline size_t udpCtrlSeal(const UdpCtrl &u, uint8_t type, uint32_t seq, uint8_t *out, size_t payloadLen) {
+  out[0] = 'W';
+  out[1] = '8';
+  out[2] = UDP_CTRL_VERSION;
+  out[3] = type;
+  udpCtrlPut32(out + 4, seq);
+  size_t len = UDP_CTRL_HDR_LEN + payloadLen;
+  uint8_t mac[32];
+  udpHmacSha256(u.key, u.keyLen, out, len, mac);
+  memcpy(out + len, mac, UDP_CTRL_TAG_LEN);
+  return len + UDP_CTRL_TAG_LEN;
+}
+
+// Vérifie magique, version, type, longueur et tag (comparaison en temps constant)
+static inline bool udpCtrlOpen(const UdpCtrl &u, uint8_t type, const uint8_t *in, size_t len, size_t expectLen) {
+  if (len != expectLen || in[0] != 'W' || in[1] != '8' || in[2] != UDP_CTRL_VERSION || in[3] != type) return false;
+  if (u.keyLen == 0) return false;
+  uint8_t mac[32];
+  udpHmacSha256(u.key, u.keyLen, in, len - UDP_CTRL_TAG_LEN, mac);
+  uint8_t diff = 0;
+  for (uint8_t i = 0; i < UDP_CTRL_TAG_LEN; i++) diff |= (uint8_t)(mac[i] ^ in[len - UDP_CTRL_TAG_LEN + i]);
+  return diff == 0;
+}
+
+static inline size_t udpCtrlEncodeCmd(const UdpCtrl &u, uint32_t seq, uint8_t mask, uint8_t values, uint8_t *out) {
+  out[UDP_CTRL_HDR_LEN] = mask;
+  out[UDP_CTRL_HDR_LEN + 1] = values;
+  return udpCtrlSeal(u, UDP_CTRL_CMD, seq, out, 2);
+}
+
+static inline size_t udpCtrlEncodeAck(UdpCtrl &u, uint32_t cmdSeq, uint8_t status, uint8_t relays, uint8_t inputs, uint8_t *out) {
+  out[UDP_CTRL_HDR_LEN] = status;
+  out[UDP_CTRL_HDR_LEN + 1] = relays;
+  out[UDP_CTRL_HDR_LEN + 2] = inputs;
+  return udpCtrlSeal(u, UDP_CTRL_ACK, cmdSeq, out, 3);
+}
+
+static inline size_t udpCtrlEncodeState(UdpCtrl &u, const UdpCtrlState &st, uint8_t *out) {
+  uint8_t *p = out + UDP_CTRL_HDR_LEN;
+  p[0] = st.relays;
+  p[1] = st.inputs;
+  p[2] = st.reason;
+  p[3] = 0;
+  udpCtrlPut16(p + 4, (uint16_t)st.tempX10);
+  udpCtrlPut16(p + 6, (uint16_t)st.humX10);
+  udpCtrlPut32(p + 8, st.uptimeMs);
+  u.stats.statesSent++;
+  return udpCtrlSeal(u, UDP_CTRL_STATE, ++u.txSeq, out, 12);
+}
+
+static inline bool udpCtrlDecodeState(const UdpCtrl &u, const uint8_t *in, size_t len, uint32_t &seq, UdpCtrlState &st) {
+  if (!udpCtrlOpen(u, UDP_CTRL_STATE, in, len, UDP_CTRL_STATE_LEN)) return false;
+  const uint8_t *p = in + UDP_CTRL_HDR_LEN;
+  seq = udpCtrlGet32(in + 4);
+  st.relays = p[0];
+  st.inputs = p[1];
+  st.reason = p[2];
+  st.tempX10 = (int16_t)udpCtrlGet16(p + 4);
+  st.humX10 = (int16_t)udpCtrlGet16(p + 6);
+  st.uptimeMs = udpCtrlGet32(p + 8);
+  return true;
+}
+
+static inline size_t udpCtrlEncodeLink(const UdpCtrl &u, uint32_t seq, const UdpCtrlLink &l, uint8_t *out) {
+  uint8_t *p = out + UDP_CTRL_HDR_LEN;
+  p[0] = l.mask;
+  p[1] = l.values;
+  p[2] = l.fsMask;
+  p[3] = l.fsValues;
+  udpCtrlPut16(p + 4, l.timeoutMs);
+  return udpCtrlSeal(u, UDP_CTRL_LINK, seq, out, 6);
+}
+
+static inline bool udpCtrlDecodeLink(const UdpCtrl &u, const uint8_t *in, size_t len, uint32_t &seq, UdpCtrlLink &l) {
+  if (!udpCtrlOpen(u, UDP_CTRL_LINK, in, len, UDP_CTRL_LINK_LEN)) return false;
+  const uint8_t *p = in + UDP_CTRL_HDR_LEN;
+  seq = udpCtrlGet32(in + 4);
+  l.mask = p[0];
+  l.values = p[1];
+  l.fsMask = p[2];
+  l.fsValues = p[3];
+  l.timeoutMs = udpCtrlGet16(p + 4);
+  return true;
+}
+
+static inline bool udpCtrlDecodeAck(const UdpCtrl &u, const uint8_t *in, size_t len, uint32_t &seq, uint8_t &status,
+                                    uint8_t &relays, uint8_t &inputs) {
+  if (!udpCtrlOpen(u, UDP_CTRL_ACK, in, len, UDP_CTRL_ACK_LEN)) return false;
+  seq = udpCtrlGet32(in + 4);
+  status = in[UDP_CTRL_HDR_LEN];
+  relays = in[UDP_CTRL_HDR_LEN + 1];
+  inputs = in[UDP_CTRL_HDR_LEN + 2];
+  return true;
+}
+
+// Type d'un datagramme reçu (0 si ce n'est pas une trame de ce protocole)
+static inline uint8_t udpCtrlType(const uint8_t *in, size_t len) {
+  if (len < UDP_CTRL_HDR_LEN || in[0] != 'W' || in[1] != '8' || in[2] != UDP_CTRL_VERSION) return 0;
+  return in[3];
+}
+
+// Anti-rejeu: UDP_CTRL_OK si seq est nouveau pour cet émetteur (et le
+// mémorise), UDP_CTRL_REPLAY sinon, UDP_CTRL_FULL pour un émetteur inconnu
+// quand la table est pleine
+static inline uint8_t udpCtrlAcceptSeq(UdpCtrl &u, uint32_t addr, uint32_t seq, uint32_t nowMs) {
+  UdpCtrlPeer *slot = nullptr;
+  for (uint8_t i = 0; i < UDP_CTRL_PEERS && !slot; i++) {
+    if (u.peers[i].addr == addr) slot = &u.peers[i];
+  }
+  if (slot && seq <= slot->lastSeq) return UDP_CTRL_REPLAY;
+  if (!slot) {
+    for (uint8_t i = 0; i < UDP_CTRL_PEERS && !slot; i++) {
+      if (u.peers[i].addr == 0) slot = &u.peers[i];
+    }
+    if (!slot) return UDP_CTRL_FULL;
+    slot->addr = addr;
+    // Nouvel émetteur: plancher écrit au prochain passage
+    u.floorsDirty = true;
+    u.floorsDirtyMs = nowMs - UDP_CTRL_SAVE_MS;
+  } else if (!u.floorsDirty) {
+    u.floorsDirty = true;
+    u.floorsDirtyMs = nowMs;
+  }
+  slot->lastSeq = seq;
+  return UDP_CTRL_OK;
+}
+
+// ----- Planchers persistants -----
+static inline bool udpCtrlFloorsDue(const UdpCtrl &u, uint32_t nowMs) {
+  return u.floorsDirty && nowMs - u.floorsDirtyMs >= UDP_CTRL_SAVE_MS;
+}
+
+static inline void udpCtrlExportFloors(const UdpCtrl &u, UdpCtrlFloors &f) {
+  f.magic = UDP_CTRL_FLOORS_MAGIC;
+  f.keyTag = u.keyTag;
+  memcpy(f.peers, u.peers, sizeof(f.peers));
+}
+
+// Au démarrage, après udpCtrlInit(). false si absent, tronqué ou d'une autre clé.
+static inline bool udpCtrlImportFloors(UdpCtrl &u, const UdpCtrlFloors &f, size_t len) {
+  if (len != sizeof(f) || f.magic != UDP_CTRL_FLOORS_MAGIC || f.keyTag != u.keyTag) return false;
+  memcpy(u.peers, f.peers, sizeof(u.peers));
+  return true;
+}
+
+// Libère la table (commande "udp forget"): écrite au prochain passage
+static inline void udpCtrlForgetPeers(UdpCtrl &u, uint32_t nowMs) {
+  memset(u.peers, 0, sizeof(u.peers));
+  u.floorsDirty = true;
+  u.floorsDirtyMs = nowMs - UDP_CTRL_SAVE_MS;
+}
+
+static inline uint8_t udpCtrlPeerCount(const UdpCtrl &u) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < UDP_CTRL_PEERS; i++) n += u.peers[i].addr != 0;
+  return n;
+}
+
+// Datagramme reçu sur le port de commande. true si un ACK doit être renvoyé
+// (statut dans status); mask/values à appliquer si status == UDP_CTRL_OK.
+// Tag invalide: false, aucune réponse.
+static inline bool udpCtrlHandleCmd(UdpCtrl &u, uint32_t addr, const uint8_t *in, size_t len, uint32_t nowMs,
+                                    uint32_t &seq, uint8_t &status, uint8_t &mask, uint8_t &values) {
+  if (len < UDP_CTRL_HDR_LEN || in[0] != 'W' || in[1] != '8') {
+    u.stats.malformed++;
+    return false;
+  }
+  if (!udpCtrlOpen(u, UDP_CTRL_CMD, in, len, UDP_CTRL_CMD_LEN)) {
+    u.stats.badMac++;
+    return false;
+  }
+  seq = udpCtrlGet32(in + 4);
+  mask = in[UDP_CTRL_HDR_LEN];
+  values = in[UDP_CTRL_HDR_LEN + 1];
+  status = udpCtrlAcceptSeq(u, addr, seq, nowMs);
+  if (status == UDP_CTRL_REPLAY) u.stats.replays++;
+  if (status == UDP_CTRL_FULL) u.stats.refused++;
+  if (status == UDP_CTRL_OK) u.stats.commands++;
+  return true;
+}
+
+#endif // UDP_CTRL_H
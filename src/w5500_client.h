@@ -0,0 +1,322 @@
+#ifndef W5500_CLIENT_H
+#define W5500_CLIENT_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Ethernet.h>
+#include <utility/w5100.h>
+#include "w5500_spi.h"
+
+// ===== CLIENT TCP W5500 À CONNEXION NON BLOQUANTE =====
+// EthernetClient::connect() boucle jusqu'à ESTABLISHED ou timeout (bloque loop()
+// quand le broker est injoignable). Ce client pilote directement les registres
+// socket du W5500: beginConnect() envoie le SYN et rend la main, l'appelant
+// interroge socketStatus() depuis loop(). Une fois connecté, il s'utilise comme
+// n'importe quel Client (PubSubClient via setClient()).
+// Écriture: SEND émis sans attendre SEND_OK (attendu seulement avant le SEND
+// suivant). cork()/uncork() regroupent plusieurs write() en un seul SEND.
+// attach() reprend l'émission d'un socket ouvert par la lib Ethernet (réponses
+// HTTP): buffers copiés en rafales SPI (w5500_spi.h).
+// discardNextWrite(): le write() suivant est accepté sans rien émettre (CONNECT
+// de PubSubClient, déjà écrit par l'appelant: voir mqtt_packet.h).
+
+class W5500AsyncClient : public Client {
+public:
+  W5500AsyncClient() : sock(MAX_SOCK_NUM), corked(false), unsent(0), sendInFlight(false), discardWrite(false) {}
+
+  // Ouvre un socket libre et envoie le SYN. false si aucun socket disponible.
+  bool beginConnect(IPAddress ip, uint16_t port) {
+    stop();
+    if (ip == IPAddress((uint32_t)0) || ip == IPAddress((uint32_t)0xFFFFFFFF)) return false;
+
+    w5500SpiBeginTransaction();
+    uint8_t s = MAX_SOCK_NUM;
+    for (uint8_t i = 0; i < MAX_SOCK_NUM; i++) {
+      if (W5100.readSnSR(i) == SnSR::CLOSED) {
+        s = i;
+        break;
+      }
+    }
+    if (s == MAX_SOCK_NUM) {
+      SPI.endTransaction();
+      return false;
+    }
+    // Le socket a pu servir à EthernetServer: ne plus le considérer comme socket d'écoute
+    EthernetServer::server_port[s] = 0;
+    W5100.writeSnMR(s, SnMR::TCP);
+    W5100.writeSnIR(s, 0xFF);
+    W5100.writeSnPORT(s, nextLocalPort());
+    W5100.execCmdSn(s, Sock_OPEN);
+    uint8_t addr[4] = {ip[0], ip[1], ip[2], ip[3]};
+    W5100.writeSnDIPR(s, addr);
+    W5100.writeSnDPORT(s, port);
+    W5100.execCmdSn(s, Sock_CONNECT);
+    SPI.endTransaction();
+
+    sock = s;
+    corked = false;
+    unsent = 0;
+    sendInFlight = false;
+    discardWrite = false;
+    return true;
+  }
+
+  // Émission sur un socket déjà établi (ex: EthernetClient accepté par un serveur).
+  // Côté réception, la lib garde un état local: ne lire que via EthernetClient.
+  void attach(uint8_t s) {
+    sock = s;
+    corked = false;
+    unsent = 0;
+    sendInFlight = false;
+  }
+
+  // Rend le socket à son propriétaire sans le fermer (après flushSend())
+  void detach() {
+    sock = MAX_SOCK_NUM;
+    corked = false;
+    unsent = 0;
+    sendInFlight = false;
+  }
+
+  // Émet ce qui reste et attend le dernier SEND_OK (SEND_OK acquitté: la lib
+  // Ethernet ne le confond pas avec le sien au write() suivant)
+  bool flushSend(uint32_t timeoutMs) {
+    if (!uncork()) return false;
+    uint32_t start = millis();
+    while (!sendIdle()) {
+      if (socketStatus() == SnSR::CLOSED || millis() - start > timeoutMs) return false;
+      yield();
+    }
+    return true;
+  }
+
+  void discardNextWrite() { discardWrite = true; }
+
+  // Accumule les write() suivants dans le buffer TX sans émettre de SEND
+  void cork() { corked = true; }
+
+  // Émet en un seul SEND tout ce qui a été écrit depuis cork()
+  bool uncork() {
+    corked = false;
+    if (sock >= MAX_SOCK_NUM || unsent == 0) return true;
+    w5500SpiBeginTransaction();
+    bool ok = issueSend();
+    SPI.endTransaction();
+    return ok;
+  }
+
+  // Place libre dans le buffer TX du socket (données non émises comprises)
+  uint16_t txFree() {
+    if (sock >= MAX_SOCK_NUM) return 0;
+    w5500SpiBeginTransaction();
+    uint16_t n = txFreeLocked();
+    SPI.endTransaction();
+    return n;
+  }
+
+  // true quand tout ce qui a été émis est acquitté (SEND_OK)
+  bool sendIdle() {
+    if (sock >= MAX_SOCK_NUM) return true;
+    if (unsent > 0) return false;
+    if (!sendInFlight) return true;
+    w5500SpiBeginTransaction();
+    if (W5100.readSnIR(sock) & SnIR::SEND_OK) {
+      W5100.writeSnIR(sock, SnIR::SEND_OK);
+      sendInFlight = false;
+    }
+    SPI.endTransaction();
+    return !sendInFlight;
+  }
+
+  // Registre Sn_SR (SnSR::CLOSED si aucun socket)
+  uint8_t socketStatus() {
+    if (sock >= MAX_SOCK_NUM) return SnSR::CLOSED;
+    w5500SpiBeginTransaction();
+    uint8_t st = W5100.readSnSR(sock);
+    SPI.endTransaction();
+    return st;
+  }
+
+  uint8_t socketNumber() const { return sock; }
+
+  // ----- Interface Client -----
+  int connect(IPAddress ip, uint16_t port) override {
+    // Utilisé seulement si quelqu'un appelle connect() directement: on démarre la
+    // connexion; connected() deviendra vrai à l'ESTABLISHED.
+    return beginConnect(ip, port) ? 1 : 0;
+  }
+
+  int connect(const char *host, uint16_t port) override {
+    (void)host;
+    (void)port;
+    return 0;  // pas de résolution DNS ici (le broker est configuré par IP)
+  }
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+
+  size_t write(const uint8_t *buf, size_t size) override {
+    if (sock >= MAX_SOCK_NUM) return 0;
+    if (discardWrite) {
+      discardWrite = false;
+      return size;
+    }
+    size_t sent = 0;
+    uint32_t start = millis();
+    w5500SpiBeginTransaction();
+    while (sent < size) {
+      uint8_t st = W5100.readSnSR(sock);
+      if (st != SnSR::ESTABLISHED && st != SnSR::CLOSE_WAIT) break;
+      uint16_t freeSize = txFreeLocked();
+      if (freeSize == 0) {
+        // Buffer plein: émettre ce qui attend et laisser le W5500 vider
+        if (unsent > 0 && !issueSend()) break;
+        if (millis() - start > WRITE_TIMEOUT_MS) break;
+        SPI.endTransaction();
+        yield();
+        w5500SpiBeginTransaction();
+        continue;
+      }
+      uint16_t n = (size - sent < freeSize) ? (uint16_t)(size - sent) : freeSize;
+      uint16_t ptr = W5100.readSnTX_WR(sock);
+      w5500TxWrite(sock, ptr, buf + sent, n);
+      W5100.writeSnTX_WR(sock, (uint16_t)(ptr + n));
+      unsent += n;
+      sent += n;
+      if (!corked && !issueSend()) break;
+    }
+    SPI.endTransaction();
+    return sent;
+  }
+
+  int available() override {
+    if (sock >= MAX_SOCK_NUM) return 0;
+    w5500SpiBeginTransaction();
+    uint16_t n = readRxSize();
+    SPI.endTransaction();
+    return n;
+  }
+
+  int read() override {
+    uint8_t b;
+    return (read(&b, 1) == 1) ? b : -1;
+  }
+
+  int read(uint8_t *buf, size_t size) override {
+    if (sock >= MAX_SOCK_NUM || size == 0) return -1;
+    w5500SpiBeginTransaction();
+    uint16_t n = readRxSize();
+    if (n == 0) {
+      SPI.endTransaction();
+      return -1;
+    }
+    if (n > size) n = (uint16_t)size;
+    uint16_t ptr = W5100.readSnRX_RD(sock);
+    // W5500: adressage par offset, pas de gestion de rebouclage nécessaire
+    w5500RxRead(sock, ptr, buf, n);
+    W5100.writeSnRX_RD(sock, (uint16_t)(ptr + n));
+    W5100.execCmdSn(sock, Sock_RECV);
+    SPI.endTransaction();
+    return n;
+  }
+
+  int peek() override {
+    if (sock >= MAX_SOCK_NUM) return -1;
+    w5500SpiBeginTransaction();
+    int b = -1;
+    if (readRxSize() > 0) {
+      uint8_t v;
+      uint16_t ptr = W5100.readSnRX_RD(sock);
+      w5500RxRead(sock, ptr, &v, 1);
+      b = v;
+    }
+    SPI.endTransaction();
+    return b;
+  }
+
+  void flush() override {}
+
+  // Fermeture sans attente: FIN envoyé, le W5500 termine seul la fermeture
+  void stop() override {
+    if (sock >= MAX_SOCK_NUM) return;
+    w5500SpiBeginTransaction();
+    uint8_t st = W5100.readSnSR(sock);
+    if (st == SnSR::ESTABLISHED || st == SnSR::CLOSE_WAIT) {
+      W5100.execCmdSn(sock, Sock_DISCON);
+    } else if (st != SnSR::CLOSED) {
+      W5100.execCmdSn(sock, Sock_CLOSE);
+    }
+    W5100.writeSnIR(sock, 0xFF);
+    SPI.endTransaction();
+    sock = MAX_SOCK_NUM;
+    corked = false;
+    unsent = 0;
+    sendInFlight = false;
+    discardWrite = false;
+  }
+
+  uint8_t connected() override {
+    if (sock >= MAX_SOCK_NUM) return 0;
+    uint8_t st = socketStatus();
+    if (st == SnSR::ESTABLISHED) return 1;
+    if (st == SnSR::CLOSE_WAIT) return available() > 0;
+    return 0;
+  }
+
+  operator bool() override { return sock < MAX_SOCK_NUM; }
+
+private:
+  static const uint32_t WRITE_TIMEOUT_MS = 1000;
+  uint8_t sock;
+  bool corked;
+  uint16_t unsent;       // octets écrits dans le buffer TX, SEND pas encore émis
+  bool sendInFlight;     // SEND émis, SEND_OK pas encore vu
+  bool discardWrite;     // write() suivant écarté (discardNextWrite)
+
+  static uint16_t nextLocalPort() {
+    static uint16_t port = 49152;
+    if (++port < 49152) port = 49152;
+    return port;
+  }
+
+  // Sn_RX_RSR / Sn_TX_FSR: relire jusqu'à valeur stable (recommandation WIZnet)
+  uint16_t readRxSize() {
+    uint16_t a, b = W5100.readSnRX_RSR(sock);
+    do {
+      a = b;
+      b = W5100.readSnRX_RSR(sock);
+    } while (a != b);
+    return a;
+  }
+
+  // Taille - (TX_WR - TX_RD): inclut les octets écrits mais pas encore émis
+  uint16_t txFreeLocked() {
+    uint16_t rd = W5100.readSnTX_RD(sock);
+    uint16_t wr = W5100.readSnTX_WR(sock);
+    return (uint16_t)(W5100.SSIZE - (uint16_t)(wr - rd));
+  }
+
+  // Un seul SEND à la fois: attend le SEND_OK du précédent (déjà reçu en
+  // général, l'attente ne dure au plus qu'un aller-retour réseau).
+  bool issueSend() {
+    if (sendInFlight) {
+      uint32_t start = millis();
+      while (!(W5100.readSnIR(sock) & SnIR::SEND_OK)) {
+        uint8_t ir = W5100.readSnIR(sock);
+        if ((ir & SnIR::TIMEOUT) || W5100.readSnSR(sock) == SnSR::CLOSED || millis() - start > WRITE_TIMEOUT_MS) {
+          W5100.writeSnIR(sock, SnIR::TIMEOUT);
+          sendInFlight = false;
+          unsent = 0;
+          return false;
+        }
+        yield();
+      }
+      W5100.writeSnIR(sock, SnIR::SEND_OK);
+    }
+    W5100.execCmdSn(sock, Sock_SEND);
+    sendInFlight = true;
+    unsent = 0;
+    return true;
+  }
+};
+
+#endif // W5500_CLIENT_H
@@ -0,0 +1,72 @@
+#ifndef W5500_IRQ_H
+#define W5500_IRQ_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Ethernet.h>
+#include <utility/w5100.h>
+#include "w5500_spi.h"
+
+// ===== INTERRUPTIONS SOCKET W5500 (broche INTn -> ETH_IRQ_PIN) =====
+// Le W5500 tient INTn bas tant qu'un bit Sn_IR non masqué est à 1. Seuls
+// CON / DISCON / RECV sont démasqués: SEND_OK et TIMEOUT restent réservés aux
+// boucles d'envoi de la lib Ethernet et de W5500AsyncClient, qui les lisent
+// et les acquittent elles-mêmes.
+// L'ISR ne fait que lever un drapeau; loop() lit SIR, acquitte les sockets
+// signalés et ne sert que les sous-systèmes concernés.
+//
+// Registres accédés par adresse brute (W5100Class::read/write): la lib
+// Ethernet nomme les registres communs aux adresses du W5100.
+
+#define W5500_REG_SIR 0x0017              // Socket Interrupt (1 bit par socket)
+#define W5500_REG_SIMR 0x0018             // Socket Interrupt Mask
+#define W5500_SN_IR 0x0002
+#define W5500_SN_IMR 0x002C
+#define W5500_SN_REG(s, r) ((uint16_t)(0x1000 + (s) * 0x100 + (r)))
+#define W5500_IRQ_EVENTS (SnIR::CON | SnIR::DISCON | SnIR::RECV)
+
+// Démasque CON/DISCON/RECV sur tous les sockets (à refaire après un reset W5500)
+static inline void w5500IrqEnable() {
+  w5500SpiBeginTransaction();
+  for (uint8_t s = 0; s < MAX_SOCK_NUM; s++) {
+    W5100.write(W5500_SN_REG(s, W5500_SN_IMR), (uint8_t)W5500_IRQ_EVENTS);
+    W5100.write(W5500_SN_REG(s, W5500_SN_IR), (uint8_t)W5500_IRQ_EVENTS);
+  }
+  W5100.write(W5500_REG_SIMR, (uint8_t)((1u << MAX_SOCK_NUM) - 1));
+  SPI.endTransaction();
+}
+
+// Lit et acquitte les événements en attente. Retourne le masque des sockets
+// signalés; conMask = sockets ayant reçu une connexion (CON).
+static inline uint8_t w5500IrqCollect(uint8_t &conMask) {
+  conMask = 0;
+  w5500SpiBeginTransaction();
+  uint8_t sir = W5100.read(W5500_REG_SIR);
+  for (uint8_t s = 0; s < MAX_SOCK_NUM; s++) {
+    if (!(sir & (1u << s))) continue;
+    uint8_t ir = W5100.read(W5500_SN_REG(s, W5500_SN_IR)) & W5500_IRQ_EVENTS;
+    if (ir == 0) continue;
+    W5100.write(W5500_SN_REG(s, W5500_SN_IR), ir);
+    if (ir & SnIR::CON) conMask |= (uint8_t)(1u << s);
+  }
+  SPI.endTransaction();
+  return sir;
+}
+
+// ----- Compteur de transactions SPI -----
+// Avec -Wl,--wrap=_ZN8SPIClass16beginTransactionE11SPISettings (platformio.ini),
+// chaque SPI.beginTransaction() de la lib Ethernet (linkStatus(), parsePacket(),
+// lectures EthernetClient...) et du firmware passe ici: /api/status
+// w5500.spi_per_s mesure toute la charge du bus. Comptage seul: les réglages
+// sont transmis tels quels (la lib garde ses 14 MHz).
+// Sans l'option, la fonction n'est jamais appelée et --gc-sections l'écarte
+// avec sa référence à __real_ (compteur à 0).
+volatile uint32_t spiTransactionCount = 0;
+
+extern "C" void __real__ZN8SPIClass16beginTransactionE11SPISettings(SPIClass *spi, SPISettings settings);
+extern "C" void __wrap__ZN8SPIClass16beginTransactionE11SPISettings(SPIClass *spi, SPISettings settings) {
+  spiTransactionCount = spiTransactionCount + 1;
+  __real__ZN8SPIClass16beginTransactionE11SPISettings(spi, settings);
+}
+
+#endif // W5500_IRQ_H
@@ -0,0 +1,77 @@
+#ifndef W5500_SPI_H
+#define W5500_SPI_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <string.h>
+
+// ===== ACCÈS SPI RAPIDE AUX BUFFERS SOCKET DU W5500 =====
+// La lib Ethernet copie les buffers TX octet par octet (SPI.transfer(uint8_t)
+// sans SPI_HAS_TRANSFER_BUF sur ESP32) à 14 MHz. Ici: une trame W5500
+// (adresse + contrôle) puis les données en rafales de 64 octets, la taille de
+// la FIFO SPI de l'ESP32-S3, sans intervention par octet.
+//
+// Horloge: les broches du W5500 (13..16) passent par la matrice GPIO, ce qui
+// limite la lecture à APB/3 = 26,7 MHz. Les accès du firmware (buffers
+// socket, registres, interruptions) ouvrent leur transaction avec
+// W5500_SPI_SETTINGS via w5500SpiBeginTransaction(). Ceux de la lib Ethernet
+// restent à SPI_ETHERNET_SETTINGS (14 MHz): la lib 2.0 le définit sans
+// #ifndef et W5100Class::init() ne prend pas de réglages.
+
+#define W5500_SPI_HZ (80000000UL / 3)
+#define W5500_SPI_SETTINGS SPISettings(W5500_SPI_HZ, MSBFIRST, SPI_MODE0)
+#define W5500_SPI_CHUNK 64
+
+// Octet de contrôle: BSB (bloc) << 3 | RWB << 2 | mode VDM
+#define W5500_CTRL_TX(s) ((uint8_t)(((s) << 5) | 0x10 | 0x04))
+#define W5500_CTRL_RX(s) ((uint8_t)(((s) << 5) | 0x18))
+
+static uint8_t w5500CsPin = 0xFF;
+
+// Transaction du firmware (comptée avec celles de la lib, voir w5500_irq.h)
+static inline void w5500SpiBeginTransaction() {
+  SPI.beginTransaction(W5500_SPI_SETTINGS);
+}
+
+static inline void w5500SpiBegin(uint8_t csPin) {
+  w5500CsPin = csPin;
+}
+
+// Trame à longueur variable; à appeler dans une transaction SPI ouverte.
+// Passage par un tampon aligné: les routines FIFO de l'ESP32 lisent et
+// écrivent par mots de 32 bits.
+static inline void w5500SpiFrame(uint16_t addr, uint8_t ctrl, const uint8_t *out, uint8_t *in, size_t len) {
+  uint32_t chunk[W5500_SPI_CHUNK / 4];
+  uint8_t *c = (uint8_t *)chunk;
+  c[0] = (uint8_t)(addr >> 8);
+  c[1] = (uint8_t)addr;
+  c[2] = ctrl;
+  digitalWrite(w5500CsPin, LOW);
+  SPI.writeBytes(c, 3);
+  while (len > 0) {
+    size_t n = (len < W5500_SPI_CHUNK) ? len : W5500_SPI_CHUNK;
+    if (out) {
+      memcpy(c, out, n);
+      SPI.writeBytes(c, (uint32_t)n);
+      out += n;
+    } else {
+      SPI.transferBytes(nullptr, c, (uint32_t)n);
+      memcpy(in, c, n);
+      in += n;
+    }
+    len -= n;
+  }
+  digitalWrite(w5500CsPin, HIGH);
+}
+
+// Adressage par offset: le W5500 reboucle lui-même dans le buffer du socket,
+// ptr est la valeur brute de Sn_TX_WR / Sn_RX_RD.
+static inline void w5500TxWrite(uint8_t s, uint16_t ptr, const uint8_t *buf, size_t len) {
+  w5500SpiFrame(ptr, W5500_CTRL_TX(s), buf, nullptr, len);
+}
+
+static inline void w5500RxRead(uint8_t s, uint16_t ptr, uint8_t *buf, size_t len) {
+  w5500SpiFrame(ptr, W5500_CTRL_RX(s), nullptr, buf, len);
+}
+
+#endif // W5500_SPI_H
@@ -5,6 +5,11 @@
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
 #include <Preferences.h>
+#include "sensor_report.h"
+#include "mqtt_queue.h"
+#include "config_blob.h"
+#include "config_schema.h"
+#include "config_store.h"
 
 #ifndef SPIFFS_AUTO_FORMAT_ONCE
 #define SPIFFS_AUTO_FORMAT_ONCE 0
@@ -26,16 +31,50 @@ extern char topicRelayStatus[100];
 extern char topicInputStatus[100];
 extern char topicSensorStatus[100];
 extern char topicSystemStatus[100];
+extern char topicRelayAck[100];
+extern char topicPrefix[64];
+extern bool haDiscoveryEnabled;
+extern char haDiscoveryPrefix[32];
+extern char sparkplugGroup[32];
+const char *mqttPayloadModeName();
+void mqttSetPayloadMode(const char *name);
+extern uint8_t modbusUnitId;
+extern bool rtuEnabled;
+extern uint32_t rtuBaud;
+extern char rtuFormat[4];
+extern uint32_t rtuTimeoutMs;
+extern uint32_t rtuCacheMs;
+extern char rtuPolls[160];
+extern bool udpEnabled;
+extern uint16_t udpPort;
+extern IPAddress udpGroup;
+extern uint16_t udpStatePort;
+extern uint32_t udpStateMs;
+extern char udpKey[64];
+extern bool dhcpEnabled;
+extern uint8_t relayBootPolicy;
+extern char peerLinks[160];
+extern uint32_t peerRetryMs;
+extern uint32_t peerHeartbeatMs;
+extern uint32_t peerTimeoutMs;
 extern char relayLabels[8][16];
 extern char inputLabels[8][16];
 extern const char* CONFIG_FILE;
+extern SensorChannel sensorTemp;
+extern SensorChannel sensorHum;
 
 // SPIFFS status (défini dans main.cpp)
 extern bool spiffsReady;
 
 // ===== GESTION SPIFFS =====
 
+// Montée à la demande: import/export de /config.json (la config de démarrage
+// vient de la NVS, sans SPIFFS) et niveau flash de la file MQTT, dans
+// mqttQueueInit()
 void initSPIFFS() {
+  static bool tried = false;
+  if (tried) return;
+  tried = true;
   spiffsReady = false;
 
   static Preferences prefs;
@@ -72,13 +111,6 @@ void initSPIFFS() {
   prefs.end();
 }
 
-static bool parseIpString(const String &ip, IPAddress &out) {
-  uint32_t parts[4];
-  if (sscanf(ip.c_str(), "%lu.%lu.%lu.%lu", &parts[0], &parts[1], &parts[2], &parts[3]) != 4) return false;
-  out = IPAddress(parts[0], parts[1], parts[2], parts[3]);
-  return true;
-}
-
 static void migrateTopicPrefix(char *topic, size_t topicSize, const char *oldPrefix, const char *newPrefix) {
   if (!topic || topicSize == 0 || !oldPrefix || !newPrefix) return;
   size_t oldLen = strlen(oldPrefix);
@@ -89,141 +121,396 @@ static void migrateTopicPrefix(char *topic, size_t topicSize, const char *oldPre
   strlcpy(topic, migrated.c_str(), topicSize);
 }
 
-void loadMQTTConfig() {
+// ===== TABLE DES CHAMPS (config_schema.h) =====
+// Seul endroit où une clé de config est décrite: import/export /config.json,
+// GET/POST /api/config et instantané NVS en dérivent. username/password: pas
+// de défaut (DEFAULT_MQTT_USER / DEFAULT_MQTT_PASSWORD de main.cpp restent) et
+// une chaîne vide ne les remplace pas.
+static const char *const RELAY_BOOT_NAMES[] = {"off", "restore", nullptr};   // index = RelayBootPolicy
+static const char *const PAYLOAD_MODE_NAMES[] = {"json", "sparkplug", "both", nullptr};
+static const char *const QUEUE_DROP_NAMES[] = {"oldest", "newest", nullptr};
+
+static const char *relayBootName() {
+  return RELAY_BOOT_NAMES[relayBootPolicy ? 1 : 0];
+}
+
+static void relayBootSet(const char *name) {
+  relayBootPolicy = (strcmp(name, "off") == 0) ? 0 : 1;
+}
+
+// Un seul délai "sans mesure" pour les deux canaux
+static void sensorStaleApply() {
+  sensorHum.staleMs = sensorTemp.staleMs;
+}
+
+static const CfgField CONFIG_FIELDS[] = {
+  // Réseau
+  CFG_IP_F("static_ip", staticIP, "192.168.1.50", CFG_FX_NET),
+  CFG_IP_F("gateway", gateway, "192.168.1.1", CFG_FX_NET),
+  CFG_IP_F("subnet", subnet, "255.255.255.0", CFG_FX_NET),
+  CFG_IP_F("dns1", dns1, "8.8.8.8", CFG_FX_NET),
+  CFG_BOOL_F("dhcp_enabled", dhcpEnabled, 0, CFG_FX_RESTART),
+  CFG_ENUM_F("relay_boot", RELAY_BOOT_NAMES, relayBootName, relayBootSet, "restore", 0),
+
+  // MQTT
+  CFG_IP_F("broker_ip", mqttServer, "192.168.1.200", CFG_FX_MQTT),
+  CFG_NUM_F("broker_port", CFG_U16, mqttPort, 1, 65535, 1883, CFG_FX_MQTT, nullptr),
+  CFG_STR_F("username", mqttUser, nullptr, CFG_FX_MQTT),
+  CFG_STR_F("password", mqttPassword, nullptr, CFG_SECRET | CFG_KEEP_EMPTY | CFG_FX_MQTT),
+  CFG_STR_F("ota_key", otaKey, "", CFG_SECRET),
+  CFG_STR_F("topic_relay_cmd", topicRelayCmd, "waveshare/relay/cmd", CFG_FX_RESTART),
+  CFG_STR_F("topic_relay_status", topicRelayStatus, "waveshare/relay/status", CFG_FX_RESTART),
+  CFG_STR_F("topic_input_status", topicInputStatus, "waveshare/input/status", CFG_FX_RESTART),
+  CFG_STR_F("topic_sensor_status", topicSensorStatus, "waveshare/sensor/status", CFG_FX_RESTART),
+  CFG_STR_F("topic_system_status", topicSystemStatus, "waveshare/system/status", CFG_FX_RESTART),
+  CFG_STR_F("topic_relay_ack", topicRelayAck, "waveshare/relay/ack", CFG_FX_RESTART),
+  CFG_STR_F("topic_prefix", topicPrefix, "waveshare", CFG_FX_RESTART),
+  CFG_BOOL_F("ha_discovery", haDiscoveryEnabled, 1, CFG_FX_RESTART),
+  CFG_STR_F("ha_discovery_prefix", haDiscoveryPrefix, "homeassistant", CFG_FX_RESTART),
+  CFG_ENUM_F("mqtt_payload_mode", PAYLOAD_MODE_NAMES, mqttPayloadModeName, mqttSetPayloadMode, "json", CFG_FX_RESTART),
+  CFG_STR_F("sparkplug_group", sparkplugGroup, "waveshare", CFG_FX_RESTART),
+  CFG_ENUM_F("mqtt_queue_drop", QUEUE_DROP_NAMES, mqttQueueDropPolicyName, mqttQueueSetDropPolicy, "oldest", 0),
+
+  // Modbus RTU / passerelle
+  CFG_NUM_F("modbus_unit_id", CFG_U8, modbusUnitId, 1, 247, 1, 0, nullptr),
+  CFG_BOOL_F("rtu_enabled", rtuEnabled, 0, CFG_FX_RESTART),
+  CFG_NUM_F("rtu_baud", CFG_U32, rtuBaud, 1200, 921600, 9600, CFG_FX_RESTART, nullptr),
+  CFG_STR_F("rtu_format", rtuFormat, "8N1", CFG_FX_RESTART),
+  CFG_NUM_F("rtu_timeout_ms", CFG_U32, rtuTimeoutMs, 1, 60000, 200, CFG_FX_RESTART, nullptr),
+  CFG_NUM_F("rtu_cache_ms", CFG_U32, rtuCacheMs, 0, 3600000, 1000, CFG_FX_RESTART, nullptr),
+  CFG_STR_F("rtu_polls", rtuPolls, "", CFG_FX_RESTART),
+
+  // Protocole UDP binaire et liens entre cartes
+  CFG_BOOL_F("udp_enabled", udpEnabled, 0, CFG_FX_RESTART),
+  CFG_NUM_F("udp_port", CFG_U16, udpPort, 1, 65535, 5005, CFG_FX_RESTART, nullptr),
+  CFG_IP_F("udp_group", udpGroup, "239.255.8.8", CFG_FX_RESTART),
+  CFG_NUM_F("udp_state_port", CFG_U16, udpStatePort, 1, 65535, 5006, CFG_FX_RESTART, nullptr),
+  CFG_NUM_F("udp_state_ms", CFG_U32, udpStateMs, 10, 3600000, 1000, CFG_FX_RESTART, nullptr),
+  CFG_STR_F("udp_key", udpKey, "", CFG_SECRET | CFG_FX_RESTART),
+  CFG_STR_F("peer_links", peerLinks, "", CFG_FX_RESTART),
+  CFG_NUM_F("peer_retry_ms", CFG_U32, peerRetryMs, 1, 10000, 20, CFG_FX_RESTART, nullptr),
+  CFG_NUM_F("peer_heartbeat_ms", CFG_U32, peerHeartbeatMs, 10, 60000, 500, CFG_FX_RESTART, nullptr),
+  // porté sur 16 bits dans la trame LINK
+  CFG_NUM_F("peer_timeout_ms", CFG_U32, peerTimeoutMs, 10, 60000, 1500, CFG_FX_RESTART, nullptr),
+
+  // Labels I/O (un label vide dans un POST laisse le label en place)
+  CFG_LABELS_F("relay_labels", relayLabels, "relay", CFG_FX_LABELS),
+  CFG_LABELS_F("input_labels", inputLabels, "input", CFG_FX_LABELS),
+
+  // Reporting capteurs (sensor_report.h)
+  CFG_NUM_F("temp_deadband", CFG_FLOAT, sensorTemp.deadbandAbs, 0, 100, 0.2f, 0, nullptr),
+  CFG_NUM_F("temp_deadband_pct", CFG_FLOAT, sensorTemp.deadbandPct, 0, 100, 0, 0, nullptr),
+  CFG_NUM_F("temp_min_interval_ms", CFG_U32, sensorTemp.minIntervalMs, 0, 86400000, 5000, 0, nullptr),
+  CFG_NUM_F("temp_max_interval_ms", CFG_U32, sensorTemp.maxIntervalMs, 0, 86400000, 300000, 0, nullptr),
+  CFG_NUM_F("hum_deadband", CFG_FLOAT, sensorHum.deadbandAbs, 0, 100, 1.0f, 0, nullptr),
+  CFG_NUM_F("hum_deadband_pct", CFG_FLOAT, sensorHum.deadbandPct, 0, 100, 0, 0, nullptr),
+  CFG_NUM_F("hum_min_interval_ms", CFG_U32, sensorHum.minIntervalMs, 0, 86400000, 5000, 0, nullptr),
+  CFG_NUM_F("hum_max_interval_ms", CFG_U32, sensorHum.maxIntervalMs, 0, 86400000, 300000, 0, nullptr),
+  CFG_NUM_F("sensor_stale_ms", CFG_U32, sensorTemp.staleMs, 0, 86400000, 30000, 0, sensorStaleApply),
+};
+static const size_t CONFIG_FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+// Clés hors table tolérées dans un document lu ("crc32" du fichier, "mqtt_connected" ou
+// "<clé>_set" d'un GET renvoyé tel quel)
+static const size_t CONFIG_EXTRA_KEYS = 8;
+
+// ===== ÉCRITURES (config_store.h) =====
+// Compteurs: GET /api/status -> config_store
+struct ConfigStoreStats {
+  uint32_t requests;                     // modifications signalées (POST /api/config...)
+  uint32_t writes;                       // sauvegardes effectuées
+  uint32_t unchanged;                    // instantané ou fichier identique: non réécrit
+  uint32_t failures;
+  uint32_t nvsBytes;                     // octets flash écrits (estimation NVS: entrées de 32 octets)
+  uint32_t fileBytes;                    // octets de /config.json écrits
+  uint32_t lastUs;                       // durée de la dernière sauvegarde
+  uint32_t blobCrc;                      // dernier instantané lu/écrit
+  uint32_t jsonCrc;                      // dernier /config.json écrit
+  bool blobCrcValid;
+  bool jsonCrcValid;
+};
+ConfigStoreStats configStore = {};
+ConfigSaveSched configSave = {};
+
+// ===== CHARGEMENT AU DÉMARRAGE =====
+// Mesures du dernier chargement (GET /api/boot): durée, tas au plus bas
+// pendant le chargement et tas gardé ensuite (tampons SPIFFS par exemple)
+struct ConfigLoadStats {
+  const char *source;                    // "nvs", "json" (migration) ou "defaults"
+  ConfigBlobStatus blob;
+  const char *jsonError;                 // "" si /config.json lu correctement ou absent
+  uint32_t loadUs;
+  uint32_t heapPeak;
+  int32_t heapKept;
+};
+ConfigLoadStats configLoad = {"defaults", CFG_BLOB_MISSING, "", 0, 0, 0};
+static uint32_t configHeapLow = 0;
+
+static void configHeapSample() {
+  uint32_t f = ESP.getFreeHeap();
+  if (f < configHeapLow) configHeapLow = f;
+}
+
+// ----- /config.json via config_store.h -----
+static const size_t CONFIG_FILE_MAX = 4096;
+
+static bool configFsWrite(const char *path, const char *data, size_t len) {
+  File f = SPIFFS.open(path, "w");
+  if (!f) return false;
+  size_t w = f.write((const uint8_t *)data, len);
+  f.close();
+  return w == len;
+}
+
+static long configFsRead(const char *path, char *buf, size_t cap) {
+  if (!SPIFFS.exists(path)) return -1;
+  File f = SPIFFS.open(path, "r");
+  if (!f) return -1;
+  size_t n = f.read((uint8_t *)buf, cap);
+  f.close();
+  return (long)n;
+}
+
+static bool configFsRemove(const char *path) {
+  return !SPIFFS.exists(path) || SPIFFS.remove(path);
+}
+
+static bool configFsRename(const char *from, const char *to) {
+  return SPIFFS.rename(from, to);
+}
+
+static const ConfigFsIo configFsIo = {configFsWrite, configFsRead, configFsRemove, configFsRename};
+
+// Import de /config.json dans les globales. false si absent ou illisible
+// (jsonError renseigné), les valeurs courantes restent alors en place.
+bool importConfigJson() {
+  initSPIFFS();
   if (!spiffsReady) {
+    configLoad.jsonError = "spiffs";
     Serial.println("⚠️ SPIFFS not ready -> using defaults");
-    return;
+    return false;
+  }
+  char *text = (char *)malloc(CONFIG_FILE_MAX);
+  if (!text) {
+    configLoad.jsonError = "no_memory";
+    return false;
   }
-  if (!SPIFFS.exists(CONFIG_FILE)) {
+  size_t len = 0;
+  ConfigFileStatus fst = configFileRecover(configFsIo, CONFIG_FILE, text, CONFIG_FILE_MAX, &len);
+  if (fst == CFG_FILE_MISSING) {
+    free(text);
     Serial.println("⚠️  Config file not found, using defaults");
-    return;
+    return false;
   }
-  
-  File file = SPIFFS.open(CONFIG_FILE, "r");
-  if (!file) {
-    Serial.println("✗ Failed to open config file for read");
-    return;
+  if (fst == CFG_FILE_BAD_CRC) {
+    free(text);
+    configLoad.jsonError = configFileStatusName(fst);
+    Serial.printf("✗ %s: CRC invalide (fichier tronqué, ou modifié sans retirer \"crc32\")\n", CONFIG_FILE);
+    return false;
+  }
+  // Lecture en place (char*): les chaînes pointent dans text, document aux
+  // seuls membres
+  DynamicJsonDocument doc(cfgParseDocSize(CONFIG_FIELDS, CONFIG_FIELD_COUNT, CONFIG_EXTRA_KEYS));
+  DeserializationError err = deserializeJson(doc, text, len);
+  configHeapSample();
+  if (err) {
+    free(text);
+    configLoad.jsonError = err.c_str();
+    Serial.printf("✗ %s illisible (%s): valeurs par défaut\n", CONFIG_FILE, err.c_str());
+    return false;
+  }
+  CfgApplyResult r;
+  cfgFromJson(CONFIG_FIELDS, CONFIG_FIELD_COUNT, doc.as<JsonObjectConst>(), false, r);
+  free(text);
+  if (r.invalid) {
+    Serial.printf("⚠️ %s: %u champ(s) refusé(s), valeur par défaut gardée (%s: %s)\n", CONFIG_FILE,
+                  (unsigned)r.invalid, r.badKey, r.reason);
   }
-  DynamicJsonDocument doc(1536);
-  
-  if (deserializeJson(doc, file) == DeserializationError::Ok) {
-    // Réseau (optionnel)
-    {
-      String ip = doc["static_ip"] | "";
-      if (ip.length()) parseIpString(ip, staticIP);
-      String gw = doc["gateway"] | "";
-      if (gw.length()) parseIpString(gw, gateway);
-      String mask = doc["subnet"] | "";
-      if (mask.length()) parseIpString(mask, subnet);
-      String dns = doc["dns1"] | "";
-      if (dns.length()) parseIpString(dns, dns1);
-    }
 
-    String ip = doc["broker_ip"] | "192.168.1.200";
-    parseIpString(ip, mqttServer);
-    
-    mqttPort = doc["broker_port"] | 1883;
+  // Migration automatique: ancien préfixe -> nouveau
+  migrateTopicPrefix(topicRelayCmd, sizeof(topicRelayCmd), "home/esp32/", "waveshare/");
+  migrateTopicPrefix(topicRelayStatus, sizeof(topicRelayStatus), "home/esp32/", "waveshare/");
+  migrateTopicPrefix(topicInputStatus, sizeof(topicInputStatus), "home/esp32/", "waveshare/");
+  migrateTopicPrefix(topicSensorStatus, sizeof(topicSensorStatus), "home/esp32/", "waveshare/");
+  migrateTopicPrefix(topicSystemStatus, sizeof(topicSystemStatus), "home/esp32/", "waveshare/");
+  migrateTopicPrefix(topicRelayAck, sizeof(topicRelayAck), "home/esp32/", "waveshare/");
 
-    // IMPORTANT: ne pas écraser les valeurs existantes (fallback hardcodé) par des chaînes vides.
-    if (doc.containsKey("username")) {
-      String u = doc["username"].as<String>();
-      if (u.length() > 0) {
-        strlcpy(mqttUser, u.c_str(), sizeof(mqttUser));
-      }
-    }
-    if (doc.containsKey("password")) {
-      String p = doc["password"].as<String>();
-      if (p.length() > 0) {
-        strlcpy(mqttPassword, p.c_str(), sizeof(mqttPassword));
-      }
-    }
-    strlcpy(otaKey, doc["ota_key"] | "", sizeof(otaKey));
-    
-    strlcpy(topicRelayCmd, doc["topic_relay_cmd"] | "waveshare/relay/cmd", sizeof(topicRelayCmd));
-    strlcpy(topicRelayStatus, doc["topic_relay_status"] | "waveshare/relay/status", sizeof(topicRelayStatus));
-    strlcpy(topicInputStatus, doc["topic_input_status"] | "waveshare/input/status", sizeof(topicInputStatus));
-    strlcpy(topicSensorStatus, doc["topic_sensor_status"] | "waveshare/sensor/status", sizeof(topicSensorStatus));
-    strlcpy(topicSystemStatus, doc["topic_system_status"] | "waveshare/system/status", sizeof(topicSystemStatus));
-
-    // Labels I/O (optionnel)
-    if (doc.containsKey("relay_labels") && doc["relay_labels"].is<JsonArray>()) {
-      JsonArray arr = doc["relay_labels"].as<JsonArray>();
-      for (int i = 0; i < 8 && i < (int)arr.size(); i++) {
-        const char *v = arr[i] | "";
-        if (v && strlen(v) > 0) strlcpy(relayLabels[i], v, sizeof(relayLabels[i]));
-      }
+  Serial.println("✓ MQTT config loaded from SPIFFS");
+  Serial.printf("  MQTT user: %s\n", mqttUser);
+  configLoad.jsonError = "";
+  return true;
+}
+
+// ----- Instantané NVS: champs de la table à la suite (config_schema.h) -----
+static size_t configBlobBytes() {
+  return sizeof(ConfigBlobHeader) + cfgBlobSize(CONFIG_FIELDS, CONFIG_FIELD_COUNT);
+}
+
+// Instantané sur le tas le temps de la lecture/écriture: pas sur la pile de
+// loop(), pas gardé en RAM ensuite
+static ConfigBlobStatus loadConfigBlob() {
+  Preferences prefs;
+  prefs.begin("config", true);
+  size_t len = prefs.getBytesLength("blob");
+  size_t want = configBlobBytes();
+  size_t cap = len > want ? len : want;
+  uint8_t *b = (uint8_t *)malloc(cap);
+  if (!b) {
+    prefs.end();
+    return CFG_BLOB_MISSING;
+  }
+  configHeapSample();
+  if (len > 0) len = prefs.getBytes("blob", b, cap);
+  prefs.end();
+  uint32_t schema = cfgSchemaHash(CONFIG_FIELDS, CONFIG_FIELD_COUNT);
+  ConfigBlobStatus st = configBlobCheck(b, len, want - sizeof(ConfigBlobHeader), schema);
+  if (st == CFG_BLOB_OK) {
+    cfgUnpack(CONFIG_FIELDS, CONFIG_FIELD_COUNT, b + sizeof(ConfigBlobHeader));
+    configStore.blobCrc = ((const ConfigBlobHeader *)b)->crc;
+    configStore.blobCrcValid = true;
+  }
+  free(b);
+  return st;
+}
+
+// Instantané identique (CRC) au dernier lu/écrit: pas d'écriture. Une
+// écriture NVS est atomique (ancienne ou nouvelle valeur après une coupure).
+static bool saveConfigBlob() {
+  size_t len = configBlobBytes();
+  uint8_t *b = (uint8_t *)malloc(len);
+  if (!b) return false;
+  cfgPack(CONFIG_FIELDS, CONFIG_FIELD_COUNT, b + sizeof(ConfigBlobHeader));
+  configBlobSeal(b, len - sizeof(ConfigBlobHeader), cfgSchemaHash(CONFIG_FIELDS, CONFIG_FIELD_COUNT));
+  uint32_t crc = ((const ConfigBlobHeader *)b)->crc;
+  if (configStore.blobCrcValid && crc == configStore.blobCrc) {
+    free(b);
+    return true;
+  }
+  Preferences prefs;
+  prefs.begin("config", false);
+  bool ok = prefs.putBytes("blob", b, len) == len;
+  prefs.end();
+  if (ok) {
+    configStore.blobCrc = crc;
+    configStore.blobCrcValid = true;
+    configStore.nvsBytes += configNvsBytes(len);
+  }
+  free(b);
+  return ok;
+}
+
+// Démarrage: instantané NVS; s'il manque ou est invalide, import de
+// /config.json (migration depuis les firmwares précédents) puis réécriture
+// de l'instantané. Un fichier illisible n'est plus ignoré en silence:
+// jsonError dans GET /api/boot.
+void loadMQTTConfig() {
+  uint32_t t0 = micros();
+  uint32_t heapBefore = ESP.getFreeHeap();
+  configHeapLow = heapBefore;
+  cfgSetDefaults(CONFIG_FIELDS, CONFIG_FIELD_COUNT);
+
+  configLoad.blob = loadConfigBlob();
+  if (configLoad.blob == CFG_BLOB_OK) {
+    configLoad.source = "nvs";
+  } else {
+    if (configLoad.blob != CFG_BLOB_MISSING) {
+      Serial.printf("✗ Config NVS refusée (%s): import de %s\n", configBlobStatusName(configLoad.blob), CONFIG_FILE);
     }
-    if (doc.containsKey("input_labels") && doc["input_labels"].is<JsonArray>()) {
-      JsonArray arr = doc["input_labels"].as<JsonArray>();
-      for (int i = 0; i < 8 && i < (int)arr.size(); i++) {
-        const char *v = arr[i] | "";
-        if (v && strlen(v) > 0) strlcpy(inputLabels[i], v, sizeof(inputLabels[i]));
-      }
+    if (importConfigJson()) {
+      configLoad.source = "json";
+      bool saved = saveConfigBlob();
+      Serial.printf("%s Config migrée en NVS (%u octets)\n", saved ? "✓" : "✗", (unsigned)configBlobBytes());
+    } else {
+      configLoad.source = "defaults";
     }
-
-    // Migration automatique: ancien préfixe -> nouveau
-    migrateTopicPrefix(topicRelayCmd, sizeof(topicRelayCmd), "home/esp32/", "waveshare/");
-    migrateTopicPrefix(topicRelayStatus, sizeof(topicRelayStatus), "home/esp32/", "waveshare/");
-    migrateTopicPrefix(topicInputStatus, sizeof(topicInputStatus), "home/esp32/", "waveshare/");
-    migrateTopicPrefix(topicSensorStatus, sizeof(topicSensorStatus), "home/esp32/", "waveshare/");
-    migrateTopicPrefix(topicSystemStatus, sizeof(topicSystemStatus), "home/esp32/", "waveshare/");
-    
-    Serial.println("✓ MQTT config loaded from SPIFFS");
-    Serial.printf("  MQTT user: %s\n", mqttUser);
   }
-  
-  file.close();
+
+  configLoad.loadUs = micros() - t0;
+  configHeapSample();
+  configLoad.heapPeak = heapBefore - configHeapLow;
+  configLoad.heapKept = (int32_t)heapBefore - (int32_t)ESP.getFreeHeap();
+  Serial.printf("Config: %s en %lu us (tas: pic %lu, gardé %ld octets)\n", configLoad.source,
+                (unsigned long)configLoad.loadUs, (unsigned long)configLoad.heapPeak, (long)configLoad.heapKept);
 }
 
+// Instantané NVS (source au démarrage) puis export /config.json. Seul l'échec
+// NVS fait échouer la sauvegarde; l'export sert à l'import après un
+// changement de format ou une NVS effacée.
 bool saveMQTTConfig() {
-  if (!spiffsReady) {
-    Serial.println("✗ SPIFFS not ready -> cannot save config");
+  uint32_t written = configStore.nvsBytes + configStore.fileBytes;
+  if (!saveConfigBlob()) {
+    Serial.println("✗ Failed to write config to NVS");
     return false;
   }
-  DynamicJsonDocument doc(1536);
-  
-  // Réseau
-  doc["static_ip"] = staticIP.toString();
-  doc["gateway"] = gateway.toString();
-  doc["subnet"] = subnet.toString();
-  doc["dns1"] = dns1.toString();
-  
-  // MQTT
-  doc["broker_ip"] = mqttServer.toString();
-  doc["broker_port"] = mqttPort;
-  doc["username"] = mqttUser;
-  doc["password"] = mqttPassword;
-  doc["ota_key"] = otaKey;
-  doc["topic_relay_cmd"] = topicRelayCmd;
-  doc["topic_relay_status"] = topicRelayStatus;
-  doc["topic_input_status"] = topicInputStatus;
-  doc["topic_sensor_status"] = topicSensorStatus;
-  doc["topic_system_status"] = topicSystemStatus;
-
-  // Labels I/O
-  JsonArray rlbl = doc.createNestedArray("relay_labels");
-  JsonArray ilbl = doc.createNestedArray("input_labels");
-  for (int i = 0; i < 8; i++) {
-    rlbl.add(relayLabels[i]);
-    ilbl.add(inputLabels[i]);
-  }
-  
-  File file = SPIFFS.open(CONFIG_FILE, "w");
-  if (!file) {
-    Serial.println("✗ Failed to open config file for write");
-    return false;
+  initSPIFFS();
+  if (!spiffsReady) {
+    Serial.println("⚠️ SPIFFS not ready -> /config.json not exported");
+    return true;
   }
-  if (serializeJson(doc, file) == 0) {
-    Serial.println("✗ Failed to write config JSON");
-    file.close();
-    return false;
+  DynamicJsonDocument doc(cfgDocSize(CONFIG_FIELDS, CONFIG_FIELD_COUNT, true));
+  cfgToJson(CONFIG_FIELDS, CONFIG_FIELD_COUNT, doc.to<JsonObject>(), true);
+
+  // Texte signé, réécrit seulement s'il change
+  size_t cap = measureJson(doc) + CONFIG_CRC_TAIL + 2;
+  char *text = (char *)malloc(cap);
+  if (!text) {
+    Serial.println("⚠️ No memory for /config.json export (NVS saved)");
+    return true;
+  }
+  size_t len = configJsonSign(text, serializeJson(doc, text, cap), cap);
+  uint32_t crc = configCrc32(text, len);
+  if (len == 0) {
+    Serial.println("⚠️ Failed to write config JSON (NVS saved)");
+  } else if (configStore.jsonCrcValid && crc == configStore.jsonCrc) {
+    // identique au dernier export
+  } else if (configFileWrite(configFsIo, CONFIG_FILE, text, len)) {
+    configStore.jsonCrc = crc;
+    configStore.jsonCrcValid = true;
+    configStore.fileBytes += len;
+  } else {
+    Serial.println("⚠️ Failed to write config JSON (NVS saved)");
   }
-  file.close();
+  free(text);
 
-  Serial.println("✓ MQTT config saved to SPIFFS");
+  if (configStore.nvsBytes + configStore.fileBytes == written) {
+    configStore.unchanged++;
+    Serial.println("✓ MQTT config unchanged (no flash write)");
+  } else {
+    Serial.println("✓ MQTT config saved (NVS + SPIFFS)");
+  }
   return true;
 }
 
+// Sauvegarde différée: une rafale de modifications = une écriture, faite
+// depuis loop() (configSaveService) et non dans la requête HTTP
+void configSaveLater() {
+  configSaveMark(configSave, millis());
+  configStore.requests++;
+}
+
+static bool configSaveRun() {
+  uint32_t t0 = micros();
+  bool ok = saveMQTTConfig();
+  configStore.lastUs = micros() - t0;
+  if (ok) {
+    configStore.writes++;
+    configSave.dirty = false;
+  } else {
+    configStore.failures++;
+    configSaveMark(configSave, millis());   // nouvel essai après CONFIG_SAVE_QUIET_MS
+  }
+  return ok;
+}
+
+void configSaveService(uint32_t now) {
+  if (configSaveDue(configSave, now)) configSaveRun();
+}
+
+// Avant un redémarrage: écrit tout de suite ce qui est en attente
+bool configSaveFlush() {
+  return !configSave.dirty || configSaveRun();
+}
+
+
 // ===== SERVEUR HTTP (implémentation simple) =====
 
 void handleWebServer(EthernetClient &client) {
@@ -0,0 +1,274 @@
+// Instantané binaire de la config (config_schema.h + config_blob.h): défauts,
+// aller-retour pack/unpack de chaque type, octets après le '\0' hors CRC,
+// tout bit inversé détecté, empreinte de la table, et les refus qui
+// renvoient au réimport de /config.json (absent, tronqué, autre firmware,
+// table modifiée, CRC, écriture interrompue). Compilé contre les doublures
+// Arduino/ArduinoJson de tools/tests/host (aucune analyse JSON ici).
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "config_schema.h"
+
+// Fourni par le core Arduino sur la carte (host_stubs.cpp pour les outils hôte)
+size_t strlcpy(char *d, const char *s, size_t n) {
+  size_t l = strlen(s);
+  if (n) {
+    size_t c = l < n - 1 ? l : n - 1;
+    memcpy(d, s, c);
+    d[c] = 0;
+  }
+  return l;
+}
+
+static bool flag;
+static uint8_t unit;
+static uint16_t port;
+static uint32_t periodMs;
+static float deadband;
+static char user[20];
+static IPAddress broker;
+static char labels[4][8];
+static int mode;
+static int hooks;
+
+static const char *const MODES[] = {"json", "sparkplug", "both", nullptr};
+static const char *modeGet() { return MODES[mode]; }
+static void modeSet(const char *n) {
+  for (int i = 0; MODES[i]; i++) {
+    if (strcmp(MODES[i], n) == 0) mode = i;
+  }
+}
+static void hook() { hooks++; }
+
+static const CfgField FIELDS[] = {
+  CFG_BOOL_F("flag", flag, 1, 0),
+  CFG_NUM_F("unit", CFG_U8, unit, 1, 247, 7, 0, nullptr),
+  CFG_NUM_F("port", CFG_U16, port, 1, 65535, 1883, 0, nullptr),
+  CFG_NUM_F("period_ms", CFG_U32, periodMs, 0, 86400000, 300000, 0, hook),
+  CFG_NUM_F("deadband", CFG_FLOAT, deadband, 0, 100, 0.2f, 0, nullptr),
+  CFG_STR_F("user", user, "hello", 0),
+  CFG_IP_F("broker", broker, "192.168.1.50", 0),
+  CFG_ENUM_F("mode", MODES, modeGet, modeSet, "sparkplug", 0),
+  CFG_LABELS_F("labels", labels, "r", 0),
+};
+static const size_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+static const size_t DATA_BYTES = 1 + 1 + 2 + 4 + 4 + 20 + 4 + 1 + 32;
+static const size_t MODE_OFFSET = 1 + 1 + 2 + 4 + 4 + 20 + 4;
+static const size_t HDR = sizeof(ConfigBlobHeader);
+
+static uint8_t blob[HDR + DATA_BYTES];
+static uint32_t schema;
+
+static void sealCurrent() {
+  cfgPack(FIELDS, FIELD_COUNT, blob + HDR);
+  configBlobSeal(blob, DATA_BYTES, schema);
+}
+
+static ConfigBlobStatus check(size_t len = sizeof(blob)) {
+  return configBlobCheck(blob, len, DATA_BYTES, schema);
+}
+
+static void scramble() {
+  flag = false;
+  unit = port = 0;
+  periodMs = 0;
+  deadband = 0;
+  strcpy(user, "x");
+  broker = IPAddress(0, 0, 0, 0);
+  mode = 2;
+  strcpy(labels[0], "zz");
+}
+
+static void assertDefaults() {
+  TEST_ASSERT_TRUE(flag);
+  TEST_ASSERT_EQUAL_UINT8(7, unit);
+  TEST_ASSERT_EQUAL_UINT16(1883, port);
+  TEST_ASSERT_EQUAL_UINT32(300000, periodMs);
+  TEST_ASSERT_EQUAL_FLOAT(0.2f, deadband);
+  TEST_ASSERT_EQUAL_STRING("hello", user);
+  TEST_ASSERT_TRUE(broker == IPAddress(192, 168, 1, 50));
+  TEST_ASSERT_EQUAL(1, mode);
+  TEST_ASSERT_EQUAL_STRING("r1", labels[0]);
+  TEST_ASSERT_EQUAL_STRING("r4", labels[3]);
+}
+
+void setUp(void) {
+  hooks = 0;
+  cfgSetDefaults(FIELDS, FIELD_COUNT);
+  schema = cfgSchemaHash(FIELDS, FIELD_COUNT);
+  sealCurrent();
+}
+
+void tearDown(void) {}
+
+static void test_defaults_and_size(void) {
+  assertDefaults();
+  TEST_ASSERT_EQUAL(1, hooks);
+  TEST_ASSERT_EQUAL(DATA_BYTES, cfgBlobSize(FIELDS, FIELD_COUNT));
+  TEST_ASSERT_EQUAL_UINT32(0xCBF43926UL, configCrc32("123456789", 9));   // CRC-32 IEEE
+}
+
+static void test_parse_ip(void) {
+  IPAddress ip;
+  TEST_ASSERT_TRUE(cfgParseIp("10.0.0.255", ip));
+  TEST_ASSERT_TRUE(ip == IPAddress(10, 0, 0, 255));
+  TEST_ASSERT_FALSE(cfgParseIp("10.0.0", ip));
+  TEST_ASSERT_FALSE(cfgParseIp("10.0.0.256", ip));
+  TEST_ASSERT_FALSE(cfgParseIp("1.2.3.4 ", ip));
+  TEST_ASSERT_FALSE(cfgParseIp("", ip));
+  TEST_ASSERT_FALSE(cfgParseIp("1..2.3", ip));
+  TEST_ASSERT_FALSE(cfgParseIp("0001.2.3.4", ip));
+  TEST_ASSERT_FALSE(cfgParseIp(nullptr, ip));
+}
+
+// Chaque type relu tel qu'écrit, crochets rappelés
+static void test_pack_unpack_round_trip(void) {
+  TEST_ASSERT_EQUAL(CFG_BLOB_OK, check());
+  scramble();
+  hooks = 0;
+  cfgUnpack(FIELDS, FIELD_COUNT, blob + HDR);
+  assertDefaults();
+  TEST_ASSERT_EQUAL(1, hooks);
+
+  // Valeurs non par défaut, chaîne à la taille maximale
+  flag = false;
+  unit = 247;
+  port = 65535;
+  periodMs = 86400000;
+  deadband = 12.5f;
+  memset(user, 'u', sizeof(user) - 1);
+  user[sizeof(user) - 1] = '\0';
+  broker = IPAddress(10, 1, 2, 3);
+  mode = 2;
+  strcpy(labels[2], "pompe");
+  sealCurrent();
+  scramble();
+  cfgUnpack(FIELDS, FIELD_COUNT, blob + HDR);
+  TEST_ASSERT_FALSE(flag);
+  TEST_ASSERT_EQUAL_UINT8(247, unit);
+  TEST_ASSERT_EQUAL_UINT16(65535, port);
+  TEST_ASSERT_EQUAL_UINT32(86400000, periodMs);
+  TEST_ASSERT_EQUAL_FLOAT(12.5f, deadband);
+  TEST_ASSERT_EQUAL(sizeof(user) - 1, strlen(user));
+  TEST_ASSERT_TRUE(broker == IPAddress(10, 1, 2, 3));
+  TEST_ASSERT_EQUAL(2, mode);
+  TEST_ASSERT_EQUAL_STRING("pompe", labels[2]);
+}
+
+// Reste d'une ancienne valeur après le '\0': même instantané, même CRC
+static void test_bytes_after_nul_ignored(void) {
+  uint32_t crc = ((const ConfigBlobHeader *)blob)->crc;
+  user[10] = 'Z';
+  labels[1][6] = 'Q';
+  sealCurrent();
+  TEST_ASSERT_EQUAL_HEX32(crc, ((const ConfigBlobHeader *)blob)->crc);
+}
+
+// Chaîne non terminée dans l'instantané (flash abîmée): relue tronquée
+static void test_unterminated_string_in_blob(void) {
+  memset(blob + HDR + 12, 'a', sizeof(user));
+  cfgUnpack(FIELDS, FIELD_COUNT, blob + HDR);
+  TEST_ASSERT_EQUAL(sizeof(user) - 1, strlen(user));
+}
+
+// Index d'enum au-delà de la table (nom retiré depuis): dernier nom connu
+static void test_enum_index_out_of_range(void) {
+  blob[HDR + MODE_OFFSET] = 9;
+  cfgUnpack(FIELDS, FIELD_COUNT, blob + HDR);
+  TEST_ASSERT_EQUAL(2, mode);
+}
+
+// Tout bit inversé dans les données: CRC; dans l'en-tête: refus aussi
+static void test_every_bit_flip_detected(void) {
+  int detected = 0, total = 0;
+  for (size_t i = 0; i < sizeof(blob); i++) {
+    for (int bit = 0; bit < 8; bit++) {
+      blob[i] ^= (uint8_t)(1 << bit);
+      ConfigBlobStatus st = check();
+      total++;
+      if (st != CFG_BLOB_OK) detected++;
+      if (i >= HDR) TEST_ASSERT_EQUAL(CFG_BLOB_CRC, st);
+      blob[i] ^= (uint8_t)(1 << bit);
+    }
+  }
+  TEST_ASSERT_EQUAL(total, detected);
+  char msg[80];
+  snprintf(msg, sizeof(msg), "instantané %u + %u octets, %d/%d bits inversés détectés", (unsigned)HDR,
+           (unsigned)DATA_BYTES, detected, total);
+  TEST_MESSAGE(msg);
+}
+
+// Empreinte: clé, type, taille ou nombre de labels changés; bornes et défauts non
+static void test_schema_hash(void) {
+  CfgField t[FIELD_COUNT];
+  memcpy(t, FIELDS, sizeof(t));
+  TEST_ASSERT_EQUAL_HEX32(schema, cfgSchemaHash(t, FIELD_COUNT));
+  t[5].size = 19;
+  TEST_ASSERT_NOT_EQUAL(schema, cfgSchemaHash(t, FIELD_COUNT));
+  memcpy(t, FIELDS, sizeof(t));
+  t[2].key = "port2";
+  TEST_ASSERT_NOT_EQUAL(schema, cfgSchemaHash(t, FIELD_COUNT));
+  memcpy(t, FIELDS, sizeof(t));
+  t[1].type = CFG_BOOL;
+  TEST_ASSERT_NOT_EQUAL(schema, cfgSchemaHash(t, FIELD_COUNT));
+  memcpy(t, FIELDS, sizeof(t));
+  t[8].max = 3;
+  TEST_ASSERT_NOT_EQUAL(schema, cfgSchemaHash(t, FIELD_COUNT));
+  // Deux champs échangés: même taille totale, format différent
+  memcpy(t, FIELDS, sizeof(t));
+  t[0] = FIELDS[1];
+  t[1] = FIELDS[0];
+  TEST_ASSERT_NOT_EQUAL(schema, cfgSchemaHash(t, FIELD_COUNT));
+  // Champ ajouté
+  TEST_ASSERT_NOT_EQUAL(schema, cfgSchemaHash(FIELDS, FIELD_COUNT - 1));
+  memcpy(t, FIELDS, sizeof(t));
+  t[3].max = 1;
+  t[3].def = 5;
+  t[5].defStr = "autre";
+  TEST_ASSERT_EQUAL_HEX32(schema, cfgSchemaHash(t, FIELD_COUNT));
+}
+
+// Refus de l'instantané: loadMQTTConfig() réimporte alors /config.json
+static void test_rejections_trigger_reimport(void) {
+  TEST_ASSERT_EQUAL(CFG_BLOB_OK, check());
+  TEST_ASSERT_EQUAL(CFG_BLOB_MISSING, check(0));
+  TEST_ASSERT_EQUAL(CFG_BLOB_SIZE, check(HDR - 1));
+  TEST_ASSERT_EQUAL(CFG_BLOB_SIZE, check(sizeof(blob) - 1));
+
+  ConfigBlobHeader h;
+  memcpy(&h, blob, HDR);
+  ConfigBlobHeader bad = h;
+  bad.magic = 0;
+  memcpy(blob, &bad, HDR);
+  TEST_ASSERT_EQUAL(CFG_BLOB_MAGIC, check());
+  bad = h;
+  bad.version = CONFIG_BLOB_VERSION - 1;     // en-tête du firmware précédent
+  memcpy(blob, &bad, HDR);
+  TEST_ASSERT_EQUAL(CFG_BLOB_VERSION, check());
+  memcpy(blob, &h, HDR);
+
+  // Table modifiée par une mise à jour: empreinte, puis taille
+  TEST_ASSERT_EQUAL(CFG_BLOB_SCHEMA, configBlobCheck(blob, sizeof(blob), DATA_BYTES, schema ^ 1));
+  TEST_ASSERT_EQUAL(CFG_BLOB_SIZE, configBlobCheck(blob, sizeof(blob), DATA_BYTES - 1, schema));
+
+  // Écriture interrompue: seconde moitié effacée (0xFF)
+  memset(blob + sizeof(blob) / 2, 0xFF, sizeof(blob) - sizeof(blob) / 2);
+  TEST_ASSERT_EQUAL(CFG_BLOB_CRC, check());
+
+  TEST_ASSERT_EQUAL_STRING("schema", configBlobStatusName(CFG_BLOB_SCHEMA));
+  TEST_ASSERT_EQUAL_STRING("crc", configBlobStatusName(CFG_BLOB_CRC));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults_and_size);
+  RUN_TEST(test_parse_ip);
+  RUN_TEST(test_pack_unpack_round_trip);
+  RUN_TEST(test_bytes_after_nul_ignored);
+  RUN_TEST(test_unterminated_string_in_blob);
+  RUN_TEST(test_enum_index_out_of_range);
+  RUN_TEST(test_every_bit_flip_detected);
+  RUN_TEST(test_schema_hash);
+  RUN_TEST(test_rejections_trigger_reimport);
+  return UNITY_END();
+}
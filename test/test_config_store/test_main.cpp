@@ -0,0 +1,335 @@
+// Écriture atomique de /config.json (config_store.h) sur un système de
+// fichiers simulé: coupure de courant à chaque étape d'une écriture et de la
+// reprise, signature CRC, regroupement des sauvegardes, octets flash écrits
+// par modification.
+#include <unity.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include "config_store.h"
+
+#define PATH "/config.json"
+#define TMP_PATH "/config.json" CONFIG_TMP_SUFFIX
+
+// Instantané NVS du firmware par défaut (configBlobBytes(), en-tête compris)
+#define BLOB_BYTES 1680
+
+// ----- Système de fichiers simulé -----
+// Chaque write/remove/rename est une étape. Coupure à l'étape cutAt: un write
+// ne laisse que la moitié des octets, remove et rename ne se font pas; plus
+// rien ne passe ensuite jusqu'au "redémarrage".
+static std::map<std::string, std::string> fs;
+static int steps;
+static int cutAt;
+static bool powerLost;
+static uint32_t bytesWritten;
+static uint32_t writeCalls;
+
+static bool stepCut() {
+  if (powerLost) return true;
+  if (steps++ == cutAt) {
+    powerLost = true;
+    return true;
+  }
+  return false;
+}
+
+static bool fakeWrite(const char *path, const char *data, size_t len) {
+  if (powerLost) return false;
+  writeCalls++;
+  if (stepCut()) {
+    fs[path] = std::string(data, len / 2);
+    bytesWritten += len / 2;
+    return false;
+  }
+  fs[path] = std::string(data, len);
+  bytesWritten += len;
+  return true;
+}
+
+static long fakeRead(const char *path, char *buf, size_t cap) {
+  auto it = fs.find(path);
+  if (it == fs.end()) return -1;
+  size_t n = it->second.size() < cap ? it->second.size() : cap;
+  memcpy(buf, it->second.data(), n);
+  return (long)n;
+}
+
+static bool fakeRemove(const char *path) {
+  if (stepCut()) return false;
+  fs.erase(path);
+  return true;
+}
+
+static bool fakeRename(const char *from, const char *to) {
+  if (stepCut()) return false;
+  auto it = fs.find(from);
+  if (it == fs.end()) return false;
+  fs[to] = it->second;
+  fs.erase(it);
+  return true;
+}
+
+static const ConfigFsIo io = {fakeWrite, fakeRead, fakeRemove, fakeRename};
+
+static void powerOn(int cut = -1) {
+  steps = 0;
+  cutAt = cut;
+  powerLost = false;
+}
+
+static std::string signedText(const std::string &body) {
+  char buf[4096];
+  memcpy(buf, body.data(), body.size());
+  size_t n = configJsonSign(buf, body.size(), sizeof(buf));
+  TEST_ASSERT_NOT_EQUAL(0, n);
+  return std::string(buf, n);
+}
+
+// Texte de la taille de l'export par défaut (~1,4 Ko)
+static std::string exportText(const char *tag) {
+  std::string body = "{\"v\":\"";
+  body += tag;
+  body += "\",\"relay_labels\":[";
+  for (int i = 0; i < 8; i++) body += std::string(i ? "," : "") + "\"Relais " + std::to_string(i + 1) + "\"";
+  body += "],\"pad\":\"" + std::string(1200, tag[0]) + "\"}";
+  return signedText(body);
+}
+
+static std::string oldText;
+static std::string newText;
+
+void setUp(void) {
+  fs.clear();
+  powerOn();
+  bytesWritten = 0;
+  writeCalls = 0;
+  oldText = exportText("old");
+  newText = exportText("new");
+}
+
+void tearDown(void) {}
+
+static ConfigFileStatus recover(std::string &out) {
+  static char buf[4096];
+  size_t n = 0;
+  ConfigFileStatus st = configFileRecover(io, PATH, buf, sizeof(buf), &n);
+  out.assign(buf, n);
+  return st;
+}
+
+// ----- Signature -----
+static void test_signed_text_verifies(void) {
+  TEST_ASSERT_EQUAL(CFG_FILE_OK, configJsonVerify(oldText.data(), oldText.size()));
+  // Objet vide: pas de virgule avant la clé
+  std::string empty = signedText("{}");
+  TEST_ASSERT_EQUAL_STRING("{\"crc32\":\"", empty.substr(0, 10).c_str());
+  TEST_ASSERT_EQUAL(CFG_FILE_OK, configJsonVerify(empty.data(), empty.size()));
+  // Fin de ligne ajoutée par un éditeur
+  std::string nl = oldText + "\n";
+  TEST_ASSERT_EQUAL(CFG_FILE_OK, configJsonVerify(nl.data(), nl.size()));
+  TEST_ASSERT_EQUAL(CFG_FILE_UNSIGNED, configJsonVerify("{\"a\":1}", 7));
+}
+
+static void test_truncation_and_bit_flips_rejected(void) {
+  std::string a = signedText("{\"k\":1,\"relay_labels\":[\"A\",\"B\"]}");
+  for (size_t i = 1; i < a.size(); i++) {
+    TEST_ASSERT_NOT_EQUAL(CFG_FILE_OK, configJsonVerify(a.data(), i));
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    for (int bit = 0; bit < 8; bit++) {
+      // Casse d'un chiffre hexadécimal du CRC: même valeur, accepté
+      bool hexCase = i >= a.size() - 10 && a[i] >= 'a' && a[i] <= 'f' && bit == 5;
+      if (hexCase) continue;
+      std::string c = a;
+      c[i] ^= (char)(1 << bit);
+      TEST_ASSERT_NOT_EQUAL(CFG_FILE_OK, configJsonVerify(c.data(), c.size()));
+    }
+  }
+}
+
+static void test_sign_refuses_small_buffer(void) {
+  char buf[32] = "{\"a\":1}";
+  TEST_ASSERT_EQUAL(0, configJsonSign(buf, 7, 7 + CONFIG_CRC_TAIL));
+  TEST_ASSERT_NOT_EQUAL(0, configJsonSign(buf, 7, sizeof(buf)));
+}
+
+// ----- Coupures -----
+static void test_write_without_fault(void) {
+  fs[PATH] = oldText;
+  TEST_ASSERT_TRUE(configFileWrite(io, PATH, newText.data(), newText.size()));
+  TEST_ASSERT_EQUAL(3, steps);               // write, remove, rename
+  TEST_ASSERT_EQUAL(1, fs.size());
+  TEST_ASSERT_TRUE(fs[PATH] == newText);
+}
+
+// Coupure à chaque étape, avec ou sans reste d'une écriture plus ancienne,
+// puis redémarrage: l'ancien ou le nouveau fichier complet, jamais rien
+static void test_fault_at_every_write_step(void) {
+  int gotOld = 0, gotNew = 0;
+  for (int cut = 0; cut <= 3; cut++) {
+    for (int stale = 0; stale < 2; stale++) {
+      fs.clear();
+      fs[PATH] = oldText;
+      if (stale) fs[TMP_PATH] = "{\"v\":\"ga";
+      powerOn(cut);
+      bool ok = configFileWrite(io, PATH, newText.data(), newText.size());
+
+      powerOn();
+      std::string got;
+      char msg[48];
+      snprintf(msg, sizeof(msg), "coupure %d, reste %d", cut, stale);
+      TEST_ASSERT_EQUAL_MESSAGE(CFG_FILE_OK, recover(got), msg);
+      TEST_ASSERT_TRUE_MESSAGE(got == oldText || got == newText, msg);
+      if (ok) TEST_ASSERT_TRUE_MESSAGE(got == newText, msg);
+      TEST_ASSERT_EQUAL_MESSAGE(1, fs.size(), msg);   // plus de temporaire
+      (got == newText ? gotNew : gotOld)++;
+    }
+  }
+  // Jusqu'à la suppression comprise: l'ancien; ensuite le temporaire repris
+  TEST_ASSERT_EQUAL(4, gotOld);
+  TEST_ASSERT_EQUAL(4, gotNew);
+}
+
+// Premier démarrage sans fichier (export jamais écrit)
+static void test_fault_on_first_write(void) {
+  for (int cut = 0; cut <= 3; cut++) {
+    fs.clear();
+    powerOn(cut);
+    configFileWrite(io, PATH, newText.data(), newText.size());
+    powerOn();
+    std::string got;
+    ConfigFileStatus st = recover(got);
+    if (cut == 0) {
+      TEST_ASSERT_EQUAL(CFG_FILE_MISSING, st);
+    } else {
+      TEST_ASSERT_EQUAL(CFG_FILE_OK, st);
+      TEST_ASSERT_TRUE(got == newText);
+    }
+    // Temporaire tronqué (coupure 0): laissé, jamais pris pour /config.json
+    TEST_ASSERT_EQUAL(cut == 0 ? 0 : 1, fs.count(PATH));
+  }
+}
+
+// Coupure pendant la reprise (entre suppression et renommage), second démarrage
+static void test_fault_during_recovery(void) {
+  for (int cut = 0; cut <= 2; cut++) {
+    fs.clear();
+    fs[PATH] = std::string(oldText, 0, oldText.size() / 2);   // ancien abîmé
+    fs[TMP_PATH] = newText;
+    powerOn(cut);
+    std::string got;
+    recover(got);
+    powerOn();
+    TEST_ASSERT_EQUAL(CFG_FILE_OK, recover(got));
+    TEST_ASSERT_TRUE(got == newText);
+    TEST_ASSERT_EQUAL(1, fs.size());
+  }
+}
+
+// Fichier écrit à la main: accepté tel quel; fichier corrompu sans temporaire: signalé
+static void test_unsigned_and_corrupt_files(void) {
+  fs[PATH] = "{\"a\":1}";
+  std::string got;
+  TEST_ASSERT_EQUAL(CFG_FILE_UNSIGNED, recover(got));
+  TEST_ASSERT_EQUAL_STRING("{\"a\":1}", got.c_str());
+
+  std::string bad = oldText;
+  bad[8] ^= 0x20;
+  fs[PATH] = bad;
+  TEST_ASSERT_EQUAL(CFG_FILE_BAD_CRC, recover(got));
+  TEST_ASSERT_TRUE(got == bad);              // contenu rendu pour le diagnostic
+}
+
+// ----- Regroupement -----
+static uint32_t runEdits(ConfigSaveSched &s, uint32_t &now, int edits, uint32_t periodMs, uint32_t tailMs) {
+  uint32_t writes = 0;
+  for (int i = 0; i < edits; i++) {
+    configSaveMark(s, now);
+    for (uint32_t t = 0; t < periodMs; t += 10) {
+      now += 10;
+      if (configSaveDue(s, now)) {
+        writes++;
+        s.dirty = false;
+      }
+    }
+  }
+  for (uint32_t t = 0; t < tailMs; t += 10) {
+    now += 10;
+    if (configSaveDue(s, now)) {
+      writes++;
+      s.dirty = false;
+    }
+  }
+  return writes;
+}
+
+static void test_burst_coalesced(void) {
+  ConfigSaveSched s = {};
+  uint32_t now = 1000;
+  TEST_ASSERT_EQUAL(1, runEdits(s, now, 10, 300, 5000));
+}
+
+static void test_continuous_edits_bounded(void) {
+  ConfigSaveSched s = {};
+  uint32_t now = 1000;
+  // Une modification toutes les 500 ms pendant 30 s: une écriture par CONFIG_SAVE_MAX_MS
+  TEST_ASSERT_EQUAL(30000 / CONFIG_SAVE_MAX_MS, runEdits(s, now, 60, 500, 0));
+}
+
+static void test_save_due_across_millis_wrap(void) {
+  ConfigSaveSched s = {};
+  uint32_t t0 = 0xFFFFFF00UL;
+  configSaveMark(s, t0);
+  TEST_ASSERT_FALSE(configSaveDue(s, t0 + 100));
+  TEST_ASSERT_TRUE(configSaveDue(s, t0 + CONFIG_SAVE_QUIET_MS));
+}
+
+// ----- Octets flash par modification -----
+// 10 modifications en rafale: une sauvegarde = instantané NVS + export écrit
+// une fois (temporaire puis renommage, sans recopie)
+static void test_flash_bytes_per_edit(void) {
+  fs[PATH] = oldText;
+  ConfigSaveSched s = {};
+  uint32_t now = 1000;
+  uint32_t nvs = 0;
+  const int edits = 10;
+  for (int i = 0; i < edits; i++) {
+    configSaveMark(s, now);
+    for (uint32_t t = 0; t < 300 + (i == edits - 1 ? 5000 : 0); t += 10) {
+      now += 10;
+      if (!configSaveDue(s, now)) continue;
+      s.dirty = false;
+      nvs += configNvsBytes(BLOB_BYTES);
+      TEST_ASSERT_TRUE(configFileWrite(io, PATH, newText.data(), newText.size()));
+    }
+  }
+  TEST_ASSERT_EQUAL(1, writeCalls);
+  TEST_ASSERT_EQUAL(newText.size(), bytesWritten);
+  TEST_ASSERT_EQUAL(32 * (2 + (BLOB_BYTES + 31) / 32), nvs);
+
+  char msg[160];
+  snprintf(msg, sizeof(msg), "rafale de %d modifications: NVS %lu + fichier %lu octets, soit %lu octets par modification",
+           edits, (unsigned long)nvs, (unsigned long)bytesWritten, (unsigned long)((nvs + bytesWritten) / edits));
+  TEST_MESSAGE(msg);
+  snprintf(msg, sizeof(msg), "modification isolée: %lu octets (avant: %lu, réécriture en place)",
+           (unsigned long)(nvs + bytesWritten), (unsigned long)newText.size());
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_signed_text_verifies);
+  RUN_TEST(test_truncation_and_bit_flips_rejected);
+  RUN_TEST(test_sign_refuses_small_buffer);
+  RUN_TEST(test_write_without_fault);
+  RUN_TEST(test_fault_at_every_write_step);
+  RUN_TEST(test_fault_on_first_write);
+  RUN_TEST(test_fault_during_recovery);
+  RUN_TEST(test_unsigned_and_corrupt_files);
+  RUN_TEST(test_burst_coalesced);
+  RUN_TEST(test_continuous_edits_bounded);
+  RUN_TEST(test_save_due_across_millis_wrap);
+  RUN_TEST(test_flash_bytes_per_edit);
+  return UNITY_END();
+}
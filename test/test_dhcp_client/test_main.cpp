@@ -0,0 +1,299 @@
+// Client DHCP non bloquant (dhcp_client.h) contre un faux serveur: DORA,
+// T1 (unicast) / T2 (diffusion) / expiration, bail en cache (INIT-REBOOT)
+// confirmé, refusé (NAK) ou sans réponse, xid périmé, baux plus longs que
+// le tour de millis() (49,7 jours).
+#include <unity.h>
+#include <stdio.h>
+#include <vector>
+#include "dhcp_client.h"
+
+static std::vector<uint8_t> lastTx;
+static uint32_t lastDst;
+static int applies, stores;
+static DhcpLease applied, stored;
+
+static bool fakeSend(uint32_t dst, const uint8_t *buf, size_t len) {
+  lastTx.assign(buf, buf + len);
+  lastDst = dst;
+  return true;
+}
+
+static void fakeApply(const DhcpLease &l, bool changed) {
+  applied = l;
+  if (changed) applies++;
+}
+
+static void fakeStore(const DhcpLease &l) {
+  stored = l;
+  stores++;
+}
+
+static const DhcpIo io = {fakeSend, fakeApply, fakeStore};
+static const uint8_t mac[6] = {0x24, 0x6F, 0x28, 1, 2, 3};
+
+static uint32_t addr(int a, int b, int c, int d) {
+  uint8_t x[4] = {(uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d};
+  uint32_t v;
+  memcpy(&v, x, 4);
+  return v;
+}
+
+static const uint32_t SERVER = addr(192, 168, 1, 1);
+static const uint32_t OFFERED = addr(192, 168, 1, 77);
+
+// Option du dernier paquet émis (0 si absente)
+static uint32_t txOption(uint8_t want) {
+  for (size_t i = 240; i + 1 < lastTx.size();) {
+    uint8_t o = lastTx[i++];
+    if (o == 255) break;
+    uint8_t l = lastTx[i++];
+    if (o == want) {
+      if (l == 1) return lastTx[i];
+      uint32_t v;
+      memcpy(&v, &lastTx[i], 4);
+      return v;
+    }
+    i += l;
+  }
+  return 0;
+}
+
+// Faux serveur: réponse au dernier paquet émis (même xid, même MAC)
+static std::vector<uint8_t> serverReply(uint8_t type, uint32_t yiaddr, uint32_t leaseS) {
+  std::vector<uint8_t> r(300, 0);
+  r[0] = 2;
+  r[1] = 1;
+  r[2] = 6;
+  memcpy(&r[4], &lastTx[4], 4);
+  memcpy(&r[16], &yiaddr, 4);
+  memcpy(&r[28], &lastTx[28], 6);
+  dhcpPut32(&r[236], 0x63825363);
+  size_t p = 240;
+  r[p++] = 53; r[p++] = 1; r[p++] = type;
+  r[p++] = 54; r[p++] = 4;
+  memcpy(&r[p], &SERVER, 4);
+  p += 4;
+  if (type != DHCP_NAK) {
+    uint32_t mask = addr(255, 255, 255, 0);
+    r[p++] = 1; r[p++] = 4;
+    memcpy(&r[p], &mask, 4);
+    p += 4;
+    r[p++] = 3; r[p++] = 4;
+    memcpy(&r[p], &SERVER, 4);
+    p += 4;
+    r[p++] = 6; r[p++] = 4;
+    memcpy(&r[p], &SERVER, 4);
+    p += 4;
+    r[p++] = 51; r[p++] = 4;
+    dhcpPut32(&r[p], leaseS);
+    p += 4;
+  }
+  r[p++] = 255;
+  return r;
+}
+
+static bool deliver(DhcpClient &c, const std::vector<uint8_t> &pkt, uint32_t nowMs) {
+  return dhcpOnPacket(c, pkt.data(), pkt.size(), nowMs);
+}
+
+// DISCOVER -> OFFER -> REQUEST -> ACK à partir de t (ms)
+static void coldBind(DhcpClient &c, uint32_t t, uint32_t leaseS) {
+  dhcpInit(c, io, mac, "esp", 100, t);
+  dhcpService(c, t);
+  deliver(c, serverReply(DHCP_OFFER, OFFERED, leaseS), t + 10);
+  deliver(c, serverReply(DHCP_ACK, OFFERED, leaseS), t + 20);
+}
+
+static const DhcpLease CACHED = {OFFERED, addr(255, 255, 255, 0), SERVER, SERVER, SERVER, 600, 300, 525};
+
+void setUp(void) {
+  lastTx.clear();
+  lastDst = 0;
+  applies = stores = 0;
+  memset(&applied, 0, sizeof(applied));
+}
+
+void tearDown(void) {}
+
+static void test_cold_dora(void) {
+  DhcpClient c;
+  dhcpInit(c, io, mac, "esp", 100, 0);
+  dhcpService(c, 10);
+  TEST_ASSERT_EQUAL(DHCP_DISCOVER, txOption(53));
+  TEST_ASSERT_EQUAL_HEX32(DHCP_BROADCAST, lastDst);
+  TEST_ASSERT_EQUAL(DHCP_ST_SELECTING, c.state);
+  dhcpService(c, 1000);
+  TEST_ASSERT_EQUAL_UINT32(1, c.stats.discovers);
+  dhcpService(c, 2010);                          // nouvel essai après 2 s
+  TEST_ASSERT_EQUAL_UINT32(2, c.stats.discovers);
+
+  TEST_ASSERT_TRUE(deliver(c, serverReply(DHCP_OFFER, OFFERED, 600), 2100));
+  TEST_ASSERT_EQUAL(DHCP_REQUEST, txOption(53));
+  TEST_ASSERT_EQUAL_HEX32(OFFERED, txOption(50));
+  TEST_ASSERT_EQUAL_HEX32(SERVER, txOption(54));
+  TEST_ASSERT_TRUE(deliver(c, serverReply(DHCP_ACK, OFFERED, 600), 2150));
+  TEST_ASSERT_EQUAL(DHCP_ST_BOUND, c.state);
+  TEST_ASSERT_EQUAL(1, applies);
+  TEST_ASSERT_EQUAL(1, stores);
+  TEST_ASSERT_EQUAL_HEX32(OFFERED, applied.ip);
+  TEST_ASSERT_EQUAL_UINT32(300, c.lease.t1S);    // T1 = bail / 2
+  TEST_ASSERT_EQUAL_UINT32(525, c.lease.t2S);    // T2 = bail * 7/8
+  TEST_ASSERT_FALSE(dhcpWantsSocket(c, 2200));
+  // ACK en double: ignoré une fois lié
+  TEST_ASSERT_FALSE(deliver(c, serverReply(DHCP_ACK, OFFERED, 600), 2160));
+}
+
+static void test_renew_at_t1(void) {
+  DhcpClient c;
+  coldBind(c, 0, 600);
+  dhcpService(c, 20 + 299000);
+  TEST_ASSERT_EQUAL(DHCP_ST_BOUND, c.state);
+  TEST_ASSERT_TRUE(dhcpWantsSocket(c, 20 + 300000));
+  dhcpService(c, 20 + 300000);
+  TEST_ASSERT_EQUAL(DHCP_ST_RENEWING, c.state);
+  TEST_ASSERT_EQUAL_HEX32(SERVER, lastDst);      // unicast
+  TEST_ASSERT_EQUAL_MEMORY(&c.lease.ip, &lastTx[12], 4);
+  TEST_ASSERT_TRUE(deliver(c, serverReply(DHCP_ACK, OFFERED, 600), 20 + 300100));
+  TEST_ASSERT_EQUAL(DHCP_ST_BOUND, c.state);
+  TEST_ASSERT_EQUAL_UINT32(1, c.stats.renewals);
+  // Même bail: ni réapplication ni écriture NVS
+  TEST_ASSERT_EQUAL(1, applies);
+  TEST_ASSERT_EQUAL(1, stores);
+}
+
+// Serveur muet: T1 unicast, T2 diffusion, fin du bail -> adresse retirée
+static void test_rebind_at_t2_then_expiry(void) {
+  DhcpClient c;
+  coldBind(c, 0, 600);
+  uint32_t b = 20, t;
+  for (t = b + 300000; t < b + 525000; t += 1000) dhcpService(c, t);
+  TEST_ASSERT_EQUAL(DHCP_ST_RENEWING, c.state);
+  dhcpService(c, t);
+  TEST_ASSERT_EQUAL(DHCP_ST_REBINDING, c.state);
+  TEST_ASSERT_EQUAL_HEX32(DHCP_BROADCAST, lastDst);
+  for (; t < b + 600000; t += 1000) dhcpService(c, t);
+  TEST_ASSERT_TRUE(c.haveAddress);
+  dhcpService(c, t);
+  TEST_ASSERT_EQUAL_UINT32(1, c.stats.expiries);
+  TEST_ASSERT_FALSE(c.haveAddress);
+  TEST_ASSERT_EQUAL_HEX32(0, applied.ip);
+  dhcpService(c, t + 10);
+  TEST_ASSERT_EQUAL(DHCP_ST_SELECTING, c.state);
+}
+
+// INIT-REBOOT: adresse appliquée avant toute réponse, puis confirmée
+static void test_cached_lease_confirmed(void) {
+  DhcpClient c;
+  dhcpInit(c, io, mac, "esp", 500, 0);
+  dhcpStartCached(c, CACHED);
+  TEST_ASSERT_EQUAL(1, applies);
+  TEST_ASSERT_EQUAL_HEX32(OFFERED, applied.ip);
+  dhcpService(c, 5);
+  TEST_ASSERT_EQUAL(DHCP_ST_REBOOTING, c.state);
+  TEST_ASSERT_EQUAL(DHCP_REQUEST, txOption(53));
+  TEST_ASSERT_EQUAL_HEX32(OFFERED, txOption(50));
+  TEST_ASSERT_EQUAL_HEX32(0, txOption(54));      // pas d'identifiant serveur (RFC 2131 §4.3.2)
+  TEST_ASSERT_TRUE(deliver(c, serverReply(DHCP_ACK, OFFERED, 600), 40));
+  TEST_ASSERT_EQUAL(DHCP_ST_BOUND, c.state);
+  TEST_ASSERT_EQUAL(1, applies);
+  TEST_ASSERT_EQUAL(0, stores);
+  char msg[64];
+  snprintf(msg, sizeof(msg), "bail en cache: adresse à 0 ms, confirmée à %u ms", (unsigned)c.firstBoundMs);
+  TEST_MESSAGE(msg);
+}
+
+static void test_cached_lease_nak(void) {
+  DhcpClient c;
+  dhcpInit(c, io, mac, "esp", 900, 0);
+  dhcpStartCached(c, CACHED);
+  dhcpService(c, 5);
+  TEST_ASSERT_TRUE(deliver(c, serverReply(DHCP_NAK, 0, 0), 30));
+  TEST_ASSERT_EQUAL(DHCP_ST_SELECTING, c.state);
+  TEST_ASSERT_FALSE(c.haveAddress);
+  TEST_ASSERT_EQUAL_HEX32(0, applied.ip);
+  TEST_ASSERT_EQUAL(DHCP_DISCOVER, txOption(53));
+  TEST_ASSERT_EQUAL_UINT32(1, c.stats.naks);
+}
+
+// Serveur muet: l'adresse en cache reste, nouvelle découverte en parallèle
+static void test_cached_lease_silent_server(void) {
+  DhcpClient c;
+  dhcpInit(c, io, mac, "esp", 1300, 0);
+  dhcpStartCached(c, CACHED);
+  for (uint32_t t = 0; t < 8000; t += 10) dhcpService(c, t);
+  TEST_ASSERT_EQUAL(DHCP_ST_SELECTING, c.state);
+  TEST_ASSERT_TRUE(c.haveAddress);
+  TEST_ASSERT_EQUAL_HEX32(OFFERED, applied.ip);
+  TEST_ASSERT_EQUAL_UINT32(DHCP_REBOOT_TRIES, c.stats.requests);
+}
+
+// Réponse à une transaction précédente (xid) ou pour une autre MAC: ignorée
+static void test_stale_xid_ignored(void) {
+  DhcpClient c;
+  dhcpInit(c, io, mac, "esp", 700, 0);
+  dhcpService(c, 0);
+  std::vector<uint8_t> offer = serverReply(DHCP_OFFER, OFFERED, 600);
+  std::vector<uint8_t> stale = offer;
+  stale[7] ^= 1;
+  TEST_ASSERT_FALSE(deliver(c, stale, 10));
+  std::vector<uint8_t> other = offer;
+  other[33] ^= 1;
+  TEST_ASSERT_FALSE(deliver(c, other, 10));
+  TEST_ASSERT_EQUAL(DHCP_ST_SELECTING, c.state);
+  // Nouvelle découverte (xid suivant): l'offre précédente ne compte plus
+  dhcpEnter(c, DHCP_ST_SELECTING, 100);
+  TEST_ASSERT_FALSE(deliver(c, offer, 110));
+  TEST_ASSERT_TRUE(deliver(c, serverReply(DHCP_OFFER, OFFERED, 600), 120));
+  TEST_ASSERT_EQUAL(DHCP_ST_REQUESTING, c.state);
+}
+
+// Bail de 100 jours (T1 = 50 j > 2^32 ms): le renouvellement a bien lieu à
+// T1, à travers le retour à 0 de millis()
+static void test_long_lease_across_millis_wrap(void) {
+  const uint32_t leaseS = 100 * 86400;
+  DhcpClient c;
+  uint32_t t0 = 0xFFFFFFFFUL - 3600000UL;        // 1 h avant le retour à 0
+  coldBind(c, t0, leaseS);
+  TEST_ASSERT_EQUAL(DHCP_ST_BOUND, c.state);
+  TEST_ASSERT_EQUAL_UINT32(leaseS / 2, c.lease.t1S);
+  uint32_t bound = t0 + 20, t = bound;
+  uint64_t steps = 0;
+  while (c.state == DHCP_ST_BOUND && steps < 200ULL * 86400) {
+    t += 1000;
+    steps++;
+    dhcpService(c, t);
+  }
+  TEST_ASSERT_EQUAL(DHCP_ST_RENEWING, c.state);
+  TEST_ASSERT_EQUAL_UINT32(leaseS / 2, (uint32_t)steps);
+  TEST_ASSERT_EQUAL_UINT32(leaseS / 2, dhcpElapsedS(c, t));
+}
+
+// Bail de 60 jours, serveur muet: fin du bail à 60 j, pas avant ni jamais
+static void test_long_lease_expiry_across_wrap(void) {
+  const uint32_t leaseS = 60 * 86400;
+  DhcpClient c;
+  coldBind(c, 1000, leaseS);
+  uint32_t t = 1020;
+  uint64_t steps = 0;
+  while (c.stats.expiries == 0 && steps < 120ULL * 86400) {
+    t += 1000;
+    steps++;
+    dhcpService(c, t);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, c.stats.expiries);
+  TEST_ASSERT_EQUAL_UINT32(leaseS, (uint32_t)steps);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cold_dora);
+  RUN_TEST(test_renew_at_t1);
+  RUN_TEST(test_rebind_at_t2_then_expiry);
+  RUN_TEST(test_cached_lease_confirmed);
+  RUN_TEST(test_cached_lease_nak);
+  RUN_TEST(test_cached_lease_silent_server);
+  RUN_TEST(test_stale_xid_ignored);
+  RUN_TEST(test_long_lease_across_millis_wrap);
+  RUN_TEST(test_long_lease_expiry_across_wrap);
+  return UNITY_END();
+}
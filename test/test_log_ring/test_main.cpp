@@ -0,0 +1,200 @@
+// Journal binaire en anneau (log_ring.h): texte relu identique à snprintf
+// pour les formats des appels du firmware et chaque conversion reconnue,
+// chaîne tronquée à LOG_STR_MAX, arguments en trop (cut), argument absent
+// ("?"), ligne tronquée ("..."), record rattrapé refusé par logRingRead.
+#include <unity.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include "log_ring.h"
+
+static uint32_t mem[256];
+static LogRing ring;
+static LogPack lastPack;
+
+template <typename... A>
+static uint32_t writeRecord(const char *fmt, A... args) {
+  uint32_t pos = logRingHead(ring);
+  lastPack.n = 0;
+  lastPack.cut = false;
+  logPackArgs(lastPack, args...);
+  logRingWrite(ring, LOG_LEVEL_INFO, 1234, fmt, lastPack);
+  return pos;
+}
+
+// Texte relu du record écrit à l'instant
+template <typename... A>
+static std::string roundTrip(const char *fmt, A... args) {
+  uint32_t pos = writeRecord(fmt, args...);
+  LogRecord rec;
+  TEST_ASSERT_TRUE(logRingRead(ring, pos, rec));
+  char out[256];
+  logRecordFormat(rec, out, sizeof(out));
+  return out;
+}
+
+template <typename... A>
+static void assertParity(const char *fmt, A... args) {
+  char expect[256];
+  snprintf(expect, sizeof(expect), fmt, args...);
+  std::string got = roundTrip(fmt, args...);
+  TEST_ASSERT_EQUAL_STRING(expect, got.c_str());
+  TEST_ASSERT_FALSE(lastPack.cut);
+}
+
+void setUp(void) {
+  memset(mem, 0, sizeof(mem));
+  ring = LOG_RING_INIT(mem);
+}
+
+void tearDown(void) {}
+
+// Formats et types d'arguments des appels logLinef/logWarnf de main.cpp
+static void test_call_site_parity(void) {
+  uint8_t mask = 0x0F, values = 0x05;
+  assertParity("MQTT cmd: mask=0x%02X values=0x%02X (%lu us)", mask, values, (unsigned long)123);
+  assertParity("MQTT cmd rejetee: %s", "bad_json");
+  assertParity("HA discovery: %d entites publiees en %lu ms", 42, (unsigned long)87);
+  assertParity("MQTT: CONNECT refuse (code %d)", -4);
+  assertParity("Réseau: %s confirmée par %s en %lu ms", "192.168.1.50", "http", (unsigned long)1234);
+  assertParity("DHCP: adresse %s (bail %lu s)", "192.168.100.200", (unsigned long)86400);
+  assertParity("Lien ignoré: %.40s", "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz");
+  assertParity("RTU: scrutation ignorée (%u:%u:%u:%u)", (unsigned)1, (unsigned)3, (unsigned)100, (unsigned)8);
+  assertParity("  Applied %u field(s). IP=%s GW=%s MQTT=%s:%u user=%s pass_set=%s", (unsigned)3, "192.168.1.50",
+               "192.168.1.1", "192.168.1.10", (unsigned)1883, "user", "YES");
+  std::string got = roundTrip("MQTT: connexion perdue");
+  TEST_ASSERT_EQUAL_STRING("MQTT: connexion perdue", got.c_str());
+  got = roundTrip("100%% fait");
+  TEST_ASSERT_EQUAL_STRING("100% fait", got.c_str());
+}
+
+// Chaque conversion et modificateur reconnus, drapeaux, largeur, précision
+static void test_conversion_parity(void) {
+  enum Small { SMALL_THREE = 3 };
+  assertParity("%d %i %u %x %X %o %c", -7, 12, 4000000000u, 0xBEEF, 0xBEEF, 8, 'z');
+  assertParity("%hhd %hhu %hd %hu", (signed char)-3, (unsigned char)250, (short)-300, (unsigned short)65000);
+  assertParity("%ld %lu %lx", -123456L, 4000000000UL, 0xDEADL);
+  assertParity("%lld %llu %llx", -12345678901LL, 18446744073709551615ULL, 0x123456789ABULL);
+  assertParity("%zu %jd %td", (size_t)77, (intmax_t)-99, (ptrdiff_t)-5);
+  assertParity("%e %E %f %g %G", 1e-7, 2.5e12, 3.14159, 0.0001234, 1e20);
+  assertParity("%a %A", 1.0, -0.5);
+  assertParity("%5.2f|%-6s|%+d|% d|%#x|%08.3f|%-4u|", 3.14159, "ab", 5, 7, 255, -2.5, 9u);
+  assertParity("float %.1f bool %d enum %d", 21.5f, true, SMALL_THREE);
+  assertParity("%p", (void *)0x1234);
+  assertParity("%s", (const char *)nullptr);
+}
+
+// Chaîne plus longue que LOG_STR_MAX: LOG_STR_MAX - 1 caractères gardés, cut
+static void test_string_truncated_at_str_max(void) {
+  std::string big(300, 'x');
+  std::string got = roundTrip("Body preview: %s", big.c_str());
+  TEST_ASSERT_TRUE(lastPack.cut);
+  TEST_ASSERT_EQUAL(strlen("Body preview: ") + LOG_STR_MAX - 1, got.size());
+  std::string expect = "Body preview: " + std::string(LOG_STR_MAX - 1, 'x');
+  TEST_ASSERT_EQUAL_STRING(expect.c_str(), got.c_str());
+  // Juste sous la limite: intacte
+  std::string fit(LOG_STR_MAX - 1, 'y');
+  assertParity("%s", fit.c_str());
+}
+
+// Plus de place dans le record: arguments suivants perdus, affichés "?"
+static void test_argument_overflow(void) {
+  std::string big(300, 'x');
+  std::string got = roundTrip("%s|%s|%s|%d", big.c_str(), big.c_str(), big.c_str(), 42);
+  TEST_ASSERT_TRUE(lastPack.cut);
+  TEST_ASSERT_EQUAL_UINT32(LOG_ARGS_MAX_WORDS, lastPack.n);
+  // Deux chaînes pleines, la troisième raccourcie à la place restante, entier perdu
+  size_t bar1 = got.find('|'), bar2 = got.find('|', bar1 + 1), bar3 = got.find('|', bar2 + 1);
+  TEST_ASSERT_EQUAL(LOG_STR_MAX - 1, bar1);
+  TEST_ASSERT_EQUAL(LOG_STR_MAX - 1, bar2 - bar1 - 1);
+  uint32_t room = (LOG_ARGS_MAX_WORDS - 2 * (LOG_STR_MAX / 4)) * 4;
+  TEST_ASSERT_EQUAL(room - 1, bar3 - bar2 - 1);
+  TEST_ASSERT_EQUAL_STRING("|?", got.c_str() + got.size() - 2);
+  // Entiers 64 bits: débordement au mot près
+  LogPack p;
+  p.n = LOG_ARGS_MAX_WORDS - 1;
+  p.cut = false;
+  logPackArgs(p, 1ULL);
+  TEST_ASSERT_TRUE(p.cut);
+  TEST_ASSERT_EQUAL_UINT32(LOG_ARGS_MAX_WORDS - 1, p.n);
+  char msg[64];
+  snprintf(msg, sizeof(msg), "record plein: %u mots d'arguments", (unsigned)LOG_ARGS_MAX_WORDS);
+  TEST_MESSAGE(msg);
+}
+
+// Format incohérent avec les arguments: "?" par argument absent
+static void test_missing_argument(void) {
+  std::string got = roundTrip("%d %lld %s %f");
+  TEST_ASSERT_EQUAL_STRING("? ? ? ?", got.c_str());
+  got = roundTrip("%d %s", 7);
+  TEST_ASSERT_EQUAL_STRING("7 ?", got.c_str());
+  // Spécification trop longue pour être recopiée
+  got = roundTrip("%000000000000000000000000000d", 1);
+  TEST_ASSERT_EQUAL_STRING("?", got.c_str());
+}
+
+// Ligne plus longue que le tampon de sortie: terminée par "..."
+static void test_output_truncated(void) {
+  std::string s(60, 'a');
+  uint32_t pos = writeRecord("%s %s", s.c_str(), s.c_str());
+  LogRecord rec;
+  TEST_ASSERT_TRUE(logRingRead(ring, pos, rec));
+  char out[40];
+  TEST_ASSERT_EQUAL(39, logRecordFormat(rec, out, sizeof(out)));
+  TEST_ASSERT_EQUAL_STRING("...", out + 36);
+  TEST_ASSERT_EQUAL('a', out[35]);
+}
+
+// Record écrasé par un tour complet, ou rattrapé pendant la copie: refusé
+static void test_read_rejects_lapped_record(void) {
+  uint32_t first = writeRecord("n=%d", -1);
+  LogRecord rec;
+  TEST_ASSERT_TRUE(logRingRead(ring, first, rec));
+  int i = 0;
+  while (logRingHead(ring) - first <= ring.mask + 1) writeRecord("n=%d", i++);
+  TEST_ASSERT_FALSE(logRingRead(ring, first, rec));
+
+  // Mots encore intacts mais head passé au-delà d'un tour (écrivain en cours)
+  setUp();
+  uint32_t pos = writeRecord("n=%d", 5);
+  ring.head = pos + ring.mask + 2;
+  TEST_ASSERT_FALSE(logRingRead(ring, pos, rec));
+  ring.head = pos + ring.mask + 1;               // exactement un tour: encore intact
+  TEST_ASSERT_TRUE(logRingRead(ring, pos, rec));
+}
+
+// Après plusieurs tours: du plus ancien au plus récent, tous lisibles et dans l'ordre
+static void test_oldest_after_lap(void) {
+  for (int i = 0; i < 1000; i++) writeRecord("n=%d", i);
+  uint32_t head = logRingHead(ring);
+  uint32_t p = logRingOldest(ring, head);
+  TEST_ASSERT_TRUE(head - p <= ring.mask + 1);
+  int count = 0, prev = -1;
+  LogRecord rec;
+  while (p != head) {
+    TEST_ASSERT_TRUE(logRingRead(ring, p, rec));
+    char out[32];
+    logRecordFormat(rec, out, sizeof(out));
+    int n = atoi(out + 2);
+    TEST_ASSERT_EQUAL(prev < 0 ? n : prev + 1, n);
+    prev = n;
+    p += rec.words;
+    count++;
+  }
+  TEST_ASSERT_EQUAL(999, prev);
+  TEST_ASSERT_EQUAL(1000, ring.records);
+  TEST_ASSERT_GREATER_THAN(0, count);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_call_site_parity);
+  RUN_TEST(test_conversion_parity);
+  RUN_TEST(test_string_truncated_at_str_max);
+  RUN_TEST(test_argument_overflow);
+  RUN_TEST(test_missing_argument);
+  RUN_TEST(test_output_truncated);
+  RUN_TEST(test_read_rejects_lapped_record);
+  RUN_TEST(test_oldest_after_lap);
+  return UNITY_END();
+}
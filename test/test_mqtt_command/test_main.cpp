@@ -0,0 +1,285 @@
+// Parseur des commandes relais (mqtt_command.h): formes acceptées et refusées,
+// échappements JSON, fin de buffer, identifiant de corrélation; mesure du
+// routage + analyse d'un message (chemin de mqttCallback sans le matériel).
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "mqtt_command.h"
+#include "topic_router.h"
+
+// Le payload de PubSubClient n'est pas terminé par '\0': chaque cas est
+// recopié dans un buffer de la taille exacte
+static MqttCmdResult parse(const char *text, size_t len, RelayCommand &cmd, CmdSlice *id = nullptr) {
+  uint8_t *buf = (uint8_t *)malloc(len ? len : 1);
+  memcpy(buf, text, len);
+  MqttCmdResult r = mqttParseRelayCommand(buf, len, cmd, id);
+  if (id && id->len > 0) {
+    // La tranche pointe dans le payload
+    TEST_ASSERT_TRUE(id->p >= (const char *)buf && id->p + id->len <= (const char *)buf + len);
+  }
+  free(buf);
+  return r;
+}
+
+struct CmdCase {
+  const char *payload;
+  MqttCmdResult result;
+  uint8_t mask;
+  uint8_t values;
+};
+
+static void runTable(const CmdCase *cases, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    const CmdCase &c = cases[i];
+    RelayCommand cmd;
+    MqttCmdResult r = parse(c.payload, strlen(c.payload), cmd);
+    char msg[160];
+    snprintf(msg, sizeof(msg), "'%s': %s", c.payload, mqttCmdResultName(r));
+    TEST_ASSERT_EQUAL_MESSAGE(c.result, r, msg);
+    if (r == MQTT_CMD_OK) {
+      TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.mask, cmd.mask, msg);
+      TEST_ASSERT_EQUAL_HEX8_MESSAGE(c.values, cmd.values, msg);
+    } else {
+      TEST_ASSERT_EQUAL_HEX8_MESSAGE(0, cmd.mask, msg);
+    }
+  }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// ----- Format texte -----
+static const CmdCase TEXT_CASES[] = {
+  {"3:on", MQTT_CMD_OK, 0x08, 0x08},
+  {"0:off", MQTT_CMD_OK, 0x01, 0x00},
+  {" 7 : ON \r\n", MQTT_CMD_OK, 0x80, 0x80},
+  {"5:true", MQTT_CMD_OK, 0x20, 0x20},
+  {"5:0", MQTT_CMD_OK, 0x20, 0x00},
+  {"ALL:on", MQTT_CMD_OK, 0xFF, 0xFF},
+  {"all:0", MQTT_CMD_OK, 0xFF, 0x00},
+  {"0x3:on", MQTT_CMD_OK, 0x08, 0x08},
+  {"8:on", MQTT_CMD_BAD_RELAY, 0, 0},
+  {"x:on", MQTT_CMD_BAD_RELAY, 0, 0},
+  {"-1:on", MQTT_CMD_BAD_RELAY, 0, 0},
+  {"99999999:on", MQTT_CMD_BAD_RELAY, 0, 0},
+  {"3:maybe", MQTT_CMD_BAD_STATE, 0, 0},
+  {"3:", MQTT_CMD_BAD_STATE, 0, 0},
+  {"3:onn", MQTT_CMD_BAD_STATE, 0, 0},
+  {"", MQTT_CMD_EMPTY, 0, 0},
+  {" \r\n\t", MQTT_CMD_EMPTY, 0, 0},
+  {"on", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {":on", MQTT_CMD_BAD_FORMAT, 0, 0},
+};
+
+static void test_text_commands(void) {
+  runTable(TEXT_CASES, sizeof(TEXT_CASES) / sizeof(TEXT_CASES[0]));
+}
+
+// ----- MASK:valeur[/masque] -----
+static const CmdCase MASK_CASES[] = {
+  {"MASK:0x05", MQTT_CMD_OK, 0xFF, 0x05},
+  {"mask:0b101/0x0F", MQTT_CMD_OK, 0x0F, 0x05},
+  {"MASK: 0xFF / 0x81 ", MQTT_CMD_OK, 0x81, 0x81},
+  {"MASK:170", MQTT_CMD_OK, 0xFF, 0xAA},
+  {"MASK:0", MQTT_CMD_OK, 0xFF, 0x00},
+  {"MASK:", MQTT_CMD_BAD_STATE, 0, 0},
+  {"MASK:   ", MQTT_CMD_BAD_STATE, 0, 0},
+  {"MASK:/0x0F", MQTT_CMD_BAD_STATE, 0, 0},
+  {"MASK:0x05/", MQTT_CMD_BAD_STATE, 0, 0},
+  {"MASK:0x", MQTT_CMD_BAD_STATE, 0, 0},
+  {"MASK:0x1FF", MQTT_CMD_BAD_STATE, 0, 0},
+  {"MASK:0x05/0x100", MQTT_CMD_BAD_STATE, 0, 0},
+  {"MASK:0b102", MQTT_CMD_BAD_STATE, 0, 0},
+};
+
+static void test_mask_commands(void) {
+  runTable(MASK_CASES, sizeof(MASK_CASES) / sizeof(MASK_CASES[0]));
+}
+
+// ----- JSON plat -----
+static const CmdCase JSON_CASES[] = {
+  {"{\"relay\":3,\"state\":\"on\"}", MQTT_CMD_OK, 0x08, 0x08},
+  {"{ \"relay\" : \"all\" , \"state\" : false }", MQTT_CMD_OK, 0xFF, 0x00},
+  {"{\"state\":1,\"relay\":\"7\"}", MQTT_CMD_OK, 0x80, 0x80},
+  {"{\"mask\":\"0x0F\",\"value\":5}", MQTT_CMD_OK, 0x0F, 0x05},
+  {"{\"value\":255}", MQTT_CMD_OK, 0xFF, 0xFF},
+  {"{\"relay\":1,\"state\":\"off\",\"x\":\"a\\\"b\\\\\"}", MQTT_CMD_OK, 0x02, 0x00},
+  {"{\"relay\":3}", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {"{\"mask\":15}", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {"{}", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {"{\"relay\":9,\"state\":1}", MQTT_CMD_BAD_RELAY, 0, 0},
+  {"{\"relay\":3,\"state\":\"maybe\"}", MQTT_CMD_BAD_STATE, 0, 0},
+  {"{\"relay\":3,\"state\":\"o\\\"n\"}", MQTT_CMD_BAD_STATE, 0, 0},
+  {"{\"value\":256}", MQTT_CMD_BAD_STATE, 0, 0},
+  {"{\"relay\":3,\"state\":\"on\"", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {"{\"relay\":3,,\"state\":\"on\"}", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {"{\"relay\":{},\"state\":1}", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {"{\"relay\":[3],\"state\":1}", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {"{\"relay\":,\"state\":1}", MQTT_CMD_BAD_FORMAT, 0, 0},
+  {"{relay:3,state:1}", MQTT_CMD_BAD_FORMAT, 0, 0},
+  // Guillemet échappé: la chaîne ne se ferme pas
+  {"{\"relay\":\"3\\\",\"state\":1}", MQTT_CMD_BAD_FORMAT, 0, 0},
+};
+
+static void test_json_commands(void) {
+  runTable(JSON_CASES, sizeof(JSON_CASES) / sizeof(JSON_CASES[0]));
+}
+
+// '\' en dernier octet du buffer, dans une clé ou une valeur: refusé sans
+// lire au-delà (buffer de taille exacte)
+static void test_backslash_at_buffer_end(void) {
+  static const char *const CUTS[] = {
+    "{\"relay\":\"3\\",
+    "{\"rel\\",
+    "{\"\\",
+    "{\"id\":\"abc\\",
+    "{\"relay\":3,\"state\":\"on\\",
+  };
+  for (size_t i = 0; i < sizeof(CUTS) / sizeof(CUTS[0]); i++) {
+    RelayCommand cmd;
+    CmdSlice id;
+    TEST_ASSERT_EQUAL_MESSAGE(MQTT_CMD_BAD_FORMAT, parse(CUTS[i], strlen(CUTS[i]), cmd, &id), CUTS[i]);
+    TEST_ASSERT_EQUAL(0, id.len);
+  }
+}
+
+// Toute troncature d'une commande JSON valide est refusée
+static void test_every_json_truncation_rejected(void) {
+  const char *full = "{\"id\":\"a-1\",\"relay\":\"all\",\"state\":\"on\"}";
+  size_t n = strlen(full);
+  for (size_t len = 1; len < n; len++) {
+    RelayCommand cmd;
+    MqttCmdResult r = parse(full, len, cmd);
+    TEST_ASSERT_NOT_EQUAL(MQTT_CMD_OK, r);
+  }
+  RelayCommand cmd;
+  TEST_ASSERT_EQUAL(MQTT_CMD_OK, parse(full, n, cmd));
+}
+
+// ----- Identifiant de corrélation -----
+static void test_id_lengths(void) {
+  char text[128];
+  char id[MQTT_CMD_ID_MAX + 2];
+  for (size_t len = 0; len <= MQTT_CMD_ID_MAX + 1; len++) {
+    memset(id, 'x', len);
+    id[len] = '\0';
+    int n = snprintf(text, sizeof(text), "{\"id\":\"%s\",\"relay\":2,\"state\":\"on\"}", id);
+    RelayCommand cmd;
+    CmdSlice got;
+    MqttCmdResult r = parse(text, (size_t)n, cmd, &got);
+    bool valid = len >= 1 && len <= MQTT_CMD_ID_MAX;
+    TEST_ASSERT_EQUAL_MESSAGE(valid ? MQTT_CMD_OK : MQTT_CMD_BAD_ID, r, text);
+    TEST_ASSERT_EQUAL(valid ? len : 0, got.len);
+  }
+}
+
+static void test_id_forms(void) {
+  RelayCommand cmd;
+  CmdSlice id;
+  const char *num = "{\"relay\":2,\"state\":\"on\",\"id\":12345}";
+  TEST_ASSERT_EQUAL(MQTT_CMD_OK, parse(num, strlen(num), cmd, &id));
+  TEST_ASSERT_EQUAL(5, id.len);
+
+  // Échappement ou caractère de contrôle: refusé (l'id est renvoyé tel quel dans l'acquittement)
+  const char *esc = "{\"id\":\"a\\\"b\",\"relay\":1,\"state\":\"off\"}";
+  TEST_ASSERT_EQUAL(MQTT_CMD_BAD_ID, parse(esc, strlen(esc), cmd, &id));
+  TEST_ASSERT_EQUAL(0, id.len);
+  const char ctl[] = "{\"id\":\"a\tb\",\"relay\":1,\"state\":\"off\"}";
+  TEST_ASSERT_EQUAL(MQTT_CMD_BAD_ID, parse(ctl, strlen(ctl), cmd, &id));
+
+  // Pas d'id: tranche vide; format texte: jamais d'id
+  const char *none = "{\"relay\":1,\"state\":\"off\"}";
+  TEST_ASSERT_EQUAL(MQTT_CMD_OK, parse(none, strlen(none), cmd, &id));
+  TEST_ASSERT_EQUAL(0, id.len);
+  TEST_ASSERT_EQUAL(MQTT_CMD_OK, parse("1:off", 5, cmd, &id));
+  TEST_ASSERT_EQUAL(0, id.len);
+
+  // Commande invalide: l'id reste disponible pour l'acquittement d'erreur
+  const char *bad = "{\"id\":\"r9\",\"relay\":9,\"state\":\"on\"}";
+  TEST_ASSERT_EQUAL(MQTT_CMD_BAD_RELAY, parse(bad, strlen(bad), cmd, &id));
+  TEST_ASSERT_EQUAL(2, id.len);
+}
+
+// ----- Mesure: routage + analyse -----
+// Mélange du firmware: topic historique (texte, JSON, MASK) et topics par
+// relais (<prefix>/relay/<n|label>/set), payload pris tel quel
+static void test_parse_dispatch_benchmark(void) {
+  static const char RELAY_LABELS[8][16] = {"Pompe", "Chaudiere", "Salle de bain", "Garage", "", "", "", "Portail"};
+  static const char INPUT_LABELS[8][16] = {""};
+  static TopicRouter router;
+  topicRouterBuild(router, "waveshare", "waveshare/relay/cmd", RELAY_LABELS, INPUT_LABELS);
+
+  struct Msg {
+    const char *topic;
+    const char *payload;
+  };
+  static const Msg MIX[] = {
+    {"waveshare/relay/cmd", "3:on"},
+    {"waveshare/relay/cmd", "ALL:off"},
+    {"waveshare/relay/cmd", "{\"relay\":3,\"state\":\"on\",\"id\":\"c-1042\"}"},
+    {"waveshare/relay/cmd", "MASK:0x5A/0xFF"},
+    {"waveshare/relay/2/set", "ON"},
+    {"waveshare/relay/salle_de_bain/set", "off"},
+    {"waveshare/relay/portail/set", "1"},
+    {"waveshare/input/status", "{}"},
+  };
+  const size_t kinds = sizeof(MIX) / sizeof(MIX[0]);
+  size_t topicLen[kinds], payloadLen[kinds];
+  for (size_t k = 0; k < kinds; k++) {
+    topicLen[k] = strlen(MIX[k].topic);
+    payloadLen[k] = strlen(MIX[k].payload);
+  }
+
+  const uint32_t N = 2000000;
+  uint32_t ok = 0, none = 0;
+  uint32_t applied = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < N; i++) {
+    size_t k = i % kinds;
+    const Msg &m = MIX[k];
+    RelayCommand cmd = {0, 0};
+    CmdSlice id;
+    int relay;
+    MqttCmdResult r = MQTT_CMD_UNKNOWN_TOPIC;
+    TopicRoute route = topicRouterMatch(router, m.topic, topicLen[k], relay);
+    if (route == TOPIC_ROUTE_RELAY_CMD) {
+      r = mqttParseRelayCommand((const uint8_t *)m.payload, payloadLen[k], cmd, &id);
+    } else if (route == TOPIC_ROUTE_RELAY_SET) {
+      bool on;
+      if (cmdParseState(CmdSlice{m.payload, payloadLen[k]}, on)) {
+        cmd.mask = (uint8_t)(1u << relay);
+        cmd.values = on ? cmd.mask : 0;
+        r = MQTT_CMD_OK;
+      }
+    }
+    if (r == MQTT_CMD_OK) {
+      ok++;
+      applied = (applied & ~cmd.mask) | cmd.values;
+    } else if (r == MQTT_CMD_UNKNOWN_TOPIC) {
+      none++;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+
+  TEST_ASSERT_EQUAL_UINT32(N / kinds * (kinds - 1), ok);
+  TEST_ASSERT_EQUAL_UINT32(N / kinds, none);
+  char msg[120];
+  snprintf(msg, sizeof(msg), "routage + analyse: %.1f ns/message (%lu messages, état final 0x%02x)", ns,
+           (unsigned long)N, (unsigned)(applied & 0xFF));
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_text_commands);
+  RUN_TEST(test_mask_commands);
+  RUN_TEST(test_json_commands);
+  RUN_TEST(test_backslash_at_buffer_end);
+  RUN_TEST(test_every_json_truncation_rejected);
+  RUN_TEST(test_id_lengths);
+  RUN_TEST(test_id_forms);
+  RUN_TEST(test_parse_dispatch_benchmark);
+  return UNITY_END();
+}
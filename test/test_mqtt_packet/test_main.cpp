@@ -0,0 +1,126 @@
+// CONNECT MQTT 3.1.1 écrit hors de PubSubClient (mqtt_packet.h): octets
+// attendus (spécification OASIS 3.1.1, §3.1), drapeaux will / utilisateur /
+// mot de passe, longueur restante sur deux octets, buffer trop petit.
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include "mqtt_packet.h"
+
+static MqttConnectOpts opts(const char *id) {
+  MqttConnectOpts o;
+  memset(&o, 0, sizeof(o));
+  o.clientId = id;
+  o.cleanSession = true;
+  o.keepAliveS = 30;
+  return o;
+}
+
+static void assertPacket(const uint8_t *expect, size_t len, const MqttConnectOpts &o) {
+  uint8_t buf[512];
+  size_t n = mqttEncodeConnect(buf, sizeof(buf), o);
+  TEST_ASSERT_EQUAL(len, n);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expect, buf, len);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static void test_minimal(void) {
+  static const uint8_t expect[] = {0x10, 0x0D, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 0x1E, 0x00, 0x01, 'c'};
+  assertPacket(expect, sizeof(expect), opts("c"));
+}
+
+// Will QoS 1, utilisateur et mot de passe: ordre id, will, utilisateur, mot de passe
+static void test_will_user_pass(void) {
+  MqttConnectOpts o = opts("id");
+  o.willTopic = "w";
+  o.willMsg = "m";
+  o.willQos = 1;
+  o.user = "u";
+  o.pass = "p";
+  o.keepAliveS = 60;
+  static const uint8_t expect[] = {0x10, 0x1A, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0xCE, 0x00, 0x3C, 0x00, 0x02,
+                                   'i', 'd', 0x00, 0x01, 'w', 0x00, 0x01, 'm', 0x00, 0x01, 'u', 0x00, 0x01, 'p'};
+  assertPacket(expect, sizeof(expect), o);
+}
+
+// Will retenu QoS 0 (disponibilité "offline" du firmware)
+static void test_retained_will(void) {
+  MqttConnectOpts o = opts("c");
+  o.willTopic = "t";
+  o.willMsg = "offline";
+  o.willRetain = true;
+  static const uint8_t expect[] = {0x10, 0x19, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x26, 0x00, 0x1E, 0x00, 0x01,
+                                   'c', 0x00, 0x01, 't', 0x00, 0x07, 'o', 'f', 'f', 'l', 'i', 'n', 'e'};
+  assertPacket(expect, sizeof(expect), o);
+}
+
+// Mot de passe seulement avec un utilisateur (comme PubSubClient); mot de
+// passe vide = champ présent de longueur 0
+static void test_password_rules(void) {
+  uint8_t buf[64];
+  MqttConnectOpts o = opts("c");
+  o.pass = "p";
+  TEST_ASSERT_EQUAL(15, mqttEncodeConnect(buf, sizeof(buf), o));
+  TEST_ASSERT_EQUAL_HEX8(0x02, buf[9]);
+  o.user = "u";
+  o.pass = nullptr;
+  TEST_ASSERT_EQUAL(18, mqttEncodeConnect(buf, sizeof(buf), o));
+  TEST_ASSERT_EQUAL_HEX8(0x82, buf[9]);
+  o.pass = "";
+  TEST_ASSERT_EQUAL(20, mqttEncodeConnect(buf, sizeof(buf), o));
+  TEST_ASSERT_EQUAL_HEX8(0xC2, buf[9]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, buf[18]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, buf[19]);
+}
+
+// Longueur restante >= 128: deux octets (132 = 0x84 0x01)
+static void test_two_byte_length(void) {
+  std::string id(120, 'x');
+  uint8_t buf[256];
+  size_t n = mqttEncodeConnect(buf, sizeof(buf), opts(id.c_str()));
+  TEST_ASSERT_EQUAL(3 + 132, n);
+  TEST_ASSERT_EQUAL_HEX8(0x84, buf[1]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buf[2]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, buf[3]);
+  TEST_ASSERT_EQUAL_HEX8(0x04, buf[4]);
+  TEST_ASSERT_EQUAL_HEX8('x', buf[n - 1]);
+}
+
+static void test_small_buffer(void) {
+  uint8_t buf[15];
+  TEST_ASSERT_EQUAL(15, mqttEncodeConnect(buf, 15, opts("c")));
+  TEST_ASSERT_EQUAL(0, mqttEncodeConnect(buf, 14, opts("c")));
+}
+
+// Pire cas du firmware: topic NDEATH (95 caractères), NDEATH (31),
+// utilisateur et mot de passe pleins (49) tiennent dans le buffer de
+// mqttReconnect(); le will JSON (topic 99 + "offline") est plus court
+static void test_firmware_worst_case(void) {
+  std::string topic(95, 't'), death(31, 'd'), user(49, 'u'), pass(49, 'p');
+  MqttConnectOpts o = opts("ESP32-S3-ETH");
+  o.willTopic = topic.c_str();
+  o.willMsg = death.c_str();
+  o.willQos = 1;
+  o.user = user.c_str();
+  o.pass = pass.c_str();
+  uint8_t buf[320];
+  size_t n = mqttEncodeConnect(buf, sizeof(buf), o);
+  TEST_ASSERT_NOT_EQUAL(0, n);
+  char msg[64];
+  snprintf(msg, sizeof(msg), "CONNECT pire cas: %u octets (buffer 320)", (unsigned)n);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_minimal);
+  RUN_TEST(test_will_user_pass);
+  RUN_TEST(test_retained_will);
+  RUN_TEST(test_password_rules);
+  RUN_TEST(test_two_byte_length);
+  RUN_TEST(test_small_buffer);
+  RUN_TEST(test_firmware_worst_case);
+  return UNITY_END();
+}
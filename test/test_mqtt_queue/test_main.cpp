@@ -0,0 +1,242 @@
+// Anneau flash de la file MQTT (mqtt_queue_ring.h) sur un fichier simulé:
+// records scellés (séquence + CRC), en-tête écrit par lots, reconstruction
+// après une coupure d'alimentation à chaque étape d'un débordement puis
+// d'un rejeu, record à moitié écrit, écritures d'en-tête par message rejoué.
+#include <unity.h>
+#include <stdio.h>
+#include "mqtt_queue_ring.h"
+
+#define SLOTS 64
+
+// ----- Fichier simulé: slots + en-tête persistés, anneau en RAM -----
+// Même enchaînement que mqtt_queue.h: ajout = un record, retrait = lot
+// d'en-tête quand mqttQueueHeaderDue().
+static MqttQueuedMsg slots[SLOTS];
+static MqttQueueFileHeader header;
+static MqttQueueRing ring;
+static uint32_t headerWrites;
+static uint32_t nowMs;
+
+static void writeHeader() {
+  header.magic = MQTT_QUEUE_MAGIC;
+  header.headSeq = ring.headSeq;
+  ring.pending = 0;
+  headerWrites++;
+}
+
+static void sync() {
+  if (mqttQueueHeaderDue(ring, nowMs)) writeHeader();
+}
+
+static void append(uint32_t ts) {
+  MqttQueuedMsg m;
+  memset(&m, 0, sizeof(m));
+  m.ts = ts;
+  m.topic = (uint8_t)(ts & 1);
+  m.len = (uint8_t)snprintf(m.payload, sizeof(m.payload), "{\"ts\":%lu}", (unsigned long)ts);
+  mqttQueueRecordSeal(m, ring.nextSeq);
+  slots[(ring.head + ring.count) % SLOTS] = m;
+  ring.count++;
+  ring.nextSeq++;
+}
+
+static uint32_t pop() {
+  uint32_t ts = slots[ring.head].ts;
+  mqttQueueRingPop(ring, SLOTS, nowMs);
+  sync();
+  return ts;
+}
+
+// Redémarrage: relecture des slots, en-tête = plancher
+static void reboot() {
+  uint32_t seqs[SLOTS];
+  for (int i = 0; i < SLOTS; i++) seqs[i] = mqttQueueRecordValid(slots[i]) ? slots[i].seq : 0;
+  uint32_t floorSeq = header.magic == MQTT_QUEUE_MAGIC ? header.headSeq : 0;
+  mqttQueueRebuild(seqs, SLOTS, floorSeq, ring);
+  if (ring.headSeq != floorSeq) writeHeader();
+}
+
+void setUp(void) {
+  memset(slots, 0, sizeof(slots));
+  memset(&header, 0, sizeof(header));
+  headerWrites = 0;
+  nowMs = 1000;
+  reboot();
+  headerWrites = 0;
+}
+
+void tearDown(void) {}
+
+// ----- Records -----
+static void test_record_seal_and_corruption(void) {
+  append(42);
+  MqttQueuedMsg m = slots[0];
+  TEST_ASSERT_TRUE(mqttQueueRecordValid(m));
+  TEST_ASSERT_EQUAL_UINT32(1, m.seq);
+  // Un bit changé n'importe où dans la partie utile invalide le record
+  size_t used = offsetof(MqttQueuedMsg, payload) + m.len;
+  for (size_t i = 0; i < used; i++) {
+    if (i == offsetof(MqttQueuedMsg, crc) || i == offsetof(MqttQueuedMsg, crc) + 1) continue;
+    for (int b = 0; b < 8; b++) {
+      MqttQueuedMsg c = m;
+      ((uint8_t *)&c)[i] ^= (uint8_t)(1 << b);
+      TEST_ASSERT_FALSE_MESSAGE(mqttQueueRecordValid(c), "bit changé accepté");
+    }
+  }
+  // Slot vide (seq 0) et longueur hors limite
+  MqttQueuedMsg z;
+  memset(&z, 0, sizeof(z));
+  z.crc = mqttQueueRecordCrc(z);
+  TEST_ASSERT_FALSE(mqttQueueRecordValid(z));
+  MqttQueuedMsg big = m;
+  big.len = MQTT_QUEUE_PAYLOAD_MAX + 1;
+  big.crc = mqttQueueRecordCrc(big);
+  TEST_ASSERT_FALSE(mqttQueueRecordValid(big));
+}
+
+// ----- Reconstruction -----
+static void test_empty_file(void) {
+  TEST_ASSERT_EQUAL(0, ring.count);
+  TEST_ASSERT_EQUAL_UINT32(1, ring.nextSeq);
+  TEST_ASSERT_EQUAL_UINT32(1, ring.headSeq);
+}
+
+static void test_appends_need_no_header(void) {
+  for (uint32_t i = 0; i < 40; i++) append(100 + i);
+  TEST_ASSERT_EQUAL(0, headerWrites);
+  reboot();
+  TEST_ASSERT_EQUAL(40, ring.count);
+  TEST_ASSERT_EQUAL(0, ring.head);
+  TEST_ASSERT_EQUAL_UINT32(41, ring.nextSeq);
+  TEST_ASSERT_EQUAL_UINT32(100, pop());
+}
+
+// Coupure après chaque retrait d'un rejeu: aucun message non envoyé perdu,
+// au plus un lot d'en-tête renvoyé, ordre conservé
+static void test_power_cut_during_replay(void) {
+  const uint32_t total = 50;
+  for (uint32_t cut = 0; cut <= total; cut++) {
+    setUp();
+    for (uint32_t i = 0; i < total; i++) append(1000 + i);
+    for (uint32_t i = 0; i < cut; i++) {
+      nowMs += 20;
+      TEST_ASSERT_EQUAL_UINT32(1000 + i, pop());
+    }
+    reboot();
+    uint32_t resent = ring.count - (total - cut);
+    TEST_ASSERT_TRUE_MESSAGE(ring.count >= total - cut, "message non envoyé perdu");
+    TEST_ASSERT_TRUE_MESSAGE(resent <= MQTT_QUEUE_HEADER_BATCH, "plus d'un lot renvoyé");
+    uint32_t expect = 1000 + cut - resent;
+    while (ring.count > 0) TEST_ASSERT_EQUAL_UINT32(expect++, pop());
+    TEST_ASSERT_EQUAL_UINT32(1000 + total, expect);
+  }
+}
+
+// Coupure pendant l'écriture d'un record: seul le début est en flash
+static void test_torn_record(void) {
+  for (uint32_t i = 0; i < 10; i++) append(i);
+  MqttQueuedMsg old = slots[10];
+  append(10);
+  for (size_t cut = 1; cut < offsetof(MqttQueuedMsg, payload) + slots[10].len; cut++) {
+    MqttQueuedMsg torn = old;
+    memcpy(&torn, &slots[10], cut);
+    TEST_ASSERT_FALSE(mqttQueueRecordValid(torn));
+  }
+  // Record entièrement écrit au-delà de la partie couverte par le CRC: valide
+  MqttQueuedMsg tail = old;
+  memcpy(&tail, &slots[10], offsetof(MqttQueuedMsg, payload) + slots[10].len);
+  TEST_ASSERT_TRUE(mqttQueueRecordValid(tail));
+  MqttQueuedMsg torn = old;
+  memcpy(&torn, &slots[10], offsetof(MqttQueuedMsg, payload) + 1);
+  slots[10] = torn;
+  reboot();
+  TEST_ASSERT_EQUAL(10, ring.count);
+  // Le slot est réécrit au même numéro de séquence
+  append(11);
+  reboot();
+  TEST_ASSERT_EQUAL(11, ring.count);
+  for (uint32_t i = 0; i < 10; i++) pop();
+  TEST_ASSERT_EQUAL_UINT32(11, pop());
+}
+
+// File vidée puis remplie à nouveau depuis le slot 0: les records périmés
+// des slots suivants ne reviennent pas, même sans en-tête écrit
+static void test_stale_records_after_drain(void) {
+  for (uint32_t i = 0; i < 30; i++) append(i);
+  for (uint32_t i = 0; i < 30; i++) pop();
+  TEST_ASSERT_EQUAL(0, ring.head);
+  TEST_ASSERT_EQUAL(0, ring.pending);            // file vidée: en-tête écrit aussitôt
+  for (uint32_t i = 0; i < 5; i++) append(500 + i);
+  reboot();
+  TEST_ASSERT_EQUAL(5, ring.count);
+  TEST_ASSERT_EQUAL_UINT32(36, ring.nextSeq);
+  // En-tête perdu (corrompu): plancher 0, les anciens records 6..30 des
+  // slots 5..29 ne prolongent pas la suite qui finit au plus récent
+  header.magic = 0;
+  reboot();
+  TEST_ASSERT_EQUAL(5, ring.count);
+  TEST_ASSERT_EQUAL(0, ring.head);
+  TEST_ASSERT_EQUAL_UINT32(31, ring.headSeq);
+  TEST_ASSERT_EQUAL_UINT32(36, ring.nextSeq);
+  TEST_ASSERT_EQUAL_UINT32(500, pop());
+}
+
+// Anneau plein qui a tourné plusieurs fois
+static void test_wrap_around(void) {
+  uint32_t next = 0, expect = 0;
+  for (int round = 0; round < 10; round++) {
+    while (ring.count < SLOTS) append(next++);
+    for (int i = 0; i < SLOTS / 2 + round; i++) TEST_ASSERT_EQUAL_UINT32(expect++, pop());
+    reboot();
+    expect -= ring.count - (next - expect);     // lot renvoyé après la relecture
+  }
+  while (ring.count > 0) TEST_ASSERT_EQUAL_UINT32(expect++, pop());
+  TEST_ASSERT_EQUAL_UINT32(next, expect);
+}
+
+static void test_header_due_by_time(void) {
+  for (uint32_t i = 0; i < 10; i++) append(i);
+  pop();
+  TEST_ASSERT_EQUAL(1, ring.pending);
+  nowMs += MQTT_QUEUE_HEADER_MS - 1;
+  sync();
+  TEST_ASSERT_EQUAL(1, ring.pending);
+  nowMs += 1;
+  sync();
+  TEST_ASSERT_EQUAL(0, ring.pending);
+  // Passage de millis() par zéro
+  nowMs = 0xFFFFFF00UL;
+  pop();
+  nowMs = 0x100;
+  sync();
+  TEST_ASSERT_EQUAL(0, ring.pending);
+}
+
+// Écritures d'en-tête pour un débordement puis un rejeu (1 message / 20 ms)
+static void test_header_writes_per_replay(void) {
+  for (uint32_t i = 0; i < SLOTS; i++) append(i);
+  TEST_ASSERT_EQUAL(0, headerWrites);
+  for (uint32_t i = 0; i < SLOTS; i++) {
+    nowMs += 20;
+    pop();
+  }
+  TEST_ASSERT_EQUAL(SLOTS / MQTT_QUEUE_HEADER_BATCH, headerWrites);
+  char msg[120];
+  snprintf(msg, sizeof(msg), "%d messages en flash puis rejoués: %lu écritures d'en-tête (avant: %d)", SLOTS,
+           (unsigned long)headerWrites, 2 * SLOTS);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_record_seal_and_corruption);
+  RUN_TEST(test_empty_file);
+  RUN_TEST(test_appends_need_no_header);
+  RUN_TEST(test_power_cut_during_replay);
+  RUN_TEST(test_torn_record);
+  RUN_TEST(test_stale_records_after_drain);
+  RUN_TEST(test_wrap_around);
+  RUN_TEST(test_header_due_by_time);
+  RUN_TEST(test_header_writes_per_replay);
+  return UNITY_END();
+}
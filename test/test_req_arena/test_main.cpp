@@ -0,0 +1,138 @@
+// Arène par requête (req_arena.h): alignement, ordre pile de reqFree,
+// reqRealloc sur place ou par copie, repli sur le tas quand la zone est
+// pleine, fin de requête (pics par route, zone vidée).
+#include <unity.h>
+#include <stdio.h>
+#include "req_arena.h"
+
+static uint8_t mem[1024] __attribute__((aligned(REQ_ARENA_ALIGN)));
+static ReqArena a;
+
+void setUp(void) {
+  a = REQ_ARENA_INIT(mem);
+}
+
+void tearDown(void) {}
+
+static void test_alignment_and_accounting(void) {
+  void *p1 = reqAlloc(a, 10);
+  void *p2 = reqAlloc(a, 1);
+  TEST_ASSERT_TRUE(reqArenaOwns(a, p1));
+  TEST_ASSERT_EQUAL(0, (uintptr_t)p1 % REQ_ARENA_ALIGN);
+  TEST_ASSERT_EQUAL(0, (uintptr_t)p2 % REQ_ARENA_ALIGN);
+  // En-tête 8 + 16, puis en-tête 8 + 8
+  TEST_ASSERT_EQUAL_UINT32(40, a.used);
+  TEST_ASSERT_EQUAL_PTR((uint8_t *)p1 + 16 + sizeof(ReqArenaBlock), p2);
+}
+
+// Seul le dernier bloc est rendu; les autres attendent reqArenaEnd
+static void test_stack_order_free(void) {
+  void *p1 = reqAlloc(a, 100);
+  void *p2 = reqAlloc(a, 200);
+  void *p3 = reqAlloc(a, 300);
+  uint32_t full = a.used;
+  reqFree(a, p2);                                // pas le dernier: ignoré
+  TEST_ASSERT_EQUAL_UINT32(full, a.used);
+  reqFree(a, p3);
+  uint32_t two = a.used;
+  TEST_ASSERT_LESS_THAN(full, two);
+  reqFree(a, p2);                                // devenu le dernier
+  reqFree(a, p1);
+  TEST_ASSERT_EQUAL_UINT32(0, a.used);
+  TEST_ASSERT_EQUAL_UINT32(REQ_ARENA_NONE, a.last);
+  // Place rendue réutilisée à la même adresse
+  TEST_ASSERT_EQUAL_PTR(p1, reqAlloc(a, 50));
+  reqFree(a, nullptr);
+  TEST_ASSERT_EQUAL_UINT32(full, a.peak);
+}
+
+static void test_realloc_in_place(void) {
+  void *p1 = reqAlloc(a, 16);
+  uint8_t *p2 = (uint8_t *)reqAlloc(a, 16);
+  memset(p2, 0x5A, 16);
+  void *q = reqRealloc(a, p2, 500);              // dernier bloc: agrandi sur place
+  TEST_ASSERT_EQUAL_PTR(p2, q);
+  TEST_ASSERT_EQUAL_HEX8(0x5A, p2[15]);
+  TEST_ASSERT_EQUAL_UINT32(2 * sizeof(ReqArenaBlock) + 16 + 504, a.used);
+  q = reqRealloc(a, p2, 8);                      // et rétréci sur place
+  TEST_ASSERT_EQUAL_PTR(p2, q);
+  TEST_ASSERT_EQUAL_UINT32(2 * sizeof(ReqArenaBlock) + 16 + 8, a.used);
+  TEST_ASSERT_EQUAL_UINT32(2 * sizeof(ReqArenaBlock) + 16 + 504, a.peak);
+  // Depuis nullptr: simple allocation
+  void *p3 = reqRealloc(a, nullptr, 24);
+  TEST_ASSERT_TRUE(reqArenaOwns(a, p3));
+  (void)p1;
+}
+
+// Bloc qui n'est pas le dernier: copié plus haut, l'ancien reste jusqu'à la fin
+static void test_realloc_moves_inner_block(void) {
+  uint8_t *p1 = (uint8_t *)reqAlloc(a, 32);
+  for (int i = 0; i < 32; i++) p1[i] = (uint8_t)i;
+  void *p2 = reqAlloc(a, 32);
+  uint8_t *q = (uint8_t *)reqRealloc(a, p1, 64);
+  TEST_ASSERT_TRUE(q > (uint8_t *)p2);
+  TEST_ASSERT_TRUE(reqArenaOwns(a, q));
+  for (int i = 0; i < 32; i++) TEST_ASSERT_EQUAL_UINT8(i, q[i]);
+  TEST_ASSERT_EQUAL_UINT32(0, a.heapFallbacks);
+}
+
+static void test_heap_fallback(void) {
+  void *small = reqAlloc(a, 900);
+  void *big = reqAlloc(a, 200);                  // reste < 200: tas
+  TEST_ASSERT_TRUE(reqArenaOwns(a, small));
+  TEST_ASSERT_NOT_NULL(big);
+  TEST_ASSERT_FALSE(reqArenaOwns(a, big));
+  TEST_ASSERT_EQUAL_UINT32(1, a.heapAllocs);
+  TEST_ASSERT_EQUAL_UINT32(1, a.heapFallbacks);
+  big = reqRealloc(a, big, 4000);                // bloc du tas: realloc()
+  TEST_ASSERT_FALSE(reqArenaOwns(a, big));
+  reqFree(a, big);                               // free()
+  TEST_ASSERT_NULL(reqArenaTake(a, 2000));       // plus grand que la zone
+}
+
+// Agrandi au-delà de la zone: contenu copié sur le tas, zone libérée
+static void test_realloc_spills_to_heap(void) {
+  uint8_t *p = (uint8_t *)reqAlloc(a, 100);
+  memset(p, 7, 100);
+  uint8_t *q = (uint8_t *)reqRealloc(a, p, 5000);
+  TEST_ASSERT_NOT_NULL(q);
+  TEST_ASSERT_FALSE(reqArenaOwns(a, q));
+  TEST_ASSERT_EQUAL_UINT8(7, q[99]);
+  TEST_ASSERT_EQUAL_UINT32(0, a.used);
+  TEST_ASSERT_EQUAL_UINT32(1, a.heapFallbacks);
+  reqFree(a, q);
+}
+
+static void test_end_of_request(void) {
+  ReqArenaRoute r = {"GET /api/status"};
+  reqAlloc(a, 300);
+  void *h = reqAlloc(a, 2000);
+  uint32_t peak = a.peak;
+  reqFree(a, h);
+  reqArenaEnd(a, r);
+  TEST_ASSERT_EQUAL_UINT32(0, a.used);
+  TEST_ASSERT_EQUAL_UINT32(REQ_ARENA_NONE, a.last);
+  TEST_ASSERT_EQUAL_UINT32(0, a.peak);
+  TEST_ASSERT_EQUAL_UINT32(0, a.heapAllocs);
+  TEST_ASSERT_EQUAL_UINT32(1, a.heapFallbacks);
+  TEST_ASSERT_EQUAL_UINT32(1, r.requests);
+  TEST_ASSERT_EQUAL_UINT32(peak, r.peak);
+  TEST_ASSERT_EQUAL_UINT32(1, r.heapAllocs);
+  reqAlloc(a, 8);
+  reqArenaEnd(a, r);
+  TEST_ASSERT_EQUAL_UINT32(2, r.requests);
+  TEST_ASSERT_EQUAL_UINT32(peak, r.peak);        // le pic reste
+  TEST_ASSERT_EQUAL_UINT32(16, r.last);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_alignment_and_accounting);
+  RUN_TEST(test_stack_order_free);
+  RUN_TEST(test_realloc_in_place);
+  RUN_TEST(test_realloc_moves_inner_block);
+  RUN_TEST(test_heap_fallback);
+  RUN_TEST(test_realloc_spills_to_heap);
+  RUN_TEST(test_end_of_request);
+  return UNITY_END();
+}
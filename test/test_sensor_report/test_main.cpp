@@ -0,0 +1,113 @@
+// Reporting capteurs (sensor_report.h): deadband absolu, relatif avec son
+// plancher près de zéro, intervalles min/max, états invalid/stale.
+#include <unity.h>
+#include <stdio.h>
+#include "sensor_report.h"
+
+static SensorChannel ch;
+
+// Mesure à t puis rapport si dû; vrai si publié
+static bool step(float v, uint32_t t) {
+  sensorSample(ch, v, t);
+  if (!sensorReportDue(ch, t)) return false;
+  sensorMarkReported(ch, t);
+  return true;
+}
+
+void setUp(void) {
+  sensorChannelInit(ch, "t", -40.0f, 80.0f, 0.0f, 0, 0);
+}
+
+void tearDown(void) {}
+
+static void test_absolute_deadband(void) {
+  ch.deadbandAbs = 0.2f;
+  TEST_ASSERT_TRUE(step(20.0f, 0));
+  TEST_ASSERT_FALSE(step(20.1f, 1));
+  TEST_ASSERT_TRUE(step(20.25f, 2));
+  TEST_ASSERT_FALSE(step(20.1f, 3));
+}
+
+static void test_no_deadband_reports_any_change(void) {
+  TEST_ASSERT_TRUE(step(20.0f, 0));
+  TEST_ASSERT_FALSE(step(20.0f, 1));
+  TEST_ASSERT_TRUE(step(20.01f, 2));
+}
+
+static void test_relative_deadband(void) {
+  ch.deadbandPct = 5.0f;
+  TEST_ASSERT_TRUE(step(40.0f, 0));              // seuil 2.0
+  TEST_ASSERT_FALSE(step(41.9f, 1));
+  TEST_ASSERT_TRUE(step(42.0f, 2));              // seuil 2.1
+  TEST_ASSERT_FALSE(step(40.0f, 3));
+  TEST_ASSERT_TRUE(step(39.8f, 4));
+}
+
+// Dernière valeur publiée à 0: le seuil relatif seul vaudrait 0
+static void test_relative_floor_at_zero(void) {
+  ch.deadbandPct = 10.0f;
+  TEST_ASSERT_TRUE(step(0.0f, 0));
+  TEST_ASSERT_EQUAL_FLOAT(SENSOR_DEADBAND_MIN, sensorDeadband(ch));
+  TEST_ASSERT_FALSE(step(0.0005f, 1));
+  TEST_ASSERT_FALSE(step(-0.0005f, 2));
+  TEST_ASSERT_TRUE(step(0.002f, 3));
+  // Bruit autour de 0: sans plancher, chaque échantillon serait publié
+  ch.deadbandAbs = 0.2f;
+  TEST_ASSERT_TRUE(step(0.5f, 4));
+  TEST_ASSERT_TRUE(step(0.0f, 5));
+  int published = 0;
+  for (uint32_t i = 0; i < 100; i++) published += step((i & 1) ? 0.1f : -0.1f, 10 + i);
+  TEST_ASSERT_EQUAL(0, published);
+}
+
+// Les deux réglés: le plus grand des deux seuils
+static void test_relative_and_absolute(void) {
+  ch.deadbandPct = 1.0f;
+  ch.deadbandAbs = 0.5f;
+  TEST_ASSERT_TRUE(step(10.0f, 0));              // max(0.1, 0.5)
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, sensorDeadband(ch));
+  TEST_ASSERT_FALSE(step(10.4f, 1));
+  TEST_ASSERT_TRUE(step(10.5f, 2));
+  ch.deadbandAbs = 0.0f;
+  TEST_ASSERT_TRUE(step(70.0f, 3));              // max(0.7, 0)
+  TEST_ASSERT_EQUAL_FLOAT(0.7f, sensorDeadband(ch));
+  TEST_ASSERT_FALSE(step(70.6f, 4));
+}
+
+static void test_intervals(void) {
+  ch.deadbandAbs = 1.0f;
+  ch.minIntervalMs = 1000;
+  ch.maxIntervalMs = 60000;
+  TEST_ASSERT_TRUE(step(20.0f, 0));
+  TEST_ASSERT_FALSE(step(25.0f, 500));           // trop tôt
+  TEST_ASSERT_TRUE(step(25.0f, 1000));
+  TEST_ASSERT_FALSE(step(25.0f, 60999));
+  TEST_ASSERT_TRUE(step(25.0f, 61000));          // heartbeat
+}
+
+static void test_invalid_and_stale(void) {
+  ch.deadbandAbs = 1.0f;
+  ch.staleMs = 1000;
+  sensorSample(ch, NAN, 0);
+  TEST_ASSERT_EQUAL(SENSOR_INVALID, sensorState(ch, 0));
+  TEST_ASSERT_EQUAL(SENSOR_REGISTER_INVALID, sensorRegisterValue(ch, 0));
+  TEST_ASSERT_TRUE(step(21.5f, 10));
+  TEST_ASSERT_EQUAL(215, sensorRegisterValue(ch, 10));
+  sensorSample(ch, 200.0f, 500);                 // hors plage: échec
+  TEST_ASSERT_EQUAL_UINT32(2, ch.readErrors);
+  TEST_ASSERT_FALSE(sensorReportDue(ch, 500));
+  TEST_ASSERT_TRUE(sensorReportDue(ch, 1011));   // ok -> stale
+  TEST_ASSERT_EQUAL(SENSOR_STALE, sensorState(ch, 1011));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_absolute_deadband);
+  RUN_TEST(test_no_deadband_reports_any_change);
+  RUN_TEST(test_relative_deadband);
+  RUN_TEST(test_relative_floor_at_zero);
+  RUN_TEST(test_relative_and_absolute);
+  RUN_TEST(test_intervals);
+  RUN_TEST(test_invalid_and_stale);
+  return UNITY_END();
+}
@@ -0,0 +1,193 @@
+// Répartition des sockets W5500 (socket_budget.h) sur une table simulée:
+// plafonds, réservation MQTT pendant une rafale HTTP, choix de l'évincé,
+// fermeture sur inactivité.
+#include <unity.h>
+#include "socket_budget.h"
+
+// ----- Table W5500 simulée -----
+static uint8_t fakeStatus[SOCK_BUDGET_MAX];
+static uint8_t fakeOwner[SOCK_BUDGET_MAX];
+static uint16_t fakeRx[SOCK_BUDGET_MAX];
+static uint32_t fakeCloses;
+
+static uint8_t fakeSr(uint8_t s) { return fakeStatus[s]; }
+static uint16_t fakeRxSize(uint8_t s) { return fakeRx[s]; }
+static uint8_t fakeService(uint8_t s) { return fakeOwner[s]; }
+static void fakeClose(uint8_t s) {
+  fakeStatus[s] = SOCK_ST_CLOSED;
+  fakeOwner[s] = SOCK_SVC_NONE;
+  fakeRx[s] = 0;
+  fakeCloses++;
+}
+
+// Premier socket fermé, comme la lib Ethernet; -1 si la table est pleine
+static int fakeOpen(uint8_t svc, uint8_t status) {
+  for (int s = 0; s < SOCK_BUDGET_MAX; s++) {
+    if (fakeStatus[s] != SOCK_ST_CLOSED) continue;
+    fakeStatus[s] = status;
+    fakeOwner[s] = svc;
+    return s;
+  }
+  return -1;
+}
+
+static SockBudget budget;
+static uint32_t now;
+
+// Répartition du firmware (main.cpp): MQTT 1/1, HTTP 1/4 (5 s), Modbus 1/3 (60 s)
+void setUp(void) {
+  memset(fakeStatus, 0, sizeof(fakeStatus));
+  memset(fakeOwner, 0, sizeof(fakeOwner));
+  memset(fakeRx, 0, sizeof(fakeRx));
+  fakeCloses = 0;
+  SockBudgetIo io = {fakeSr, fakeRxSize, fakeService, fakeClose};
+  sockBudgetInit(budget, io, SOCK_BUDGET_MAX);
+  sockBudgetSetService(budget, SOCK_SVC_HTTP, 1, 4, 5000);
+  sockBudgetSetService(budget, SOCK_SVC_MODBUS, 1, 3, 60000);
+  sockBudgetSetService(budget, SOCK_SVC_MQTT, 1, 1, 0);
+  now = 1000;
+}
+
+void tearDown(void) {}
+
+// Demande puis ouverture, comme netServerAccept()
+static int tryOpen(uint8_t svc, uint8_t status = SOCK_ST_ESTABLISHED) {
+  sockBudgetRefresh(budget, now);
+  if (!sockBudgetMayOpen(budget, svc, now)) return -1;
+  return fakeOpen(svc, status);
+}
+
+static int burst(uint8_t svc, int n) {
+  int opened = 0;
+  for (int k = 0; k < n; k++) {
+    if (tryOpen(svc) >= 0) opened++;
+  }
+  return opened;
+}
+
+static void test_http_burst_capped(void) {
+  TEST_ASSERT_EQUAL(4, burst(SOCK_SVC_HTTP, 10));
+  TEST_ASSERT_EQUAL(4, budget.svc[SOCK_SVC_HTTP].used);
+  // Refus consécutifs: un seul passage à l'état bloqué
+  TEST_ASSERT_EQUAL(1, budget.svc[SOCK_SVC_HTTP].refusals);
+  TEST_ASSERT_TRUE(budget.svc[SOCK_SVC_HTTP].blocked);
+}
+
+static void test_modbus_capped_and_reservations_kept(void) {
+  burst(SOCK_SVC_HTTP, 10);
+  // 4 libres, MQTT en réserve 1: Modbus prend ses 3 (plafond) et pas plus
+  TEST_ASSERT_EQUAL(3, burst(SOCK_SVC_MODBUS, 5));
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(1, budget.free);
+  // Le dernier socket libre reste à MQTT
+  TEST_ASSERT_FALSE(sockBudgetMayOpen(budget, SOCK_SVC_HTTP, now));
+  TEST_ASSERT_FALSE(sockBudgetMayOpen(budget, SOCK_SVC_MODBUS, now));
+}
+
+static void test_mqtt_reservation_under_http_burst(void) {
+  burst(SOCK_SVC_HTTP, 10);
+  burst(SOCK_SVC_MODBUS, 10);
+  TEST_ASSERT_TRUE(tryOpen(SOCK_SVC_MQTT) >= 0);
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(0, budget.free);
+  TEST_ASSERT_EQUAL(1, budget.svc[SOCK_SVC_MQTT].used);
+  // Plafond MQTT: une seule connexion
+  TEST_ASSERT_FALSE(sockBudgetMayOpen(budget, SOCK_SVC_MQTT, now));
+  TEST_ASSERT_EQUAL(0, fakeCloses);
+}
+
+static void test_mqtt_evicts_oldest_over_reservation(void) {
+  burst(SOCK_SVC_HTTP, 10);                // sockets 0..3
+  burst(SOCK_SVC_MODBUS, 10);              // sockets 4..6
+  int other = fakeOpen(SOCK_SVC_OTHER, 0x22);   // DHCP/DNS prend le dernier
+  TEST_ASSERT_EQUAL(7, other);
+  // Le socket HTTP 0 vient de servir; 1 est le plus ancien inactif
+  now += 100;
+  sockBudgetTouch(budget, 0, now);
+  now += 50;
+  sockBudgetTouch(budget, 2, now);
+  sockBudgetTouch(budget, 3, now);
+  for (int s = 4; s < 7; s++) sockBudgetTouch(budget, (uint8_t)s, now);
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(0, budget.free);
+
+  TEST_ASSERT_TRUE(sockBudgetMayOpen(budget, SOCK_SVC_MQTT, now));
+  TEST_ASSERT_EQUAL(1, fakeCloses);
+  TEST_ASSERT_EQUAL(SOCK_ST_CLOSED, fakeStatus[1]);
+  TEST_ASSERT_EQUAL(1, budget.svc[SOCK_SVC_HTTP].evictions);
+  TEST_ASSERT_EQUAL(0, budget.svc[SOCK_SVC_MODBUS].evictions);
+  // Ni l'actif, ni le socket OTHER
+  TEST_ASSERT_EQUAL(SOCK_ST_ESTABLISHED, fakeStatus[0]);
+  TEST_ASSERT_EQUAL(0x22, fakeStatus[7]);
+  TEST_ASSERT_EQUAL(1, fakeOpen(SOCK_SVC_MQTT, SOCK_ST_ESTABLISHED));
+}
+
+static void test_no_eviction_within_reservations(void) {
+  // Chaque service à sa réservation: rien à prendre, même pour MQTT
+  tryOpen(SOCK_SVC_HTTP);
+  tryOpen(SOCK_SVC_MODBUS);
+  for (int k = 0; k < 6; k++) fakeOpen(SOCK_SVC_OTHER, 0x22);
+  now += 4000;
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_FALSE(sockBudgetMayOpen(budget, SOCK_SVC_MQTT, now));
+  TEST_ASSERT_EQUAL(1, budget.svc[SOCK_SVC_MQTT].refusals);
+  TEST_ASSERT_EQUAL(0, fakeCloses);
+}
+
+static void test_listen_never_evicted(void) {
+  int l = tryOpen(SOCK_SVC_HTTP, SOCK_ST_LISTEN);
+  TEST_ASSERT_TRUE(l >= 0);
+  now += 600000;
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(SOCK_ST_LISTEN, fakeStatus[l]);
+  TEST_ASSERT_EQUAL(0, fakeCloses);
+}
+
+static void test_idle_timeout_per_service(void) {
+  int h = tryOpen(SOCK_SVC_HTTP);
+  int m = tryOpen(SOCK_SVC_MODBUS);
+  int q = tryOpen(SOCK_SVC_MQTT);
+  now += 5000;
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(SOCK_ST_ESTABLISHED, fakeStatus[h]);   // 5 s pile: pas encore
+  now += 1;
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(SOCK_ST_CLOSED, fakeStatus[h]);
+  TEST_ASSERT_EQUAL(1, budget.svc[SOCK_SVC_HTTP].evictions);
+  // Modbus: 60 s; MQTT: jamais
+  now += 60000;
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(SOCK_ST_CLOSED, fakeStatus[m]);
+  now += 3600000;
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(SOCK_ST_ESTABLISHED, fakeStatus[q]);
+  TEST_ASSERT_EQUAL(0, budget.svc[SOCK_SVC_MQTT].evictions);
+}
+
+static void test_rx_activity_postpones_idle(void) {
+  int h = tryOpen(SOCK_SVC_HTTP);
+  for (int k = 0; k < 4; k++) {
+    now += 4000;
+    fakeRx[h] = (uint16_t)(fakeRx[h] + 10);   // octets reçus, non lus
+    sockBudgetRefresh(budget, now);
+  }
+  TEST_ASSERT_EQUAL(SOCK_ST_ESTABLISHED, fakeStatus[h]);
+  now += 5001;
+  sockBudgetRefresh(budget, now);
+  TEST_ASSERT_EQUAL(SOCK_ST_CLOSED, fakeStatus[h]);
+}
+
+int main(int argc, char **argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_http_burst_capped);
+  RUN_TEST(test_modbus_capped_and_reservations_kept);
+  RUN_TEST(test_mqtt_reservation_under_http_burst);
+  RUN_TEST(test_mqtt_evicts_oldest_over_reservation);
+  RUN_TEST(test_no_eviction_within_reservations);
+  RUN_TEST(test_listen_never_evicted);
+  RUN_TEST(test_idle_timeout_per_service);
+  RUN_TEST(test_rx_activity_postpones_idle);
+  return UNITY_END();
+}
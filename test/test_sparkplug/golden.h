@@ -0,0 +1,305 @@
+// Généré par tools/tests/sparkplug_golden.py (protoc), ne pas modifier.
+// Au-dessus de chaque tableau: le message relu par protoc --decode.
+#ifndef SPARKPLUG_GOLDEN_H
+#define SPARKPLUG_GOLDEN_H
+
+#include <stdint.h>
+
+// timestamp: 1700000000000
+// metrics {
+//   name: "bdSeq"
+//   datatype: 8
+//   long_value: 3
+// }
+// metrics {
+//   name: "Relays/0"
+//   alias: 1
+//   datatype: 11
+//   boolean_value: true
+// }
+// metrics {
+//   name: "Relays/1"
+//   alias: 2
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Relays/2"
+//   alias: 3
+//   datatype: 11
+//   boolean_value: true
+// }
+// metrics {
+//   name: "Relays/3"
+//   alias: 4
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Relays/4"
+//   alias: 5
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Relays/5"
+//   alias: 6
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Relays/6"
+//   alias: 7
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Relays/7"
+//   alias: 8
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Inputs/0"
+//   alias: 9
+//   datatype: 11
+//   boolean_value: true
+// }
+// metrics {
+//   name: "Inputs/1"
+//   alias: 10
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Inputs/2"
+//   alias: 11
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Inputs/3"
+//   alias: 12
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Inputs/4"
+//   alias: 13
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Inputs/5"
+//   alias: 14
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Inputs/6"
+//   alias: 15
+//   datatype: 11
+//   boolean_value: false
+// }
+// metrics {
+//   name: "Inputs/7"
+//   alias: 16
+//   datatype: 11
+//   boolean_value: true
+// }
+// metrics {
+//   name: "Sensors/Temperature"
+//   alias: 17
+//   datatype: 9
+//   float_value: 21.5
+// }
+// metrics {
+//   name: "Sensors/Humidity"
+//   alias: 18
+//   datatype: 9
+//   is_null: true
+// }
+// metrics {
+//   name: "System/Uptime"
+//   alias: 19
+//   datatype: 8
+//   long_value: 123456
+// }
+// metrics {
+//   name: "System/IP"
+//   alias: 20
+//   datatype: 12
+//   string_value: "192.168.1.50"
+// }
+// metrics {
+//   name: "Node Control/Rebirth"
+//   alias: 21
+//   datatype: 11
+//   boolean_value: false
+// }
+// seq: 0
+static const uint8_t GOLDEN_NBIRTH[] = {
+  0x08, 0x80, 0xd0, 0x95, 0xff, 0xbc, 0x31, 0x12, 0x0b, 0x0a, 0x05, 0x62, 0x64, 0x53, 0x65, 0x71,
+  0x20, 0x08, 0x58, 0x03, 0x12, 0x10, 0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61, 0x79, 0x73, 0x2f, 0x30,
+  0x10, 0x01, 0x20, 0x0b, 0x70, 0x01, 0x12, 0x10, 0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61, 0x79, 0x73,
+  0x2f, 0x31, 0x10, 0x02, 0x20, 0x0b, 0x70, 0x00, 0x12, 0x10, 0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61,
+  0x79, 0x73, 0x2f, 0x32, 0x10, 0x03, 0x20, 0x0b, 0x70, 0x01, 0x12, 0x10, 0x0a, 0x08, 0x52, 0x65,
+  0x6c, 0x61, 0x79, 0x73, 0x2f, 0x33, 0x10, 0x04, 0x20, 0x0b, 0x70, 0x00, 0x12, 0x10, 0x0a, 0x08,
+  0x52, 0x65, 0x6c, 0x61, 0x79, 0x73, 0x2f, 0x34, 0x10, 0x05, 0x20, 0x0b, 0x70, 0x00, 0x12, 0x10,
+  0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61, 0x79, 0x73, 0x2f, 0x35, 0x10, 0x06, 0x20, 0x0b, 0x70, 0x00,
+  0x12, 0x10, 0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61, 0x79, 0x73, 0x2f, 0x36, 0x10, 0x07, 0x20, 0x0b,
+  0x70, 0x00, 0x12, 0x10, 0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61, 0x79, 0x73, 0x2f, 0x37, 0x10, 0x08,
+  0x20, 0x0b, 0x70, 0x00, 0x12, 0x10, 0x0a, 0x08, 0x49, 0x6e, 0x70, 0x75, 0x74, 0x73, 0x2f, 0x30,
+  0x10, 0x09, 0x20, 0x0b, 0x70, 0x01, 0x12, 0x10, 0x0a, 0x08, 0x49, 0x6e, 0x70, 0x75, 0x74, 0x73,
+  0x2f, 0x31, 0x10, 0x0a, 0x20, 0x0b, 0x70, 0x00, 0x12, 0x10, 0x0a, 0x08, 0x49, 0x6e, 0x70, 0x75,
+  0x74, 0x73, 0x2f, 0x32, 0x10, 0x0b, 0x20, 0x0b, 0x70, 0x00, 0x12, 0x10, 0x0a, 0x08, 0x49, 0x6e,
+  0x70, 0x75, 0x74, 0x73, 0x2f, 0x33, 0x10, 0x0c, 0x20, 0x0b, 0x70, 0x00, 0x12, 0x10, 0x0a, 0x08,
+  0x49, 0x6e, 0x70, 0x75, 0x74, 0x73, 0x2f, 0x34, 0x10, 0x0d, 0x20, 0x0b, 0x70, 0x00, 0x12, 0x10,
+  0x0a, 0x08, 0x49, 0x6e, 0x70, 0x75, 0x74, 0x73, 0x2f, 0x35, 0x10, 0x0e, 0x20, 0x0b, 0x70, 0x00,
+  0x12, 0x10, 0x0a, 0x08, 0x49, 0x6e, 0x70, 0x75, 0x74, 0x73, 0x2f, 0x36, 0x10, 0x0f, 0x20, 0x0b,
+  0x70, 0x00, 0x12, 0x10, 0x0a, 0x08, 0x49, 0x6e, 0x70, 0x75, 0x74, 0x73, 0x2f, 0x37, 0x10, 0x10,
+  0x20, 0x0b, 0x70, 0x01, 0x12, 0x1e, 0x0a, 0x13, 0x53, 0x65, 0x6e, 0x73, 0x6f, 0x72, 0x73, 0x2f,
+  0x54, 0x65, 0x6d, 0x70, 0x65, 0x72, 0x61, 0x74, 0x75, 0x72, 0x65, 0x10, 0x11, 0x20, 0x09, 0x65,
+  0x00, 0x00, 0xac, 0x41, 0x12, 0x18, 0x0a, 0x10, 0x53, 0x65, 0x6e, 0x73, 0x6f, 0x72, 0x73, 0x2f,
+  0x48, 0x75, 0x6d, 0x69, 0x64, 0x69, 0x74, 0x79, 0x10, 0x12, 0x20, 0x09, 0x38, 0x01, 0x12, 0x17,
+  0x0a, 0x0d, 0x53, 0x79, 0x73, 0x74, 0x65, 0x6d, 0x2f, 0x55, 0x70, 0x74, 0x69, 0x6d, 0x65, 0x10,
+  0x13, 0x20, 0x08, 0x58, 0xc0, 0xc4, 0x07, 0x12, 0x1d, 0x0a, 0x09, 0x53, 0x79, 0x73, 0x74, 0x65,
+  0x6d, 0x2f, 0x49, 0x50, 0x10, 0x14, 0x20, 0x0c, 0x7a, 0x0c, 0x31, 0x39, 0x32, 0x2e, 0x31, 0x36,
+  0x38, 0x2e, 0x31, 0x2e, 0x35, 0x30, 0x12, 0x1c, 0x0a, 0x14, 0x4e, 0x6f, 0x64, 0x65, 0x20, 0x43,
+  0x6f, 0x6e, 0x74, 0x72, 0x6f, 0x6c, 0x2f, 0x52, 0x65, 0x62, 0x69, 0x72, 0x74, 0x68, 0x10, 0x15,
+  0x20, 0x0b, 0x70, 0x00, 0x18, 0x00,
+};
+
+// timestamp: 1700000001000
+// metrics {
+//   alias: 3
+//   boolean_value: true
+// }
+// metrics {
+//   alias: 9
+//   boolean_value: true
+// }
+// metrics {
+//   alias: 17
+//   float_value: 22.25
+// }
+// metrics {
+//   alias: 19
+//   long_value: 124456
+// }
+// seq: 5
+static const uint8_t GOLDEN_NDATA[] = {
+  0x08, 0xe8, 0xd7, 0x95, 0xff, 0xbc, 0x31, 0x12, 0x04, 0x10, 0x03, 0x70, 0x01, 0x12, 0x04, 0x10,
+  0x09, 0x70, 0x01, 0x12, 0x07, 0x10, 0x11, 0x65, 0x00, 0x00, 0xb2, 0x41, 0x12, 0x06, 0x10, 0x13,
+  0x58, 0xa8, 0xcc, 0x07, 0x18, 0x05,
+};
+
+// timestamp: 1700000002000
+// metrics {
+//   alias: 18
+//   is_null: true
+// }
+// seq: 6
+static const uint8_t GOLDEN_NDATA_NULL[] = {
+  0x08, 0xd0, 0xdf, 0x95, 0xff, 0xbc, 0x31, 0x12, 0x04, 0x10, 0x12, 0x38, 0x01, 0x18, 0x06,
+};
+
+// metrics {
+//   name: "bdSeq"
+//   datatype: 8
+//   long_value: 7
+// }
+static const uint8_t GOLDEN_NDEATH[] = {
+  0x12, 0x0b, 0x0a, 0x05, 0x62, 0x64, 0x53, 0x65, 0x71, 0x20, 0x08, 0x58, 0x07,
+};
+
+// timestamp: 1700000003000
+// metrics {
+//   alias: 3
+//   datatype: 11
+//   boolean_value: true
+// }
+// metrics {
+//   alias: 8
+//   datatype: 11
+//   boolean_value: false
+// }
+static const uint8_t GOLDEN_NCMD_ALIAS[] = {
+  0x08, 0xb8, 0xe7, 0x95, 0xff, 0xbc, 0x31, 0x12, 0x06, 0x10, 0x03, 0x20, 0x0b, 0x70, 0x01, 0x12,
+  0x06, 0x10, 0x08, 0x20, 0x0b, 0x70, 0x00,
+};
+
+// timestamp: 1700000003000
+// metrics {
+//   name: "Relays/2"
+//   datatype: 11
+//   boolean_value: true
+// }
+// metrics {
+//   name: "Relays/5"
+//   timestamp: 1700000003000
+//   datatype: 11
+//   is_transient: true
+//   boolean_value: true
+// }
+static const uint8_t GOLDEN_NCMD_NAME[] = {
+  0x08, 0xb8, 0xe7, 0x95, 0xff, 0xbc, 0x31, 0x12, 0x0e, 0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61, 0x79,
+  0x73, 0x2f, 0x32, 0x20, 0x0b, 0x70, 0x01, 0x12, 0x17, 0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61, 0x79,
+  0x73, 0x2f, 0x35, 0x18, 0xb8, 0xe7, 0x95, 0xff, 0xbc, 0x31, 0x20, 0x0b, 0x30, 0x01, 0x70, 0x01,
+};
+
+// timestamp: 1700000003000
+// metrics {
+//   name: "Node Control/Rebirth"
+//   datatype: 11
+//   boolean_value: true
+// }
+static const uint8_t GOLDEN_NCMD_REBIRTH[] = {
+  0x08, 0xb8, 0xe7, 0x95, 0xff, 0xbc, 0x31, 0x12, 0x1a, 0x0a, 0x14, 0x4e, 0x6f, 0x64, 0x65, 0x20,
+  0x43, 0x6f, 0x6e, 0x74, 0x72, 0x6f, 0x6c, 0x2f, 0x52, 0x65, 0x62, 0x69, 0x72, 0x74, 0x68, 0x20,
+  0x0b, 0x70, 0x01,
+};
+
+// timestamp: 1700000003000
+// metrics {
+//   name: "Relays/9"
+//   datatype: 11
+//   boolean_value: true
+// }
+// metrics {
+//   alias: 42
+//   datatype: 11
+//   boolean_value: true
+// }
+static const uint8_t GOLDEN_NCMD_UNKNOWN[] = {
+  0x08, 0xb8, 0xe7, 0x95, 0xff, 0xbc, 0x31, 0x12, 0x0e, 0x0a, 0x08, 0x52, 0x65, 0x6c, 0x61, 0x79,
+  0x73, 0x2f, 0x39, 0x20, 0x0b, 0x70, 0x01, 0x12, 0x06, 0x10, 0x2a, 0x20, 0x0b, 0x70, 0x01,
+};
+
+// metrics {
+//   alias: 1
+//   datatype: 12
+//   string_value: "on"
+// }
+static const uint8_t GOLDEN_NCMD_NO_VALUE[] = {
+  0x12, 0x08, 0x10, 0x01, 0x20, 0x0c, 0x7a, 0x02, 0x6f, 0x6e,
+};
+
+// metrics {
+//   alias: 1
+//   datatype: 11
+//   boolean_value: true
+// }
+// metrics {
+//   alias: 17
+//   datatype: 9
+//   float_value: 1
+// }
+// uuid: "x"
+// body: "\001\002"
+static const uint8_t GOLDEN_NCMD_MIXED[] = {
+  0x12, 0x06, 0x10, 0x01, 0x20, 0x0b, 0x70, 0x01, 0x12, 0x09, 0x10, 0x11, 0x20, 0x09, 0x65, 0x00,
+  0x00, 0x80, 0x3f, 0x22, 0x01, 0x78, 0x2a, 0x02, 0x01, 0x02,
+};
+
+#endif // SPARKPLUG_GOLDEN_H
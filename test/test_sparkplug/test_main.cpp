@@ -0,0 +1,237 @@
+// Sparkplug B (sparkplug.h): NBIRTH/NDATA/NDEATH comparés octet par octet à
+// l'encodage de protoc, NCMD encodés par protoc passés à spParseNcmd()
+// (golden.h, tools/tests/sparkplug_golden.py); taille et temps d'encodage
+// face aux topics de statut JSON.
+#include <unity.h>
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include "sparkplug.h"
+#include "status_payload.h"
+#include "golden.h"
+
+// Mêmes valeurs que tools/tests/sparkplug_golden.py
+#define TS 1700000000000ULL
+#define BD_SEQ 3
+
+static uint8_t buf[512];
+
+static SpNodeSnapshot boardState() {
+  SpNodeSnapshot s = {0x05, 0x81, 21.5f, NAN, 123456, "192.168.1.50"};
+  return s;
+}
+
+void setUp(void) {
+  memset(buf, 0xAA, sizeof(buf));
+}
+
+void tearDown(void) {}
+
+#define ASSERT_GOLDEN(golden, len)                         \
+  do {                                                     \
+    TEST_ASSERT_EQUAL(sizeof(golden), len);                \
+    TEST_ASSERT_EQUAL_MEMORY(golden, buf, sizeof(golden)); \
+  } while (0)
+
+// ----- Encodeurs contre protoc -----
+static void test_nbirth_matches_protoc(void) {
+  size_t len = spEncodeBirth(buf, sizeof(buf), TS, BD_SEQ, boardState(), 0);
+  ASSERT_GOLDEN(GOLDEN_NBIRTH, len);
+}
+
+static void test_ndata_matches_protoc(void) {
+  SpNodeSnapshot s = boardState();
+  s.relays = 0x05;                       // relais 2 passé à 1 (changements: bit 2)
+  s.inputs = 0x81;                       // entrée 0 passée à 1
+  s.temperature = 22.25f;
+  s.uptimeMs = 124456;
+  SpDataChanges c = {0x04, 0x01, true, false, true};
+  size_t len = spEncodeData(buf, sizeof(buf), TS + 1000, s, c, 5);
+  ASSERT_GOLDEN(GOLDEN_NDATA, len);
+
+  // Humidité redevenue invalide: is_null
+  SpDataChanges h = {0, 0, false, true, false};
+  len = spEncodeData(buf, sizeof(buf), TS + 2000, s, h, 6);
+  ASSERT_GOLDEN(GOLDEN_NDATA_NULL, len);
+}
+
+static void test_ndeath_matches_protoc(void) {
+  size_t len = spEncodeDeath(buf, sizeof(buf), 7);
+  ASSERT_GOLDEN(GOLDEN_NDEATH, len);
+  // Message de will en chaîne C: aucun octet nul pour tout bdSeq 1..255
+  for (int bd = 1; bd <= 255; bd++) {
+    len = spEncodeDeath(buf, sizeof(buf), (uint8_t)bd);
+    TEST_ASSERT_NOT_EQUAL(0, len);
+    TEST_ASSERT_NULL(memchr(buf, 0, len));
+  }
+}
+
+// Buffer trop court à n'importe quelle taille: 0, jamais d'écriture au-delà
+static void test_encoders_overflow(void) {
+  size_t full = spEncodeBirth(buf, sizeof(buf), TS, BD_SEQ, boardState(), 0);
+  for (size_t cap = 0; cap < full; cap++) {
+    memset(buf, 0xAA, sizeof(buf));
+    TEST_ASSERT_EQUAL(0, spEncodeBirth(buf, cap, TS, BD_SEQ, boardState(), 0));
+    TEST_ASSERT_EQUAL_HEX8(0xAA, buf[cap]);
+  }
+}
+
+// Les NBIRTH/NDATA de la carte se relisent avec le décodeur des NCMD
+static void test_decoder_reads_board_payloads(void) {
+  size_t len = spEncodeBirth(buf, sizeof(buf), TS, BD_SEQ, boardState(), 0);
+  int metrics = 0;
+  uint8_t relays = 0;
+  TEST_ASSERT_TRUE(spDecodeMetrics(buf, len, [&](const SpCommandMetric &m) {
+    metrics++;
+    if (m.alias >= SP_ALIAS_RELAY0 && m.alias < SP_ALIAS_RELAY0 + 8 && m.value) {
+      relays |= (uint8_t)(1u << (m.alias - SP_ALIAS_RELAY0));
+    }
+  }));
+  TEST_ASSERT_EQUAL(22, metrics);
+  TEST_ASSERT_EQUAL_HEX8(0x05, relays);
+  // Coupé avant seq (2 derniers octets): refusé ou arrêté à une métrique complète
+  for (size_t n = 1; n < len - 2; n++) {
+    int seen = 0;
+    bool ok = spDecodeMetrics(buf, n, [&](const SpCommandMetric &) { seen++; });
+    TEST_ASSERT_TRUE(!ok || seen < 22);
+  }
+}
+
+// ----- NCMD encodés par protoc -----
+static MqttCmdResult ncmd(const uint8_t *p, size_t len, RelayCommand &cmd, bool &rebirth) {
+  cmd.mask = 0;
+  cmd.values = 0;
+  rebirth = false;
+  return spParseNcmd(p, len, cmd, rebirth);
+}
+
+static void test_ncmd_from_protoc(void) {
+  RelayCommand cmd;
+  bool rebirth;
+  // Par alias: relais 2 ON, relais 7 OFF
+  TEST_ASSERT_EQUAL(MQTT_CMD_OK, ncmd(GOLDEN_NCMD_ALIAS, sizeof(GOLDEN_NCMD_ALIAS), cmd, rebirth));
+  TEST_ASSERT_EQUAL_HEX8(0x84, cmd.mask);
+  TEST_ASSERT_EQUAL_HEX8(0x04, cmd.values);
+  TEST_ASSERT_FALSE(rebirth);
+  // Par nom, champs inconnus de la carte (timestamp, is_transient) ignorés
+  TEST_ASSERT_EQUAL(MQTT_CMD_OK, ncmd(GOLDEN_NCMD_NAME, sizeof(GOLDEN_NCMD_NAME), cmd, rebirth));
+  TEST_ASSERT_EQUAL_HEX8(0x24, cmd.mask);
+  TEST_ASSERT_EQUAL_HEX8(0x24, cmd.values);
+  // Renaissance seule: commande valide sans écriture relais
+  TEST_ASSERT_EQUAL(MQTT_CMD_OK, ncmd(GOLDEN_NCMD_REBIRTH, sizeof(GOLDEN_NCMD_REBIRTH), cmd, rebirth));
+  TEST_ASSERT_EQUAL_HEX8(0, cmd.mask);
+  TEST_ASSERT_TRUE(rebirth);
+  // Métriques inconnues (Relays/9, alias 42)
+  TEST_ASSERT_EQUAL(MQTT_CMD_BAD_RELAY, ncmd(GOLDEN_NCMD_UNKNOWN, sizeof(GOLDEN_NCMD_UNKNOWN), cmd, rebirth));
+  // Valeur chaîne: pas de valeur exploitable
+  TEST_ASSERT_EQUAL(MQTT_CMD_BAD_RELAY, ncmd(GOLDEN_NCMD_NO_VALUE, sizeof(GOLDEN_NCMD_NO_VALUE), cmd, rebirth));
+  // Relais valide + métrique non inscriptible + champs uuid/body: le relais passe
+  TEST_ASSERT_EQUAL(MQTT_CMD_OK, ncmd(GOLDEN_NCMD_MIXED, sizeof(GOLDEN_NCMD_MIXED), cmd, rebirth));
+  TEST_ASSERT_EQUAL_HEX8(0x01, cmd.mask);
+  TEST_ASSERT_EQUAL_HEX8(0x01, cmd.values);
+}
+
+static void test_ncmd_malformed(void) {
+  RelayCommand cmd;
+  bool rebirth;
+  TEST_ASSERT_EQUAL(MQTT_CMD_EMPTY, ncmd(buf, 0, cmd, rebirth));
+  for (size_t n = 1; n < sizeof(GOLDEN_NCMD_NAME); n++) {
+    MqttCmdResult r = ncmd(GOLDEN_NCMD_NAME, n, cmd, rebirth);
+    // Troncature: refusée, ou arrêtée après la première métrique complète
+    TEST_ASSERT_TRUE(r != MQTT_CMD_OK || cmd.mask == 0x04);
+  }
+  static const uint8_t BAD_WIRE[] = {0x0F, 0x01};            // type de champ 7
+  TEST_ASSERT_EQUAL(MQTT_CMD_BAD_FORMAT, ncmd(BAD_WIRE, sizeof(BAD_WIRE), cmd, rebirth));
+  static const uint8_t LONG_LEN[] = {0x12, 0x7F, 0x10, 0x03};  // métrique plus longue que le buffer
+  TEST_ASSERT_EQUAL(MQTT_CMD_BAD_FORMAT, ncmd(LONG_LEN, sizeof(LONG_LEN), cmd, rebirth));
+}
+
+// ----- Comparaison avec les topics de statut JSON -----
+// Mode json, un cycle de mqttPublishStatus() + mqttPublishSensors():
+// relay/status, relay/status_named, input/status, input/status_named,
+// system/status, sensor/status (payloads seuls, labels par défaut)
+static const char RELAY_LABELS[8][16] = {"relay1", "relay2", "relay3", "relay4", "relay5", "relay6", "relay7", "relay8"};
+static const char INPUT_LABELS[8][16] = {"input1", "input2", "input3", "input4", "input5", "input6", "input7", "input8"};
+
+static size_t jsonStatus(char *out, size_t cap, const SpNodeSnapshot &s, bool relaysOnly) {
+  size_t total = 0;
+  total += renderBitArray(out, cap, s.relays);
+  total += renderNamedBits(out, cap, RELAY_LABELS, s.relays);
+  if (relaysOnly) return total;
+  total += renderBitArray(out, cap, s.inputs);
+  total += renderNamedBits(out, cap, INPUT_LABELS, s.inputs);
+  int n = snprintf(out, cap, "{\"ip\":\"%s\",\"mqtt\":\"connected\",\"uptime\":%lu}", s.ip,
+                   (unsigned long)(s.uptimeMs / 1000));
+  total += (size_t)n;
+  n = snprintf(out, cap, "{\"ts\":%lu,\"temperature\":%.1f,\"temperature_state\":\"ok\","
+               "\"humidity\":%.1f,\"humidity_state\":\"ok\"}", (unsigned long)s.uptimeMs, s.temperature, s.humidity);
+  total += (size_t)n;
+  return total;
+}
+
+static void test_size_and_encode_time_vs_json(void) {
+  SpNodeSnapshot s = boardState();
+  s.humidity = 45.0f;
+  char json[320];
+  SpDataChanges all = {0xFF, 0xFF, true, true, true};
+  SpDataChanges oneRelay = {0x04, 0, false, false, false};
+
+  size_t birth = spEncodeBirth(buf, sizeof(buf), TS, BD_SEQ, s, 0);
+  size_t dataAll = spEncodeData(buf, sizeof(buf), TS, s, all, 1);
+  size_t dataOne = spEncodeData(buf, sizeof(buf), TS, s, oneRelay, 2);
+  size_t jsonAll = jsonStatus(json, sizeof(json), s, false);
+  size_t jsonOne = jsonStatus(json, sizeof(json), s, true);
+  TEST_ASSERT_TRUE(dataAll < jsonAll);
+  TEST_ASSERT_TRUE(dataOne < jsonOne);
+
+  const int N = 200000;
+  volatile size_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    s.relays = (uint8_t)i;
+    sink += spEncodeData(buf, sizeof(buf), TS + i, s, all, (uint8_t)i);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    s.relays = (uint8_t)i;
+    sink += jsonStatus(json, sizeof(json), s, false);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    s.relays = (uint8_t)i;
+    sink += spEncodeData(buf, sizeof(buf), TS + i, s, oneRelay, (uint8_t)i);
+  }
+  auto t3 = std::chrono::steady_clock::now();
+  for (int i = 0; i < N; i++) {
+    s.relays = (uint8_t)i;
+    sink += jsonStatus(json, sizeof(json), s, true);
+  }
+  auto t4 = std::chrono::steady_clock::now();
+  double spAllNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+  double jsAllNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / N;
+  double spOneNs = std::chrono::duration<double, std::nano>(t3 - t2).count() / N;
+  double jsOneNs = std::chrono::duration<double, std::nano>(t4 - t3).count() / N;
+
+  char msg[160];
+  snprintf(msg, sizeof(msg), "NBIRTH %u octets", (unsigned)birth);
+  TEST_MESSAGE(msg);
+  snprintf(msg, sizeof(msg), "état complet: NDATA %u octets en %.0f ns, JSON (6 topics) %u octets en %.0f ns",
+           (unsigned)dataAll, spAllNs, (unsigned)jsonAll, jsAllNs);
+  TEST_MESSAGE(msg);
+  snprintf(msg, sizeof(msg), "un relais: NDATA %u octets en %.0f ns, JSON (2 topics relais) %u octets en %.0f ns",
+           (unsigned)dataOne, spOneNs, (unsigned)jsonOne, jsOneNs);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_nbirth_matches_protoc);
+  RUN_TEST(test_ndata_matches_protoc);
+  RUN_TEST(test_ndeath_matches_protoc);
+  RUN_TEST(test_encoders_overflow);
+  RUN_TEST(test_decoder_reads_board_payloads);
+  RUN_TEST(test_ncmd_from_protoc);
+  RUN_TEST(test_ncmd_malformed);
+  RUN_TEST(test_size_and_encode_time_vs_json);
+  return UNITY_END();
+}
@@ -0,0 +1,236 @@
+// Routage des topics entrants (topic_router.h): topic historique, topics par
+// relais (index ou label), topics inconnus; mesure sur 100 000 messages mêlés.
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "topic_router.h"
+#include "mqtt_command.h"
+
+static TopicRouter router;
+
+static const char RELAY_LABELS[8][16] = {"Pompe", "Salle de bain", "relay3", "Chauffage", "Éclairage", "", "7", "relay3"};
+static const char INPUT_LABELS[8][16] = {"Porte", "Fenetre", "", "", "", "", "", ""};
+
+void setUp(void) {
+  memset(&router, 0, sizeof(router));
+  topicRouterBuild(router, "waveshare", "waveshare/relay/cmd", RELAY_LABELS, INPUT_LABELS);
+}
+
+void tearDown(void) {}
+
+static TopicRoute route(const char *topic, int &relay) {
+  return topicRouterMatch(router, topic, strlen(topic), relay);
+}
+
+// ----- Topics sortants -----
+static void test_named_status_topics(void) {
+  TEST_ASSERT_EQUAL_STRING("waveshare/relay/status_named", router.relayNamedTopic);
+  TEST_ASSERT_EQUAL_STRING("waveshare/input/status_named", router.inputNamedTopic);
+  // Préfixe de longueur maximale: topic complet, sans troncature
+  char prefix[TOPIC_ROUTER_PREFIX_MAX];
+  memset(prefix, 'p', sizeof(prefix) - 1);
+  prefix[sizeof(prefix) - 1] = '\0';
+  topicRouterBuild(router, prefix, "x/relay/cmd", RELAY_LABELS, INPUT_LABELS);
+  TEST_ASSERT_EQUAL(strlen(prefix) + strlen("/input/status_named"), strlen(router.inputNamedTopic));
+}
+
+// ----- Slugs -----
+static void test_slugify(void) {
+  char slug[TOPIC_SLUG_MAX];
+  topicSlugify("Salle de bain", slug);
+  TEST_ASSERT_EQUAL_STRING("salle_de_bain", slug);
+  topicSlugify("Pompe-2", slug);
+  TEST_ASSERT_EQUAL_STRING("pompe-2", slug);
+  topicSlugify("a/b+#", slug);                 // caractères réservés MQTT
+  TEST_ASSERT_EQUAL_STRING("a_b__", slug);
+  topicSlugify("", slug);
+  TEST_ASSERT_EQUAL_STRING("", slug);
+  topicSlugify("5", slug);                     // serait pris pour un index
+  TEST_ASSERT_EQUAL_STRING("", slug);
+  topicSlugify("12", slug);
+  TEST_ASSERT_EQUAL_STRING("12", slug);
+  topicSlugify("Un label beaucoup trop long", slug);
+  TEST_ASSERT_EQUAL(TOPIC_SLUG_MAX - 1, strlen(slug));
+}
+
+static void test_slug_table(void) {
+  TEST_ASSERT_EQUAL_STRING("pompe", router.relaySlug[0]);
+  TEST_ASSERT_EQUAL_STRING("salle_de_bain", router.relaySlug[1]);
+  // Doublon: aucun des deux n'a d'alias
+  TEST_ASSERT_EQUAL_STRING("", router.relaySlug[2]);
+  TEST_ASSERT_EQUAL_STRING("", router.relaySlug[7]);
+  // UTF-8: chaque octet hors [a-z0-9-] devient '_'
+  TEST_ASSERT_EQUAL_STRING("__clairage", router.relaySlug[4]);
+  TEST_ASSERT_EQUAL_STRING("", router.relaySlug[6]);
+  TEST_ASSERT_EQUAL_STRING("porte", router.inputSlug[0]);
+}
+
+// ----- Routage -----
+static void test_legacy_topic(void) {
+  int relay;
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_RELAY_CMD, route("waveshare/relay/cmd", relay));
+  TEST_ASSERT_EQUAL(-1, relay);
+  // Correspondance exacte seulement
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("waveshare/relay/cmd/", relay));
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("waveshare/relay/cm", relay));
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("Waveshare/relay/cmd", relay));
+}
+
+static void test_per_channel_by_index(void) {
+  char topic[64];
+  for (int i = 0; i < 8; i++) {
+    snprintf(topic, sizeof(topic), "waveshare/relay/%d/set", i);
+    int relay;
+    TEST_ASSERT_EQUAL_MESSAGE(TOPIC_ROUTE_RELAY_SET, route(topic, relay), topic);
+    TEST_ASSERT_EQUAL(i, relay);
+  }
+}
+
+static void test_per_channel_by_label(void) {
+  int relay;
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_RELAY_SET, route("waveshare/relay/pompe/set", relay));
+  TEST_ASSERT_EQUAL(0, relay);
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_RELAY_SET, route("waveshare/relay/salle_de_bain/set", relay));
+  TEST_ASSERT_EQUAL(1, relay);
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_RELAY_SET, route("waveshare/relay/chauffage/set", relay));
+  TEST_ASSERT_EQUAL(3, relay);
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_RELAY_SET, route("waveshare/relay/__clairage/set", relay));
+  TEST_ASSERT_EQUAL(4, relay);
+  // Le slug est en minuscules: le label tel quel ne correspond pas
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("waveshare/relay/Pompe/set", relay));
+  // Préfixe d'un slug, slug plus long
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("waveshare/relay/pomp/set", relay));
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("waveshare/relay/pompes/set", relay));
+  // Doublons sans alias
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("waveshare/relay/relay3/set", relay));
+  TEST_ASSERT_EQUAL(-1, relay);
+}
+
+static void test_unknown_topics(void) {
+  static const char *const UNKNOWN[] = {
+    "",
+    "waveshare",
+    "waveshare/relay/",
+    "waveshare/relay//set",
+    "waveshare/relay/8/set",
+    "waveshare/relay/07/set",
+    "waveshare/relay/3/state",
+    "waveshare/relay/3/set/x",
+    "waveshare/relay/a/b/set",
+    "waveshare/relay/nope/set",
+    "waveshare/relay/un_segment_trop_long/set",
+    "waveshare/input/0/set",
+    "waveshare/input/porte/set",
+    "other/relay/3/set",
+    "waveshare2/relay/3/set",
+    "waveshare/relay/status",
+    "spBv1.0/waveshare/NCMD/node",
+  };
+  for (size_t i = 0; i < sizeof(UNKNOWN) / sizeof(UNKNOWN[0]); i++) {
+    int relay = 42;
+    TEST_ASSERT_EQUAL_MESSAGE(TOPIC_ROUTE_NONE, route(UNKNOWN[i], relay), UNKNOWN[i]);
+    TEST_ASSERT_EQUAL(-1, relay);
+  }
+}
+
+// Le topic n'est pas terminé par '\0' dans le buffer MQTT: seule la longueur compte
+static void test_length_bounded(void) {
+  const char *buf = "waveshare/relay/pompe/setXXXX";
+  int relay;
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_RELAY_SET, topicRouterMatch(router, buf, strlen(buf) - 4, relay));
+  TEST_ASSERT_EQUAL(0, relay);
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, topicRouterMatch(router, buf, strlen(buf), relay));
+}
+
+// Changement de préfixe et de labels: l'ancienne table ne répond plus
+static void test_rebuild(void) {
+  char labels[8][16] = {"A", "B", "C", "D", "E", "F", "G", "H"};
+  topicRouterBuild(router, "maison/rdc", "maison/rdc/relay/cmd", labels, INPUT_LABELS);
+  int relay;
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("waveshare/relay/3/set", relay));
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_NONE, route("waveshare/relay/cmd", relay));
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_RELAY_CMD, route("maison/rdc/relay/cmd", relay));
+  TEST_ASSERT_EQUAL(TOPIC_ROUTE_RELAY_SET, route("maison/rdc/relay/3/set", relay));
+  TEST_ASSERT_EQUAL(3, relay);
+  TEST_ASSERT_EQUAL_STRING("maison/rdc/relay/status_named", router.relayNamedTopic);
+  TEST_ASSERT_EQUAL_STRING("maison/rdc/input/status_named", router.inputNamedTopic);
+  // 8 labels dans 32 cases: tous joignables malgré les collisions de case
+  char topic[64];
+  for (int i = 0; i < 8; i++) {
+    snprintf(topic, sizeof(topic), "maison/rdc/relay/%c/set", 'a' + i);
+    TEST_ASSERT_EQUAL_MESSAGE(TOPIC_ROUTE_RELAY_SET, route(topic, relay), topic);
+    TEST_ASSERT_EQUAL(i, relay);
+  }
+}
+
+// ----- Mesure: 100 000 messages mêlés -----
+// Topic historique (texte et JSON), /set par index et par label, topics
+// inconnus; routage puis analyse du payload comme dans mqttCallback
+static void test_mixed_100k_benchmark(void) {
+  static const char *const TOPICS[] = {
+    "waveshare/relay/cmd",
+    "waveshare/relay/3/set",
+    "waveshare/relay/pompe/set",
+    "waveshare/relay/salle_de_bain/set",
+    "waveshare/relay/chauffage/set",
+    "waveshare/relay/relay3/set",
+    "waveshare/relay/nope/set",
+    "waveshare/relay/8/set",
+    "other/topic",
+    "waveshare/relay/3/state",
+    "waveshare/relay/a/b/set",
+  };
+  static const char *const PAYLOADS[] = {"ON", "off", "3:on", "{\"relay\":2,\"state\":\"on\"}"};
+  const size_t topics = sizeof(TOPICS) / sizeof(TOPICS[0]);
+  size_t topicLen[topics];
+  for (size_t k = 0; k < topics; k++) topicLen[k] = strlen(TOPICS[k]);
+  size_t payloadLen[4];
+  for (int k = 0; k < 4; k++) payloadLen[k] = strlen(PAYLOADS[k]);
+
+  const uint32_t N = 100000;
+  uint32_t routed = 0, unknown = 0, parsed = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < N; i++) {
+    size_t k = i % topics;
+    const char *pl = PAYLOADS[i & 3];
+    int relay;
+    TopicRoute r = topicRouterMatch(router, TOPICS[k], topicLen[k], relay);
+    if (r == TOPIC_ROUTE_RELAY_CMD) {
+      RelayCommand cmd;
+      routed++;
+      if (mqttParseRelayCommand((const uint8_t *)pl, payloadLen[i & 3], cmd) == MQTT_CMD_OK) parsed++;
+    } else if (r == TOPIC_ROUTE_RELAY_SET) {
+      bool on;
+      routed++;
+      if (cmdParseState(CmdSlice{pl, payloadLen[i & 3]}, on)) parsed++;
+    } else {
+      unknown++;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+  // 5 topics routés sur 11 (cmd, 3, pompe, salle_de_bain, chauffage)
+  TEST_ASSERT_EQUAL_UINT32(N, routed + unknown);
+  TEST_ASSERT_UINT32_WITHIN(topics, N * 5 / topics, routed);
+  TEST_ASSERT_TRUE(parsed > 0 && parsed <= routed);
+  char msg[120];
+  snprintf(msg, sizeof(msg), "100k messages mêlés: %.2f ms, %.1f ns/message (%lu routés, %lu inconnus)", ms,
+           ms * 1e6 / N, (unsigned long)routed, (unsigned long)unknown);
+  TEST_MESSAGE(msg);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_slugify);
+  RUN_TEST(test_slug_table);
+  RUN_TEST(test_legacy_topic);
+  RUN_TEST(test_per_channel_by_index);
+  RUN_TEST(test_per_channel_by_label);
+  RUN_TEST(test_unknown_topics);
+  RUN_TEST(test_length_bounded);
+  RUN_TEST(test_rebuild);
+  RUN_TEST(test_named_status_topics);
+  RUN_TEST(test_mixed_100k_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,165 @@
+// Anti-rejeu du protocole UDP (udp_ctrl.h): planchers par émetteur, table
+// pleine sans éviction, planchers conservés au redémarrage (NVS simulée)
+// et liés à la clé, écriture paresseuse.
+#include <unity.h>
+#include <stdio.h>
+#include "udp_ctrl.h"
+
+#define KEY "secret partagé"
+#define IP(n) (0x0A000000UL + (n))
+
+static UdpCtrl u;
+static UdpCtrlFloors nvs;
+static size_t nvsLen;
+static uint32_t nvsWrites;
+
+static void save() {
+  udpCtrlExportFloors(u, nvs);
+  nvsLen = sizeof(nvs);
+  u.floorsDirty = false;
+  nvsWrites++;
+}
+
+static void service(uint32_t now) {
+  if (udpCtrlFloorsDue(u, now)) save();
+}
+
+static bool reboot(const char *key) {
+  udpCtrlInit(u, key, 0);
+  return udpCtrlImportFloors(u, nvs, nvsLen);
+}
+
+// CMD signé envoyé par addr: statut de l'ACK
+static uint8_t command(uint32_t addr, uint32_t seq, uint32_t now) {
+  uint8_t buf[UDP_CTRL_CMD_LEN];
+  size_t n = udpCtrlEncodeCmd(u, seq, 0x01, 0x01, buf);
+  uint32_t ackSeq;
+  uint8_t status = 0xFF, mask, values;
+  TEST_ASSERT_TRUE(udpCtrlHandleCmd(u, addr, buf, n, now, ackSeq, status, mask, values));
+  TEST_ASSERT_EQUAL_UINT32(seq, ackSeq);
+  return status;
+}
+
+void setUp(void) {
+  memset(&nvs, 0, sizeof(nvs));
+  nvsLen = 0;
+  nvsWrites = 0;
+  TEST_ASSERT_FALSE(reboot(KEY));
+}
+
+void tearDown(void) {}
+
+static void test_replay_rejected(void) {
+  TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(1), 100, 0));
+  TEST_ASSERT_EQUAL(UDP_CTRL_REPLAY, command(IP(1), 100, 1));
+  TEST_ASSERT_EQUAL(UDP_CTRL_REPLAY, command(IP(1), 99, 2));
+  TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(1), 101, 3));
+  // Planchers indépendants par émetteur
+  TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(2), 5, 4));
+  TEST_ASSERT_EQUAL_UINT32(3, u.stats.commands);
+  TEST_ASSERT_EQUAL_UINT32(2, u.stats.replays);
+}
+
+// Table pleine: aucun émetteur connu n'est évincé, l'inconnu est refusé
+static void test_full_table_refuses_unknown(void) {
+  for (uint32_t i = 1; i <= UDP_CTRL_PEERS; i++) TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(i), 1000, i));
+  TEST_ASSERT_EQUAL(UDP_CTRL_PEERS, udpCtrlPeerCount(u));
+  for (uint32_t k = 0; k < 3 * UDP_CTRL_PEERS; k++) {
+    TEST_ASSERT_EQUAL(UDP_CTRL_FULL, command(IP(100 + k), 1, 100 + k));
+  }
+  TEST_ASSERT_EQUAL_UINT32(3 * UDP_CTRL_PEERS, u.stats.refused);
+  // Les anciens planchers tiennent toujours: rejeu d'une trame capturée refusé
+  for (uint32_t i = 1; i <= UDP_CTRL_PEERS; i++) TEST_ASSERT_EQUAL(UDP_CTRL_REPLAY, command(IP(i), 1000, 200));
+  udpCtrlForgetPeers(u, 300);
+  TEST_ASSERT_EQUAL(0, udpCtrlPeerCount(u));
+  TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(100), 1, 301));
+}
+
+// Un LINK passe par la même table (peer_link.h)
+static void test_link_shares_table(void) {
+  for (uint32_t i = 1; i <= UDP_CTRL_PEERS; i++) command(IP(i), 1, i);
+  UdpCtrlLink l = {0x01, 0x01, 0, 0, 1500};
+  uint8_t buf[UDP_CTRL_LINK_LEN];
+  size_t n = udpCtrlEncodeLink(u, 7, l, buf);
+  uint32_t seq;
+  UdpCtrlLink out;
+  TEST_ASSERT_TRUE(udpCtrlDecodeLink(u, buf, n, seq, out));
+  TEST_ASSERT_EQUAL(UDP_CTRL_FULL, udpCtrlAcceptSeq(u, IP(50), seq, 0));
+}
+
+// Redémarrage: planchers écrits relus, trame capturée avant refusée après
+static void test_floors_survive_reboot(void) {
+  TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(1), 500, 1000));
+  service(1000);                                 // nouvel émetteur: écrit aussitôt
+  TEST_ASSERT_EQUAL_UINT32(1, nvsWrites);
+  TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(1), 501, 2000));
+  service(2000 + UDP_CTRL_SAVE_MS);
+  TEST_ASSERT_EQUAL_UINT32(2, nvsWrites);
+  TEST_ASSERT_TRUE(reboot(KEY));
+  TEST_ASSERT_EQUAL(UDP_CTRL_REPLAY, command(IP(1), 500, 0));
+  TEST_ASSERT_EQUAL(UDP_CTRL_REPLAY, command(IP(1), 501, 0));
+  TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(1), 502, 0));
+}
+
+// Coupure avant l'écriture paresseuse: seules les trames du dernier délai
+// sont rejouables, une fois
+static void test_power_cut_window(void) {
+  command(IP(1), 10, 0);
+  service(0);
+  for (uint32_t s = 11; s <= 20; s++) command(IP(1), s, s * 100);
+  TEST_ASSERT_TRUE(u.floorsDirty);
+  TEST_ASSERT_TRUE(reboot(KEY));
+  TEST_ASSERT_EQUAL(UDP_CTRL_REPLAY, command(IP(1), 10, 0));
+  TEST_ASSERT_EQUAL(UDP_CTRL_OK, command(IP(1), 15, 0));    // dans la fenêtre
+  TEST_ASSERT_EQUAL(UDP_CTRL_REPLAY, command(IP(1), 15, 1)); // une seule fois
+  TEST_ASSERT_EQUAL(UDP_CTRL_REPLAY, command(IP(1), 12, 2));
+}
+
+// Autre clé ou blob invalide: table vide
+static void test_floors_bound_to_key(void) {
+  command(IP(1), 10, 0);
+  save();
+  TEST_ASSERT_FALSE(reboot("autre clé"));
+  TEST_ASSERT_EQUAL(0, udpCtrlPeerCount(u));
+  TEST_ASSERT_TRUE(reboot(KEY));
+  TEST_ASSERT_EQUAL(1, udpCtrlPeerCount(u));
+  nvsLen = sizeof(nvs) - 1;
+  TEST_ASSERT_FALSE(reboot(KEY));
+  nvsLen = sizeof(nvs);
+  nvs.magic ^= 1;
+  TEST_ASSERT_FALSE(reboot(KEY));
+}
+
+// Trafic continu (battement de cœur d'un lien toutes les 500 ms): une
+// écriture NVS par UDP_CTRL_SAVE_MS au plus
+static void test_lazy_writes(void) {
+  uint32_t seq = 1;
+  const uint32_t hourMs = 3600000UL;
+  for (uint32_t now = 0; now < hourMs; now += 500) {
+    command(IP(1), seq++, now);
+    service(now);
+  }
+  TEST_ASSERT_UINT32_WITHIN(2, hourMs / UDP_CTRL_SAVE_MS, nvsWrites);
+  char msg[100];
+  snprintf(msg, sizeof(msg), "1 h de LINK toutes les 500 ms: %lu écritures NVS (%lu trames)", (unsigned long)nvsWrites,
+           (unsigned long)(seq - 1));
+  TEST_MESSAGE(msg);
+  // Passage de millis() par zéro
+  const uint32_t t0 = 0xFFFFFF00UL;
+  u.floorsDirty = false;
+  command(IP(1), seq++, t0);
+  TEST_ASSERT_FALSE(udpCtrlFloorsDue(u, 0x100));
+  TEST_ASSERT_TRUE(udpCtrlFloorsDue(u, t0 + UDP_CTRL_SAVE_MS));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_replay_rejected);
+  RUN_TEST(test_full_table_refuses_unknown);
+  RUN_TEST(test_link_shares_table);
+  RUN_TEST(test_floors_survive_reboot);
+  RUN_TEST(test_power_cut_window);
+  RUN_TEST(test_floors_bound_to_key);
+  RUN_TEST(test_lazy_writes);
+  return UNITY_END();
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+Banc de débit HTTP de l'ESP32-S3 8DI/8RO (W5500)
+- envoi de 1 Mo vers /api/bench/upload (lu et jeté par la carte)
+- téléchargement de 100 Ko depuis /api/bench/download
+- option --ota firmware.bin: vraie mise à jour via /api/ota (la carte redémarre)
+
+Le firmware doit être compilé avec -DENABLE_BENCH_HTTP=1 (routes /api/bench/*,
+absentes des builds de production) et une clé OTA configurée; --ota demande
+aussi ENABLE_OTA_HTTP=1.
+
+Usage: ESP32_HOST=192.168.1.50 OTA_KEY=secret python3 bench_w5500_throughput.py
+Dépendance: pip install requests
+"""
+
+import argparse
+import os
+import sys
+import time
+
+import requests
+
+HOST = os.getenv("ESP32_HOST", "192.168.1.50")
+OTA_KEY = os.getenv("OTA_KEY", "")
+
+
+def kbps(nbytes, seconds):
+    return nbytes * 8 / 1000.0 / seconds if seconds > 0 else 0.0
+
+
+def bench_upload(base, size, runs):
+    payload = bytes(i & 0xFF for i in range(size))
+    best = 0.0
+    for i in range(runs):
+        t0 = time.perf_counter()
+        r = requests.post(f"{base}/api/bench/upload", data=payload,
+                          headers={"X-OTA-Key": OTA_KEY, "Content-Type": "application/octet-stream"},
+                          timeout=60)
+        dt = time.perf_counter() - t0
+        if r.status_code != 200 or not r.json().get("ok"):
+            print(f"✗ upload #{i + 1}: HTTP {r.status_code} {r.text[:120]}")
+            return False
+        side = r.json()
+        best = max(best, kbps(size, dt))
+        print(f"  upload #{i + 1}: {size} octets en {dt * 1000:.0f} ms "
+              f"-> {kbps(size, dt):.0f} kbit/s (carte: {side['duration_ms']} ms, {side['kbps']} kbit/s)")
+    print(f"✓ Upload {size // 1024} Ko: meilleur {best:.0f} kbit/s")
+    return True
+
+
+def bench_download(base, size, runs):
+    best = 0.0
+    for i in range(runs):
+        t0 = time.perf_counter()
+        r = requests.get(f"{base}/api/bench/download", params={"bytes": size},
+                         headers={"X-OTA-Key": OTA_KEY}, timeout=60)
+        dt = time.perf_counter() - t0
+        if r.status_code != 200 or len(r.content) != size:
+            print(f"✗ download #{i + 1}: HTTP {r.status_code}, {len(r.content)}/{size} octets")
+            return False
+        best = max(best, kbps(size, dt))
+        print(f"  download #{i + 1}: {size} octets en {dt * 1000:.0f} ms -> {kbps(size, dt):.0f} kbit/s")
+    print(f"✓ Download {size // 1024} Ko: meilleur {best:.0f} kbit/s")
+    return True
+
+
+def run_ota(base, path):
+    with open(path, "rb") as f:
+        image = f.read()
+    print(f"OTA: {len(image)} octets...")
+    t0 = time.perf_counter()
+    r = requests.post(f"{base}/api/ota", data=image,
+                      headers={"X-OTA-Key": OTA_KEY, "Content-Type": "application/octet-stream"},
+                      timeout=120)
+    dt = time.perf_counter() - t0
+    ok = r.status_code == 200 and r.json().get("ok")
+    print(("✓ " if ok else "✗ ") + f"OTA en {dt:.1f} s ({kbps(len(image), dt):.0f} kbit/s) {r.text[:120]}")
+    return bool(ok)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default=HOST)
+    ap.add_argument("--upload-bytes", type=int, default=1024 * 1024)
+    ap.add_argument("--download-bytes", type=int, default=100 * 1024)
+    ap.add_argument("--runs", type=int, default=3)
+    ap.add_argument("--ota", help="image firmware.bin à flasher en fin de banc")
+    args = ap.parse_args()
+
+    if not OTA_KEY:
+        print("✗ OTA_KEY non défini")
+        return 1
+    base = f"http://{args.host}"
+    ok = bench_upload(base, args.upload_bytes, args.runs)
+    ok &= bench_download(base, args.download_bytes, args.runs)
+    if args.ota:
+        ok &= run_ota(base, args.ota)
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
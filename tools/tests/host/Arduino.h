@@ -0,0 +1,224 @@
+#pragma once
+// ===== DOUBLURES HÔTE (Arduino-ESP32, Ethernet, PubSubClient, ArduinoJson...) =====
+// Juste assez d'interface pour compiler src/main.cpp sur PC avec g++ et
+// l'exécuter (tools/tests/soak_alloc_host.cpp). Les bibliothèques ne font
+// rien, mais allouent comme les vraies là où le firmware en dépend:
+// Print::printf au-delà de 64 octets, pool des documents ArduinoJson,
+// String (std::string, operator new passé par malloc dans host_stubs.cpp).
+// Horloge (hostMs) et requête HTTP injectée (hostHttpReq): host_stubs.cpp.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <strings.h>
+#include <string>
+#include <algorithm>
+typedef uint8_t byte;
+typedef bool boolean;
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define RISING 1
+#define CHANGE 3
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define PROGMEM
+#define F(x) x
+#define digitalPinToInterrupt(p) (p)
+class String {
+public:
+  std::string s;
+  String() {}
+  String(const char *c) : s(c ? c : "") {}
+  String(const std::string &c) : s(c) {}
+  String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+  String(float v, int d = 2) { char b[32]; snprintf(b, 32, "%.*f", d, v); s = b; }
+  String(double v, int d = 2) { char b[32]; snprintf(b, 32, "%.*f", d, v); s = b; }
+  const char *c_str() const { return s.c_str(); }
+  char *begin() { return &s[0]; }
+  unsigned length() const { return s.size(); }
+  bool reserve(unsigned n) { s.reserve(n); return true; }
+  String &operator+=(const String &o) { s += o.s; return *this; }
+  String &operator+=(const char *o) { s += o; return *this; }
+  String &operator+=(char o) { s += o; return *this; }
+  String &operator+=(int o) { s += std::to_string(o); return *this; }
+  String &operator+=(unsigned o) { s += std::to_string(o); return *this; }
+  String &operator+=(long o) { s += std::to_string(o); return *this; }
+  String &operator+=(unsigned long o) { s += std::to_string(o); return *this; }
+  bool concat(const char *o, unsigned n) { s.append(o, n); return true; }
+  bool concat(const char *o) { s += o; return true; }
+  bool concat(char o) { s += o; return true; }
+  friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+  friend String operator+(const String &a, const char *b) { return String(a.s + b); }
+  friend String operator+(const char *a, const String &b) { return String(std::string(a) + b.s); }
+  bool operator==(const String &o) const { return s == o.s; }
+  bool operator==(const char *o) const { return s == o; }
+  bool operator!=(const String &o) const { return s != o.s; }
+  bool operator!=(const char *o) const { return s != o; }
+  char operator[](unsigned i) const { return s[i]; }
+  char charAt(unsigned i) const { return s[i]; }
+  int indexOf(char c, unsigned from = 0) const { auto p = s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const char *c, unsigned from = 0) const { auto p = s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const String &c, unsigned from = 0) const { return indexOf(c.c_str(), from); }
+  String substring(unsigned a) const { return String(s.substr(a)); }
+  String substring(unsigned a, unsigned b) const { return String(s.substr(a, b - a)); }
+  void toLowerCase() { for (char &c : s) c = (char)tolower((unsigned char)c); }
+  void toUpperCase() { for (char &c : s) c = (char)toupper((unsigned char)c); }
+  void trim() {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) { s.clear(); return; }
+    s = s.substr(a, s.find_last_not_of(" \t\r\n") - a + 1);
+  }
+  void replace(const char *f, const char *t) {
+    size_t fl = strlen(f), tl = strlen(t);
+    if (fl == 0) return;
+    for (size_t p = s.find(f); p != std::string::npos; p = s.find(f, p + tl)) s.replace(p, fl, t);
+  }
+  bool startsWith(const char *p) const { return s.rfind(p, 0) == 0; }
+  bool endsWith(const char *p) const { size_t n = strlen(p); return s.size() >= n && s.compare(s.size() - n, n, p) == 0; }
+  bool equalsIgnoreCase(const String &o) const { return strcasecmp(s.c_str(), o.s.c_str()) == 0; }
+  long toInt() const { return atol(s.c_str()); }
+  float toFloat() const { return atof(s.c_str()); }
+  void remove(unsigned i) { s.erase(i); }
+  void remove(unsigned i, unsigned n) { s.erase(i, n); }
+  void clear() { s.clear(); }
+  bool isEmpty() const { return s.empty(); }
+  explicit operator bool() const { return true; }
+};
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) { return 1; }
+  virtual size_t write(const uint8_t *b, size_t n) { return n; }
+  size_t write(const char *b) { return 0; }
+  size_t write(int v) { return write((uint8_t)v); }
+  size_t write(const char *b, size_t n) { return n; }
+  size_t print(const char *) { return 0; }
+  size_t print(const String &) { return 0; }
+  size_t print(char) { return 0; }
+  size_t print(int, int = 10) { return 0; }
+  size_t print(unsigned, int = 10) { return 0; }
+  size_t print(long, int = 10) { return 0; }
+  size_t print(unsigned long, int = 10) { return 0; }
+  size_t print(double, int = 2) { return 0; }
+  size_t println() { return 0; }
+  template <class T> size_t println(const T &) { return 0; }
+  template <class T> size_t println(const T &, int) { return 0; }
+  // Comme le core ESP32: tampon de 64 octets sur la pile, malloc au-delà
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char loc[64]; char *t = loc; va_list a; va_start(a, fmt); int n = vsnprintf(loc, sizeof(loc), fmt, a); va_end(a);
+    if (n < 0) return 0;
+    if ((size_t)n >= sizeof(loc)) { t = (char *)malloc(n + 1); va_start(a, fmt); vsnprintf(t, n + 1, fmt, a); va_end(a); }
+    size_t w = write((const uint8_t *)t, n); if (t != loc) free(t); return w; }
+  virtual void flush() {}
+};
+class Printable { public: virtual ~Printable() {} };
+class Stream : public Print {
+public:
+  virtual int available() { return 0; }
+  virtual int read() { return -1; }
+  virtual int peek() { return -1; }
+  void setTimeout(unsigned long) {}
+  String readStringUntil(char t) { String r; int c; while ((c = read()) >= 0 && c != t) r += (char)c; return r; }
+  String readString() { return String(); }
+  size_t readBytes(char *b, size_t n) { size_t i = 0; int c; while (i < n && (c = read()) >= 0) b[i++] = (char)c; return i; }
+  size_t readBytes(uint8_t *b, size_t n) { return readBytes((char *)b, n); }
+  size_t readBytesUntil(char t, char *b, size_t n) { size_t i = 0; int c; while (i < n && (c = read()) >= 0 && c != t) b[i++] = (char)c; return i; }
+};
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long, uint32_t = 0, int = -1, int = -1) {}
+  void end() {}
+  using Print::write;
+  size_t write(uint8_t) override { return 1; }
+  void setRxFIFOFull(uint8_t) {}
+  void setRxTimeout(uint8_t) {}
+  size_t setRxBufferSize(size_t n) { return n; }
+  size_t setTxBufferSize(size_t n) { return n; }
+  using Stream::read;
+  size_t read(uint8_t *, size_t) { return 0; }
+  void onReceive(void (*)(), bool = true) {}
+  bool setMode(uint8_t) { return true; }
+  int availableForWrite() { return 64; }
+  operator bool() const { return true; }
+};
+#define SERIAL_8N1 0
+#define SERIAL_8E1 1
+#define SERIAL_8O1 2
+#define SERIAL_8N2 3
+#define UART_MODE_RS485_HALF_DUPLEX 1
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long);
+void delayMicroseconds(unsigned);
+void pinMode(int, int);
+void digitalWrite(int, int);
+int digitalRead(int);
+void attachInterrupt(int, void (*)(), int);
+void detachInterrupt(int);
+void yield();
+long random(long);
+long random(long, long);
+void randomSeed(unsigned long);
+uint32_t esp_random();
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(v,a,b) ((v)<(a)?(a):((v)>(b)?(b):(v)))
+class IPAddress : public Printable {
+public:
+  uint8_t b[4] = {0};
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t c, uint8_t d, uint8_t e) { b[0]=a; b[1]=c; b[2]=d; b[3]=e; }
+  IPAddress(uint32_t v) { memcpy(b, &v, 4); }
+  operator uint32_t() const { uint32_t v; memcpy(&v, b, 4); return v; }
+  uint8_t operator[](int i) const { return b[i]; }
+  uint8_t &operator[](int i) { return b[i]; }
+  bool operator==(const IPAddress &o) const { return memcmp(b, o.b, 4) == 0; }
+  bool operator!=(const IPAddress &o) const { return !(*this == o); }
+  String toString() const { return String(); }
+  bool fromString(const char *) { return true; }
+};
+size_t strlcpy(char *, const char *, size_t);
+size_t strlcat(char *, const char *, size_t);
+uint32_t getCpuFrequencyMhz();
+class EspClass { public: uint32_t getCycleCount(); void restart(); uint32_t getFreeHeap(); uint32_t getMinFreeHeap(); uint32_t getMaxAllocHeap(); uint64_t getEfuseMac(); uint32_t getHeapSize(); uint32_t getPsramSize(); uint32_t getFreePsram(); uint32_t getSketchSize(); };
+extern EspClass ESP;
+void *ps_malloc(size_t);
+bool psramFound();
+typedef void *TaskHandle_t;
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(x) (void)(x)
+#define portEXIT_CRITICAL(x) (void)(x)
+#define portENTER_CRITICAL_ISR(x) (void)(x)
+#define portEXIT_CRITICAL_ISR(x) (void)(x)
+int64_t esp_timer_get_time();
+uint32_t xPortGetCoreID();
+bool xPortInIsrContext();
+typedef int BaseType_t;
+#define pdFALSE 0
+#define pdTRUE 1
+TaskHandle_t xTaskGetCurrentTaskHandle();
+uint32_t ulTaskNotifyTake(BaseType_t, uint32_t);
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *);
+#define portYIELD_FROM_ISR() do {} while (0)
+#define pdMS_TO_TICKS(x) (x)
+#ifndef STUB_RESET_REASON
+#define STUB_RESET_REASON
+typedef enum { ESP_RST_UNKNOWN, ESP_RST_POWERON, ESP_RST_EXT, ESP_RST_SW, ESP_RST_PANIC, ESP_RST_INT_WDT, ESP_RST_TASK_WDT, ESP_RST_WDT, ESP_RST_DEEPSLEEP, ESP_RST_BROWNOUT, ESP_RST_SDIO } esp_reset_reason_t;
+inline esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
+#endif
@@ -0,0 +1,94 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+class JsonArray;
+class JsonObject;
+class JsonVariant {
+public:
+  template <class T> T as() const { return T(); }
+  template <class T> bool is() const { return false; }
+  template <class T> JsonVariant &operator=(const T &) { return *this; }
+  JsonVariant operator[](const char *) const { return JsonVariant(); }
+  JsonVariant operator[](int) const { return JsonVariant(); }
+  template <class T> T operator|(T d) const { return d; }
+  const char *operator|(const char *d) const { return d; }
+  bool isNull() const { return true; }
+  bool containsKey(const char *) const { return false; }
+  size_t size() const { return 0; }
+  template <class T> bool set(const T &) { return true; }
+  template <class T> operator T() const { return T(); }
+  JsonArray createNestedArray(const char * = 0) const;
+  JsonObject createNestedObject(const char * = 0) const;
+  template <class T> bool add(const T &) const { return true; }
+};
+typedef JsonVariant JsonVariantConst;
+class JsonArray : public JsonVariant {
+public:
+  template <class T> bool add(const T &) const { return true; }
+  JsonObject createNestedObject() const;
+  JsonArray createNestedArray() const { return JsonArray(); }
+  JsonVariant *begin() const { return 0; }
+  JsonVariant *end() const { return 0; }
+};
+class JsonObject : public JsonVariant {};
+class JsonString { public: const char *c_str() const { return ""; } };
+struct JsonPairConst { JsonString key() const { return JsonString(); } JsonVariant value() const { return JsonVariant(); } };
+class JsonObjectConst : public JsonVariant {
+public:
+  JsonPairConst *begin() const { return 0; }
+  JsonPairConst *end() const { return 0; }
+};
+typedef JsonArray JsonArrayConst;
+#define JSON_OBJECT_SIZE(n) ((n) * 16)
+#define JSON_ARRAY_SIZE(n) ((n) * 16)
+inline JsonArray JsonVariant::createNestedArray(const char *) const { return JsonArray(); }
+inline JsonObject JsonVariant::createNestedObject(const char *) const { return JsonObject(); }
+inline JsonObject JsonArray::createNestedObject() const { return JsonObject(); }
+class JsonDocument : public JsonVariant {
+public:
+  JsonVariant operator[](const char *) const { return JsonVariant(); }
+  JsonVariant operator[](const String &) const { return JsonVariant(); }
+  JsonVariant operator[](int) const { return JsonVariant(); }
+  void clear() {}
+  size_t memoryUsage() const { return 0; }
+  size_t capacity() const { return 0; }
+  bool overflowed() const { return false; }
+  JsonObject to_obj() { return JsonObject(); }
+  template <class T> T to() { return T(); }
+  void shrinkToFit() {}
+  void garbageCollect() {}
+};
+// Pool alloué comme dans ArduinoJson 6: malloc (Dynamic), allocateur fourni (Basic)
+class DynamicJsonDocument : public JsonDocument {
+  void *pool;
+public:
+  explicit DynamicJsonDocument(size_t n) : pool(malloc(n)) {}
+  ~DynamicJsonDocument() { free(pool); }
+};
+template <size_t N> class StaticJsonDocument : public JsonDocument {};
+template <size_t N> class StaticJsonBuffer {};
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+  DeserializationError(Code c = Ok) : c_(c) {}
+  explicit operator bool() const { return c_ != Ok; }
+  bool operator==(Code c) const { return c == c_; }
+  bool operator!=(Code c) const { return c != c_; }
+  const char *c_str() const { return ""; }
+  Code code() const { return c_; }
+  Code c_;
+};
+template <class T> DeserializationError deserializeJson(JsonDocument &, const T &) { return DeserializationError(); }
+template <class T> DeserializationError deserializeJson(JsonDocument &, T *, size_t) { return DeserializationError(); }
+inline DeserializationError deserializeJson(JsonDocument &, fs::File &) { return DeserializationError(); }
+inline size_t serializeJson(const JsonVariant &, String &) { return 0; }
+inline size_t serializeJson(const JsonVariant &, char *, size_t) { return 0; }
+inline size_t serializeJson(const JsonVariant &, Print &) { return 0; }
+inline size_t measureJson(const JsonVariant &) { return 0; }
+namespace ARDUINOJSON_NAMESPACE { class Allocator {}; }
+template <class TAllocator> class BasicJsonDocument : public JsonDocument {
+  TAllocator al; void *pool;
+public:
+  explicit BasicJsonDocument(size_t n) : pool(al.allocate(n)) {}
+  ~BasicJsonDocument() { al.deallocate(pool); }
+};
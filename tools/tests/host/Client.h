@@ -0,0 +1,17 @@
+#pragma once
+#include <Arduino.h>
+class Client : public Stream {
+public:
+  virtual int connect(IPAddress, uint16_t) { return 1; }
+  virtual int connect(const char *, uint16_t) { return 1; }
+  using Print::write;
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *b, size_t n) override { return n; }
+  virtual int read(uint8_t *, size_t) { return 0; }
+  int read() override { return -1; }
+  virtual void stop() {}
+  virtual uint8_t connected() { return 1; }
+  virtual operator bool() { return true; }
+};
+class Server : public Print { public: virtual void begin(uint16_t = 0) = 0; };
+class UDP : public Stream {};
@@ -0,0 +1,4 @@
+#pragma once
+#include <Arduino.h>
+#define DHT22 22
+class DHT { public: DHT(int, int) {} void begin() {} float readTemperature() { return 0; } float readHumidity() { return 0; } };
@@ -0,0 +1,76 @@
+#pragma once
+#include <Arduino.h>
+#include <Client.h>
+enum EthernetHardwareStatus { EthernetNoHardware, EthernetW5100, EthernetW5200, EthernetW5500 };
+enum EthernetLinkStatus { Unknown, LinkON, LinkOFF };
+// Requête HTTP injectée (host_stubs.cpp): tout client accepté la lit, stop() la consomme
+extern const char *hostHttpReq;
+extern size_t hostHttpPos;
+class EthernetClient : public Client {
+public:
+  operator bool() override { return hostHttpReq != nullptr; }
+  uint8_t connected() override { return hostHttpReq != nullptr; }
+  int available() override { return hostHttpReq ? (int)strlen(hostHttpReq + hostHttpPos) : 0; }
+  int read() override { return (hostHttpReq && hostHttpReq[hostHttpPos]) ? (uint8_t)hostHttpReq[hostHttpPos++] : -1; }
+  void stop() override { hostHttpReq = nullptr; }
+  EthernetClient() {}
+  EthernetClient(uint8_t s) {}
+  uint8_t getSocketNumber() const { return 0; }
+  uint8_t status() { return 0; }
+  int availableForWrite() { return 0; }
+  IPAddress remoteIP() { return IPAddress(); }
+  uint16_t remotePort() { return 0; }
+  void setConnectionTimeout(uint16_t) {}
+  using Client::read;
+  int read(uint8_t *b, size_t n) override { return (int)readBytes(b, n); }
+};
+class EthernetServer : public Server {
+public:
+  EthernetServer(uint16_t) {}
+  EthernetClient available() { return EthernetClient(); }
+  EthernetClient accept() { return EthernetClient(); }
+  virtual void begin() {}
+  static uint16_t server_port[8];
+  void begin(uint16_t) override {}
+  using Print::write;
+};
+class EthernetUDP : public UDP {
+public:
+  uint8_t begin(uint16_t) { return 1; }
+  uint8_t beginMulticast(IPAddress, uint16_t) { return 1; }
+  void stop() {}
+  int beginPacket(IPAddress, uint16_t) { return 1; }
+  int endPacket() { return 1; }
+  int parsePacket() { return 0; }
+  using Print::write;
+  size_t write(const uint8_t *b, size_t n) override { return n; }
+  int read(uint8_t *, size_t) { return 0; }
+  int read() override { return -1; }
+  IPAddress remoteIP() { return IPAddress(); }
+  uint16_t remotePort() { return 0; }
+};
+class EthernetClass {
+public:
+  void init(uint8_t) {}
+  int begin(uint8_t *, unsigned long = 60000, unsigned long = 4000) { return 1; }
+  void begin(uint8_t *, IPAddress) {}
+  void begin(uint8_t *, IPAddress, IPAddress) {}
+  void begin(uint8_t *, IPAddress, IPAddress, IPAddress) {}
+  void begin(uint8_t *, IPAddress, IPAddress, IPAddress, IPAddress) {}
+  int maintain() { return 0; }
+  EthernetLinkStatus linkStatus() { return LinkON; }
+  EthernetHardwareStatus hardwareStatus() { return EthernetW5500; }
+  IPAddress localIP() { return IPAddress(); }
+  IPAddress subnetMask() { return IPAddress(); }
+  IPAddress gatewayIP() { return IPAddress(); }
+  IPAddress dnsServerIP() { return IPAddress(); }
+  void setLocalIP(const IPAddress) {}
+  void setSubnetMask(const IPAddress) {}
+  void setGatewayIP(const IPAddress) {}
+  void setDnsServerIP(const IPAddress) {}
+  void setMACAddress(const uint8_t *) {}
+  void MACAddress(uint8_t *) {}
+  void setRetransmissionTimeout(uint16_t) {}
+  void setRetransmissionCount(uint8_t) {}
+};
+extern EthernetClass Ethernet;
@@ -0,0 +1,3 @@
+#pragma once
+#include <Arduino.h>
+class Preferences { public: bool begin(const char *, bool = false) { return true; } void end() {} bool getBool(const char *, bool d = false) { return d; } size_t putBool(const char *, bool) { return 1; } size_t getBytesLength(const char *) { return 0; } size_t getBytes(const char *, void *, size_t) { return 0; } size_t putBytes(const char *, const void *, size_t n) { return n; } bool remove(const char *) { return true; } uint32_t getUInt(const char *, uint32_t d = 0) { return d; } size_t putUInt(const char *, uint32_t) { return 4; } bool isKey(const char *) { return false; } uint8_t getUChar(const char *, uint8_t d = 0) { return d; } size_t putUChar(const char *, uint8_t) { return 1; } };
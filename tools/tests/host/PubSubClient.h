@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+#include <Client.h>
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_CONNECTED 0
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECT_FAILED -2
+class PubSubClient : public Print {
+public:
+  PubSubClient(Client &) {}
+  PubSubClient &setServer(IPAddress, uint16_t) { return *this; }
+  PubSubClient &setCallback(void (*)(char *, uint8_t *, unsigned int)) { return *this; }
+  PubSubClient &setKeepAlive(uint16_t) { return *this; }
+  PubSubClient &setSocketTimeout(uint16_t) { return *this; }
+  PubSubClient &setClient(Client &) { return *this; }
+  bool setBufferSize(uint16_t) { return true; }
+  uint16_t getBufferSize() { return 256; }
+  bool connect(const char *) { return true; }
+  bool connect(const char *, const char *, const char *) { return true; }
+  bool connect(const char *, const char *, const char *, const char *, uint8_t, bool, const char *) { return true; }
+  bool connect(const char *, const char *, const char *, const char *, uint8_t, bool, const char *, bool) { return true; }
+  void disconnect() {}
+  bool publish(const char *, const char *) { return true; }
+  bool publish(const char *, const char *, bool) { return true; }
+  bool publish(const char *, const uint8_t *, unsigned int) { return true; }
+  bool publish(const char *, const uint8_t *, unsigned int, bool) { return true; }
+  bool beginPublish(const char *, unsigned int, bool) { return true; }
+  int endPublish() { return 1; }
+  using Print::write;
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *b, size_t n) override { return n; }
+  bool subscribe(const char *) { return true; }
+  bool subscribe(const char *, uint8_t) { return true; }
+  bool loop() { return true; }
+  bool connected() { return true; }
+  int state() { return 0; }
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <Arduino.h>
+#define MSBFIRST 1
+#define SPI_MODE0 0
+struct SPISettings { SPISettings(uint32_t c=0, uint8_t=0, uint8_t=0) : _clock(c) {} uint32_t _clock; uint8_t _bitOrder; uint8_t _dataMode; };
+// beginTransaction() hors ligne (host_stubs.cpp), comme dans le core: -Wl,--wrap s'applique
+class SPIClass { public: void begin(int=-1,int=-1,int=-1,int=-1){} void beginTransaction(SPISettings s); uint32_t lastClock = 0; void endTransaction(){} uint8_t transfer(uint8_t){return 0;} void transfer(void*, size_t){} void transferBytes(const uint8_t*, uint8_t*, uint32_t){} void writeBytes(const uint8_t*, uint32_t){} void setFrequency(uint32_t){} };
+extern SPIClass SPI;
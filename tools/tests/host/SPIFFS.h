@@ -0,0 +1,4 @@
+#pragma once
+#include <FS.h>
+class SPIFFSFS : public fs::FS { public: bool begin(bool = false) { return true; } size_t totalBytes() { return 0; } size_t usedBytes() { return 0; } };
+extern SPIFFSFS SPIFFS;
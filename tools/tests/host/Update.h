@@ -0,0 +1,4 @@
+#pragma once
+#include <Arduino.h>
+class UpdateClass { public: bool begin(size_t) { return true; } size_t write(uint8_t *, size_t n) { return n; } bool end(bool = false) { return true; } void abort() {} uint8_t getError() { return 0; } };
+extern UpdateClass Update;
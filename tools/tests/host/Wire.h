@@ -0,0 +1,4 @@
+#pragma once
+#include <Arduino.h>
+class TwoWire : public Stream { public: bool begin(int, int) { return true; } void setClock(uint32_t) {} void beginTransmission(int) {} uint8_t endTransmission(bool = true) { return 0; } uint8_t requestFrom(int, int) { return 1; } using Print::write; size_t write(uint8_t) override { return 1; } int read() override { return 0; } };
+extern TwoWire Wire;
@@ -0,0 +1,3 @@
+#pragma once
+#include <stdio.h>
+#define esp_rom_printf printf
@@ -0,0 +1,101 @@
+// Définitions des doublures hôte (voir Arduino.h de ce dossier): objets
+// globaux du core et des bibliothèques, horloge simulée, requête HTTP
+// injectée, operator new/delete passés par malloc/free.
+#include <Arduino.h>
+#include <SPI.h>
+#include <Ethernet.h>
+#include <Wire.h>
+#include <SPIFFS.h>
+#include <Update.h>
+#include <utility/w5100.h>
+#include <new>
+#include <time.h>
+
+HardwareSerial Serial, Serial1, Serial2;
+EthernetClass Ethernet;
+TwoWire Wire;
+SPIFFSFS SPIFFS;
+UpdateClass Update;
+SPIClass SPI;
+EspClass ESP;
+W5100Class W5100;
+uint16_t EthernetServer::server_port[8];
+
+// Horloge simulée: avancée par le programme de test
+unsigned long hostMs = 0;
+unsigned long millis() { return hostMs; }
+unsigned long micros() { return hostMs * 1000; }
+int64_t esp_timer_get_time() { return (int64_t)hostMs * 1000; }
+void delay(unsigned long) {}
+void delayMicroseconds(unsigned) {}
+void yield() {}
+
+// Requête HTTP en attente (nullptr: aucune), lue par EthernetClient
+const char *hostHttpReq = nullptr;
+size_t hostHttpPos = 0;
+
+void pinMode(int, int) {}
+void digitalWrite(int, int) {}
+int digitalRead(int) { return 0; }
+void attachInterrupt(int, void (*)(), int) {}
+void detachInterrupt(int) {}
+long random(long) { return 0; }
+long random(long, long) { return 0; }
+void randomSeed(unsigned long) {}
+uint32_t esp_random() { return 0; }
+
+size_t strlcpy(char *d, const char *s, size_t n) {
+  size_t l = strlen(s);
+  if (n) {
+    size_t c = l < n - 1 ? l : n - 1;
+    memcpy(d, s, c);
+    d[c] = 0;
+  }
+  return l;
+}
+
+size_t strlcat(char *d, const char *s, size_t n) {
+  size_t l = strlen(d);
+  return l + strlcpy(d + l, s, n > l ? n - l : 0);
+}
+
+// Cycles d'un CPU fictif à 1000 MHz (temps réel, pour les mesures de durée)
+uint32_t getCpuFrequencyMhz() { return 1000; }
+uint32_t EspClass::getCycleCount() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint32_t)((uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec);
+}
+void EspClass::restart() {}
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint64_t EspClass::getEfuseMac() { return 0; }
+uint32_t EspClass::getHeapSize() { return 0; }
+uint32_t EspClass::getPsramSize() { return 0; }
+uint32_t EspClass::getFreePsram() { return 0; }
+uint32_t EspClass::getSketchSize() { return 0; }
+void *ps_malloc(size_t n) { return malloc(n); }
+bool psramFound() { return false; }
+
+// Tâche loop unique: l'ISR ne réveille personne, l'attente rend la main
+uint32_t xPortGetCoreID() { return 0; }
+bool xPortInIsrContext() { return false; }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return (TaskHandle_t)1; }
+uint32_t ulTaskNotifyTake(BaseType_t, uint32_t) { return 0; }
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) {}
+
+void SPIClass::beginTransaction(SPISettings s) { lastClock = s._clock; }
+
+// libstdc++ alloue dans la bibliothèque partagée, hors de portée de
+// -Wl,--wrap=malloc: new (String, std::string...) repasse ici par malloc.
+void *operator new(size_t n) {
+  void *p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void *operator new[](size_t n) { return operator new(n); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+#include <SPI.h>
+typedef uint8_t SOCKET;
+#define SPI_ETHERNET_SETTINGS SPISettings(14000000, MSBFIRST, SPI_MODE0)
+enum SockCMD { Sock_OPEN = 0x01, Sock_LISTEN = 0x02, Sock_CONNECT = 0x04, Sock_DISCON = 0x08, Sock_CLOSE = 0x10, Sock_SEND = 0x20, Sock_SEND_MAC = 0x21, Sock_SEND_KEEP = 0x22, Sock_RECV = 0x40 };
+class SnMR { public: static const uint8_t CLOSE = 0, TCP = 0x21, UDP = 0x02, MULTI = 0x80; };
+class SnIR { public: static const uint8_t SEND_OK = 0x10, TIMEOUT = 0x08, RECV = 0x04, DISCON = 0x02, CON = 0x01; };
+class SnSR { public: static const uint8_t CLOSED = 0, INIT = 0x13, LISTEN = 0x14, SYNSENT = 0x15, SYNRECV = 0x16, ESTABLISHED = 0x17, FIN_WAIT = 0x18, CLOSING = 0x1A, TIME_WAIT = 0x1B, CLOSE_WAIT = 0x1C, LAST_ACK = 0x1D, UDP = 0x22, IPRAW = 0x32, MACRAW = 0x42, PPPOE = 0x5F; };
+class W5100Class {
+public:
+  static uint8_t init() { return 1; }
+  static uint8_t getChip() { return 55; }
+  static const uint16_t SSIZE = 2048;
+  static const uint16_t SMASK = 0x07FF;
+  static uint16_t SBASE(uint8_t s) { return s * SSIZE + 0x8000; }
+  static uint16_t RBASE(uint8_t s) { return s * SSIZE + 0xC000; }
+  static bool hasOffsetAddressMapping() { return true; }
+  static uint16_t write(uint16_t, const uint8_t *, uint16_t n) { return n; }
+  static uint8_t write(uint16_t, uint8_t) { return 1; }
+  static uint16_t read(uint16_t, uint8_t *, uint16_t n) { return n; }
+  static uint8_t read(uint16_t) { return 0; }
+  static void execCmdSn(SOCKET, SockCMD) {}
+#define R8(n) static uint8_t read##n(SOCKET) { return 0; } static void write##n(SOCKET, uint8_t) {}
+#define R16(n) static uint16_t read##n(SOCKET) { return 0; } static void write##n(SOCKET, uint16_t) {}
+  R8(SnMR) R8(SnCR) R8(SnIR) R8(SnSR) R16(SnPORT) R16(SnDPORT) R16(SnMSSR) R8(SnTTL) R8(SnRX_SIZE) R8(SnTX_SIZE) R16(SnTX_FSR) R16(SnTX_RD) R16(SnTX_WR) R16(SnRX_RSR) R16(SnRX_RD) R16(SnRX_WR) R16(SnIMR)
+  static void writeSnDIPR(SOCKET, const uint8_t *) {}
+  static void readSnDIPR(SOCKET, uint8_t *) {}
+  static void writeSnDHAR(SOCKET, const uint8_t *) {}
+  R8(SnKPALVTR)
+#undef R8
+#define G8(n) static uint8_t read##n() { return 0; } static void write##n(uint8_t) {}
+#define G16(n) static uint16_t read##n() { return 0; } static void write##n(uint16_t) {}
+  G8(MR) G8(IR) G8(IMR) G8(SIR) G8(SIMR) G16(INTLEVEL) G16(RTR) G8(RCR) G8(PHYCFGR_W5500) G8(VERSIONR_W5500)
+  static uint8_t getPHYCFGR() { return 0; }
+  static void setRetransmissionTime(uint16_t) {}
+  static void setRetransmissionCount(uint8_t) {}
+};
+extern W5100Class W5100;
+#define MAX_SOCK_NUM 8
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Esclave Modbus RTU simulé (compteurs d'énergie) pour tester le maître RS485
+de la carte ou sa version hôte sous Linux.
+
+- sans argument: crée une paire de pseudo-terminaux et affiche le port
+  (ex: /dev/pts/5) à ouvrir par le programme testé
+- --port /dev/ttyUSB0: utilise un adaptateur USB-RS485 réel (pyserial)
+
+Esclaves 1..N (--units): FC 01/02/03/04/05/06/0F/10, registres qui évoluent
+à chaque lecture. Fin de trame détectée par un silence de 3,5 caractères.
+
+Usage: python3 modbus_rtu_slave_sim.py --units 3 --baud 9600 --delay-ms 5
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+class Slave:
+    def __init__(self, unit):
+        self.unit = unit
+        self.coils = [False] * 256
+        self.holding = [unit * 1000 + i for i in range(256)]
+        self.ticks = 0
+
+    def input_reg(self, addr):
+        # Mesure "vivante": varie à chaque lecture
+        return (self.unit * 100 + addr + self.ticks) & 0xFFFF
+
+    def handle(self, pdu):
+        fc = pdu[0]
+        try:
+            if fc in (1, 2, 3, 4):
+                addr, count = struct.unpack(">HH", pdu[1:5])
+                if count < 1 or addr + count > 256:
+                    return bytes([fc | 0x80, 0x02])
+                self.ticks += 1
+                if fc in (1, 2):
+                    bits = [self.coils[addr + i] if fc == 1 else bool((addr + i) & 1) for i in range(count)]
+                    data = bytearray((count + 7) // 8)
+                    for i, b in enumerate(bits):
+                        if b:
+                            data[i // 8] |= 1 << (i % 8)
+                    return bytes([fc, len(data)]) + bytes(data)
+                regs = [self.holding[addr + i] if fc == 3 else self.input_reg(addr + i) for i in range(count)]
+                return bytes([fc, count * 2]) + struct.pack(">%dH" % count, *regs)
+            if fc == 5:
+                addr, value = struct.unpack(">HH", pdu[1:5])
+                self.coils[addr] = value == 0xFF00
+                return bytes(pdu[:5])
+            if fc == 6:
+                addr, value = struct.unpack(">HH", pdu[1:5])
+                self.holding[addr] = value
+                return bytes(pdu[:5])
+            if fc == 15:
+                addr, count = struct.unpack(">HH", pdu[1:5])
+                for i in range(count):
+                    self.coils[addr + i] = bool(pdu[6 + i // 8] & (1 << (i % 8)))
+                return bytes(pdu[:5])
+            if fc == 16:
+                addr, count = struct.unpack(">HH", pdu[1:5])
+                for i in range(count):
+                    self.holding[addr + i] = struct.unpack(">H", pdu[6 + 2 * i:8 + 2 * i])[0]
+                return bytes(pdu[:5])
+        except (IndexError, struct.error):
+            return bytes([fc | 0x80, 0x03])
+        return bytes([fc | 0x80, 0x01])
+
+
+def open_port(args):
+    if args.port:
+        import serial  # pyserial
+        ser = serial.Serial(args.port, args.baud, timeout=0)
+        return ser.fileno(), ser
+    # Le simulateur garde le côté maître du PTY; le programme testé ouvre l'autre côté
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    attrs = termios.tcgetattr(slave)
+    attrs[3] &= ~termios.ECHO
+    termios.tcsetattr(slave, termios.TCSANOW, attrs)
+    print(f"Port à ouvrir: {os.ttyname(slave)}", flush=True)
+    return master, slave
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--port", help="port série réel (sinon paire de PTY)")
+    ap.add_argument("--baud", type=int, default=9600)
+    ap.add_argument("--units", type=int, default=2, help="nombre d'esclaves (adresses 1..N)")
+    ap.add_argument("--delay-ms", type=float, default=5.0, help="temps de réponse de l'esclave")
+    ap.add_argument("--silent-unit", type=int, default=0, help="adresse qui ne répond jamais (test timeout)")
+    args = ap.parse_args()
+
+    fd, _keep = open_port(args)
+    slaves = {u: Slave(u) for u in range(1, args.units + 1)}
+    gap = max(3.5 * 11 / args.baud, 0.00175)
+    frame = bytearray()
+    served = 0
+
+    while True:
+        r, _, _ = select.select([fd], [], [], gap if frame else None)
+        if r:
+            try:
+                frame += os.read(fd, 256)
+            except OSError:
+                time.sleep(0.05)  # côté maître pas encore ouvert
+            continue
+        # Silence: trame complète
+        req, frame = bytes(frame), bytearray()
+        if len(req) < 4 or crc16(req[:-2]) != struct.unpack("<H", req[-2:])[0]:
+            print(f"✗ trame invalide {req.hex()}", flush=True)
+            continue
+        unit = req[0]
+        if unit not in slaves or unit == args.silent_unit:
+            continue
+        resp = bytes([unit]) + slaves[unit].handle(req[1:-2])
+        resp += struct.pack("<H", crc16(resp))
+        time.sleep(args.delay_ms / 1000.0)
+        os.write(fd, resp)
+        served += 1
+        if served % 100 == 0:
+            print(f"{served} réponses", flush=True)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except KeyboardInterrupt:
+        sys.exit(0)
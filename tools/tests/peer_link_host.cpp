@@ -0,0 +1,166 @@
+// Build PC du moteur de liens directs (src/peer_link.h) sur un socket UDP.
+// Deux instances l'une contre l'autre en boucle locale remplacent deux cartes:
+//   émetteur  (A): entrée 0 -> relais 2 (follow, repli off),
+//                  entrée 1 -> relais 3 (toggle, repli hold)
+//   récepteur (B): applique les LINK, répond ACK, passe en repli quand A se tait
+// Lancé par test_peer_link_loopback.py; utilisable seul:
+//   g++ -std=gnu++17 -O2 -Isrc tools/tests/peer_link_host.cpp -o peer_link_host
+//   ./peer_link_host receiver 47001 47000 &
+//   ./peer_link_host sender 47000 47001 1000
+// Dernière ligne de chaque instance: résultat "clé=valeur" lu par le script.
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "peer_link.h"
+
+#define RETRY_MS 20
+#define HEARTBEAT_MS 500
+#define TIMEOUT_MS 1500
+#define CHANGE_PERIOD_US 5000        // un changement d'entrée toutes les 5 ms
+#define RUN_MAX_S 30                 // abandon d'une instance bloquée
+
+static int sock = -1;
+static uint8_t relays = 0;
+
+static uint64_t monoUs() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000ULL + (uint64_t)t.tv_nsec / 1000;
+}
+
+static bool hostSend(uint32_t addr, uint16_t port, const uint8_t *buf, size_t len) {
+  sockaddr_in to = {};
+  to.sin_family = AF_INET;
+  to.sin_port = htons(port);
+  to.sin_addr.s_addr = addr;
+  return sendto(sock, buf, len, 0, (sockaddr *)&to, sizeof(to)) == (ssize_t)len;
+}
+
+static void hostApply(uint8_t mask, uint8_t values) {
+  relays = (uint8_t)((relays & ~mask) | (values & mask));
+}
+
+// Datagrammes en attente: ACK (émetteur) ou LINK (récepteur)
+static void drain(PeerLink &link, UdpCtrl &ctrl) {
+  uint8_t buf[UDP_CTRL_MAX_LEN + 8];
+  for (;;) {
+    sockaddr_in from = {};
+    socklen_t fromLen = sizeof(from);
+    ssize_t n = recvfrom(sock, buf, sizeof(buf), MSG_DONTWAIT, (sockaddr *)&from, &fromLen);
+    if (n <= 0) return;
+    uint64_t us = monoUs();
+    uint32_t ms = (uint32_t)(us / 1000);
+    uint8_t type = udpCtrlType(buf, (size_t)n);
+    uint32_t seq;
+    uint8_t status, r, in;
+    if (type == UDP_CTRL_ACK && udpCtrlDecodeAck(ctrl, buf, (size_t)n, seq, status, r, in)) {
+      if (status == UDP_CTRL_OK) peerLinkOnAck(link, from.sin_addr.s_addr, seq, ms, (uint32_t)us);
+    } else if (type == UDP_CTRL_LINK &&
+               peerLinkOnLink(link, from.sin_addr.s_addr, buf, (size_t)n, ms, seq, status)) {
+      uint8_t ack[UDP_CTRL_ACK_LEN];
+      size_t k = udpCtrlEncodeAck(ctrl, seq, status, relays, 0, ack);
+      sendto(sock, ack, k, 0, (sockaddr *)&from, fromLen);
+    }
+  }
+}
+
+static int runSender(PeerLink &link, UdpCtrl &ctrl, uint16_t peerPort, int changes) {
+  uint32_t lo = htonl(INADDR_LOOPBACK);
+  peerLinkAddBinding(link, lo, peerPort, 0, 2, PEER_MODE_FOLLOW, PEER_FS_OFF);
+  peerLinkAddBinding(link, lo, peerPort, 1, 3, PEER_MODE_TOGGLE, PEER_FS_HOLD);
+
+  uint8_t inputs = 0;
+  int done = 0;
+  uint64_t start = monoUs();
+  uint64_t nextChange = start + 200000;
+  peerLinkInputs(link, inputs, (uint32_t)(start / 1000), (uint32_t)start);
+  for (;;) {
+    uint64_t us = monoUs();
+    // Changement suivant une fois le précédent acquitté: une mesure par changement
+    if (done < changes && us >= nextChange && link.out[0].acked) {
+      inputs ^= 0x01;
+      if (done % 10 == 0) inputs ^= 0x02;
+      done++;
+      nextChange = us + CHANGE_PERIOD_US;
+      peerLinkInputs(link, inputs, (uint32_t)(us / 1000), (uint32_t)us);
+    }
+    pollfd pf = {sock, POLLIN, 0};
+    poll(&pf, 1, 1);
+    drain(link, ctrl);
+    peerLinkService(link, (uint32_t)(monoUs() / 1000));
+    if (done >= changes && link.out[0].acked) break;
+    if (monoUs() - start > (uint64_t)RUN_MAX_S * 1000000ULL) break;
+  }
+
+  const LatencyHistogram &h = link.latency;
+  const PeerLinkOut &o = link.out[0];
+  printf("[A] histogramme (us) <50 <100 <200 <500 <1000 <2000 <5000 >=:");
+  for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) printf(" %lu", (unsigned long)h.counts[i]);
+  printf("\n");
+  printf("changes=%d acks=%lu sent=%lu retransmits=%lu avg_us=%lu max_us=%lu\n", done, (unsigned long)h.samples,
+         (unsigned long)o.sent, (unsigned long)o.retransmits, (unsigned long)latencyHistAvgUs(h),
+         (unsigned long)h.maxUs);
+  return done == changes ? 0 : 1;
+}
+
+// Attend le premier LINK, puis le silence de l'émetteur et le repli
+static int runReceiver(PeerLink &link, UdpCtrl &ctrl) {
+  uint64_t start = monoUs();
+  uint64_t lastLinkUs = 0;
+  uint32_t commands = 0;
+  for (;;) {
+    pollfd pf = {sock, POLLIN, 0};
+    poll(&pf, 1, 1);
+    drain(link, ctrl);
+    if (ctrl.stats.commands != commands) {
+      commands = ctrl.stats.commands;
+      lastLinkUs = monoUs();
+    }
+    peerLinkService(link, (uint32_t)(monoUs() / 1000));
+    if (link.in[0].failed) break;
+    if (monoUs() - start > (uint64_t)RUN_MAX_S * 1000000ULL) {
+      printf("links=%lu failsafe=0\n", (unsigned long)commands);
+      return 1;
+    }
+  }
+  unsigned long silentMs = (unsigned long)((monoUs() - lastLinkUs) / 1000);
+  printf("links=%lu replays=%lu failsafe=1 failsafe_after_ms=%lu relays=0x%02X\n", (unsigned long)commands,
+         (unsigned long)ctrl.stats.replays, silentMs, relays);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 4) {
+    fprintf(stderr, "usage: %s sender|receiver <port local> <port distant> [changements]\n", argv[0]);
+    return 2;
+  }
+  bool sender = strcmp(argv[1], "sender") == 0;
+  uint16_t myPort = (uint16_t)atoi(argv[2]);
+  uint16_t peerPort = (uint16_t)atoi(argv[3]);
+  int changes = argc > 4 ? atoi(argv[4]) : 1000;
+
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in me = {};
+  me.sin_family = AF_INET;
+  me.sin_port = htons(myPort);
+  me.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (sock < 0 || bind(sock, (sockaddr *)&me, sizeof(me)) != 0) {
+    perror("bind");
+    return 2;
+  }
+
+  static UdpCtrl ctrl;
+  static PeerLink link;
+  udpCtrlInit(ctrl, "loopback-test", 0);
+  PeerLinkIo io = {hostSend, hostApply, nullptr};
+  peerLinkInit(link, &ctrl, io, RETRY_MS, HEARTBEAT_MS, TIMEOUT_MS, (uint32_t)time(nullptr) << 12);
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  int rc = sender ? runSender(link, ctrl, peerPort, changes) : runReceiver(link, ctrl);
+  close(sock);
+  return rc;
+}
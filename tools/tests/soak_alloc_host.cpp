@@ -0,0 +1,136 @@
+// Endurance hôte du mode sans allocation: setup() puis loop() du firmware
+// (src/main.cpp) compilés sur PC contre les doublures de tools/tests/host/,
+// horloge simulée à 1 ms par itération. Le trafic du tableau de bord
+// (comme soak_alloc_idle.py) et une commande MQTT toutes les 10 s sont
+// injectés. Après le préchauffage, les compteurs sont remis à zéro comme par
+// GET /api/mem?reset=1, puis vérifiés: traçage actif, iter_dirty = 0,
+// hot = 0, chaque requête servie, chaque commande appliquée.
+//   g++ -std=gnu++17 -O1 -Isrc -Itools/tests/host -DENABLE_OTA_HTTP=1 \
+//     tools/tests/soak_alloc_host.cpp tools/tests/host/host_stubs.cpp \
+//     -Wl,--wrap=malloc,--wrap=free,--wrap=realloc,--wrap=calloc \
+//     -Wl,--wrap=_ZN8SPIClass16beginTransactionE11SPISettings -o soak_alloc_host
+//   ./soak_alloc_host 1000000
+// Couvre le firmware; les bibliothèques sont des doublures (voir
+// tools/tests/host/Arduino.h): une allocation interne à Ethernet ou
+// PubSubClient n'est visible que sur la carte (soak_alloc_idle.py).
+#include "alloc_trace.h"
+#include "main.cpp"
+
+extern unsigned long hostMs;
+extern const char *hostHttpReq;
+extern size_t hostHttpPos;
+
+#define WARMUP_MS 60000
+#define MQTT_CMD_PERIOD_MS 10000
+
+struct SoakReq {
+  unsigned long periodMs;
+  const char *name;
+  const char *text;
+  uint32_t injected;
+  uint32_t served;
+  uint32_t allocs;                 // allocations des itérations qui l'ont servie
+};
+
+static SoakReq reqs[] = {
+  {60000, "GET /", "GET / HTTP/1.1\r\nHost: 192.168.1.50\r\nAccept: text/html,application/xhtml+xml\r\n"
+                   "Accept-Language: fr-FR,fr;q=0.9,en;q=0.5\r\n\r\n", 0, 0, 0},
+  {45000, "GET /api/boot", "GET /api/boot HTTP/1.1\r\nHost: 192.168.1.50\r\n\r\n", 0, 0, 0},
+  {30000, "GET /api/config", "GET /api/config HTTP/1.1\r\nHost: 192.168.1.50\r\n\r\n", 0, 0, 0},
+  {20000, "GET /api/logs", "GET /api/logs HTTP/1.1\r\nHost: 192.168.1.50\r\n\r\n", 0, 0, 0},
+  {10000, "GET /api/mem", "GET /api/mem HTTP/1.1\r\nHost: 192.168.1.50\r\n\r\n", 0, 0, 0},
+  {5000, "GET /relay", "GET /relay HTTP/1.1\r\nHost: 192.168.1.50\r\n\r\n", 0, 0, 0},
+  {1500, "GET /api/status", "GET /api/status HTTP/1.1\r\nHost: 192.168.1.50\r\n"
+                            "User-Agent: Mozilla/5.0 (X11; Linux x86_64) Gecko/20100101 Firefox/128.0\r\n"
+                            "Accept: */*\r\nReferer: http://192.168.1.50/\r\n\r\n", 0, 0, 0},
+};
+
+// Commande reçue pendant mqttClient.loop() sur la carte
+static void injectMqttCommand(uint32_t n) {
+  static char topic[sizeof(topicRelayCmd)];
+  static char payload[64];
+  strlcpy(topic, topicRelayCmd, sizeof(topic));
+  int len = snprintf(payload, sizeof(payload), "{\"relay\":3,\"state\":\"%s\",\"id\":\"soak-%lu\"}",
+                     (n & 1) ? "off" : "on", (unsigned long)n);
+  allocTag(ALLOC_TAG_MQTT);
+  mqttCallback(topic, (byte *)payload, (unsigned)len);
+}
+
+int main(int argc, char **argv) {
+  long iters = argc > 1 ? atol(argv[1]) : 1000000;
+  allocTraceBegin();
+  setup();
+  // Broker joignable: branche connectée de loop() (publications, acquittements)
+  mqttPhase = MQTT_PHASE_CONNECTED;
+  mqttConnected = true;
+
+  uint32_t mqttCmds = 0, mqttApplied0 = 0;
+  SoakReq *pending = nullptr;
+  uint32_t pendingAllocs = 0;
+  for (long i = 0; i < WARMUP_MS + iters; i++) {
+    if (i == WARMUP_MS) {
+      allocTraceReset();
+      for (SoakReq &r : reqs) r.injected = r.served = r.allocs = 0;
+      mqttCmds = 0;
+      mqttApplied0 = mqttCmdLatency.samples;
+    }
+    hostMs++;
+    if (!pending) {
+      for (SoakReq &r : reqs) {
+        if (hostMs % r.periodMs != 0) continue;
+        hostHttpReq = r.text;
+        hostHttpPos = 0;
+        r.injected++;
+        pending = &r;
+        pendingAllocs = 0;
+        break;
+      }
+    }
+    uint32_t before = allocTrace.total;
+    if (hostMs % MQTT_CMD_PERIOD_MS == MQTT_CMD_PERIOD_MS / 2) injectMqttCommand(mqttCmds++);
+    loop();
+    if (pending) {
+      pendingAllocs += allocTrace.total - before;
+      if (!hostHttpReq) {
+        pending->served++;
+        pending->allocs += pendingAllocs;
+        pending = nullptr;
+      }
+    }
+  }
+  allocTraceIteration();                         // bilan de la dernière itération
+
+  uint32_t applied = mqttCmdLatency.samples - mqttApplied0;
+  printf("%ld itérations (%ld ms simulées après %d ms de préchauffage)\n", iters, iters, WARMUP_MS);
+  printf("traçage actif: %d\n", (int)allocTrace.active);
+  printf("iterations=%lu iter_dirty=%lu iter_max=%lu hot=%lu\n", (unsigned long)allocTrace.iterations,
+         (unsigned long)allocTrace.iterDirty, (unsigned long)allocTrace.iterMax, (unsigned long)allocTrace.hotAllocs);
+  for (int k = 0; k < ALLOC_TAG_COUNT; k++) {
+    if (allocTrace.tags[k].allocs) printf("  %-7s %lu allocations\n", ALLOC_TAG_NAMES[k], (unsigned long)allocTrace.tags[k].allocs);
+  }
+  bool served = pending == nullptr;
+  for (const SoakReq &r : reqs) {
+    printf("  %-16s injectées %5lu servies %5lu allocations %lu\n", r.name, (unsigned long)r.injected,
+           (unsigned long)r.served, (unsigned long)r.allocs);
+    if (r.served != r.injected) served = false;
+  }
+  printf("commandes MQTT: %lu injectées, %lu appliquées\n", (unsigned long)mqttCmds, (unsigned long)applied);
+
+  bool ok = true;
+  if (!allocTrace.active) {
+    printf("ÉCHEC: traçage inactif (options -Wl,--wrap=malloc... absentes)\n");
+    ok = false;
+  }
+  if (allocTrace.iterDirty || allocTrace.hotAllocs) {
+    printf("ÉCHEC: %lu itérations ont alloué, %lu en section chaude (appelant %p, %s)\n",
+           (unsigned long)allocTrace.iterDirty, (unsigned long)allocTrace.hotAllocs, (void *)allocTrace.hotCaller,
+           ALLOC_TAG_NAMES[allocTrace.hotTag]);
+    ok = false;
+  }
+  if (!served || applied != mqttCmds) {
+    printf("ÉCHEC: requête ou commande non traitée, la mesure ne couvre pas le trafic\n");
+    ok = false;
+  }
+  printf(ok ? "OK: aucune allocation en régime établi\n" : "");
+  return ok ? 0 : 1;
+}
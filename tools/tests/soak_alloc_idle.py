@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""
+Endurance au repos de l'ESP32-S3 8DI/8RO: aucune allocation du tas par tour de loop()
+- simule le tableau de bord: GET /api/status toutes les 1,5 s, plus /relay
+  (lecture), /api/logs, /api/config, /api/boot et la page / de temps en temps
+- après --warmup s, remet les compteurs à zéro (GET /api/mem?reset=1)
+- toutes les --sample s: GET /api/mem (compteurs "alloc")
+- échec si le traçage est absent, si un tour de loop() a alloué
+  (iter_dirty) ou si une section chaude a alloué (hot)
+
+Ne modifie rien: ni relais, ni config. Laisser MQTT connecté (broker joignable)
+pour couvrir la réception et les publications.
+
+Même vérification sans carte (firmware compilé sur PC): tools/tests/soak_alloc_host.cpp
+
+Usage: ESP32_HOST=192.168.1.50 python3 soak_alloc_idle.py --duration 600
+Dépendance: pip install requests
+"""
+
+import argparse
+import os
+import sys
+import time
+
+import requests
+
+HOST = os.getenv("ESP32_HOST", "192.168.1.50")
+
+# (période en s, chemin)
+POLLS = [
+    (1.5, "/api/status"),
+    (5.0, "/relay"),
+    (20.0, "/api/logs"),
+    (30.0, "/api/config"),
+    (30.0, "/api/boot"),
+    (60.0, "/"),
+]
+
+
+def mem(session, base, reset=False):
+    r = session.get(f"{base}/api/mem" + ("?reset=1" if reset else ""), timeout=5)
+    r.raise_for_status()
+    return r.json().get("alloc", {})
+
+
+def show(elapsed, al):
+    tags = ", ".join(f"{t['tag']} {t['allocs']}" for t in al.get("tags", [])) or "-"
+    print(f"  {elapsed:6.0f} s: {al.get('iterations', 0):9d} tours, avec allocation {al.get('iter_dirty', 0)}, "
+          f"max/tour {al.get('iter_max', 0)}, section chaude {al.get('hot', 0)} | {tags}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default=HOST)
+    ap.add_argument("--duration", type=float, default=600.0, help="durée mesurée (s)")
+    ap.add_argument("--warmup", type=float, default=10.0, help="mise en route avant remise à zéro (s)")
+    ap.add_argument("--sample", type=float, default=30.0)
+    args = ap.parse_args()
+
+    base = f"http://{args.host}"
+    s = requests.Session()
+    errors = 0
+
+    def poll(until):
+        nonlocal errors
+        due = {path: 0.0 for _, path in POLLS}
+        while time.monotonic() < until:
+            now = time.monotonic()
+            for period, path in POLLS:
+                if now < due[path]:
+                    continue
+                due[path] = now + period
+                try:
+                    r = s.get(f"{base}{path}", timeout=5)
+                    if r.status_code != 200:
+                        errors += 1
+                        print(f"✗ GET {path}: HTTP {r.status_code}")
+                except requests.RequestException as e:
+                    errors += 1
+                    print(f"✗ GET {path}: {e}")
+            time.sleep(0.05)
+
+    poll(time.monotonic() + args.warmup)
+    al = mem(s, base, reset=True)
+    if not al.get("active"):
+        print("✗ traçage absent (options --wrap de platformio.ini)")
+        return 1
+
+    t0 = time.monotonic()
+    end = t0 + args.duration
+    while time.monotonic() < end:
+        poll(min(end, time.monotonic() + args.sample))
+        al = mem(s, base)
+        show(time.monotonic() - t0, al)
+
+    if al.get("hot"):
+        print(f"Section chaude: {al.get('hot_tag')} @ {al.get('hot_caller')} "
+              f"(xtensa-esp32s3-elf-addr2line -e firmware.elf {al.get('hot_caller')})")
+    others = al.get("other_tasks", {})
+    print(f"Autres tâches: {others.get('allocs', 0)} allocations, {others.get('frees', 0)} libérations")
+
+    ok = errors == 0 and al.get("iterations", 0) > 0 and al.get("iter_dirty", 1) == 0 and al.get("hot", 1) == 0
+    print(("✓ " if ok else "✗ ") + f"{al.get('iterations', 0)} tours de loop(), {al.get('iter_dirty', 0)} avec allocation, "
+          f"{errors} erreur(s)")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
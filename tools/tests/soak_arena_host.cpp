@@ -0,0 +1,269 @@
+// Endurance hôte de l'arène par requête (src/req_arena.h): tas simulé de
+// 200 Ko (first-fit avec fusion des voisins, comme un tas embarqué sans MMU),
+// 1 000 000 requêtes mêlées, deux passes sur la même suite aléatoire:
+//   tas:   documents JSON, corps et réponse String pris sur le tas;
+//   arène: mêmes tailles par reqAlloc/reqRealloc/reqFree/reqArenaEnd dans
+//          une zone de HTTP_ARENA_SIZE octets (prise sur la RAM statique,
+//          donc retirée du tas simulé); un repli (zone pleine) est reporté
+//          sur le tas simulé.
+// Entre les requêtes, des allocations durables de vie aléatoire (messages,
+// tampons de bibliothèques) restent sur le tas dans les deux passes. Le plus
+// grand bloc libre est relevé toutes les 10 requêtes et affiché par dixième.
+// Échec si la passe arène voit un malloc échouer, si son plus grand bloc
+// libre tombe sous ARENA_LARGEST_MIN, si elle fragmente plus que la passe tas
+// (1 - plus grand bloc / libre) ou si la zone n'est pas rendue vide.
+//   g++ -std=gnu++17 -O2 -Isrc tools/tests/soak_arena_host.cpp -o soak_arena_host
+//   ./soak_arena_host 1000000
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <random>
+#include "req_arena.h"
+
+#define HEAP_BYTES (200 * 1024)
+#define HTTP_ARENA_SIZE 12288              // défaut de main.cpp
+#define ARENA_LARGEST_MIN (16 * 1024)      // page / envoyée par morceaux: 16 Ko suffisent
+#define DURABLE_MAX 1024
+#define SAMPLE_EVERY 10
+
+// Tas first-fit: blocs libres [offset, taille) triés, en-tête de 8 octets
+struct SimHeap {
+  size_t cap;
+  std::map<size_t, size_t> freeBlocks;
+  std::map<size_t, size_t> used;
+  size_t fails = 0;
+
+  explicit SimHeap(size_t c) : cap(c) { freeBlocks[0] = c; }
+
+  long alloc(size_t n) {
+    n = ((n + 7) & ~(size_t)7) + 8;
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+      if (it->second < n) continue;
+      size_t off = it->first, size = it->second;
+      freeBlocks.erase(it);
+      if (size > n) freeBlocks[off + n] = size - n;
+      used[off] = n;
+      return (long)off;
+    }
+    fails++;
+    return -1;
+  }
+
+  void release(long off) {
+    if (off < 0) return;
+    auto u = used.find((size_t)off);
+    if (u == used.end()) abort();
+    size_t size = u->second;
+    used.erase(u);
+    auto next = freeBlocks.lower_bound((size_t)off);
+    if (next != freeBlocks.end() && (size_t)off + size == next->first) {
+      size += next->second;
+      next = freeBlocks.erase(next);
+    }
+    if (next != freeBlocks.begin()) {
+      auto prev = std::prev(next);
+      if (prev->first + prev->second == (size_t)off) {
+        prev->second += size;
+        return;
+      }
+    }
+    freeBlocks[(size_t)off] = size;
+  }
+
+  // realloc pire cas: nouveau bloc puis ancien rendu
+  long grow(long off, size_t n) {
+    long q = alloc(n);
+    release(off);
+    return q;
+  }
+
+  size_t largest() const {
+    size_t m = 0;
+    for (const auto &f : freeBlocks) m = f.second > m ? f.second : m;
+    return m;
+  }
+
+  size_t freeTotal() const {
+    size_t t = 0;
+    for (const auto &f : freeBlocks) t += f.second;
+    return t;
+  }
+};
+
+// Tailles par route (capacités des HttpJsonDocument de main.cpp)
+struct Route {
+  const char *name;
+  size_t doc;                              // document JSON (0: aucun)
+  size_t out;                              // réponse sérialisée
+  size_t body;                             // corps POST
+  int weight;
+};
+
+static const Route ROUTES[] = {
+  {"GET /api/status", 4864, 2900, 0, 50},
+  {"GET /api/config", 1221, 1150, 0, 10},
+  {"POST /api/config", 1600, 150, 900, 5},
+  {"GET /api/boot", 1280, 600, 0, 5},
+  {"GET /relay", 0, 2, 0, 25},
+  {"GET /api/logs", 0, 3000, 0, 5},
+};
+static const int ROUTE_COUNT = sizeof(ROUTES) / sizeof(ROUTES[0]);
+
+static uint8_t arenaMem[HTTP_ARENA_SIZE] __attribute__((aligned(REQ_ARENA_ALIGN)));
+
+// Replis de l'arène (vrai malloc) reportés sur le tas simulé
+struct Fallback {
+  void *p;
+  long off;
+};
+static Fallback fallbacks[8];
+static int fallbackCount = 0;
+
+static void *arenaAlloc(ReqArena &a, SimHeap &h, size_t n) {
+  uint32_t before = a.heapAllocs;
+  void *p = reqAlloc(a, n);
+  if (p && a.heapAllocs != before && fallbackCount < 8) fallbacks[fallbackCount++] = {p, h.alloc(n)};
+  return p;
+}
+
+static void arenaFree(ReqArena &a, SimHeap &h, void *p) {
+  for (int k = 0; k < fallbackCount; k++) {
+    if (fallbacks[k].p != p) continue;
+    h.release(fallbacks[k].off);
+    fallbacks[k] = fallbacks[--fallbackCount];
+    break;
+  }
+  reqFree(a, p);
+}
+
+// Réponse String: ArduinoJson écrit par morceaux de 32 octets
+static long stringGrow(SimHeap &h, size_t total) {
+  long p = -1;
+  for (size_t n = 32; n < total + 32; n += 32) p = p < 0 ? h.alloc(n) : h.grow(p, n);
+  return p;
+}
+
+struct Durable {
+  long off;
+  long expires;                            // numéro de requête
+};
+
+struct PassResult {
+  size_t fails;
+  size_t minLargest;
+  double maxFrag;                          // 1 - plus grand bloc / libre
+  bool arenaEmpty;
+};
+
+static PassResult runPass(bool arena, long count) {
+  SimHeap h(arena ? HEAP_BYTES - sizeof(arenaMem) : HEAP_BYTES);
+  std::mt19937 rng(42);
+  ReqArena a = REQ_ARENA_INIT(arenaMem);
+  ReqArenaRoute routes[ROUTE_COUNT];
+  for (int i = 0; i < ROUTE_COUNT; i++) routes[i] = {ROUTES[i].name, 0, 0, 0, 0};
+  static Durable durable[DURABLE_MAX];
+  int durableCount = 0;
+  int totalWeight = 0;
+  for (const Route &r : ROUTES) totalWeight += r.weight;
+
+  // Allocations permanentes (tampons de bibliothèques, tâches)
+  for (int i = 0; i < 40; i++) h.alloc(600 + rng() % 1400);
+
+  PassResult res = {0, SIZE_MAX, 0.0, true};
+  long firstFail = -1;
+  printf("%s\n", arena ? "arène" : "tas");
+  for (long req = 0; req < count; req++) {
+    for (int k = 0; k < durableCount;) {
+      if (durable[k].expires > req) {
+        k++;
+        continue;
+      }
+      h.release(durable[k].off);
+      durable[k] = durable[--durableCount];
+    }
+    int w = (int)(rng() % totalWeight), r = 0;
+    while (w >= ROUTES[r].weight) w -= ROUTES[r++].weight;
+    const Route &ro = ROUTES[r];
+    // Une requête sur 500 dépasse la zone (corps ou réponse hors norme)
+    size_t extra = rng() % 500 == 0 ? HTTP_ARENA_SIZE : 0;
+
+    long hdr[4];
+    for (long &x : hdr) x = h.alloc(16 + rng() % 48);
+    bool durableNow = rng() % 2 == 0;
+    size_t durableSize = 40 + rng() % 200;
+    long durableLife = 50 + rng() % 500;
+    if (!arena) {
+      long body = ro.body ? stringGrow(h, ro.body + 1) : -1;
+      long doc = ro.doc ? h.alloc(ro.doc) : -1;
+      long out = ro.doc || ro.out > 100 ? stringGrow(h, ro.out + extra) : -1;
+      if (durableNow && durableCount < DURABLE_MAX) durable[durableCount++] = {h.alloc(durableSize), req + durableLife};
+      h.release(out);
+      h.release(doc);
+      h.release(body);
+    } else {
+      // Corps lu par morceaux de 512: reqRealloc agrandit le dernier bloc sur place
+      void *body = nullptr;
+      for (size_t n = 512; ro.body && n < ro.body + 512; n += 512) body = reqRealloc(a, body, n < ro.body ? n : ro.body + 1);
+      void *doc = ro.doc ? arenaAlloc(a, h, ro.doc) : nullptr;
+      void *out = ro.doc || ro.out > 100 ? arenaAlloc(a, h, ro.out + 1 + extra) : nullptr;
+      if (durableNow && durableCount < DURABLE_MAX) durable[durableCount++] = {h.alloc(durableSize), req + durableLife};
+      arenaFree(a, h, out);
+      arenaFree(a, h, doc);
+      arenaFree(a, h, body);
+      reqArenaEnd(a, routes[r]);
+      if (a.used != 0 || a.last != REQ_ARENA_NONE || fallbackCount != 0) res.arenaEmpty = false;
+    }
+    for (int k = 3; k >= 0; k--) h.release(hdr[k]);
+
+    if (h.fails && firstFail < 0) firstFail = req;
+    if (req % SAMPLE_EVERY == 0) {
+      size_t largest = h.largest();
+      double frag = 1.0 - (double)largest / (double)h.freeTotal();
+      if (largest < res.minLargest) res.minLargest = largest;
+      if (frag > res.maxFrag) res.maxFrag = frag;
+    }
+    if ((req + 1) % (count / 10) == 0) {
+      printf("  %8ld req: libre %6zu plus grand bloc %6zu (min %6zu) fragmentation max %4.1f%% échecs %zu\n",
+             req + 1, h.freeTotal(), h.largest(), res.minLargest, 100 * res.maxFrag, h.fails);
+    }
+  }
+  if (arena) {
+    for (const ReqArenaRoute &rt : routes) {
+      printf("  %-18s n=%7u pic=%5u tas=%u\n", rt.name, (unsigned)rt.requests, (unsigned)rt.peak, (unsigned)rt.heapAllocs);
+    }
+    printf("  replis sur le tas: %u\n", (unsigned)a.heapFallbacks);
+  }
+  printf("  premier échec: requête %ld\n", firstFail);
+  res.fails = h.fails;
+  return res;
+}
+
+int main(int argc, char **argv) {
+  long count = argc > 1 ? atol(argv[1]) : 1000000;
+  if (count < 10) count = 10;
+  PassResult heap = runPass(false, count);
+  PassResult arena = runPass(true, count);
+  printf("plus grand bloc libre, minimum: tas %zu, arène %zu (seuil %d)\n", heap.minLargest, arena.minLargest,
+         ARENA_LARGEST_MIN);
+  printf("fragmentation max: tas %.1f%%, arène %.1f%%\n", 100 * heap.maxFrag, 100 * arena.maxFrag);
+
+  bool ok = true;
+  if (arena.fails) {
+    printf("ÉCHEC: %zu malloc échoués avec l'arène\n", arena.fails);
+    ok = false;
+  }
+  if (arena.minLargest < ARENA_LARGEST_MIN) {
+    printf("ÉCHEC: plus grand bloc libre sous le seuil avec l'arène\n");
+    ok = false;
+  }
+  if (arena.maxFrag > heap.maxFrag) {
+    printf("ÉCHEC: l'arène fragmente davantage le tas\n");
+    ok = false;
+  }
+  if (!arena.arenaEmpty) {
+    printf("ÉCHEC: zone non rendue vide par reqArenaEnd\n");
+    ok = false;
+  }
+  printf(ok ? "OK\n" : "");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""
+Endurance HTTP de l'ESP32-S3 8DI/8RO: requêtes mêlées et suivi du tas
+- mélange pondéré: /api/status, /api/config (GET + POST sans modification),
+  /api/boot, /relay (lecture), /api/logs, /
+- toutes les --sample requêtes: GET /api/mem (tas libre, plus grand bloc
+  libre, pics de l'arène HTTP par route)
+- échec si une requête échoue, si l'arène a dû se replier sur le tas ou si le
+  plus grand bloc libre descend sous --min-largest
+
+Le POST renvoie la valeur courante de mqtt_queue_drop: validé et appliqué,
+mais rien ne change et aucune écriture flash n'est programmée.
+
+Usage: ESP32_HOST=192.168.1.50 python3 soak_http_memory.py --requests 1000000
+Dépendance: pip install requests
+"""
+
+import argparse
+import os
+import random
+import sys
+import time
+
+import requests
+
+HOST = os.getenv("ESP32_HOST", "192.168.1.50")
+
+# (poids, méthode, chemin)
+MIX = [
+    (50, "GET", "/api/status"),
+    (10, "GET", "/api/config"),
+    (5, "POST", "/api/config"),
+    (5, "GET", "/api/boot"),
+    (20, "GET", "/relay"),
+    (5, "GET", "/api/logs"),
+    (5, "GET", "/"),
+]
+
+
+def sample(session, base):
+    r = session.get(f"{base}/api/mem", timeout=5)
+    r.raise_for_status()
+    return r.json()
+
+
+def show(n, mem, t0):
+    ar = mem.get("arena", {})
+    rate = n / max(time.perf_counter() - t0, 1e-6)
+    print(f"  {n:9d} req ({rate:5.0f}/s): tas libre {mem['heap_free']:6d}, plus grand bloc "
+          f"{mem['heap_largest']:6d}, min {mem['heap_min']:6d}, replis arène {ar.get('heap_fallbacks', 0)}")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default=HOST)
+    ap.add_argument("--requests", type=int, default=1000000)
+    ap.add_argument("--sample", type=int, default=10000)
+    ap.add_argument("--min-largest", type=int, default=32768,
+                    help="plus grand bloc libre minimal accepté (octets)")
+    ap.add_argument("--seed", type=int, default=1)
+    args = ap.parse_args()
+
+    base = f"http://{args.host}"
+    rng = random.Random(args.seed)
+    weights = [w for w, _, _ in MIX]
+    s = requests.Session()
+    drop = s.get(f"{base}/api/config", timeout=5).json().get("mqtt_queue_drop", "oldest")
+
+    first = sample(s, base)
+    show(0, first, time.perf_counter())
+    lowest = first["heap_largest"]
+    errors = 0
+    t0 = time.perf_counter()
+    for n in range(1, args.requests + 1):
+        _, method, path = rng.choices(MIX, weights)[0]
+        try:
+            if method == "POST":
+                r = s.post(f"{base}{path}", json={"mqtt_queue_drop": drop}, timeout=5)
+            else:
+                r = s.get(f"{base}{path}", timeout=5)
+            if r.status_code != 200:
+                errors += 1
+                print(f"✗ #{n} {method} {path}: HTTP {r.status_code} {r.text[:120]}")
+        except requests.RequestException as e:
+            errors += 1
+            print(f"✗ #{n} {method} {path}: {e}")
+        if n % args.sample == 0:
+            mem = sample(s, base)
+            lowest = min(lowest, mem["heap_largest"])
+            show(n, mem, t0)
+
+    mem = sample(s, base)
+    lowest = min(lowest, mem["heap_largest"])
+    ar = mem.get("arena", {})
+    print(f"Arène {ar.get('size')} octets, pics par route:")
+    for rt in ar.get("routes", []):
+        print(f"  {rt['route']:26s} n={rt['n']:8d} pic={rt['peak']:6d} dernier={rt['last']:6d} tas={rt['heap']}")
+    print(f"Plus grand bloc libre: début {first['heap_largest']}, fin {mem['heap_largest']}, plus bas {lowest}")
+
+    ok = errors == 0 and ar.get("heap_fallbacks", 0) == 0 and lowest >= args.min_largest
+    print(("✓ " if ok else "✗ ") + f"{args.requests} requêtes, {errors} erreur(s)")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Payloads Sparkplug B de référence pour test/test_sparkplug
+- encode avec protoc (encodeur de référence) les messages ci-dessous, écrits
+  au format texte protobuf, et les relit (protoc --decode) pour contrôle
+- écrit test/test_sparkplug/golden.h: un tableau d'octets par message
+- le test compare octet par octet NBIRTH/NDATA/NDEATH de sparkplug.h à ces
+  tableaux et passe les NCMD à spParseNcmd()
+
+À relancer après toute modification des métriques (et du test).
+
+Usage: python3 tools/tests/sparkplug_golden.py
+Dépendance: protoc (paquet protobuf-compiler), aucun paquet Python
+"""
+
+import os
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+TEST_DIR = os.path.join(ROOT, "test", "test_sparkplug")
+PROTO = "sparkplug_b.proto"
+TYPE = "org.eclipse.tahu.protobuf.Payload"
+
+
+def metric(name=None, alias=None, datatype=None, **value):
+    fields = []
+    if name is not None:
+        fields.append(f'name: "{name}"')
+    if alias is not None:
+        fields.append(f"alias: {alias}")
+    if datatype is not None:
+        fields.append(f"datatype: {datatype}")
+    for k, v in value.items():
+        if isinstance(v, bool):
+            v = "true" if v else "false"
+        elif isinstance(v, str):
+            v = f'"{v}"'
+        fields.append(f"{k}: {v}")
+    return "metrics { " + " ".join(fields) + " }"
+
+
+BOOLEAN, UINT64, FLOAT, STRING = 11, 8, 9, 12
+RELAYS, INPUTS = 0x05, 0x81
+
+# Mêmes valeurs que test_main.cpp (TS, BD_SEQ, état de la carte)
+BIRTH = ["timestamp: 1700000000000", metric("bdSeq", None, UINT64, long_value=3)]
+BIRTH += [metric(f"Relays/{i}", 1 + i, BOOLEAN, boolean_value=bool(RELAYS >> i & 1)) for i in range(8)]
+BIRTH += [metric(f"Inputs/{i}", 9 + i, BOOLEAN, boolean_value=bool(INPUTS >> i & 1)) for i in range(8)]
+BIRTH += [
+    metric("Sensors/Temperature", 17, FLOAT, float_value=21.5),
+    metric("Sensors/Humidity", 18, FLOAT, is_null=True),
+    metric("System/Uptime", 19, UINT64, long_value=123456),
+    metric("System/IP", 20, STRING, string_value="192.168.1.50"),
+    metric("Node Control/Rebirth", 21, BOOLEAN, boolean_value=False),
+    "seq: 0",
+]
+
+# NDATA: relais 2 et entrée 0 changés, température, uptime périodique
+DATA = [
+    "timestamp: 1700000001000",
+    metric(None, 3, boolean_value=True),
+    metric(None, 9, boolean_value=True),
+    metric(None, 17, float_value=22.25),
+    metric(None, 19, long_value=124456),
+    "seq: 5",
+]
+
+# NDATA: humidité redevenue invalide
+DATA_NULL = ["timestamp: 1700000002000", metric(None, 18, is_null=True), "seq: 6"]
+
+DEATH = [metric("bdSeq", None, UINT64, long_value=7)]
+
+# NCMD tels que les envoie une application hôte (Ignition, Tahu...)
+NCMD_ALIAS = ["timestamp: 1700000003000", metric(None, 3, BOOLEAN, boolean_value=True),
+              metric(None, 8, BOOLEAN, boolean_value=False)]
+NCMD_NAME = ["timestamp: 1700000003000", metric("Relays/2", None, BOOLEAN, boolean_value=True),
+             "metrics { name: \"Relays/5\" timestamp: 1700000003000 datatype: 11 is_transient: true boolean_value: true }"]
+NCMD_REBIRTH = ["timestamp: 1700000003000", metric("Node Control/Rebirth", None, BOOLEAN, boolean_value=True)]
+NCMD_UNKNOWN = ["timestamp: 1700000003000", metric("Relays/9", None, BOOLEAN, boolean_value=True),
+                metric(None, 42, BOOLEAN, boolean_value=True)]
+NCMD_NO_VALUE = [metric(None, 1, STRING, string_value="on")]
+NCMD_MIXED = [metric(None, 1, BOOLEAN, boolean_value=True), metric(None, 17, FLOAT, float_value=1.0),
+              "uuid: \"x\"", "body: \"\\001\\002\""]
+
+MESSAGES = [
+    ("GOLDEN_NBIRTH", BIRTH),
+    ("GOLDEN_NDATA", DATA),
+    ("GOLDEN_NDATA_NULL", DATA_NULL),
+    ("GOLDEN_NDEATH", DEATH),
+    ("GOLDEN_NCMD_ALIAS", NCMD_ALIAS),
+    ("GOLDEN_NCMD_NAME", NCMD_NAME),
+    ("GOLDEN_NCMD_REBIRTH", NCMD_REBIRTH),
+    ("GOLDEN_NCMD_UNKNOWN", NCMD_UNKNOWN),
+    ("GOLDEN_NCMD_NO_VALUE", NCMD_NO_VALUE),
+    ("GOLDEN_NCMD_MIXED", NCMD_MIXED),
+]
+
+
+def protoc(mode, data):
+    r = subprocess.run(["protoc", f"--{mode}={TYPE}", PROTO], input=data, cwd=TEST_DIR,
+                       stdout=subprocess.PIPE, check=True)
+    return r.stdout
+
+
+def c_array(name, text, data):
+    lines = [f"// {line}" for line in text.strip().splitlines()]
+    lines.append(f"static const uint8_t {name}[] = {{")
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def main():
+    blocks = []
+    for name, fields in MESSAGES:
+        text = "\n".join(fields) + "\n"
+        data = protoc("encode", text.encode())
+        decoded = protoc("decode", data).decode()
+        blocks.append(c_array(name, decoded, data))
+        print(f"✓ {name}: {len(data)} octets")
+
+    header = [
+        "// Généré par tools/tests/sparkplug_golden.py (protoc), ne pas modifier.",
+        "// Au-dessus de chaque tableau: le message relu par protoc --decode.",
+        "#ifndef SPARKPLUG_GOLDEN_H",
+        "#define SPARKPLUG_GOLDEN_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "\n\n".join(blocks),
+        "",
+        "#endif // SPARKPLUG_GOLDEN_H",
+        "",
+    ]
+    with open(os.path.join(TEST_DIR, "golden.h"), "w") as f:
+        f.write("\n".join(header))
+    print(f"✓ {os.path.relpath(os.path.join(TEST_DIR, 'golden.h'), ROOT)}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
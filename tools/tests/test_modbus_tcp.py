@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""
+Test Modbus TCP de l'ESP32-S3 8DI/8RO (port 502)
+- vérifie coils / entrées / registres / écritures multiples
+- mesure le débit de scrutation FC01/FC02
+
+Usage: MODBUS_HOST=192.168.1.50 python3 test_modbus_tcp.py
+Dépendance: pip install pymodbus  (API 3.x)
+"""
+
+import os
+import sys
+import time
+
+from pymodbus.client import ModbusTcpClient
+
+HOST = os.getenv("MODBUS_HOST", "192.168.1.50")
+PORT = int(os.getenv("MODBUS_PORT", "502"))
+POLLS = int(os.getenv("MODBUS_POLLS", "2000"))
+
+
+def check(cond, label):
+    print(("✓ " if cond else "✗ ") + label)
+    return bool(cond)
+
+
+def main():
+    client = ModbusTcpClient(HOST, port=PORT, timeout=2)
+    if not client.connect():
+        print(f"✗ Connexion impossible à {HOST}:{PORT}")
+        return 1
+    print(f"✓ Connecté à {HOST}:{PORT}")
+
+    ok = True
+    saved = client.read_coils(0, count=8).bits[:8]
+
+    # FC0F: écriture multiple (un seul accès TCA9554 côté carte)
+    pattern = [True, False, True, False, False, True, False, True]
+    ok &= check(not client.write_coils(0, pattern).isError(), "FC0F écriture 8 coils")
+    ok &= check(client.read_coils(0, count=8).bits[:8] == pattern, "FC01 relecture des coils")
+
+    # FC05 / FC03 / FC10: masque relais en holding register 0
+    ok &= check(not client.write_coil(1, True).isError(), "FC05 coil 1 ON")
+    hr = client.read_holding_registers(0, count=1)
+    ok &= check(not hr.isError() and hr.registers[0] == 0xA7, f"FC03 masque relais = 0x{hr.registers[0]:02X}")
+    ok &= check(not client.write_registers(0, [0x00]).isError(), "FC10 masque relais = 0x00")
+    ok &= check(client.read_coils(0, count=8).bits[:8] == [False] * 8, "FC01 tous relais OFF")
+
+    # FC02 / FC04: entrées et capteurs (adresses historiques 10000 / 30000 acceptées)
+    di = client.read_discrete_inputs(0, count=8)
+    ok &= check(not di.isError(), f"FC02 entrées {di.bits[:8]}")
+    ok &= check(client.read_discrete_inputs(10000, count=8).bits[:8] == di.bits[:8], "FC02 alias 10000")
+    ir = client.read_input_registers(30000, count=2)
+    ok &= check(not ir.isError(), f"FC04 registres {ir.registers}")
+
+    # Exceptions attendues
+    ok &= check(client.read_coils(6, count=4).isError(), "FC01 hors plage -> exception")
+
+    # Débit de scrutation FC01/FC02
+    t0 = time.perf_counter()
+    for i in range(POLLS):
+        if i & 1:
+            client.read_coils(0, count=8)
+        else:
+            client.read_discrete_inputs(0, count=8)
+    dt = time.perf_counter() - t0
+    print(f"Débit FC01/FC02: {POLLS / dt:.0f} req/s ({dt / POLLS * 1000:.2f} ms/req)")
+
+    client.write_coils(0, saved)
+    client.close()
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
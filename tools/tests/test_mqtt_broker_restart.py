@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+"""
+Coupure du broker pendant une rafale d'entrées (file store-and-forward MQTT)
+- lance un broker MQTT 3.1.1 minimal sur ce PC (bibliothèque standard seule)
+- provoque une rafale de fronts d'entrée: bascule --relay par HTTP
+  (/relay?num=N&action=toggle), le contact du relais étant câblé sur
+  l'entrée --input; avec --manual, basculer l'entrée à la main
+- au milieu de la rafale, tue le broker (connexions coupées par RST),
+  le laisse arrêté --down s puis le relance sur le même port
+- attend le rejeu de la file, puis vérifie sur waveshare/input/event:
+  ordre (ts croissant), pertes (chaque événement: inputs = précédent XOR
+  changed), doublons, nombre de fronts = nombre de bascules
+- relève mqtt_queue (/api/status) avant et après
+
+Prérequis: serveur MQTT de la carte = IP de ce PC, port --port
+(configure_mqtt.py ou /api/config), relais --relay câblé sur l'entrée --input.
+Ne modifie pas la config; le relais est remis dans son état initial.
+
+Usage: ESP32_HOST=192.168.1.50 python3 test_mqtt_broker_restart.py --count 200 --down 5
+Dépendance: pip install requests
+"""
+
+import argparse
+import json
+import os
+import select
+import socket
+import struct
+import sys
+import threading
+import time
+
+import requests
+
+HOST = os.getenv("ESP32_HOST", "192.168.1.50")
+EVENT_TOPIC = "waveshare/input/event"
+
+
+# ----- Broker minimal (QoS 0/1, sans rétention ni session) -----
+class MiniBroker:
+    def __init__(self, port):
+        self.port = port
+        self.lock = threading.Lock()
+        self.events = []            # (arrivée, payload) sur EVENT_TOPIC
+        self.connects = 0
+        self.server = None
+        self.clients = []
+        self.running = False
+
+    def start(self):
+        self.server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.server.bind(("0.0.0.0", self.port))
+        self.server.listen(8)
+        self.running = True
+        threading.Thread(target=self._accept, args=(self.server,), daemon=True).start()
+
+    # Arrêt brutal: plus d'écoute, connexions fermées par RST (SO_LINGER 0)
+    def kill(self):
+        self.running = False
+        try:
+            self.server.close()
+        except OSError:
+            pass
+        with self.lock:
+            clients, self.clients = self.clients, []
+        for c in clients:
+            try:
+                c.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER, struct.pack("ii", 1, 0))
+                c.close()
+            except OSError:
+                pass
+
+    def _accept(self, server):
+        while self.running:
+            try:
+                c, _ = server.accept()
+            except OSError:
+                return
+            c.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+            with self.lock:
+                self.clients.append(c)
+            threading.Thread(target=self._client, args=(c,), daemon=True).start()
+
+    @staticmethod
+    def _read_packet(buf):
+        # -> (type, flags, corps, reste) ou None si incomplet
+        if len(buf) < 2:
+            return None
+        mult, length, i = 1, 0, 1
+        while True:
+            if i >= len(buf):
+                return None
+            b = buf[i]
+            length += (b & 0x7F) * mult
+            mult *= 128
+            i += 1
+            if not b & 0x80:
+                break
+        if len(buf) < i + length:
+            return None
+        return buf[0] >> 4, buf[0] & 0x0F, buf[i:i + length], buf[i + length:]
+
+    def _client(self, c):
+        buf = b""
+        try:
+            while self.running:
+                r, _, _ = select.select([c], [], [], 0.5)
+                if not r:
+                    continue
+                data = c.recv(4096)
+                if not data:
+                    break
+                buf += data
+                while True:
+                    p = self._read_packet(buf)
+                    if p is None:
+                        break
+                    ptype, flags, body, buf = p
+                    self._handle(c, ptype, flags, body)
+        except OSError:
+            pass
+        finally:
+            with self.lock:
+                if c in self.clients:
+                    self.clients.remove(c)
+            try:
+                c.close()
+            except OSError:
+                pass
+
+    def _handle(self, c, ptype, flags, body):
+        if ptype == 1:                                   # CONNECT
+            with self.lock:
+                self.connects += 1
+            c.sendall(b"\x20\x02\x00\x00")
+        elif ptype == 8:                                 # SUBSCRIBE
+            pid = body[:2]
+            i, granted = 2, b""
+            while i + 2 <= len(body):
+                i += 2 + struct.unpack(">H", body[i:i + 2])[0] + 1
+                granted += b"\x00"
+            c.sendall(bytes([0x90, 2 + len(granted)]) + pid + granted)
+        elif ptype == 3:                                 # PUBLISH
+            qos = (flags >> 1) & 3
+            n = struct.unpack(">H", body[:2])[0]
+            topic = body[2:2 + n].decode(errors="replace")
+            i = 2 + n
+            if qos:
+                pid = body[i:i + 2]
+                i += 2
+                c.sendall(b"\x40\x02" + pid)
+            if topic == EVENT_TOPIC:
+                with self.lock:
+                    self.events.append((time.monotonic(), body[i:]))
+        elif ptype == 12:                                # PINGREQ
+            c.sendall(b"\xd0\x00")
+        elif ptype == 14:                                # DISCONNECT
+            raise OSError("disconnect")
+
+
+def status(session, base):
+    try:
+        r = session.get(f"{base}/api/status", timeout=3)
+        r.raise_for_status()
+        return r.json()
+    except (requests.RequestException, ValueError):
+        return {}
+
+
+def check(cond, label):
+    print(("✓ " if cond else "✗ ") + label)
+    return bool(cond)
+
+
+def analyse(events, input_bit):
+    """Ordre, doublons et pertes sur la suite des événements d'entrée."""
+    out = {"events": 0, "order": 0, "dupes": 0, "gaps": 0, "edges": 0, "bad": 0}
+    prev = None
+    seen = set()
+    for _, raw in events:
+        try:
+            ev = json.loads(raw)
+            ts = int(ev["ts"])
+            bits = sum((1 << i) for i, v in enumerate(ev["inputs"]) if v)
+            changed = int(ev["changed"])
+        except (ValueError, KeyError, TypeError):
+            out["bad"] += 1
+            continue
+        out["events"] += 1
+        if (ts, bits) in seen:
+            out["dupes"] += 1
+            continue
+        seen.add((ts, bits))
+        if changed & input_bit:
+            out["edges"] += 1
+        if prev is not None:
+            if ts < prev[0]:
+                out["order"] += 1
+            elif prev[1] ^ changed != bits:
+                out["gaps"] += 1                         # au moins un événement manquant
+        prev = (ts, bits)
+    return out
+
+
+# Nouveau broker sur le même port; reçus et compteurs conservés
+def restart(broker):
+    nb = MiniBroker(broker.port)
+    nb.events, nb.connects = broker.events, broker.connects
+    nb.start()
+    print(f"  broker relancé ({len(nb.events)} événements reçus)")
+    return nb
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default=HOST)
+    ap.add_argument("--port", type=int, default=1883, help="port du broker local")
+    ap.add_argument("--relay", type=int, default=1, help="relais câblé sur l'entrée (1..8)")
+    ap.add_argument("--input", type=int, default=1, help="entrée pilotée (1..8)")
+    ap.add_argument("--count", type=int, default=200, help="bascules de la rafale")
+    ap.add_argument("--period", type=float, default=0.1, help="intervalle entre bascules (s, >= 0.06)")
+    ap.add_argument("--down", type=float, default=5.0, help="durée d'arrêt du broker (s)")
+    ap.add_argument("--drain", type=float, default=30.0, help="attente max du rejeu après la rafale (s)")
+    ap.add_argument("--manual", action="store_true", help="pas de pilotage HTTP: basculer l'entrée à la main")
+    args = ap.parse_args()
+
+    base = f"http://{args.host}"
+    s = requests.Session()
+    broker = MiniBroker(args.port)
+    broker.start()
+    print(f"Broker local sur le port {args.port}, attente de la carte...")
+    t0 = time.monotonic()
+    while broker.connects == 0 and time.monotonic() - t0 < 60:
+        time.sleep(0.2)
+    if not check(broker.connects > 0, "carte connectée au broker local"):
+        return 1
+    time.sleep(1.0)
+
+    before = status(s, base)
+    kill_at = args.count // 2
+    toggles, restarts = 0, 0
+    duration = args.count * args.period
+    print(f"Rafale: {args.count} bascules toutes les {args.period * 1000:.0f} ms, "
+          f"broker tué à la bascule {kill_at} pendant {args.down:.1f} s")
+
+    start = time.monotonic()
+    killed_at = None
+    for k in range(args.count):
+        if k == kill_at:
+            broker.kill()
+            killed_at = time.monotonic()
+            print(f"  broker tué ({len(broker.events)} événements reçus)")
+        if killed_at is not None and restarts == 0 and time.monotonic() - killed_at >= args.down:
+            broker = restart(broker)
+            restarts += 1
+        if args.manual:
+            time.sleep(args.period)
+            continue
+        t = time.monotonic()
+        try:
+            s.get(f"{base}/relay", params={"num": args.relay, "action": "toggle"}, timeout=2)
+            toggles += 1
+        except requests.RequestException as e:
+            print(f"✗ bascule {k}: {e}")
+        time.sleep(max(0.0, args.period - (time.monotonic() - t)))
+    if restarts == 0:
+        time.sleep(max(0.0, args.down - (time.monotonic() - killed_at)))
+        broker = restart(broker)
+    burst_s = time.monotonic() - start
+
+    # Rejeu: attendre que la file de la carte soit vide et que plus rien n'arrive
+    t0 = time.monotonic()
+    last_n, stable_since = -1, time.monotonic()
+    while time.monotonic() - t0 < args.drain:
+        q = status(s, base).get("mqtt_queue", {})
+        n = len(broker.events)
+        if n != last_n:
+            last_n, stable_since = n, time.monotonic()
+        if q and q.get("ram", 1) == 0 and q.get("flash", 1) == 0 and time.monotonic() - stable_since > 2:
+            break
+        time.sleep(0.5)
+
+    if toggles % 2:                                      # relais remis dans son état initial
+        s.get(f"{base}/relay", params={"num": args.relay, "action": "toggle"}, timeout=2)
+
+    after = status(s, base)
+    qb, qa = before.get("mqtt_queue", {}), after.get("mqtt_queue", {})
+    with broker.lock:
+        events = list(broker.events)
+    r = analyse(events, 1 << (args.input - 1))
+    print(f"Rafale {burst_s:.1f} s (prévue {duration:.1f} s), connexions au broker: {broker.connects}")
+    print(f"mqtt_queue: rejoués {qa.get('replayed', 0) - qb.get('replayed', 0)}, "
+          f"jetés {qa.get('dropped', 0) - qb.get('dropped', 0)}, "
+          f"erreurs flash {qa.get('flash_errors', 0) - qb.get('flash_errors', 0)}, flash {qa.get('flash_state', '?')}")
+
+    ok = True
+    ok &= check(broker.connects >= 2, f"reconnexion après redémarrage ({broker.connects} CONNECT)")
+    ok &= check(r["bad"] == 0, f"{r['events']} événements reçus, {r['bad']} illisibles")
+    ok &= check(r["order"] == 0, f"ordre: {r['order']} inversion(s) de ts")
+    ok &= check(r["dupes"] == 0, f"doublons: {r['dupes']}")
+    ok &= check(r["gaps"] == 0, f"pertes: {r['gaps']} rupture(s) de la chaîne inputs/changed")
+    if not args.manual:
+        ok &= check(r["edges"] == toggles, f"fronts de l'entrée {args.input}: {r['edges']} / {toggles} bascules")
+    ok &= check(qa.get("dropped", 0) == qb.get("dropped", 0), "aucun message jeté par la file")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+Liens directs entre cartes (src/peer_link.h) sans matériel: deux builds PC
+du moteur l'un contre l'autre en UDP sur la boucle locale
+- compile tools/tests/peer_link_host.cpp (g++) avec les en-têtes de src/
+- B (récepteur) démarre, A (émetteur) envoie --changes changements d'entrée,
+  chacun attendant l'ACK du précédent
+- vérifie: un ACK par changement, latence changement d'entrée -> ACK
+  (moyenne et maximum), puis repli de B environ TIMEOUT_MS (1,5 s) après
+  le dernier LINK de A
+
+Usage: python3 tools/tests/test_peer_link_loopback.py --changes 1000
+Dépendance: g++ (aucun paquet Python)
+"""
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+SOURCE = os.path.join(ROOT, "tools", "tests", "peer_link_host.cpp")
+TIMEOUT_MS = 1500                   # TIMEOUT_MS de peer_link_host.cpp
+
+
+def check(cond, label):
+    print(("✓ " if cond else "✗ ") + label)
+    return bool(cond)
+
+
+def fields(line):
+    return dict(kv.split("=", 1) for kv in line.split() if "=" in kv)
+
+
+def build(out_dir):
+    exe = os.path.join(out_dir, "peer_link_host")
+    cxx = os.getenv("CXX", "g++")
+    cmd = [cxx, "-std=gnu++17", "-O2", "-Wall", "-I", os.path.join(ROOT, "src"), SOURCE, "-o", exe]
+    subprocess.run(cmd, check=True)
+    return exe
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--changes", type=int, default=1000)
+    ap.add_argument("--port", type=int, default=47000, help="port de A (B: port + 1)")
+    ap.add_argument("--max-avg-us", type=float, default=1000.0, help="latence moyenne maximale admise")
+    args = ap.parse_args()
+
+    if not shutil.which(os.getenv("CXX", "g++")):
+        print("✗ g++ introuvable")
+        return 1
+
+    with tempfile.TemporaryDirectory() as tmp:
+        exe = build(tmp)
+        port_a, port_b = args.port, args.port + 1
+        receiver = subprocess.Popen([exe, "receiver", str(port_b), str(port_a)], stdout=subprocess.PIPE, text=True)
+        try:
+            sender = subprocess.run([exe, "sender", str(port_a), str(port_b), str(args.changes)],
+                                    stdout=subprocess.PIPE, text=True, timeout=60)
+            out_b, _ = receiver.communicate(timeout=60)
+        finally:
+            if receiver.poll() is None:
+                receiver.kill()
+
+    print(sender.stdout.strip())
+    a = fields(sender.stdout.strip().splitlines()[-1])
+    b = fields(out_b.strip().splitlines()[-1]) if out_b.strip() else {}
+    print(f"[B] {out_b.strip()}")
+
+    ok = True
+    changes = int(a.get("changes", 0))
+    ok &= check(sender.returncode == 0 and changes == args.changes, f"A: {changes}/{args.changes} changements envoyés")
+    ok &= check(int(a.get("acks", 0)) == changes, f"A: {a.get('acks')} ACK mesurés (un par changement)")
+    avg, mx = int(a.get("avg_us", 0)), int(a.get("max_us", 0))
+    ok &= check(0 < avg <= args.max_avg_us, f"A: latence entrée -> ACK moyenne {avg} us, max {mx} us")
+    print(f"  envois {a.get('sent')}, retransmissions {a.get('retransmits')}")
+    ok &= check(int(b.get("links", 0)) >= changes, f"B: {b.get('links')} LINK acceptés, {b.get('replays', 0)} rejeux")
+    after = int(b.get("failsafe_after_ms", 0))
+    ok &= check(b.get("failsafe") == "1" and TIMEOUT_MS <= after <= TIMEOUT_MS + 200,
+                f"B: repli {after} ms après le dernier LINK (délai {TIMEOUT_MS} ms), relais {b.get('relays')}")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
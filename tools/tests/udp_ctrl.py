@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""
+Protocole UDP binaire de l'ESP32-S3 8DI/8RO (src/udp_ctrl.h): les deux bouts.
+
+- bench: envoie des commandes relais et mesure l'aller-retour CMD -> ACK
+- listen: affiche les datagrammes d'état reçus sur le groupe multicast
+- device: carte simulée (ACK + état périodique / sur changement), pour
+  mesurer le protocole seul sur la boucle locale
+
+Usage:
+  UDP_KEY=secret python3 udp_ctrl.py device --group 239.255.8.8
+  UDP_KEY=secret python3 udp_ctrl.py bench --host 127.0.0.1 --count 5000
+  UDP_KEY=secret python3 udp_ctrl.py bench --host 192.168.1.50
+  UDP_KEY=secret python3 udp_ctrl.py listen
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import socket
+import struct
+import sys
+import time
+
+VERSION = 1
+CMD, ACK, STATE = 1, 2, 3
+OK, REPLAY, FULL = 0, 1, 2
+STATUS_NAMES = {REPLAY: "rejeu", FULL: "table des émetteurs pleine"}
+HDR = struct.Struct(">2sBBI")
+TAG_LEN = 16
+SENSOR_INVALID = -0x8000
+
+KEY = os.getenv("UDP_KEY", "").encode()
+
+
+def seal(key, typ, seq, payload):
+    body = HDR.pack(b"W8", VERSION, typ, seq) + payload
+    return body + hmac.new(key, body, hashlib.sha256).digest()[:TAG_LEN]
+
+
+def unseal(key, data, typ, payload_len):
+    if len(data) != HDR.size + payload_len + TAG_LEN:
+        return None
+    magic, ver, t, seq = HDR.unpack_from(data)
+    if magic != b"W8" or ver != VERSION or t != typ:
+        return None
+    tag = hmac.new(key, data[:-TAG_LEN], hashlib.sha256).digest()[:TAG_LEN]
+    if not hmac.compare_digest(tag, data[-TAG_LEN:]):
+        return None
+    return seq, data[HDR.size:-TAG_LEN]
+
+
+def encode_state(key, seq, relays, inputs, reason, temp_x10, hum_x10, uptime_ms):
+    return seal(key, STATE, seq, struct.pack(">BBBxhhI", relays, inputs, reason, temp_x10, hum_x10, uptime_ms))
+
+
+def decode_state(key, data):
+    r = unseal(key, data, STATE, 12)
+    if r is None:
+        return None
+    seq, p = r
+    relays, inputs, reason, temp, hum, uptime = struct.unpack(">BBBxhhI", p)
+    return seq, relays, inputs, reason, temp, hum, uptime
+
+
+def first_seq():
+    # Croissant entre deux lancements (anti-rejeu côté carte)
+    return (int(time.time()) << 12) & 0xFFFFFFFF
+
+
+def mcast_socket(group, port):
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind(("", port))
+    mreq = struct.pack("4s4s", socket.inet_aton(group), socket.inet_aton("0.0.0.0"))
+    s.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+    return s
+
+
+def run_device(args):
+    """Carte simulée: même logique que udpCtrlService() dans main.cpp."""
+    rx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    rx.bind(("", args.port))
+    tx = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    tx.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+    tx.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    relays, inputs, seq = 0, 0x05, 0
+    peers = {}
+    start = time.monotonic()
+    last_state = 0.0
+    print(f"Carte simulée: commandes sur :{args.port}, état -> {args.group}:{args.state_port}", flush=True)
+
+    def send_state(reason):
+        nonlocal seq
+        seq = (seq + 1) & 0xFFFFFFFF
+        up = int((time.monotonic() - start) * 1000) & 0xFFFFFFFF
+        tx.sendto(encode_state(KEY, seq, relays, inputs, reason, 215, 480, up), (args.group, args.state_port))
+
+    while True:
+        wait = last_state + args.state_ms / 1000.0 - time.monotonic()
+        data = None
+        if wait > 0:
+            rx.settimeout(wait)
+            try:
+                data, addr = rx.recvfrom(64)
+            except socket.timeout:
+                pass
+        if data is None:
+            send_state(0)
+            last_state = time.monotonic()
+            continue
+        r = unseal(KEY, data, CMD, 2)
+        if r is None:
+            continue
+        cseq, p = r
+        mask, values = p[0], p[1]
+        status = OK
+        old = relays
+        if cseq <= peers.get(addr[0], -1):
+            status = REPLAY
+        else:
+            peers[addr[0]] = cseq
+            relays = (relays & ~mask | values & mask) & 0xFF
+        rx.sendto(seal(KEY, ACK, cseq, bytes([status, relays, inputs])), addr)
+        if status == OK and relays != old:
+            send_state(1)
+
+
+def run_bench(args):
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    s.settimeout(args.timeout_ms / 1000.0)
+    seq = first_seq()
+    rtts = []
+    lost = 0
+    for i in range(args.count):
+        seq = (seq + 1) & 0xFFFFFFFF
+        values = 0x01 if i & 1 else 0x00
+        pkt = seal(KEY, CMD, seq, bytes([args.mask, values & args.mask]))
+        t0 = time.perf_counter()
+        s.sendto(pkt, (args.host, args.port))
+        while True:
+            try:
+                data, _ = s.recvfrom(64)
+            except socket.timeout:
+                lost += 1
+                break
+            r = unseal(KEY, data, ACK, 3)
+            if r is None or r[0] != seq:
+                continue  # ACK retardataire d'une commande précédente
+            if r[1][0] != OK:
+                print(f"✗ statut {r[1][0]} (seq {seq} refusé: {STATUS_NAMES.get(r[1][0], '?')})")
+                return 1
+            rtts.append((time.perf_counter() - t0) * 1e6)
+            break
+    if not rtts:
+        print(f"✗ aucun ACK de {args.host}:{args.port} (clé? udp_enabled?)")
+        return 1
+    rtts.sort()
+    pct = lambda q: rtts[min(len(rtts) - 1, int(q * len(rtts)))]
+    print(f"✓ {len(rtts)} ACK / {args.count} commandes, {lost} perdue(s)")
+    print(f"  RTT µs: min {rtts[0]:.0f}  p50 {pct(0.5):.0f}  p99 {pct(0.99):.0f}  max {rtts[-1]:.0f}")
+    return 0
+
+
+def run_listen(args):
+    s = mcast_socket(args.group, args.state_port)
+    last = None
+    while True:
+        data, addr = s.recvfrom(64)
+        st = decode_state(KEY, data)
+        if st is None:
+            print(f"✗ datagramme rejeté de {addr[0]} ({len(data)} octets)")
+            continue
+        seq, relays, inputs, reason, temp, hum, up = st
+        gap = "" if last is None or seq == last + 1 else f"  (saut de {seq - last - 1})"
+        last = seq
+        t = "--" if temp == SENSOR_INVALID else f"{temp / 10:.1f}"
+        h = "--" if hum == SENSOR_INVALID else f"{hum / 10:.1f}"
+        print(f"{addr[0]} seq={seq} {'chg' if reason else 'per'} relais=0x{relays:02X} "
+              f"entrées=0x{inputs:02X} T={t} H={h} up={up / 1000:.1f}s{gap}", flush=True)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("mode", choices=["bench", "listen", "device"])
+    ap.add_argument("--host", default=os.getenv("ESP32_HOST", "192.168.1.50"))
+    ap.add_argument("--port", type=int, default=5005, help="port des commandes")
+    ap.add_argument("--group", default="239.255.8.8")
+    ap.add_argument("--state-port", type=int, default=5006)
+    ap.add_argument("--state-ms", type=int, default=1000)
+    ap.add_argument("--count", type=int, default=1000)
+    ap.add_argument("--mask", type=lambda v: int(v, 0), default=0x01, help="relais commutés par le banc")
+    ap.add_argument("--timeout-ms", type=int, default=200)
+    args = ap.parse_args()
+    if not KEY:
+        print("✗ UDP_KEY non défini")
+        return 1
+    return {"bench": run_bench, "listen": run_listen, "device": run_device}[args.mode](args) or 0
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main())
+    except KeyboardInterrupt:
+        sys.exit(0)